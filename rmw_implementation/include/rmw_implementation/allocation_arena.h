@@ -0,0 +1,221 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__ALLOCATION_ARENA_H_
+#define RMW_IMPLEMENTATION__ALLOCATION_ARENA_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcutils/allocator.h"
+
+#include "rmw/types.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_runtime_c/sequence_bound.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+typedef struct rmw_implementation_allocation_arena_impl_s
+  rmw_implementation_allocation_arena_impl_t;
+
+/// Arena of preallocated publisher and subscription allocations.
+/**
+ * Allocations are initialized once per publisher or subscription, with
+ * rmw_init_publisher_allocation() or rmw_init_subscription_allocation(), and
+ * kept until released or until the arena is finalized, so that these can be
+ * set up ahead of publishing and taking messages.
+ * Publishers and subscriptions do not share allocations, as rmw
+ * implementations that preallocate use these as scratch memory, which
+ * concurrent calls must not share either: an allocation must only be used by
+ * one rmw_publish() or rmw_take() call at a time.
+ * Entities are told apart by address, hence the allocations of an entity must
+ * be released with rmw_implementation_allocation_arena_release() before the
+ * entity is destroyed, lest an entity created later at the same address get
+ * them. The memory of released allocations is reused for later ones.
+ * rmw implementations that do not support preallocation get `NULL`
+ * allocations, which are valid allocations for rmw_publish() and rmw_take().
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_allocation_arena_s
+{
+  /// Implementation defined state of the arena.
+  rmw_implementation_allocation_arena_impl_t * impl;
+} rmw_implementation_allocation_arena_t;
+
+/// Return a zero initialized allocation arena.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_allocation_arena_t
+rmw_implementation_get_zero_initialized_allocation_arena(void);
+
+/// Initialize an allocation arena.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] arena zero initialized arena to initialize.
+ * \param[in] allocator allocator used for the arena.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is already initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_allocation_arena_init(
+  rmw_implementation_allocation_arena_t * arena,
+  const rcutils_allocator_t * allocator);
+
+/// Finalize an allocation arena and all its allocations.
+/**
+ * Allocations are finalized with rmw_fini_publisher_allocation() or
+ * rmw_fini_subscription_allocation(), and must no longer be in use.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] arena arena to finalize, zero initialized when done.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is not initialized, or
+ * \return an error returned when finalizing the first allocation that fails to.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_allocation_arena_fini(rmw_implementation_allocation_arena_t * arena);
+
+/// Release the allocations of an arena for a publisher or a subscription.
+/**
+ * Allocations are finalized with rmw_fini_publisher_allocation() or
+ * rmw_fini_subscription_allocation(), and must no longer be in use.
+ * This must be called before destroying the publisher or subscription.
+ * Releasing an entity the arena has no allocations for has no effect.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] arena arena to release the allocations from.
+ * \param[in] entity publisher or subscription to release the allocations of.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `entity` is NULL, or
+ * \return an error returned when finalizing the first allocation that fails to.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_allocation_arena_release(
+  rmw_implementation_allocation_arena_t * arena,
+  const void * entity);
+
+/// Get the allocation of an arena for a publisher.
+/**
+ * The allocation is initialized on first use for the publisher, type support
+ * and message bounds, and the same allocation is returned afterwards.
+ * It must not be used by concurrent calls, even with the same publisher.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Only on first use for the publisher
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] arena arena to get the allocation from.
+ * \param[in] publisher publisher to publish messages with.
+ * \param[in] type_support type support of the messages to publish.
+ * \param[in] message_bounds bounds of the messages to publish, may be NULL.
+ * \param[out] allocation allocation to publish messages with, set to `NULL` if
+ *   the rmw implementation does not support publisher allocations.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `publisher` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `type_support` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocation` is NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_init_publisher_allocation() other than
+ *   `RMW_RET_UNSUPPORTED`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_allocation_arena_get_publisher_allocation(
+  rmw_implementation_allocation_arena_t * arena,
+  const rmw_publisher_t * publisher,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_publisher_allocation_t ** allocation);
+
+/// Get the allocation of an arena for a subscription.
+/**
+ * The allocation is initialized on first use for the subscription, type
+ * support and message bounds, and the same allocation is returned afterwards.
+ * It must not be used by concurrent calls, even with the same subscription.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Only on first use for the subscription
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] arena arena to get the allocation from.
+ * \param[in] subscription subscription to take messages with.
+ * \param[in] type_support type support of the messages to take.
+ * \param[in] message_bounds bounds of the messages to take, may be NULL.
+ * \param[out] allocation allocation to take messages with, set to `NULL` if
+ *   the rmw implementation does not support subscription allocations.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `arena` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `subscription` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `type_support` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocation` is NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_init_subscription_allocation() other than
+ *   `RMW_RET_UNSUPPORTED`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_allocation_arena_get_subscription_allocation(
+  rmw_implementation_allocation_arena_t * arena,
+  const rmw_subscription_t * subscription,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_subscription_allocation_t ** allocation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__ALLOCATION_ARENA_H_
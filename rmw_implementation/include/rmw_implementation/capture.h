@@ -0,0 +1,271 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__CAPTURE_H_
+#define RMW_IMPLEMENTATION__CAPTURE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/serialized_message.h"
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Environment variable enabling capture from rmw_init() on, to the file it is set to.
+#define RMW_IMPLEMENTATION_CAPTURE_ENV_VAR "RMW_IMPLEMENTATION_CAPTURE"
+
+/// Options of message capture.
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_capture_options_s
+{
+  /// Size the capture file is mapped with, in bytes.
+  /**
+   * Messages captured once the file is full are dropped.
+   */
+  size_t max_file_size;
+  /// Size of the buffer of each thread capturing messages, in bytes.
+  /**
+   * Sizes are rounded up to a power of two.
+   * Messages captured while the buffer of the thread is full, i.e. faster
+   * than it is written out, are dropped.
+   * Buffers are allocated on the first message each thread captures, and
+   * allocated anew on the first one after capture is enabled with another
+   * size.
+   */
+  size_t thread_buffer_size;
+} rmw_implementation_capture_options_t;
+
+/// Return the default options of message capture.
+/**
+ * The capture file is mapped with 64 MiB, and thread buffers are 1 MiB each.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_capture_options_t
+rmw_implementation_get_default_capture_options(void);
+
+/// Start capturing serialized messages published and taken to a file.
+/**
+ * Calls to rmw_publish_serialized_message(), rmw_take_serialized_message() and
+ * rmw_take_serialized_message_with_info() are forwarded to the rmw
+ * implementation through a capture layer until capture is disabled, or the
+ * rmw implementation is unloaded.
+ * Messages successfully published or taken are copied, along with their topic
+ * name and the system time, to a buffer of the calling thread, which does not
+ * lock nor allocate once the buffer of the thread is allocated.
+ * A background thread periodically writes buffers out to the file, which is
+ * memory mapped, and updates its header so that the file can still be read
+ * should the process crash.
+ * When capture is disabled, calls are forwarded as they would be otherwise.
+ *
+ * Capture can also be enabled from rmw_init() on, with default options, by
+ * setting the `RMW_IMPLEMENTATION_CAPTURE` environment variable to the path
+ * of the file to capture to.
+ *
+ * Capture files can be read with rmw_implementation_capture_reader_init().
+ * Capture is only supported on POSIX systems.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] file_path path of the file to capture to, which is overwritten.
+ * \param[in] options options of capture, or `NULL` for default options.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `file_path` is `NULL`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `max_file_size` cannot hold the file header, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `thread_buffer_size` is zero or too large, or
+ * \return `RMW_RET_ERROR` if capture is already enabled, or
+ * \return `RMW_RET_ERROR` if the file cannot be created and mapped, or
+ * \return `RMW_RET_ERROR` if the rmw implementation could not be loaded, or
+ * \return `RMW_RET_UNSUPPORTED` if capture is not supported on this system.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_capture_enable(
+  const char * file_path,
+  const rmw_implementation_capture_options_t * options);
+
+/// Stop capturing serialized messages.
+/**
+ * Buffers of all threads are written out, and the file is truncated to the
+ * messages it holds before being closed.
+ *
+ * Disabling capture when not enabled has no effect.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_ERROR` if the file could not be written out.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_capture_disable(void);
+
+/// Check whether serialized messages are being captured.
+RMW_IMPLEMENTATION_PUBLIC
+bool
+rmw_implementation_capture_is_enabled(void);
+
+/// Statistics of the last capture.
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_capture_stats_s
+{
+  /// Number of messages written to the capture file.
+  uint64_t record_count;
+  /// Number of messages dropped, as thread buffers or the file were full.
+  uint64_t dropped_count;
+  /// Size of the messages written to the capture file, in bytes.
+  uint64_t byte_count;
+} rmw_implementation_capture_stats_t;
+
+/// Get statistics of the current capture, or of the last one if disabled.
+/**
+ * Statistics only account for buffers as last written out, see
+ * rmw_implementation_capture_enable().
+ *
+ * \param[out] stats statistics to fill.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stats` is `NULL`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_capture_get_stats(rmw_implementation_capture_stats_t * stats);
+
+/// Whether a captured message was published or taken.
+typedef enum RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_capture_direction_e
+{
+  /// Published with rmw_publish_serialized_message().
+  RMW_IMPLEMENTATION_CAPTURE_PUBLISHED,
+  /// Taken with rmw_take_serialized_message() or
+  /// rmw_take_serialized_message_with_info().
+  RMW_IMPLEMENTATION_CAPTURE_TAKEN,
+} rmw_implementation_capture_direction_t;
+
+/// Message read from a capture file.
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_capture_record_s
+{
+  /// System time the message was published or taken at, in nanoseconds.
+  int64_t timestamp_ns;
+  /// Whether the message was published or taken.
+  rmw_implementation_capture_direction_t direction;
+  /// Name of the topic the message was published or taken on.
+  const char * topic_name;
+  /// Serialized message, which can e.g. be published again to replay it.
+  /**
+   * The message refers to memory of the reader, which must not be modified,
+   * and must not be resized nor finalized.
+   */
+  rmw_serialized_message_t serialized_message;
+} rmw_implementation_capture_record_t;
+
+typedef struct rmw_implementation_capture_reader_impl_s rmw_implementation_capture_reader_impl_t;
+
+/// Reader of capture files.
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_capture_reader_s
+{
+  /// Number of messages in the capture file.
+  uint64_t record_count;
+  /// Implementation defined state of the reader.
+  rmw_implementation_capture_reader_impl_t * impl;
+} rmw_implementation_capture_reader_t;
+
+/// Return a zero initialized capture reader.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_capture_reader_t
+rmw_implementation_get_zero_initialized_capture_reader(void);
+
+/// Initialize a reader of a capture file.
+/**
+ * The whole file is read into memory and checked up front.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] reader zero initialized reader to initialize.
+ * \param[in] file_path path of the capture file to read.
+ * \param[in] allocator allocator used for the reader.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `reader` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `reader` is already initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `file_path` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return `RMW_RET_ERROR` if the file cannot be read, or is not a capture file.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_capture_reader_init(
+  rmw_implementation_capture_reader_t * reader,
+  const char * file_path,
+  const rcutils_allocator_t * allocator);
+
+/// Read the next message of a capture file.
+/**
+ * Messages are read in the order these were written out, which is the order
+ * these were captured in for each thread only.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] reader reader to read with.
+ * \param[out] record message read, valid until the reader is finalized.
+ * \param[out] found whether a message was read, `false` once all were.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `reader` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `reader` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `record` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `found` is NULL.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_capture_reader_next(
+  rmw_implementation_capture_reader_t * reader,
+  rmw_implementation_capture_record_t * record,
+  bool * found);
+
+/// Finalize a reader of a capture file.
+/**
+ * \param[inout] reader reader to finalize, zero initialized on success.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `reader` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `reader` is not initialized.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_capture_reader_fini(rmw_implementation_capture_reader_t * reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__CAPTURE_H_
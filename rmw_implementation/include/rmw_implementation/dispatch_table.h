@@ -0,0 +1,82 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__DISPATCH_TABLE_H_
+#define RMW_IMPLEMENTATION__DISPATCH_TABLE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "rmw_implementation/rmw_interface.h"
+#include "rmw_implementation/visibility_control.h"
+
+#define RMW_IMPLEMENTATION_DISPATCH_TABLE_ENTRY(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType (* name) ArgTypes;
+
+/// Functions of an rmw implementation loaded alongside the process-wide one.
+/**
+ * The `rmw_*` functions exported by this package always forward to the rmw
+ * implementation selected for the process.
+ * A dispatch table instead calls into the rmw implementation it was loaded
+ * for, so that several of them can be used in the same process.
+ * Entities must be passed back to the table that created them, which can be
+ * found from their `implementation_identifier` using rmw_implementation_find().
+ * No entry is `NULL`: functions extending the rmw API, see
+ * `rmw_implementation/extensions.h`, fall back as the process-wide ones do
+ * if the rmw implementation does not have them, calling functions of the
+ * table the entity passed belongs to, and functions of optional features,
+ * see `rmw_implementation/features.h`, return `RMW_RET_UNSUPPORTED`.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_dispatch_table_s
+{
+  /// Name of the loaded rmw implementation e.g. `rmw_cyclonedds_cpp`.
+  const char * name;
+  /// Identifier the rmw implementation stamps on all its entities.
+  const char * implementation_identifier;
+
+  RMW_IMPLEMENTATION_API_FNS(RMW_IMPLEMENTATION_DISPATCH_TABLE_ENTRY)
+} rmw_implementation_dispatch_table_t;
+
+/// Load an rmw implementation, and get its dispatch table.
+/**
+ * Loading the same rmw implementation more than once returns the same table.
+ * Tables remain valid for the lifetime of the process.
+ *
+ * \param[in] rmw_implementation name of the rmw implementation to load.
+ * \return dispatch table of the rmw implementation, or
+ * \return `NULL` if `rmw_implementation` is `NULL`, or
+ * \return `NULL` if the rmw implementation could not be loaded, or
+ * \return `NULL` if any function is missing from the rmw implementation.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+const rmw_implementation_dispatch_table_t *
+rmw_implementation_load(const char * rmw_implementation);
+
+/// Find the dispatch table of an already loaded rmw implementation.
+/**
+ * \param[in] implementation_identifier identifier, as found in entities.
+ * \return dispatch table of the rmw implementation, or
+ * \return `NULL` if no loaded rmw implementation has this identifier.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+const rmw_implementation_dispatch_table_t *
+rmw_implementation_find(const char * implementation_identifier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__DISPATCH_TABLE_H_
@@ -0,0 +1,78 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__EXTENSIONS_H_
+#define RMW_IMPLEMENTATION__EXTENSIONS_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rmw/message_sequence.h"
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+// Functions extending the rmw API.
+// These are forwarded to the loaded rmw implementation if it has them, and
+// are otherwise implemented on top of the rmw API by this package.
+
+/// Publish a sequence of ROS messages.
+/**
+ * Messages are published in order, as if each was published using
+ * rmw_publish(), but in a single call.
+ * Publishing stops at the first message that fails to be published.
+ *
+ * rmw implementations that do not have this function fall back to calling
+ * rmw_publish() for each message.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Maybe [1]
+ * Lock-Free          | Maybe [1]
+ *
+ * <i>[1] implementation defined, check the implementation documentation.</i>
+ *
+ * \param[in] publisher Publisher to be used to send messages.
+ * \param[in] message_sequence Sequence of type erased ROS messages to publish.
+ * \param[out] published Number of messages published, even on failure.
+ * \param[in] allocation Pre-allocated memory to be used. May be NULL.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `publisher` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `message_sequence` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `published` is NULL, or
+ * \return `RMW_RET_INCORRECT_RMW_IMPLEMENTATION` if the `publisher`
+ *   implementation identifier does not match this implementation, or
+ * \return an error returned by rmw_publish() on the first message that fails, or
+ * \return `RMW_RET_ERROR` if an unexpected error occurs.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_publish_sequence(
+  const rmw_publisher_t * publisher,
+  const rmw_message_sequence_t * message_sequence,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__EXTENSIONS_H_
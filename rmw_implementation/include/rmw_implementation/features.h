@@ -0,0 +1,75 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__FEATURES_H_
+#define RMW_IMPLEMENTATION__FEATURES_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Features rmw implementations may leave out.
+typedef enum RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_feature_e
+{
+  /// Loaning messages, i.e. rmw_borrow_loaned_message(), rmw_take_loaned_message()
+  /// and related functions.
+  /**
+   * Publishers and subscriptions may still not be able to loan messages,
+   * see their `can_loan_messages` member.
+   */
+  RMW_IMPLEMENTATION_FEATURE_LOANED_MESSAGES,
+  /// Events, i.e. rmw_publisher_event_init(), rmw_subscription_event_init()
+  /// and rmw_take_event().
+  RMW_IMPLEMENTATION_FEATURE_EVENTS,
+  /// Publishing sequences of messages natively, rather than by falling back
+  /// to publishing each message, see rmw_publish_sequence().
+  RMW_IMPLEMENTATION_FEATURE_PUBLISH_SEQUENCE,
+} rmw_implementation_feature_t;
+
+/// Check whether the rmw implementation has a feature.
+/**
+ * Functions of the features the rmw implementation is missing are still
+ * forwarded, but return `RMW_RET_UNSUPPORTED`, or fall back to other functions.
+ *
+ * The rmw implementation is loaded if not already, and only the functions of
+ * the feature are resolved if not already, so that checking is cheap.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Only when loading the rmw implementation
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | Yes, once the rmw implementation is loaded
+ *
+ * \param[in] feature feature to check.
+ * \return `true` if the rmw implementation has all functions of the feature, or
+ * \return `false` if it is missing any, or
+ * \return `false` if the rmw implementation could not be loaded, or
+ * \return `false` if the feature is unknown.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+bool
+rmw_implementation_has_feature(rmw_implementation_feature_t feature);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__FEATURES_H_
@@ -0,0 +1,244 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__GID_H_
+#define RMW_IMPLEMENTATION__GID_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Check whether two GIDs are equal, without calling the rmw implementation.
+/**
+ * GIDs are equal if they are of the same rmw implementation and their data is
+ * the same byte by byte, as rmw_compare_gids_equal() checks: rmw
+ * implementations zero initialize the storage of GIDs before writing the
+ * identifier of the entity into it.
+ * Unlike rmw_compare_gids_equal(), GIDs of different rmw implementations are
+ * not an error but compare unequal.
+ *
+ * \param[in] lhs GID to compare, must not be `NULL`.
+ * \param[in] rhs other GID to compare, must not be `NULL`.
+ * \return `true` if both GIDs are equal, or
+ * \return `false` otherwise.
+ */
+static inline bool
+rmw_implementation_gid_equal(const rmw_gid_t * lhs, const rmw_gid_t * rhs)
+{
+  if (lhs->implementation_identifier != rhs->implementation_identifier &&
+    (NULL == lhs->implementation_identifier || NULL == rhs->implementation_identifier ||
+    0 != strcmp(lhs->implementation_identifier, rhs->implementation_identifier)))
+  {
+    return false;
+  }
+  return 0 == memcmp(lhs->data, rhs->data, RMW_GID_STORAGE_SIZE);
+}
+
+/// Hash a GID, consistently with rmw_implementation_gid_equal().
+/**
+ * The data of the GID is hashed a word at a time, FNV-1a style, then mixed
+ * with the finalizer of MurmurHash3, so that GIDs differing only in a few
+ * bytes, e.g. the entity id of publishers of the same participant, spread.
+ *
+ * \param[in] gid GID to hash, must not be `NULL`.
+ * \return hash of the GID.
+ */
+static inline size_t
+rmw_implementation_gid_hash(const rmw_gid_t * gid)
+{
+  uint64_t hash = 14695981039346656037ull;
+  size_t i = 0u;
+  for (; i + sizeof(uint64_t) <= RMW_GID_STORAGE_SIZE; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, gid->data + i, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  for (; i < RMW_GID_STORAGE_SIZE; ++i) {
+    hash = (hash ^ gid->data[i]) * 1099511628211ull;
+  }
+  hash ^= hash >> 33u;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33u;
+  return hash;
+}
+
+typedef struct rmw_implementation_gid_set_impl_s rmw_implementation_gid_set_impl_t;
+
+/// Set of GIDs, e.g. of known publishers, looked up in constant time.
+/**
+ * GIDs are hashed and compared with rmw_implementation_gid_hash() and
+ * rmw_implementation_gid_equal(), without calling the rmw implementation.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_gid_set_s
+{
+  /// Number of GIDs in the set.
+  size_t size;
+  /// Implementation defined state of the set.
+  rmw_implementation_gid_set_impl_t * impl;
+} rmw_implementation_gid_set_t;
+
+/// Return a zero initialized GID set.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_gid_set_t
+rmw_implementation_get_zero_initialized_gid_set(void);
+
+/// Initialize an empty GID set.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes, if the allocator is
+ *
+ * \param[inout] set zero initialized set to initialize.
+ * \param[in] allocator allocator used for the set and its entries.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is already initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_gid_set_init(
+  rmw_implementation_gid_set_t * set,
+  const rcutils_allocator_t * allocator);
+
+/// Finalize a GID set.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes, if the allocator is
+ *
+ * \param[inout] set set to finalize, zero initialized when done.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is not initialized.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_gid_set_fini(rmw_implementation_gid_set_t * set);
+
+/// Insert a GID into a set.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes, if the GID is not in the set
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes, if the allocator is
+ *
+ * \param[inout] set set to insert the GID into.
+ * \param[in] gid GID to insert, which is copied.
+ * \param[out] inserted set to `true` if the GID was not in the set, `false` otherwise,
+ *   may be `NULL`.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` or `gid` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is not initialized, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_gid_set_insert(
+  rmw_implementation_gid_set_t * set,
+  const rmw_gid_t * gid,
+  bool * inserted);
+
+/// Remove a GID from a set.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes, if the allocator is
+ *
+ * \param[inout] set set to remove the GID from.
+ * \param[in] gid GID to remove.
+ * \param[out] removed set to `true` if the GID was in the set, `false` otherwise,
+ *   may be `NULL`.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` or `gid` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is not initialized.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_gid_set_remove(
+  rmw_implementation_gid_set_t * set,
+  const rmw_gid_t * gid,
+  bool * removed);
+
+/// Check whether a GID is in a set.
+/**
+ * Sets can be looked up from several threads at once, as long as these are not
+ * modified meanwhile.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[in] set set to look the GID up in.
+ * \param[in] gid GID to look up, e.g. the publisher GID of a message taken.
+ * \param[out] contains set to `true` if the GID is in the set, `false` otherwise.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set`, `gid` or `contains` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is not initialized.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_gid_set_contains(
+  const rmw_implementation_gid_set_t * set,
+  const rmw_gid_t * gid,
+  bool * contains);
+
+/// Remove all GIDs from a set.
+/**
+ * \param[inout] set set to clear.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `set` is not initialized.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_gid_set_clear(rmw_implementation_gid_set_t * set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__GID_H_
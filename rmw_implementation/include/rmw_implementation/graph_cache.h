@@ -0,0 +1,322 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__GRAPH_CACHE_H_
+#define RMW_IMPLEMENTATION__GRAPH_CACHE_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcutils/allocator.h"
+#include "rcutils/types/string_array.h"
+
+#include "rmw/names_and_types.h"
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+typedef struct rmw_implementation_graph_cache_impl_s rmw_implementation_graph_cache_impl_t;
+
+/// Cache of graph queries made through one node.
+/**
+ * Query results are kept in a snapshot, taken with one query to the rmw
+ * implementation, and served from it until the graph changes.
+ *
+ * Caches watching the graph guard condition of the node, see
+ * rmw_node_get_graph_guard_condition(), check it on each query by waiting on
+ * it with a zero timeout, so that queries made after a change in the graph are
+ * never served from a stale snapshot.
+ * Waiting on the graph guard condition consumes its triggers, so graph caches
+ * and graph event streams of the same node share these, and can be used
+ * together on any node.
+ * The graph guard condition must however not be waited on by anything else,
+ * e.g. by the graph listener of rcl, or triggers will go unseen.
+ * Callers that do wait on it must instead initialize caches that do not watch
+ * it, and call rmw_implementation_graph_cache_invalidate() whenever it is
+ * triggered.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_graph_cache_s
+{
+  /// Implementation defined state of the cache.
+  rmw_implementation_graph_cache_impl_t * impl;
+} rmw_implementation_graph_cache_t;
+
+/// Return a zero initialized graph cache.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_graph_cache_t
+rmw_implementation_get_zero_initialized_graph_cache(void);
+
+/// Initialize a graph cache for queries made through a node.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] cache zero initialized cache to initialize.
+ * \param[in] node node to query the graph through, must outlive the cache.
+ * \param[in] watch_graph_guard_condition whether to watch the graph guard
+ *   condition of the node, or to leave it to the caller, which must then
+ *   invalidate the cache whenever it is triggered.
+ * \param[in] allocator allocator used for the cache, and for the node names
+ *   it returns.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is already initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `node` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return `RMW_RET_ERROR` if the graph guard condition of the node is to be
+ *   watched but cannot be waited on.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_init(
+  rmw_implementation_graph_cache_t * cache,
+  const rmw_node_t * node,
+  bool watch_graph_guard_condition,
+  const rcutils_allocator_t * allocator);
+
+/// Finalize a graph cache.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] cache cache to finalize, zero initialized when done.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized, or
+ * \return an error returned by rmw_destroy_wait_set().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_fini(rmw_implementation_graph_cache_t * cache);
+
+/// Drop the snapshot of a graph cache, so that the next queries are made anew.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] cache cache to invalidate.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_invalidate(rmw_implementation_graph_cache_t * cache);
+
+/// Get topic names and types, as rmw_get_topic_names_and_types() does.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] cache cache to query.
+ * \param[in] allocator allocator used for `topic_names_and_types`.
+ * \param[in] no_demangle whether to return topic names and types as they are
+ *   in the middleware.
+ * \param[out] topic_names_and_types zero initialized array of topic names and
+ *   types, set to a copy of those in the snapshot.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `topic_names_and_types` is NULL or
+ *   not zero initialized, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_wait() or rmw_get_topic_names_and_types().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_get_topic_names_and_types(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_allocator_t * allocator,
+  bool no_demangle,
+  rmw_names_and_types_t * topic_names_and_types);
+
+/// Get service names and types, as rmw_get_service_names_and_types() does.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] cache cache to query.
+ * \param[in] allocator allocator used for `service_names_and_types`.
+ * \param[out] service_names_and_types zero initialized array of service names
+ *   and types, set to a copy of those in the snapshot.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `service_names_and_types` is NULL or
+ *   not zero initialized, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_wait() or rmw_get_service_names_and_types().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_get_service_names_and_types(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_allocator_t * allocator,
+  rmw_names_and_types_t * service_names_and_types);
+
+/// Get node names and namespaces, as rmw_get_node_names() does.
+/**
+ * Node names are served from the same snapshot as
+ * rmw_implementation_graph_cache_get_node_names_with_enclaves().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] cache cache to query.
+ * \param[out] node_names zero initialized array of node names.
+ * \param[out] node_namespaces zero initialized array of node namespaces.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if an output array is NULL or not zero
+ *   initialized, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_wait() or rmw_get_node_names_with_enclaves().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_get_node_names(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_string_array_t * node_names,
+  rcutils_string_array_t * node_namespaces);
+
+/// Get node names, namespaces and enclaves, as rmw_get_node_names_with_enclaves() does.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] cache cache to query.
+ * \param[out] node_names zero initialized array of node names.
+ * \param[out] node_namespaces zero initialized array of node namespaces.
+ * \param[out] enclaves zero initialized array of node enclaves.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if an output array is NULL or not zero
+ *   initialized, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_wait() or rmw_get_node_names_with_enclaves().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_get_node_names_with_enclaves(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_string_array_t * node_names,
+  rcutils_string_array_t * node_namespaces,
+  rcutils_string_array_t * enclaves);
+
+/// Count publishers to a topic, as rmw_count_publishers() does.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Only on first query for the topic
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] cache cache to query.
+ * \param[in] topic_name fully qualified name of the topic.
+ * \param[out] count number of publishers to the topic.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `topic_name` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `count` is NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_wait() or rmw_count_publishers().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_count_publishers(
+  rmw_implementation_graph_cache_t * cache,
+  const char * topic_name,
+  size_t * count);
+
+/// Count subscribers to a topic, as rmw_count_subscribers() does.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Only on first query for the topic
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] cache cache to query.
+ * \param[in] topic_name fully qualified name of the topic.
+ * \param[out] count number of subscribers to the topic.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `cache` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `topic_name` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `count` is NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_wait() or rmw_count_subscribers().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_cache_count_subscribers(
+  rmw_implementation_graph_cache_t * cache,
+  const char * topic_name,
+  size_t * count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__GRAPH_CACHE_H_
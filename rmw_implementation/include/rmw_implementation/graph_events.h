@@ -0,0 +1,226 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__GRAPH_EVENTS_H_
+#define RMW_IMPLEMENTATION__GRAPH_EVENTS_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Kind of change in the graph.
+typedef enum RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_graph_event_type_e
+{
+  RMW_IMPLEMENTATION_GRAPH_EVENT_PUBLISHER_ADDED,
+  RMW_IMPLEMENTATION_GRAPH_EVENT_PUBLISHER_REMOVED,
+  RMW_IMPLEMENTATION_GRAPH_EVENT_SUBSCRIPTION_ADDED,
+  RMW_IMPLEMENTATION_GRAPH_EVENT_SUBSCRIPTION_REMOVED
+} rmw_implementation_graph_event_type_t;
+
+/// Change in the graph, i.e. an endpoint added to or removed from a topic.
+/**
+ * Strings are owned by the stream the event was taken from, and remain valid
+ * until the next event is taken from it or until the stream is finalized.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_graph_event_s
+{
+  /// Kind of change.
+  rmw_implementation_graph_event_type_t type;
+  /// Name of the topic.
+  const char * topic_name;
+  /// Type of the endpoint.
+  const char * topic_type;
+  /// Name of the node the endpoint belongs to.
+  const char * node_name;
+  /// Namespace of the node the endpoint belongs to.
+  const char * node_namespace;
+  /// Global identifier of the endpoint.
+  uint8_t endpoint_gid[RMW_GID_STORAGE_SIZE];
+  /// QoS profile of the endpoint.
+  rmw_qos_profile_t qos_profile;
+} rmw_implementation_graph_event_t;
+
+typedef struct rmw_implementation_graph_event_stream_impl_s
+  rmw_implementation_graph_event_stream_impl_t;
+
+/// Stream of changes in the graph, as seen through one node.
+/**
+ * No rmw implementation reports changes in the graph as such, hence these
+ * are computed by comparing successive snapshots of the graph, each taken
+ * when the graph guard condition of a node is triggered, see
+ * rmw_node_get_graph_guard_condition().
+ * Taking events costs work proportional to the number of events taken.
+ * Taking a snapshot costs a query per topic, hence streams of nodes in the
+ * same context, which all see the same graph, share their snapshots: each
+ * change in the graph is handled with a single snapshot, however many nodes
+ * and streams there are, and each stream only copies the changes found.
+ * Snapshots are taken through the node of any stream of the context.
+ *
+ * Streams watching the graph guard condition check it whenever events are
+ * taken, by waiting on it with a zero timeout.
+ * Waiting on the graph guard condition consumes its triggers, so graph caches
+ * and graph event streams of the same node share these, and can be used
+ * together on any node.
+ * The graph guard condition of nodes with such streams must however not be
+ * waited on by anything else, e.g. by the graph listener of rcl, or triggers
+ * will go unseen.
+ * Callers that do wait on it must instead initialize streams that do not
+ * watch it, and call rmw_implementation_graph_event_stream_update() whenever
+ * it is triggered.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_graph_event_stream_s
+{
+  /// Implementation defined state of the stream.
+  rmw_implementation_graph_event_stream_impl_t * impl;
+} rmw_implementation_graph_event_stream_t;
+
+/// Return a zero initialized graph event stream.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_graph_event_stream_t
+rmw_implementation_get_zero_initialized_graph_event_stream(void);
+
+/// Initialize a graph event stream for changes seen through a node.
+/**
+ * The first events taken from the stream add every endpoint in the graph.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] stream zero initialized stream to initialize.
+ * \param[in] node node to query the graph through, must outlive the stream.
+ * \param[in] watch_graph_guard_condition whether to watch the graph guard
+ *   condition of the node, or to leave it to the caller, which must then
+ *   update the stream whenever it is triggered.
+ * \param[in] allocator allocator used for the stream and its events, while
+ *   snapshots shared by the streams of the context use the default allocator.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is already initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `node` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return `RMW_RET_ERROR` if the graph guard condition of the node is to be
+ *   watched but cannot be waited on.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_event_stream_init(
+  rmw_implementation_graph_event_stream_t * stream,
+  const rmw_node_t * node,
+  bool watch_graph_guard_condition,
+  const rcutils_allocator_t * allocator);
+
+/// Finalize a graph event stream.
+/**
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[inout] stream stream to finalize, zero initialized when done.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is not initialized, or
+ * \return an error returned by rmw_destroy_wait_set().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_event_stream_fini(rmw_implementation_graph_event_stream_t * stream);
+
+/// Take a snapshot of the graph, and queue the changes since the last one.
+/**
+ * The snapshot is shared by the streams of nodes in the same context, and the
+ * changes queued for all of them.
+ *
+ * Meant for callers that wait on the graph guard condition themselves.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] stream stream to update.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is not initialized, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return `RMW_RET_ERROR` if the graph guard condition of the node queried
+ *   through cannot be waited on, or
+ * \return an error returned by rmw_get_topic_names_and_types(),
+ *   rmw_get_publishers_info_by_topic() or
+ *   rmw_get_subscriptions_info_by_topic().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_event_stream_update(rmw_implementation_graph_event_stream_t * stream);
+
+/// Take changes in the graph, oldest first.
+/**
+ * Events taken on a previous call are invalidated.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] stream stream to take events from.
+ * \param[out] events array of at least `capacity` events to fill.
+ * \param[in] capacity maximum number of events to take.
+ * \param[out] count number of events taken, which may be zero.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `events` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `count` is NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_wait(), or
+ * \return an error returned by rmw_implementation_graph_event_stream_update().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_graph_event_stream_take(
+  rmw_implementation_graph_event_stream_t * stream,
+  rmw_implementation_graph_event_t * events,
+  size_t capacity,
+  size_t * count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__GRAPH_EVENTS_H_
@@ -0,0 +1,191 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__GRAPH_WAIT_H_
+#define RMW_IMPLEMENTATION__GRAPH_WAIT_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Condition on the graph, evaluated by rmw_implementation_wait_for_graph_condition().
+/**
+ * \param[in] data data given to rmw_implementation_wait_for_graph_condition().
+ * \param[out] holds whether the condition holds.
+ * \return `RMW_RET_OK` if the condition could be evaluated, or
+ * \return an error, which stops waiting.
+ */
+typedef rmw_ret_t (* rmw_implementation_graph_condition_t)(void * data, bool * holds);
+
+/// Wait for a condition on the graph to hold.
+/**
+ * The condition is evaluated anew whenever the graph guard condition of the
+ * node is triggered, see rmw_node_get_graph_guard_condition(), and at least
+ * every 10 milliseconds, as not every change a condition may depend on, e.g.
+ * matching endpoints, triggers it.
+ * Unlike sleeping for a fixed delay, this returns as soon as the condition
+ * holds.
+ *
+ * The graph guard condition is waited on with a wait set of its own, as
+ * rcl_wait_for_publishers() does, for at most 10 milliseconds at a time.
+ * Waits are polled regardless, so triggers seen elsewhere in the meantime,
+ * e.g. by the graph listener of rcl, only delay these.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | Yes
+ * Lock-Free          | No
+ *
+ * \param[in] node node to wait on the graph guard condition of.
+ * \param[in] condition condition to wait for.
+ * \param[in] data data to give to `condition`, may be NULL.
+ * \param[in] timeout how long to wait for, or NULL to wait indefinitely.
+ * \return `RMW_RET_OK` if the condition holds, or
+ * \return `RMW_RET_TIMEOUT` if the condition does not hold after `timeout`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `node` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `condition` is NULL, or
+ * \return `RMW_RET_ERROR` if the graph guard condition of the node cannot be
+ *   waited on, or
+ * \return an error returned by `condition`, or by rmw_wait().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_for_graph_condition(
+  const rmw_node_t * node,
+  rmw_implementation_graph_condition_t condition,
+  void * data,
+  const rmw_time_t * timeout);
+
+/// Wait for a publisher to match a number of subscriptions.
+/**
+ * See rmw_implementation_wait_for_graph_condition() and
+ * rmw_publisher_count_matched_subscriptions().
+ *
+ * \param[in] node node the publisher belongs to.
+ * \param[in] publisher publisher to wait for.
+ * \param[in] count number of matched subscriptions to wait for.
+ * \param[in] timeout how long to wait for, or NULL to wait indefinitely.
+ * \return `RMW_RET_OK` if the publisher matches `count` subscriptions, or
+ * \return `RMW_RET_TIMEOUT` if it does not after `timeout`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `publisher` is NULL, or
+ * \return an error returned by rmw_implementation_wait_for_graph_condition().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_for_matched_subscriptions(
+  const rmw_node_t * node,
+  const rmw_publisher_t * publisher,
+  size_t count,
+  const rmw_time_t * timeout);
+
+/// Wait for a subscription to match a number of publishers.
+/**
+ * See rmw_implementation_wait_for_graph_condition() and
+ * rmw_subscription_count_matched_publishers().
+ *
+ * \param[in] node node the subscription belongs to.
+ * \param[in] subscription subscription to wait for.
+ * \param[in] count number of matched publishers to wait for.
+ * \param[in] timeout how long to wait for, or NULL to wait indefinitely.
+ * \return `RMW_RET_OK` if the subscription matches `count` publishers, or
+ * \return `RMW_RET_TIMEOUT` if it does not after `timeout`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `subscription` is NULL, or
+ * \return an error returned by rmw_implementation_wait_for_graph_condition().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_for_matched_publishers(
+  const rmw_node_t * node,
+  const rmw_subscription_t * subscription,
+  size_t count,
+  const rmw_time_t * timeout);
+
+/// Wait for a number of publishers on a topic.
+/**
+ * See rmw_implementation_wait_for_graph_condition() and rmw_count_publishers().
+ *
+ * \param[in] node node to query the graph through.
+ * \param[in] topic_name fully qualified name of the topic.
+ * \param[in] count number of publishers to wait for.
+ * \param[in] timeout how long to wait for, or NULL to wait indefinitely.
+ * \return `RMW_RET_OK` if there are `count` publishers on the topic, or
+ * \return `RMW_RET_TIMEOUT` if there are not after `timeout`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `topic_name` is NULL, or
+ * \return an error returned by rmw_implementation_wait_for_graph_condition().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_for_publishers(
+  const rmw_node_t * node,
+  const char * topic_name,
+  size_t count,
+  const rmw_time_t * timeout);
+
+/// Wait for a number of subscriptions on a topic.
+/**
+ * See rmw_implementation_wait_for_graph_condition() and rmw_count_subscribers().
+ *
+ * \param[in] node node to query the graph through.
+ * \param[in] topic_name fully qualified name of the topic.
+ * \param[in] count number of subscriptions to wait for.
+ * \param[in] timeout how long to wait for, or NULL to wait indefinitely.
+ * \return `RMW_RET_OK` if there are `count` subscriptions on the topic, or
+ * \return `RMW_RET_TIMEOUT` if there are not after `timeout`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `topic_name` is NULL, or
+ * \return an error returned by rmw_implementation_wait_for_graph_condition().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_for_subscribers(
+  const rmw_node_t * node,
+  const char * topic_name,
+  size_t count,
+  const rmw_time_t * timeout);
+
+/// Wait for the service server of a client to be available.
+/**
+ * See rmw_implementation_wait_for_graph_condition() and
+ * rmw_service_server_is_available().
+ *
+ * \param[in] node node the client belongs to.
+ * \param[in] client client to wait for.
+ * \param[in] timeout how long to wait for, or NULL to wait indefinitely.
+ * \return `RMW_RET_OK` if the service server is available, or
+ * \return `RMW_RET_TIMEOUT` if it is not after `timeout`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `client` is NULL, or
+ * \return an error returned by rmw_implementation_wait_for_graph_condition().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_for_service_server(
+  const rmw_node_t * node,
+  const rmw_client_t * client,
+  const rmw_time_t * timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__GRAPH_WAIT_H_
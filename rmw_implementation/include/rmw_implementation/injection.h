@@ -0,0 +1,183 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__INJECTION_H_
+#define RMW_IMPLEMENTATION__INJECTION_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Latency and faults to inject into calls made for a topic.
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_injection_s
+{
+  /// Delay added to each call, in nanoseconds.
+  uint64_t latency_ns;
+  /// Largest random delay added on top of `latency_ns`, in nanoseconds.
+  /**
+   * Delays are uniformly distributed between zero and this.
+   */
+  uint64_t jitter_ns;
+  /// Probability of dropping each message published or taken, from 0 to 1.
+  double drop_probability;
+  /// Probability of holding back each serialized message published, from 0 to 1.
+  /**
+   * Held back messages are published right after the next message published
+   * by the same publisher, hence swapping the order of both.
+   * Only messages published with rmw_publish_serialized_message() are held
+   * back: this has no effect on rmw_publish(), whose messages cannot be copied
+   * without their type support.
+   */
+  double reorder_probability;
+} rmw_implementation_injection_t;
+
+/// Return an injection of neither latency nor faults.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_injection_t
+rmw_implementation_get_zero_initialized_injection(void);
+
+/// Set the latency and faults to inject into calls made for a topic.
+/**
+ * Injections apply to:
+ * - rmw_publish() and rmw_publish_serialized_message(), which are delayed
+ *   before publishing, and whose messages may be dropped, i.e. not published
+ *   even though `RMW_RET_OK` is returned;
+ * - rmw_publish_serialized_message() too, whose messages may be reordered;
+ * - rmw_take(), rmw_take_with_info(), rmw_take_serialized_message() and
+ *   rmw_take_serialized_message_with_info(), which are delayed before taking,
+ *   and whose messages may be dropped, i.e. taken then reported as not taken.
+ *
+ * Messages of typed publishers cannot be reordered, as these cannot be
+ * copied without their type support.
+ *
+ * Calls look the injection of their topic up once per entity and thread,
+ * without locking afterwards until injections are set or cleared again.
+ *
+ * The injection set without a topic applies to all topics without one of
+ * their own, and to rmw_wait(), which is delayed once it returns `RMW_RET_OK`.
+ *
+ * Injections only take effect while injection is enabled, see
+ * rmw_implementation_injection_enable().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] topic_name fully qualified name of the topic, or `NULL` for all topics.
+ * \param[in] injection latency and faults to inject, which are copied.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `injection` is `NULL`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if probabilities are not between 0 and 1, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_injection_set(
+  const char * topic_name,
+  const rmw_implementation_injection_t * injection);
+
+/// Remove the injections of all topics.
+/**
+ * \return `RMW_RET_OK`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_injection_clear(void);
+
+/// Start injecting latency and faults into calls made to the rmw implementation.
+/**
+ * Calls injections apply to are forwarded to the rmw implementation through
+ * an injection layer until injection is disabled, or the rmw implementation
+ * is unloaded.
+ * When injection is disabled, calls are forwarded as they would be otherwise.
+ *
+ * Random delays and faults of each thread are drawn from its own generator,
+ * seeded from `seed` and the order threads first made calls in, so that
+ * single threaded runs can be reproduced.
+ *
+ * Enabling injection when already enabled reseeds generators.
+ *
+ * \param[in] seed seed of random delays and faults.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_ERROR` if the rmw implementation could not be loaded.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_injection_enable(uint64_t seed);
+
+/// Stop injecting latency and faults.
+/**
+ * Messages held back to be reordered are published.
+ *
+ * Disabling injection when not enabled has no effect.
+ *
+ * \return `RMW_RET_OK`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_injection_disable(void);
+
+/// Check whether latency and faults are being injected.
+RMW_IMPLEMENTATION_PUBLIC
+bool
+rmw_implementation_injection_is_enabled(void);
+
+/// Latency and faults injected.
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_injection_stats_s
+{
+  /// Number of calls delayed.
+  uint64_t delayed_count;
+  /// Time calls were delayed for, in nanoseconds.
+  uint64_t total_delay_ns;
+  /// Number of messages dropped.
+  uint64_t dropped_count;
+  /// Number of messages held back to be reordered.
+  uint64_t reordered_count;
+} rmw_implementation_injection_stats_t;
+
+/// Get statistics of latency and faults injected since last reset.
+/**
+ * \param[out] stats statistics to fill.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stats` is `NULL`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_injection_get_stats(rmw_implementation_injection_stats_t * stats);
+
+/// Reset statistics of latency and faults injected.
+/**
+ * \return `RMW_RET_OK`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_injection_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__INJECTION_H_
@@ -0,0 +1,223 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__MESSAGE_LOAN_POOL_H_
+#define RMW_IMPLEMENTATION__MESSAGE_LOAN_POOL_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/types.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+typedef struct rmw_implementation_message_loan_pool_impl_s
+  rmw_implementation_message_loan_pool_impl_t;
+
+/// Pool of messages to publish, loaned by the rmw implementation if it can.
+/**
+ * Messages are borrowed from the rmw implementation if the publisher can loan
+ * messages, see rmw_borrow_loaned_message(), and are otherwise taken from a
+ * pool of preallocated messages, which are published with rmw_publish().
+ * Callers thus use the same calls either way, and only avoid copies with
+ * rmw implementations that loan messages.
+ *
+ * As with loaned messages, borrowed messages are storage for a message of the
+ * type, to be initialized by the caller, and their ownership passes on when
+ * published.
+ * Messages should thus be of a type that owns no memory, such as those
+ * rmw implementations loan, or any memory they own is leaked.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_message_loan_pool_s
+{
+  /// Whether messages are loaned by the rmw implementation, rather than taken from the pool.
+  bool loans_messages;
+  /// Implementation defined state of the pool.
+  rmw_implementation_message_loan_pool_impl_t * impl;
+} rmw_implementation_message_loan_pool_t;
+
+/// Return a zero initialized message loan pool.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_message_loan_pool_t
+rmw_implementation_get_zero_initialized_message_loan_pool(void);
+
+/// Initialize a message loan pool for a publisher.
+/**
+ * Whether the publisher can loan messages is checked once, here.
+ * If it can, no message is preallocated.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] pool zero initialized pool to initialize.
+ * \param[in] publisher publisher to publish messages with, which must outlive
+ *   the pool.
+ * \param[in] type_support type support of the messages of the publisher.
+ * \param[in] message_size size of the messages of the publisher, in bytes.
+ * \param[in] initial_count number of messages to preallocate, if the publisher
+ *   cannot loan messages.
+ * \param[in] allocator allocator used for the pool and its messages.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is already initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `publisher` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `type_support` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `message_size` is zero, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_message_loan_pool_init(
+  rmw_implementation_message_loan_pool_t * pool,
+  const rmw_publisher_t * publisher,
+  const rosidl_message_type_support_t * type_support,
+  size_t message_size,
+  size_t initial_count,
+  const rcutils_allocator_t * allocator);
+
+/// Finalize a message loan pool.
+/**
+ * All messages taken from the pool must have been published or returned.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] pool pool to finalize, zero initialized on success.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is not initialized, or
+ * \return `RMW_RET_ERROR` if messages taken from the pool have been neither
+ *   published nor returned.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_message_loan_pool_fini(rmw_implementation_message_loan_pool_t * pool);
+
+/// Borrow a message to publish.
+/**
+ * The message is loaned by the rmw implementation if the pool loans messages,
+ * and is otherwise taken from the pool, a new one being allocated if none is
+ * left.
+ * It must then be either published or returned through the same pool.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe, if no message is left or by the rmw implementation
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] pool pool to borrow a message from.
+ * \param[out] ros_message borrowed message, which must point to NULL.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `ros_message` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `*ros_message` is not NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+ * \return an error returned by rmw_borrow_loaned_message().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_message_loan_pool_borrow(
+  rmw_implementation_message_loan_pool_t * pool,
+  void ** ros_message);
+
+/// Publish a message borrowed from a pool.
+/**
+ * Loaned messages are published with rmw_publish_loaned_message(), and
+ * messages taken from the pool with rmw_publish(), after which these are
+ * back in the pool.
+ * If publishing fails, the message is still borrowed.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Maybe, by the rmw implementation
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] pool pool the message was borrowed from.
+ * \param[in] ros_message message to publish.
+ * \param[in] allocation publisher allocation to use, may be NULL.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `ros_message` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if no message taken from the pool is
+ *   left to publish, or
+ * \return an error returned by rmw_publish_loaned_message() or rmw_publish().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_message_loan_pool_publish(
+  rmw_implementation_message_loan_pool_t * pool,
+  void * ros_message,
+  rmw_publisher_allocation_t * allocation);
+
+/// Give a message borrowed from a pool back without publishing it.
+/**
+ * Loaned messages are returned with rmw_return_loaned_message_from_publisher().
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] pool pool the message was borrowed from.
+ * \param[in] ros_message message to give back.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `ros_message` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if no message taken from the pool is
+ *   left to give back, or
+ * \return an error returned by rmw_return_loaned_message_from_publisher().
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_message_loan_pool_return(
+  rmw_implementation_message_loan_pool_t * pool,
+  void * ros_message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__MESSAGE_LOAN_POOL_H_
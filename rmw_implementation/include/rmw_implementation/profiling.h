@@ -0,0 +1,140 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__PROFILING_H_
+#define RMW_IMPLEMENTATION__PROFILING_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "rmw/types.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Environment variable enabling profiling from rmw_init() on, when set to `1`.
+#define RMW_IMPLEMENTATION_PROFILING_ENV_VAR "RMW_IMPLEMENTATION_PROFILING"
+
+/// Number of buckets of the call duration histograms.
+#define RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE 32
+
+/// Calls made to a function of the rmw API while profiling.
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_function_profile_s
+{
+  /// Name of the function e.g. `rmw_publish`.
+  const char * function_name;
+  /// Number of calls made to the function.
+  uint64_t call_count;
+  /// Time spent in the function by all calls, in nanoseconds.
+  uint64_t total_duration_ns;
+  /// Number of calls by duration.
+  /**
+   * Bucket `i` counts calls taking [2^i, 2^(i+1)) nanoseconds, except for the
+   * first bucket which also counts calls taking less, and the last bucket
+   * which also counts calls taking more.
+   */
+  uint64_t duration_histogram[RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE];
+} rmw_implementation_function_profile_t;
+
+/// Start profiling calls made to the rmw implementation.
+/**
+ * Calls are forwarded to the rmw implementation through a profiling layer
+ * until profiling is disabled, or the rmw implementation is unloaded.
+ * Calls are counted and timed per thread, and only added up in snapshots.
+ * When profiling is disabled, calls are forwarded as they would be otherwise.
+ *
+ * Profiling can also be enabled from rmw_init() on by setting the
+ * `RMW_IMPLEMENTATION_PROFILING` environment variable to `1`.
+ *
+ * Enabling profiling when already enabled has no effect.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_ERROR` if the rmw implementation could not be loaded.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_profiling_enable(void);
+
+/// Stop profiling calls made to the rmw implementation.
+/**
+ * Profiles are kept, until reset.
+ *
+ * Disabling profiling when not enabled has no effect.
+ *
+ * \return `RMW_RET_OK`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_profiling_disable(void);
+
+/// Check whether calls made to the rmw implementation are being profiled.
+RMW_IMPLEMENTATION_PUBLIC
+bool
+rmw_implementation_profiling_is_enabled(void);
+
+/// Get the number of profiled functions, one profile each.
+RMW_IMPLEMENTATION_PUBLIC
+size_t
+rmw_implementation_profile_count(void);
+
+/// Take a snapshot of the profiles of all functions.
+/**
+ * Profiles cover all calls made since profiling was first enabled, or since
+ * profiles were last reset.
+ *
+ * \param[out] profiles array of profiles to fill.
+ * \param[in] count size of the `profiles` array, which must be no less than
+ *   the number of profiled functions.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `profiles` is `NULL`, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `count` is too small.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_profile_snapshot(rmw_implementation_function_profile_t * profiles, size_t count);
+
+/// Reset the profiles of all functions.
+/**
+ * \return `RMW_RET_OK`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_profile_reset(void);
+
+/// Export a snapshot of the profiles of all functions as CSV.
+/**
+ * One line is written per function that has been called, after a header line.
+ * Columns are the function name, call count, total duration, then the
+ * histogram buckets.
+ *
+ * \param[in] stream stream to write to.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `stream` is `NULL`, or
+ * \return `RMW_RET_ERROR` if writing to `stream` fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_profile_export(FILE * stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__PROFILING_H_
@@ -0,0 +1,440 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__RMW_INTERFACE_H_
+#define RMW_IMPLEMENTATION__RMW_INTERFACE_H_
+
+#include "rcutils/allocator.h"
+#include "rcutils/types/string_array.h"
+
+#include "rmw/event.h"
+#include "rmw/names_and_types.h"
+#include "rmw/get_node_info_and_types.h"
+#include "rmw/get_service_names_and_types.h"
+#include "rmw/get_topic_endpoint_info.h"
+#include "rmw/get_topic_names_and_types.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/extensions.h"
+
+// Manifest of the rmw API, the single source from which forwarders, the
+// dispatch table, symbol prefetching and unloading are all generated.
+// Each entry reads as
+//   X(name, ReturnType, error_value, number_of_arguments, (ArgTypes...))
+// where error_value is returned if the symbol cannot be resolved.
+
+// Functions forwarded as-is to the loaded rmw implementation.
+#define RMW_IMPLEMENTATION_FORWARDED_FNS(X) \
+  X( \
+    rmw_get_implementation_identifier, \
+    const char *, NULL, \
+    0, (void)) \
+  X( \
+    rmw_init_options_init, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (rmw_init_options_t *, rcutils_allocator_t)) \
+  X( \
+    rmw_init_options_copy, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_init_options_t *, rmw_init_options_t *)) \
+  X( \
+    rmw_init_options_fini, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_init_options_t *)) \
+  X( \
+    rmw_shutdown, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_context_t *)) \
+  X( \
+    rmw_context_fini, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_context_t *)) \
+  X( \
+    rmw_get_serialization_format, \
+    const char *, NULL, \
+    0, (void)) \
+  X( \
+    rmw_create_node, \
+    rmw_node_t *, NULL, \
+    3, ( \
+      rmw_context_t *, const char *, const char *)) \
+  X( \
+    rmw_destroy_node, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_node_t *)) \
+  X( \
+    rmw_node_get_graph_guard_condition, \
+    const rmw_guard_condition_t *, NULL, \
+    1, (const rmw_node_t *)) \
+  X( \
+    rmw_init_publisher_allocation, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, ( \
+      const rosidl_message_type_support_t *, \
+      const rosidl_runtime_c__Sequence__bound *, \
+      rmw_publisher_allocation_t *)) \
+  X( \
+    rmw_fini_publisher_allocation, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_publisher_allocation_t *)) \
+  X( \
+    rmw_create_publisher, \
+    rmw_publisher_t *, NULL, \
+    5, ( \
+      const rmw_node_t *, const rosidl_message_type_support_t *, const char *, \
+      const rmw_qos_profile_t *, const rmw_publisher_options_t *)) \
+  X( \
+    rmw_destroy_publisher, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (rmw_node_t *, rmw_publisher_t *)) \
+  X( \
+    rmw_publish, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_publisher_t *, const void *, rmw_publisher_allocation_t *)) \
+  X( \
+    rmw_publisher_count_matched_subscriptions, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_publisher_t *, size_t *)) \
+  X( \
+    rmw_publisher_get_actual_qos, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_publisher_t *, rmw_qos_profile_t *)) \
+  X( \
+    rmw_publish_serialized_message, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, \
+    ( \
+      const rmw_publisher_t *, const rmw_serialized_message_t *, \
+      rmw_publisher_allocation_t *)) \
+  X( \
+    rmw_get_serialized_message_size, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, ( \
+      const rosidl_message_type_support_t *, \
+      const rosidl_runtime_c__Sequence__bound *, \
+      size_t *)) \
+  X( \
+    rmw_publisher_assert_liveliness, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (const rmw_publisher_t *)) \
+  X( \
+    rmw_serialize, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, ( \
+      const void *, const rosidl_message_type_support_t *, rmw_serialized_message_t *)) \
+  X( \
+    rmw_deserialize, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, ( \
+      const rmw_serialized_message_t *, const rosidl_message_type_support_t *, void *)) \
+  X( \
+    rmw_init_subscription_allocation, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, ( \
+      const rosidl_message_type_support_t *, \
+      const rosidl_runtime_c__Sequence__bound *, \
+      rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_fini_subscription_allocation, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_create_subscription, \
+    rmw_subscription_t *, NULL, \
+    5, ( \
+      const rmw_node_t *, const rosidl_message_type_support_t *, const char *, \
+      const rmw_qos_profile_t *, const rmw_subscription_options_t *)) \
+  X( \
+    rmw_destroy_subscription, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (rmw_node_t *, rmw_subscription_t *)) \
+  X( \
+    rmw_subscription_count_matched_publishers, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_subscription_t *, size_t *)) \
+  X( \
+    rmw_subscription_get_actual_qos, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_subscription_t *, rmw_qos_profile_t *)) \
+  X( \
+    rmw_take, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, (const rmw_subscription_t *, void *, bool *, rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_take_sequence, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    6, ( \
+      const rmw_subscription_t *, size_t, rmw_message_sequence_t *, \
+      rmw_message_info_sequence_t *, size_t *, rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_take_with_info, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, \
+    ( \
+      const rmw_subscription_t *, void *, bool *, rmw_message_info_t *, \
+      rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_take_serialized_message, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, \
+    ( \
+      const rmw_subscription_t *, rmw_serialized_message_t *, bool *, \
+      rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_take_serialized_message_with_info, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, ( \
+      const rmw_subscription_t *, rmw_serialized_message_t *, bool *, rmw_message_info_t *, \
+      rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_create_client, \
+    rmw_client_t *, NULL, \
+    4, ( \
+      const rmw_node_t *, const rosidl_service_type_support_t *, const char *, \
+      const rmw_qos_profile_t *)) \
+  X( \
+    rmw_destroy_client, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (rmw_node_t *, rmw_client_t *)) \
+  X( \
+    rmw_send_request, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_client_t *, const void *, int64_t *)) \
+  X( \
+    rmw_take_response, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, (const rmw_client_t *, rmw_service_info_t *, void *, bool *)) \
+  X( \
+    rmw_create_service, \
+    rmw_service_t *, NULL, \
+    4, ( \
+      const rmw_node_t *, const rosidl_service_type_support_t *, const char *, \
+      const rmw_qos_profile_t *)) \
+  X( \
+    rmw_destroy_service, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (rmw_node_t *, rmw_service_t *)) \
+  X( \
+    rmw_take_request, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, (const rmw_service_t *, rmw_service_info_t *, void *, bool *)) \
+  X( \
+    rmw_send_response, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_service_t *, rmw_request_id_t *, void *)) \
+  X( \
+    rmw_create_guard_condition, \
+    rmw_guard_condition_t *, NULL, \
+    1, (rmw_context_t *)) \
+  X( \
+    rmw_destroy_guard_condition, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_guard_condition_t *)) \
+  X( \
+    rmw_trigger_guard_condition, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (const rmw_guard_condition_t *)) \
+  X( \
+    rmw_create_wait_set, \
+    rmw_wait_set_t *, NULL, \
+    2, (rmw_context_t *, size_t)) \
+  X( \
+    rmw_destroy_wait_set, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_wait_set_t *)) \
+  X( \
+    rmw_wait, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    7, ( \
+      rmw_subscriptions_t *, rmw_guard_conditions_t *, rmw_services_t *, rmw_clients_t *, \
+      rmw_events_t *, rmw_wait_set_t *, const rmw_time_t *)) \
+  X( \
+    rmw_get_publisher_names_and_types_by_node, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    6, ( \
+      const rmw_node_t *, rcutils_allocator_t *, const char *, const char *, bool, \
+      rmw_names_and_types_t *)) \
+  X( \
+    rmw_get_subscriber_names_and_types_by_node, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    6, ( \
+      const rmw_node_t *, rcutils_allocator_t *, const char *, const char *, bool, \
+      rmw_names_and_types_t *)) \
+  X( \
+    rmw_get_service_names_and_types_by_node, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, ( \
+      const rmw_node_t *, rcutils_allocator_t *, const char *, const char *, \
+      rmw_names_and_types_t *)) \
+  X( \
+    rmw_get_client_names_and_types_by_node, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, ( \
+      const rmw_node_t *, rcutils_allocator_t *, const char *, const char *, \
+      rmw_names_and_types_t *)) \
+  X( \
+    rmw_get_topic_names_and_types, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, ( \
+      const rmw_node_t *, rcutils_allocator_t *, bool, \
+      rmw_names_and_types_t *)) \
+  X( \
+    rmw_get_service_names_and_types, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, ( \
+      const rmw_node_t *, rcutils_allocator_t *, \
+      rmw_names_and_types_t *)) \
+  X( \
+    rmw_get_node_names, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_node_t *, rcutils_string_array_t *, rcutils_string_array_t *)) \
+  X( \
+    rmw_get_node_names_with_enclaves, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, ( \
+      const rmw_node_t *, rcutils_string_array_t *, \
+      rcutils_string_array_t *, rcutils_string_array_t *)) \
+  X( \
+    rmw_count_publishers, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_node_t *, const char *, size_t *)) \
+  X( \
+    rmw_count_subscribers, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_node_t *, const char *, size_t *)) \
+  X( \
+    rmw_get_gid_for_publisher, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_publisher_t *, rmw_gid_t *)) \
+  X( \
+    rmw_compare_gids_equal, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_gid_t *, const rmw_gid_t *, bool *)) \
+  X( \
+    rmw_service_server_is_available, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_node_t *, const rmw_client_t *, bool *)) \
+  X( \
+    rmw_set_log_severity, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    1, (rmw_log_severity_t)) \
+  X( \
+    rmw_get_publishers_info_by_topic, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, ( \
+      const rmw_node_t *, \
+      rcutils_allocator_t *, \
+      const char *, \
+      bool, \
+      rmw_topic_endpoint_info_array_t *)) \
+  X( \
+    rmw_get_subscriptions_info_by_topic, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, ( \
+      const rmw_node_t *, \
+      rcutils_allocator_t *, \
+      const char *, \
+      bool, \
+      rmw_topic_endpoint_info_array_t *)) \
+  X( \
+    rmw_qos_profile_check_compatible, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, ( \
+      const rmw_qos_profile_t, \
+      const rmw_qos_profile_t, \
+      rmw_qos_compatibility_type_t *, \
+      char *, \
+      size_t))
+
+// Functions rmw implementations may leave out, grouped by feature.
+// These are bound to a stub returning RMW_RET_UNSUPPORTED, named
+// unsupported_<name> in this package, if missing from the loaded rmw
+// implementation, hence must all return rmw_ret_t.
+#define RMW_IMPLEMENTATION_LOANED_MESSAGES_FNS(X) \
+  X( \
+    rmw_borrow_loaned_message, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, ( \
+      const rmw_publisher_t *, \
+      const rosidl_message_type_support_t *, \
+      void **)) \
+  X( \
+    rmw_publish_loaned_message, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_publisher_t *, void *, rmw_publisher_allocation_t *)) \
+  X( \
+    rmw_return_loaned_message_from_publisher, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_publisher_t *, void *)) \
+  X( \
+    rmw_take_loaned_message, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, ( \
+      const rmw_subscription_t *, void **, bool *, rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_take_loaned_message_with_info, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    5, ( \
+      const rmw_subscription_t *, void **, bool *, rmw_message_info_t *, \
+      rmw_subscription_allocation_t *)) \
+  X( \
+    rmw_return_loaned_message_from_subscription, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_subscription_t *, void *))
+
+#define RMW_IMPLEMENTATION_EVENTS_FNS(X) \
+  X( \
+    rmw_publisher_event_init, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (rmw_event_t *, const rmw_publisher_t *, rmw_event_type_t)) \
+  X( \
+    rmw_subscription_event_init, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (rmw_event_t *, const rmw_subscription_t *, rmw_event_type_t)) \
+  X( \
+    rmw_take_event, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    3, (const rmw_event_t *, void *, bool *))
+
+#define RMW_IMPLEMENTATION_OPTIONAL_FNS(X) \
+  RMW_IMPLEMENTATION_LOANED_MESSAGES_FNS(X) \
+  RMW_IMPLEMENTATION_EVENTS_FNS(X)
+
+// Functions forwarded to the loaded rmw implementation if it has them, and
+// otherwise bound to a fallback named fallback_<name> in this package.
+#define RMW_IMPLEMENTATION_FALLBACK_FNS(X) \
+  X( \
+    rmw_publish_sequence, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    4, ( \
+      const rmw_publisher_t *, \
+      const rmw_message_sequence_t *, \
+      size_t *, \
+      rmw_publisher_allocation_t *))
+
+// rmw_init() prefetches all symbols before being forwarded.
+#define RMW_IMPLEMENTATION_INIT_FN(X) \
+  X( \
+    rmw_init, \
+    rmw_ret_t, RMW_RET_ERROR, \
+    2, (const rmw_init_options_t *, rmw_context_t *))
+
+// All functions resolved from the loaded rmw implementation.
+#define RMW_IMPLEMENTATION_API_FNS(X) \
+  RMW_IMPLEMENTATION_FORWARDED_FNS(X) \
+  RMW_IMPLEMENTATION_OPTIONAL_FNS(X) \
+  RMW_IMPLEMENTATION_FALLBACK_FNS(X) \
+  RMW_IMPLEMENTATION_INIT_FN(X)
+
+#endif  // RMW_IMPLEMENTATION__RMW_INTERFACE_H_
@@ -0,0 +1,182 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__SERIALIZED_MESSAGE_POOL_H_
+#define RMW_IMPLEMENTATION__SERIALIZED_MESSAGE_POOL_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/serialized_message.h"
+#include "rmw/types.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_runtime_c/sequence_bound.h"
+
+#include "rmw_implementation/visibility_control.h"
+
+typedef struct rmw_implementation_serialized_message_pool_impl_s
+  rmw_implementation_serialized_message_pool_impl_t;
+
+/// Pool of serialized messages for messages of one type.
+/**
+ * Serialized messages are sized for the largest serialized message of the
+ * type, if the rmw implementation can tell it, and keep their capacity when
+ * released to the pool.
+ * Serializing, publishing or taking messages of the type into serialized
+ * messages from the pool thus does not reallocate them, once the pool has as
+ * many serialized messages as are used at the same time.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_serialized_message_pool_s
+{
+  /// Capacity of the serialized messages the pool creates, in bytes.
+  size_t buffer_capacity;
+  /// Implementation defined state of the pool.
+  rmw_implementation_serialized_message_pool_impl_t * impl;
+} rmw_implementation_serialized_message_pool_t;
+
+/// Return a zero initialized serialized message pool.
+RMW_IMPLEMENTATION_PUBLIC
+rmw_implementation_serialized_message_pool_t
+rmw_implementation_get_zero_initialized_serialized_message_pool(void);
+
+/// Initialize a serialized message pool for messages of one type.
+/**
+ * The capacity of serialized messages is the one given by
+ * rmw_get_serialized_message_size() for bounded types.
+ * If the rmw implementation cannot tell it, e.g. for unbounded types,
+ * serialized messages are created with `initial_capacity` instead, and still
+ * keep the capacity they grow to.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Yes
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] pool zero initialized pool to initialize.
+ * \param[in] type_support type support of the messages to serialize.
+ * \param[in] message_bounds bounds of the messages to serialize, may be NULL.
+ * \param[in] initial_capacity capacity of serialized messages, in bytes, to use
+ *   if the rmw implementation cannot tell the serialized size of messages.
+ * \param[in] initial_count number of serialized messages to create up front.
+ * \param[in] allocator allocator used for the pool and its serialized messages.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is already initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `type_support` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `allocator` is invalid, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_serialized_message_pool_init(
+  rmw_implementation_serialized_message_pool_t * pool,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  size_t initial_capacity,
+  size_t initial_count,
+  const rcutils_allocator_t * allocator);
+
+/// Finalize a serialized message pool.
+/**
+ * All serialized messages taken from the pool must have been released to it.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | No
+ * Uses Atomics       | No
+ * Lock-Free          | Yes
+ *
+ * \param[inout] pool pool to finalize, zero initialized on success.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is not initialized, or
+ * \return `RMW_RET_ERROR` if serialized messages have not been released.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_serialized_message_pool_fini(
+  rmw_implementation_serialized_message_pool_t * pool);
+
+/// Take a serialized message from a pool.
+/**
+ * A new serialized message is created if none is left in the pool.
+ * The serialized message has no content, and must be released to the pool
+ * it was taken from.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | Only if no serialized message is left
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] pool pool to take a serialized message from.
+ * \param[out] serialized_message serialized message taken from the pool.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `serialized_message` is NULL, or
+ * \return `RMW_RET_BAD_ALLOC` if memory allocation fails.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_serialized_message_pool_acquire(
+  rmw_implementation_serialized_message_pool_t * pool,
+  rmw_serialized_message_t ** serialized_message);
+
+/// Give a serialized message back to the pool it was taken from.
+/**
+ * The serialized message keeps its capacity, but not its content.
+ *
+ * <hr>
+ * Attribute          | Adherence
+ * ------------------ | -------------
+ * Allocates Memory   | No
+ * Thread-Safe        | Yes
+ * Uses Atomics       | No
+ * Lock-Free          | No
+ *
+ * \param[in] pool pool the serialized message was taken from.
+ * \param[in] serialized_message serialized message to give back.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `pool` is not initialized, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `serialized_message` is NULL, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if no serialized message taken from the
+ *   pool is left to release.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_serialized_message_pool_release(
+  rmw_implementation_serialized_message_pool_t * pool,
+  rmw_serialized_message_t * serialized_message);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__SERIALIZED_MESSAGE_POOL_H_
@@ -12,8 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#ifndef VISIBILITY_CONTROL_H_
-#define VISIBILITY_CONTROL_H_
+#ifndef RMW_IMPLEMENTATION__VISIBILITY_CONTROL_H_
+#define RMW_IMPLEMENTATION__VISIBILITY_CONTROL_H_
 
 #ifdef __cplusplus
 extern "C"
@@ -59,4 +59,4 @@ extern "C"
 }
 #endif
 
-#endif  // VISIBILITY_CONTROL_H_
+#endif  // RMW_IMPLEMENTATION__VISIBILITY_CONTROL_H_
@@ -0,0 +1,120 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_IMPLEMENTATION__WAIT_TIMING_H_
+#define RMW_IMPLEMENTATION__WAIT_TIMING_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rmw/types.h"
+
+#include "rmw_implementation/profiling.h"
+#include "rmw_implementation/visibility_control.h"
+
+/// Timing of calls made to rmw_wait() while timing waits.
+/**
+ * Histograms have the same buckets as those of function profiles, see
+ * rmw_implementation_function_profile_t.
+ */
+typedef struct RMW_IMPLEMENTATION_PUBLIC_TYPE rmw_implementation_wait_timing_s
+{
+  /// Number of calls made to rmw_wait().
+  uint64_t wait_count;
+  /// Time spent in rmw_wait() by all calls, in nanoseconds.
+  uint64_t total_wait_duration_ns;
+  /// Number of calls to rmw_wait() by duration.
+  uint64_t wait_duration_histogram[RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE];
+  /// Number of calls to rmw_wait() woken up by a guard condition.
+  /**
+   * Only guard conditions triggered with rmw_trigger_guard_condition() during
+   * the call count, as the time these are triggered at is known.
+   */
+  uint64_t wakeup_count;
+  /// Time from triggering guard conditions to rmw_wait() returning, in nanoseconds.
+  /**
+   * Only the first guard condition triggered during each call counts.
+   */
+  uint64_t total_wakeup_latency_ns;
+  /// Number of calls to rmw_wait() woken up by a guard condition, by latency.
+  uint64_t wakeup_latency_histogram[RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE];
+} rmw_implementation_wait_timing_t;
+
+/// Start timing calls made to rmw_wait().
+/**
+ * Calls to rmw_wait() and rmw_trigger_guard_condition() are forwarded to the
+ * rmw implementation through a timing layer until wait timing is disabled, or
+ * the rmw implementation is unloaded.
+ * Each call to rmw_wait() is timed, and so is the time it takes to return
+ * once woken up by a guard condition, i.e. its wake-up latency, which tells
+ * blocking in rmw_wait() apart from the overhead of returning from it.
+ * When wait timing is disabled, calls are forwarded as they would be otherwise.
+ *
+ * Enabling wait timing when already enabled has no effect.
+ *
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_ERROR` if the rmw implementation could not be loaded.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_timing_enable(void);
+
+/// Stop timing calls made to rmw_wait().
+/**
+ * Timings are kept, until reset.
+ *
+ * Disabling wait timing when not enabled has no effect.
+ *
+ * \return `RMW_RET_OK`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_timing_disable(void);
+
+/// Check whether calls made to rmw_wait() are being timed.
+RMW_IMPLEMENTATION_PUBLIC
+bool
+rmw_implementation_wait_timing_is_enabled(void);
+
+/// Take a snapshot of the timing of calls made to rmw_wait().
+/**
+ * Timings cover all calls made since wait timing was first enabled, or since
+ * timings were last reset.
+ *
+ * \param[out] timing timing to fill.
+ * \return `RMW_RET_OK` if successful, or
+ * \return `RMW_RET_INVALID_ARGUMENT` if `timing` is `NULL`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_timing_snapshot(rmw_implementation_wait_timing_t * timing);
+
+/// Reset the timing of calls made to rmw_wait().
+/**
+ * \return `RMW_RET_OK`.
+ */
+RMW_IMPLEMENTATION_PUBLIC
+rmw_ret_t
+rmw_implementation_wait_timing_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_IMPLEMENTATION__WAIT_TIMING_H_
@@ -0,0 +1,341 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/allocation_arena.h"
+
+#include <deque>
+#include <mutex>
+#include <new>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "./allocator.hpp"
+
+namespace
+{
+
+template<typename AllocationT>
+struct AllocationTraits;
+
+template<>
+struct AllocationTraits<rmw_publisher_allocation_t>
+{
+  static rmw_ret_t
+  init(
+    const rosidl_message_type_support_t * type_support,
+    const rosidl_runtime_c__Sequence__bound * message_bounds,
+    rmw_publisher_allocation_t * allocation)
+  {
+    return rmw_init_publisher_allocation(type_support, message_bounds, allocation);
+  }
+
+  static rmw_ret_t
+  fini(rmw_publisher_allocation_t * allocation)
+  {
+    return rmw_fini_publisher_allocation(allocation);
+  }
+};
+
+template<>
+struct AllocationTraits<rmw_subscription_allocation_t>
+{
+  static rmw_ret_t
+  init(
+    const rosidl_message_type_support_t * type_support,
+    const rosidl_runtime_c__Sequence__bound * message_bounds,
+    rmw_subscription_allocation_t * allocation)
+  {
+    return rmw_init_subscription_allocation(type_support, message_bounds, allocation);
+  }
+
+  static rmw_ret_t
+  fini(rmw_subscription_allocation_t * allocation)
+  {
+    return rmw_fini_subscription_allocation(allocation);
+  }
+};
+
+template<typename AllocationT>
+struct ArenaEntry
+{
+  // Entity the allocation is for, NULL once released.
+  const void * entity;
+  const rosidl_message_type_support_t * type_support;
+  const rosidl_runtime_c__Sequence__bound * message_bounds;
+  // Whether the rmw implementation supports preallocation, if not the
+  // allocation is not initialized and NULL is handed out instead.
+  bool supported;
+  AllocationT allocation;
+};
+
+// Allocations of one kind, keyed by entity, type support and message bounds.
+// Entities do not share allocations, as concurrent calls using the same one
+// would race in rmw implementations that preallocate.
+// Entries are few, one per publisher or subscription, hence looked up
+// linearly, and kept in a deque so that allocations handed out stay put as
+// entries are added. Released entries are reused rather than removed, for the
+// same reason.
+template<typename AllocationT>
+class Allocations
+{
+public:
+  explicit Allocations(const rcutils_allocator_t & allocator)
+  : entries_(typename Entries::allocator_type(allocator))
+  {
+  }
+
+  rmw_ret_t
+  get(
+    const void * entity,
+    const rosidl_message_type_support_t * type_support,
+    const rosidl_runtime_c__Sequence__bound * message_bounds,
+    AllocationT ** allocation)
+  {
+    for (ArenaEntry<AllocationT> & entry : entries_) {
+      if (entry.entity == entity && entry.type_support == type_support &&
+        entry.message_bounds == message_bounds)
+      {
+        *allocation = entry.supported ? &entry.allocation : nullptr;
+        return RMW_RET_OK;
+      }
+    }
+
+    ArenaEntry<AllocationT> * free_entry = nullptr;
+    for (ArenaEntry<AllocationT> & entry : entries_) {
+      if (nullptr == entry.entity) {
+        free_entry = &entry;
+        break;
+      }
+    }
+    if (nullptr == free_entry) {
+      try {
+        entries_.emplace_back();
+      } catch (const std::bad_alloc &) {
+        RMW_SET_ERROR_MSG("failed to allocate arena entry");
+        return RMW_RET_BAD_ALLOC;
+      }
+      free_entry = &entries_.back();
+    }
+    ArenaEntry<AllocationT> & entry = *free_entry;
+    entry.entity = entity;
+    entry.type_support = type_support;
+    entry.message_bounds = message_bounds;
+    rmw_ret_t ret = AllocationTraits<AllocationT>::init(
+      type_support, message_bounds, &entry.allocation);
+    if (RMW_RET_UNSUPPORTED == ret) {
+      rmw_reset_error();
+      entry.supported = false;
+    } else if (RMW_RET_OK != ret) {
+      entry.entity = nullptr;
+      return ret;
+    } else {
+      entry.supported = true;
+    }
+    *allocation = entry.supported ? &entry.allocation : nullptr;
+    return RMW_RET_OK;
+  }
+
+  // Finalize the allocations of an entity, leaving their entries free.
+  rmw_ret_t
+  release(const void * entity)
+  {
+    rmw_ret_t ret = RMW_RET_OK;
+    for (ArenaEntry<AllocationT> & entry : entries_) {
+      if (entry.entity == entity) {
+        release_entry(entry, ret);
+      }
+    }
+    return ret;
+  }
+
+  rmw_ret_t
+  fini()
+  {
+    rmw_ret_t ret = RMW_RET_OK;
+    for (ArenaEntry<AllocationT> & entry : entries_) {
+      if (nullptr != entry.entity) {
+        release_entry(entry, ret);
+      }
+    }
+    entries_.clear();
+    return ret;
+  }
+
+private:
+  static void
+  release_entry(ArenaEntry<AllocationT> & entry, rmw_ret_t & ret)
+  {
+    entry.entity = nullptr;
+    if (!entry.supported) {
+      return;
+    }
+    rmw_ret_t fini_ret = AllocationTraits<AllocationT>::fini(&entry.allocation);
+    if (RMW_RET_OK != fini_ret) {
+      if (RMW_RET_OK == ret) {
+        ret = fini_ret;
+      } else {
+        // keep the first error
+        rmw_reset_error();
+      }
+    }
+  }
+
+  using Entries = std::deque<
+    ArenaEntry<AllocationT>, rmw_implementation::RcutilsAllocator<ArenaEntry<AllocationT>>>;
+
+  Entries entries_;
+};
+
+}  // namespace
+
+struct rmw_implementation_allocation_arena_impl_s
+{
+  explicit rmw_implementation_allocation_arena_impl_s(const rcutils_allocator_t & allocator)
+  : allocator(allocator), publisher_allocations(allocator), subscription_allocations(allocator)
+  {
+  }
+
+  rcutils_allocator_t allocator;
+  std::mutex mutex;
+  Allocations<rmw_publisher_allocation_t> publisher_allocations;
+  Allocations<rmw_subscription_allocation_t> subscription_allocations;
+};
+
+extern "C"
+{
+rmw_implementation_allocation_arena_t
+rmw_implementation_get_zero_initialized_allocation_arena(void)
+{
+  rmw_implementation_allocation_arena_t arena;
+  arena.impl = nullptr;
+  return arena;
+}
+
+rmw_ret_t
+rmw_implementation_allocation_arena_init(
+  rmw_implementation_allocation_arena_t * arena,
+  const rcutils_allocator_t * allocator)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(arena, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != arena->impl) {
+    RMW_SET_ERROR_MSG("allocation arena is already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  void * memory = allocator->allocate(
+    sizeof(rmw_implementation_allocation_arena_impl_t), allocator->state);
+  if (nullptr == memory) {
+    RMW_SET_ERROR_MSG("failed to allocate allocation arena");
+    return RMW_RET_BAD_ALLOC;
+  }
+  try {
+    arena->impl = new (memory) rmw_implementation_allocation_arena_impl_t(*allocator);
+  } catch (const std::bad_alloc &) {
+    allocator->deallocate(memory, allocator->state);
+    RMW_SET_ERROR_MSG("failed to allocate allocation arena");
+    return RMW_RET_BAD_ALLOC;
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_allocation_arena_fini(rmw_implementation_allocation_arena_t * arena)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(arena, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    arena->impl, "allocation arena is not initialized", return RMW_RET_INVALID_ARGUMENT);
+
+  rmw_implementation_allocation_arena_impl_t * impl = arena->impl;
+  rmw_ret_t ret = impl->publisher_allocations.fini();
+  rmw_ret_t subscription_ret = impl->subscription_allocations.fini();
+  if (RMW_RET_OK == ret) {
+    ret = subscription_ret;
+  } else if (RMW_RET_OK != subscription_ret) {
+    // keep the first error
+    rmw_reset_error();
+  }
+  rcutils_allocator_t allocator = impl->allocator;
+  impl->~rmw_implementation_allocation_arena_impl_t();
+  allocator.deallocate(impl, allocator.state);
+  *arena = rmw_implementation_get_zero_initialized_allocation_arena();
+  return ret;
+}
+
+rmw_ret_t
+rmw_implementation_allocation_arena_release(
+  rmw_implementation_allocation_arena_t * arena,
+  const void * entity)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(arena, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    arena->impl, "allocation arena is not initialized", return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(entity, RMW_RET_INVALID_ARGUMENT);
+
+  std::lock_guard<std::mutex> lock(arena->impl->mutex);
+  rmw_ret_t ret = arena->impl->publisher_allocations.release(entity);
+  rmw_ret_t subscription_ret = arena->impl->subscription_allocations.release(entity);
+  if (RMW_RET_OK == ret) {
+    ret = subscription_ret;
+  } else if (RMW_RET_OK != subscription_ret) {
+    // keep the first error
+    rmw_reset_error();
+  }
+  return ret;
+}
+
+rmw_ret_t
+rmw_implementation_allocation_arena_get_publisher_allocation(
+  rmw_implementation_allocation_arena_t * arena,
+  const rmw_publisher_t * publisher,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_publisher_allocation_t ** allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(arena, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    arena->impl, "allocation arena is not initialized", return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+
+  std::lock_guard<std::mutex> lock(arena->impl->mutex);
+  return arena->impl->publisher_allocations.get(
+    publisher, type_support, message_bounds, allocation);
+}
+
+rmw_ret_t
+rmw_implementation_allocation_arena_get_subscription_allocation(
+  rmw_implementation_allocation_arena_t * arena,
+  const rmw_subscription_t * subscription,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_subscription_allocation_t ** allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(arena, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    arena->impl, "allocation arena is not initialized", return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+
+  std::lock_guard<std::mutex> lock(arena->impl->mutex);
+  return arena->impl->subscription_allocations.get(
+    subscription, type_support, message_bounds, allocation);
+}
+}  // extern "C"
@@ -0,0 +1,94 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ALLOCATOR_HPP_
+#define ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+#include "rcutils/allocator.h"
+
+namespace rmw_implementation
+{
+
+/// Standard allocator allocating through an rcutils allocator.
+/**
+ * Lets standard containers allocate their elements with the allocator given
+ * by callers, rather than with the global operator new.
+ * \throws std::bad_alloc if the rcutils allocator fails to allocate.
+ */
+template<typename T>
+class RcutilsAllocator
+{
+public:
+  using value_type = T;
+
+  explicit RcutilsAllocator(const rcutils_allocator_t & allocator) noexcept
+  : allocator_(allocator)
+  {
+  }
+
+  template<typename U>
+  RcutilsAllocator(const RcutilsAllocator<U> & other) noexcept  // NOLINT(runtime/explicit)
+  : allocator_(other.get_rcutils_allocator())
+  {
+  }
+
+  T * allocate(size_t count)
+  {
+    if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    void * memory = allocator_.allocate(count * sizeof(T), allocator_.state);
+    if (nullptr == memory) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T *>(memory);
+  }
+
+  void deallocate(T * memory, size_t) noexcept
+  {
+    allocator_.deallocate(memory, allocator_.state);
+  }
+
+  const rcutils_allocator_t & get_rcutils_allocator() const noexcept
+  {
+    return allocator_;
+  }
+
+private:
+  rcutils_allocator_t allocator_;
+};
+
+template<typename T, typename U>
+bool operator==(const RcutilsAllocator<T> & lhs, const RcutilsAllocator<U> & rhs) noexcept
+{
+  const rcutils_allocator_t & lhs_allocator = lhs.get_rcutils_allocator();
+  const rcutils_allocator_t & rhs_allocator = rhs.get_rcutils_allocator();
+  return lhs_allocator.allocate == rhs_allocator.allocate &&
+         lhs_allocator.deallocate == rhs_allocator.deallocate &&
+         lhs_allocator.state == rhs_allocator.state;
+}
+
+template<typename T, typename U>
+bool operator!=(const RcutilsAllocator<T> & lhs, const RcutilsAllocator<U> & rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+}  // namespace rmw_implementation
+
+#endif  // ALLOCATOR_HPP_
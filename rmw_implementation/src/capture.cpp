@@ -0,0 +1,894 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/capture.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "rcutils/get_env.h"
+
+#include "rmw/error_handling.h"
+
+#include "./capture.hpp"
+#include "./forwarding.hpp"
+#include "./functions.hpp"
+
+namespace
+{
+
+// Capture files start with a header, followed by records. Each record is a
+// header, the null terminated topic name, then the serialized message, padded
+// so that records stay 8 bytes aligned. Fields are in host byte order.
+constexpr char file_magic[8] = {'R', 'M', 'W', 'C', 'A', 'P', 'T', '\0'};
+constexpr uint32_t file_version = 1u;
+
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  // Size of the records that follow, in bytes.
+  uint64_t data_size;
+  uint64_t record_count;
+};
+
+struct RecordHeader
+{
+  int64_t timestamp_ns;
+  uint64_t payload_size;
+  // Size of the topic name, including its terminating null character.
+  uint32_t topic_name_size;
+  uint32_t direction;
+};
+
+constexpr size_t record_alignment = 8u;
+
+size_t
+aligned_size(size_t size)
+{
+  return (size + record_alignment - 1u) & ~(record_alignment - 1u);
+}
+
+}  // namespace
+
+namespace rmw_implementation
+{
+namespace
+{
+
+// Records as buffered by threads, tagged with the capture they were made
+// during so that those left over from a previous capture are not written out.
+struct EntryHeader
+{
+  uint32_t capture_id;
+  // Size of the record that follows, in bytes.
+  uint32_t record_size;
+};
+
+// Ring of records captured by a single thread, and written out by the writer
+// thread. Positions only ever increase, and wrap around the data, whose
+// capacity is a power of two so that entries never wrap within their header.
+struct ThreadBuffer
+{
+  ThreadBuffer(uint8_t * data, size_t capacity)
+  : data(data), capacity(capacity)
+  {
+  }
+
+  ~ThreadBuffer()
+  {
+    delete[] data;
+  }
+
+  void copy_in(uint64_t position, const void * source, size_t size)
+  {
+    if (0u == size) {
+      return;
+    }
+    const size_t offset = static_cast<size_t>(position & (capacity - 1u));
+    const size_t size_before_end = std::min(size, capacity - offset);
+    memcpy(data + offset, source, size_before_end);
+    memcpy(data, static_cast<const uint8_t *>(source) + size_before_end, size - size_before_end);
+  }
+
+  void copy_out(uint64_t position, void * destination, size_t size) const
+  {
+    if (0u == size) {
+      return;
+    }
+    const size_t offset = static_cast<size_t>(position & (capacity - 1u));
+    const size_t size_before_end = std::min(size, capacity - offset);
+    memcpy(destination, data + offset, size_before_end);
+    memcpy(static_cast<uint8_t *>(destination) + size_before_end, data, size - size_before_end);
+  }
+
+  uint8_t * data;
+  const size_t capacity;
+  // Position up to which records are buffered, only stored by the capturing thread.
+  std::atomic<uint64_t> head{0u};
+  // Position up to which records are written out, only stored by the writer.
+  std::atomic<uint64_t> tail{0u};
+  // Number of records dropped as the buffer was full, since last written out.
+  std::atomic<uint64_t> dropped_count{0u};
+};
+
+// Buffer a record, or drop it if the buffer is full.
+void
+buffer_record(
+  ThreadBuffer & buffer,
+  uint32_t capture_id,
+  const RecordHeader & header,
+  const char * topic_name,
+  const uint8_t * payload)
+{
+  const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  const uint64_t tail = buffer.tail.load(std::memory_order_acquire);
+  const size_t free_size = buffer.capacity - static_cast<size_t>(head - tail);
+  if (header.payload_size > buffer.capacity || header.topic_name_size > buffer.capacity) {
+    buffer.dropped_count.fetch_add(1u, std::memory_order_relaxed);
+    return;
+  }
+  const size_t unaligned_size = sizeof(RecordHeader) + header.topic_name_size +
+    static_cast<size_t>(header.payload_size);
+  const size_t record_size = aligned_size(unaligned_size);
+  if (record_size > std::numeric_limits<uint32_t>::max()) {
+    // too large for its entry header
+    buffer.dropped_count.fetch_add(1u, std::memory_order_relaxed);
+    return;
+  }
+  if (sizeof(EntryHeader) + record_size > free_size) {
+    buffer.dropped_count.fetch_add(1u, std::memory_order_relaxed);
+    return;
+  }
+  static constexpr uint8_t padding[record_alignment] = {};
+  const EntryHeader entry{capture_id, static_cast<uint32_t>(record_size)};
+  uint64_t position = head;
+  buffer.copy_in(position, &entry, sizeof(entry));
+  position += sizeof(entry);
+  buffer.copy_in(position, &header, sizeof(header));
+  position += sizeof(header);
+  buffer.copy_in(position, topic_name, header.topic_name_size);
+  position += header.topic_name_size;
+  buffer.copy_in(position, payload, static_cast<size_t>(header.payload_size));
+  position += header.payload_size;
+  buffer.copy_in(position, padding, record_size - unaligned_size);
+  buffer.head.store(head + sizeof(entry) + record_size, std::memory_order_release);
+}
+
+// Memory mapped capture file.
+class CaptureFile
+{
+public:
+  bool is_open() const
+  {
+    return nullptr != data_;
+  }
+
+  rmw_ret_t open(const char * file_path, size_t size)
+  {
+#ifdef _WIN32
+    (void)file_path;
+    (void)size;
+    RMW_SET_ERROR_MSG("capture is not supported on Windows");
+    return RMW_RET_UNSUPPORTED;
+#else
+    int fd = ::open(file_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+        "failed to create capture file '%s': %s", file_path, strerror(errno));
+      return RMW_RET_ERROR;
+    }
+    if (0 != ftruncate(fd, static_cast<off_t>(size))) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+        "failed to size capture file '%s': %s", file_path, strerror(errno));
+      ::close(fd);
+      return RMW_RET_ERROR;
+    }
+    void * data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == data) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+        "failed to map capture file '%s': %s", file_path, strerror(errno));
+      ::close(fd);
+      return RMW_RET_ERROR;
+    }
+    fd_ = fd;
+    data_ = static_cast<uint8_t *>(data);
+    size_ = size;
+    data_size_ = 0u;
+    record_count_ = 0u;
+    FileHeader header{};
+    memcpy(header.magic, file_magic, sizeof(header.magic));
+    header.version = file_version;
+    memcpy(data_, &header, sizeof(header));
+    return RMW_RET_OK;
+#endif
+  }
+
+  // Write a record out of a thread buffer, unless the file is full.
+  bool write(const ThreadBuffer & buffer, uint64_t position, size_t record_size)
+  {
+    if (record_size > size_ - sizeof(FileHeader) - data_size_) {
+      return false;
+    }
+    buffer.copy_out(position, data_ + sizeof(FileHeader) + data_size_, record_size);
+    data_size_ += record_size;
+    ++record_count_;
+    return true;
+  }
+
+  // Publish records written out so far in the file header.
+  void update_header()
+  {
+    FileHeader * header = reinterpret_cast<FileHeader *>(data_);
+    header->data_size = data_size_;
+    header->record_count = record_count_;
+  }
+
+  rmw_ret_t close()
+  {
+#ifdef _WIN32
+    return RMW_RET_OK;
+#else
+    update_header();
+    rmw_ret_t ret = RMW_RET_OK;
+    if (0 != munmap(data_, size_)) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to unmap capture file: %s", strerror(errno));
+      ret = RMW_RET_ERROR;
+    }
+    // the file is mapped with its maximum size
+    if (RMW_RET_OK == ret &&
+      0 != ftruncate(fd_, static_cast<off_t>(sizeof(FileHeader) + data_size_)))
+    {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to truncate capture file: %s", strerror(errno));
+      ret = RMW_RET_ERROR;
+    }
+    if (0 != ::close(fd_) && RMW_RET_OK == ret) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to close capture file: %s", strerror(errno));
+      ret = RMW_RET_ERROR;
+    }
+    fd_ = -1;
+    data_ = nullptr;
+    size_ = 0u;
+    return ret;
+#endif
+  }
+
+  uint64_t data_size() const
+  {
+    return data_size_;
+  }
+
+  uint64_t record_count() const
+  {
+    return record_count_;
+  }
+
+private:
+  int fd_{-1};
+  uint8_t * data_{nullptr};
+  size_t size_{0u};
+  uint64_t data_size_{0u};
+  uint64_t record_count_{0u};
+};
+
+constexpr size_t default_max_file_size = 64u * 1024u * 1024u;
+constexpr size_t default_thread_buffer_size = 1024u * 1024u;
+constexpr std::chrono::milliseconds write_out_period(10);
+
+// Serializes enabling and disabling capture.
+std::mutex g_capture_mutex;
+std::atomic<bool> g_capture_enabled{false};
+// Whether capture is disabled on exit, guarded by the capture mutex.
+bool g_disable_capture_on_exit_registered = false;
+std::atomic<uint32_t> g_capture_id{0u};
+std::atomic<size_t> g_thread_buffer_size{default_thread_buffer_size};
+
+// Buffers of threads that captured records, the file these are written out
+// to and the writer thread, all guarded by the buffers mutex.
+std::mutex g_buffers_mutex;
+std::condition_variable g_writer_condition;
+std::vector<ThreadBuffer *> g_thread_buffers;
+CaptureFile g_capture_file;
+uint64_t g_dropped_count = 0u;
+bool g_stop_writer = false;
+std::thread g_writer_thread;
+
+// Write out the records of a thread buffer.
+// Must be called with the buffers mutex held.
+void
+write_out(ThreadBuffer & buffer)
+{
+  const uint32_t capture_id = g_capture_id.load(std::memory_order_relaxed);
+  uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+  const uint64_t head = buffer.head.load(std::memory_order_acquire);
+  while (tail != head) {
+    EntryHeader entry;
+    buffer.copy_out(tail, &entry, sizeof(entry));
+    tail += sizeof(entry);
+    if (capture_id == entry.capture_id && g_capture_file.is_open()) {
+      if (!g_capture_file.write(buffer, tail, entry.record_size)) {
+        ++g_dropped_count;
+      }
+    }
+    tail += entry.record_size;
+  }
+  buffer.tail.store(tail, std::memory_order_release);
+  g_dropped_count += buffer.dropped_count.exchange(0u, std::memory_order_relaxed);
+}
+
+// Must be called with the buffers mutex held.
+void
+write_out_all()
+{
+  for (ThreadBuffer * buffer : g_thread_buffers) {
+    write_out(*buffer);
+  }
+  if (g_capture_file.is_open()) {
+    g_capture_file.update_header();
+  }
+}
+
+void
+write_out_periodically()
+{
+  std::unique_lock<std::mutex> lock(g_buffers_mutex);
+  while (!g_stop_writer) {
+    g_writer_condition.wait_for(lock, write_out_period);
+    write_out_all();
+  }
+}
+
+class ThreadBufferRegistration
+{
+public:
+  ThreadBufferRegistration()
+  : buffer_(nullptr)
+  {
+  }
+
+  ~ThreadBufferRegistration()
+  {
+    if (!buffer_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+    write_out(*buffer_);
+    g_thread_buffers.erase(
+      std::remove(g_thread_buffers.begin(), g_thread_buffers.end(), buffer_),
+      g_thread_buffers.end());
+    delete buffer_;
+  }
+
+  // Replace the buffer with one of the given capacity, once the records of
+  // the current one are written out. The current buffer is kept if the new
+  // one cannot be allocated.
+  void reset(size_t capacity)
+  {
+    uint8_t * data = new (std::nothrow) uint8_t[capacity];
+    if (!data) {
+      return;
+    }
+    ThreadBuffer * buffer = new (std::nothrow) ThreadBuffer(data, capacity);
+    if (!buffer) {
+      delete[] data;
+      return;
+    }
+    std::lock_guard<std::mutex> lock(g_buffers_mutex);
+    if (buffer_) {
+      write_out(*buffer_);
+      *std::find(g_thread_buffers.begin(), g_thread_buffers.end(), buffer_) = buffer;
+      delete buffer_;
+      buffer_ = buffer;
+      return;
+    }
+    try {
+      g_thread_buffers.push_back(buffer);
+    } catch (const std::bad_alloc &) {
+      delete buffer;
+      return;
+    }
+    buffer_ = buffer;
+  }
+
+  ThreadBuffer * buffer_;
+};
+
+// Buffer of this thread, cached outside of its registration as accessing
+// thread locals that need constructing is slower, and the buffer size it was
+// last reset for.
+thread_local ThreadBuffer * t_buffer = nullptr;
+thread_local size_t t_buffer_size = 0u;
+
+ThreadBuffer *
+get_thread_buffer()
+{
+  const size_t buffer_size = g_thread_buffer_size.load(std::memory_order_relaxed);
+  if (t_buffer_size != buffer_size) {
+    // Registered on the first record captured by each thread, and reset on
+    // the first one after capture is enabled with another buffer size.
+    // Records of threads for which a buffer could not be allocated are not
+    // captured.
+    static thread_local ThreadBufferRegistration registration;
+    registration.reset(buffer_size);
+    t_buffer = registration.buffer_;
+    t_buffer_size = buffer_size;
+  }
+  return t_buffer;
+}
+
+void
+capture(
+  rmw_implementation_capture_direction_t direction,
+  int64_t timestamp_ns,
+  const char * topic_name,
+  const rmw_serialized_message_t * serialized_message)
+{
+  ThreadBuffer * buffer = get_thread_buffer();
+  if (!buffer) {
+    return;
+  }
+  if (!topic_name) {
+    topic_name = "";
+  }
+  RecordHeader header;
+  header.timestamp_ns = timestamp_ns;
+  header.payload_size = serialized_message->buffer_length;
+  header.topic_name_size = static_cast<uint32_t>(strlen(topic_name) + 1u);
+  header.direction = static_cast<uint32_t>(direction);
+  buffer_record(
+    *buffer, g_capture_id.load(std::memory_order_relaxed), header, topic_name,
+    serialized_message->buffer);
+}
+
+int64_t
+now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Functions the capturers forward to, as swapped out of the dispatch table.
+DispatchTable g_captured_table;
+
+rmw_ret_t
+capture_rmw_publish_serialized_message(
+  const rmw_publisher_t * publisher,
+  const rmw_serialized_message_t * serialized_message,
+  rmw_publisher_allocation_t * allocation)
+{
+  const int64_t timestamp_ns = now_ns();
+  rmw_ret_t ret = g_captured_table.rmw_publish_serialized_message.load(
+    std::memory_order_relaxed)(publisher, serialized_message, allocation);
+  if (RMW_RET_OK == ret && g_capture_enabled.load(std::memory_order_relaxed)) {
+    capture(
+      RMW_IMPLEMENTATION_CAPTURE_PUBLISHED, timestamp_ns, publisher->topic_name,
+      serialized_message);
+  }
+  return ret;
+}
+
+rmw_ret_t
+capture_rmw_take_serialized_message(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message,
+  bool * taken,
+  rmw_subscription_allocation_t * allocation)
+{
+  rmw_ret_t ret = g_captured_table.rmw_take_serialized_message.load(
+    std::memory_order_relaxed)(subscription, serialized_message, taken, allocation);
+  if (RMW_RET_OK == ret && *taken && g_capture_enabled.load(std::memory_order_relaxed)) {
+    capture(
+      RMW_IMPLEMENTATION_CAPTURE_TAKEN, now_ns(), subscription->topic_name, serialized_message);
+  }
+  return ret;
+}
+
+rmw_ret_t
+capture_rmw_take_serialized_message_with_info(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message,
+  bool * taken,
+  rmw_message_info_t * message_info,
+  rmw_subscription_allocation_t * allocation)
+{
+  rmw_ret_t ret = g_captured_table.rmw_take_serialized_message_with_info.load(
+    std::memory_order_relaxed)(subscription, serialized_message, taken, message_info, allocation);
+  if (RMW_RET_OK == ret && *taken && g_capture_enabled.load(std::memory_order_relaxed)) {
+    capture(
+      RMW_IMPLEMENTATION_CAPTURE_TAKEN, now_ns(), subscription->topic_name, serialized_message);
+  }
+  return ret;
+}
+
+#define CAPTURED_FNS(X) \
+  X(rmw_publish_serialized_message) \
+  X(rmw_take_serialized_message) \
+  X(rmw_take_serialized_message_with_info)
+
+#define INSTALL_CAPTURER(name) \
+  INTERPOSE_DISPATCH_TABLE_ENTRY(g_captured_table, name, capture_ ## name)
+
+#define UNINSTALL_CAPTURER(name) \
+  RESTORE_DISPATCH_TABLE_ENTRY(g_captured_table, name, capture_ ## name)
+
+rmw_ret_t
+disable_capture();
+
+// Write out and close the capture file on exit, e.g. when capturing from
+// rmw_init() on.
+void
+disable_capture_on_exit()
+{
+  if (RMW_RET_OK != disable_capture()) {
+    rmw_reset_error();
+  }
+}
+
+rmw_ret_t
+enable_capture(const char * file_path, const rmw_implementation_capture_options_t & options)
+{
+  if (options.max_file_size <= sizeof(FileHeader)) {
+    RMW_SET_ERROR_MSG("max_file_size is too small for the capture file header");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  constexpr size_t max_thread_buffer_size = (std::numeric_limits<size_t>::max() >> 1u) + 1u;
+  if (0u == options.thread_buffer_size || options.thread_buffer_size > max_thread_buffer_size) {
+    RMW_SET_ERROR_MSG("thread_buffer_size is zero or too large");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  size_t thread_buffer_size = record_alignment;
+  while (thread_buffer_size < options.thread_buffer_size) {
+    thread_buffer_size <<= 1u;
+  }
+
+  std::lock_guard<std::mutex> lock(g_capture_mutex);
+  if (g_capture_enabled.load()) {
+    RMW_SET_ERROR_MSG("capture is already enabled");
+    return RMW_RET_ERROR;
+  }
+  // Registered once the interposers and the capture state are constructed, so
+  // as to run before these are destroyed, in whichever order files are.
+  if (!g_disable_capture_on_exit_registered) {
+    if (0 != std::atexit(disable_capture_on_exit)) {
+      RMW_SET_ERROR_MSG("failed to register disabling capture on exit");
+      return RMW_RET_ERROR;
+    }
+    g_disable_capture_on_exit_registered = true;
+  }
+  // only bound entries can be captured
+  prefetch_symbols();
+  if (!all_symbols_resolved()) {
+    // error message set by prefetch_symbols()
+    return RMW_RET_ERROR;
+  }
+  {
+    std::lock_guard<std::mutex> buffers_lock(g_buffers_mutex);
+    rmw_ret_t ret = g_capture_file.open(file_path, options.max_file_size);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    // drop records left over from the last capture
+    g_capture_id.fetch_add(1u, std::memory_order_relaxed);
+    write_out_all();
+    g_dropped_count = 0u;
+    g_stop_writer = false;
+    try {
+      g_writer_thread = std::thread(write_out_periodically);
+    } catch (const std::system_error & e) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to start capture writer thread: %s", e.what());
+      if (RMW_RET_OK != g_capture_file.close()) {
+        rmw_reset_error();
+      }
+      return RMW_RET_ERROR;
+    }
+  }
+  g_thread_buffer_size.store(thread_buffer_size, std::memory_order_relaxed);
+  CAPTURED_FNS(INSTALL_CAPTURER)
+  g_capture_enabled.store(true);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+disable_capture()
+{
+  std::lock_guard<std::mutex> lock(g_capture_mutex);
+  if (!g_capture_enabled.load()) {
+    return RMW_RET_OK;
+  }
+  CAPTURED_FNS(UNINSTALL_CAPTURER)
+  g_capture_enabled.store(false);
+  {
+    std::lock_guard<std::mutex> buffers_lock(g_buffers_mutex);
+    g_stop_writer = true;
+  }
+  g_writer_condition.notify_one();
+  g_writer_thread.join();
+  std::lock_guard<std::mutex> buffers_lock(g_buffers_mutex);
+  write_out_all();
+  return g_capture_file.close();
+}
+
+}  // namespace
+
+void
+enable_capture_from_env()
+{
+  const char * value = nullptr;
+  if (rcutils_get_env(RMW_IMPLEMENTATION_CAPTURE_ENV_VAR, &value) || !value || '\0' == value[0]) {
+    return;
+  }
+  if (g_capture_enabled.load()) {
+    return;
+  }
+  // calls are still forwarded if capture cannot be enabled
+  if (RMW_RET_OK != enable_capture(value, rmw_implementation_get_default_capture_options())) {
+    rmw_reset_error();
+  }
+}
+
+}  // namespace rmw_implementation
+
+struct rmw_implementation_capture_reader_impl_s
+{
+  rcutils_allocator_t allocator;
+  uint8_t * data;
+  size_t data_size;
+  size_t position;
+};
+
+namespace
+{
+
+using ReaderImpl = rmw_implementation_capture_reader_impl_t;
+
+// Check that records lay within the data of the file.
+bool
+check_records(const uint8_t * data, size_t data_size, uint64_t record_count)
+{
+  size_t position = 0u;
+  for (uint64_t i = 0u; i < record_count; ++i) {
+    if (data_size - position < sizeof(RecordHeader)) {
+      return false;
+    }
+    RecordHeader header;
+    memcpy(&header, data + position, sizeof(header));
+    const size_t size_left = data_size - position - sizeof(RecordHeader);
+    if (0u == header.topic_name_size || header.topic_name_size > size_left ||
+      header.payload_size > size_left - header.topic_name_size ||
+      header.direction > RMW_IMPLEMENTATION_CAPTURE_TAKEN)
+    {
+      return false;
+    }
+    const char * topic_name = reinterpret_cast<const char *>(data + position + sizeof(header));
+    if ('\0' != topic_name[header.topic_name_size - 1u]) {
+      return false;
+    }
+    const size_t record_size = aligned_size(
+      sizeof(RecordHeader) + header.topic_name_size + static_cast<size_t>(header.payload_size));
+    if (record_size > data_size - position) {
+      return false;
+    }
+    position += record_size;
+  }
+  return position == data_size;
+}
+
+}  // namespace
+
+#define CHECK_CAPTURE_READER(reader) \
+  do { \
+    RMW_CHECK_ARGUMENT_FOR_NULL(reader, RMW_RET_INVALID_ARGUMENT); \
+    if (nullptr == (reader)->impl) { \
+      RMW_SET_ERROR_MSG("capture reader is not initialized"); \
+      return RMW_RET_INVALID_ARGUMENT; \
+    } \
+  } while (0)
+
+extern "C"
+{
+rmw_implementation_capture_options_t
+rmw_implementation_get_default_capture_options(void)
+{
+  rmw_implementation_capture_options_t options;
+  options.max_file_size = rmw_implementation::default_max_file_size;
+  options.thread_buffer_size = rmw_implementation::default_thread_buffer_size;
+  return options;
+}
+
+rmw_ret_t
+rmw_implementation_capture_enable(
+  const char * file_path,
+  const rmw_implementation_capture_options_t * options)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(file_path, RMW_RET_INVALID_ARGUMENT);
+  if (!options) {
+    return rmw_implementation::enable_capture(
+      file_path, rmw_implementation_get_default_capture_options());
+  }
+  return rmw_implementation::enable_capture(file_path, *options);
+}
+
+rmw_ret_t
+rmw_implementation_capture_disable(void)
+{
+  return rmw_implementation::disable_capture();
+}
+
+bool
+rmw_implementation_capture_is_enabled(void)
+{
+  return rmw_implementation::g_capture_enabled.load();
+}
+
+rmw_ret_t
+rmw_implementation_capture_get_stats(rmw_implementation_capture_stats_t * stats)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(stats, RMW_RET_INVALID_ARGUMENT);
+  std::lock_guard<std::mutex> lock(rmw_implementation::g_buffers_mutex);
+  stats->record_count = rmw_implementation::g_capture_file.record_count();
+  stats->dropped_count = rmw_implementation::g_dropped_count;
+  stats->byte_count = rmw_implementation::g_capture_file.data_size();
+  return RMW_RET_OK;
+}
+
+rmw_implementation_capture_reader_t
+rmw_implementation_get_zero_initialized_capture_reader(void)
+{
+  rmw_implementation_capture_reader_t reader;
+  reader.record_count = 0u;
+  reader.impl = nullptr;
+  return reader;
+}
+
+rmw_ret_t
+rmw_implementation_capture_reader_init(
+  rmw_implementation_capture_reader_t * reader,
+  const char * file_path,
+  const rcutils_allocator_t * allocator)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(reader, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != reader->impl) {
+    RMW_SET_ERROR_MSG("capture reader is already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(file_path, RMW_RET_INVALID_ARGUMENT);
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  FILE * file = fopen(file_path, "rb");
+  if (!file) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "failed to open capture file '%s': %s", file_path, strerror(errno));
+    return RMW_RET_ERROR;
+  }
+  FileHeader header;
+  if (1u != fread(&header, sizeof(header), 1u, file) ||
+    0 != memcmp(header.magic, file_magic, sizeof(header.magic)))
+  {
+    fclose(file);
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("'%s' is not a capture file", file_path);
+    return RMW_RET_ERROR;
+  }
+  if (file_version != header.version) {
+    fclose(file);
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "capture file '%s' has unsupported version %u", file_path,
+      static_cast<unsigned int>(header.version));
+    return RMW_RET_ERROR;
+  }
+  if (header.data_size > std::numeric_limits<size_t>::max()) {
+    fclose(file);
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("capture file '%s' is too large", file_path);
+    return RMW_RET_ERROR;
+  }
+  const size_t data_size = static_cast<size_t>(header.data_size);
+
+  void * memory = allocator->allocate(sizeof(ReaderImpl), allocator->state);
+  if (nullptr == memory) {
+    fclose(file);
+    RMW_SET_ERROR_MSG("failed to allocate capture reader");
+    return RMW_RET_BAD_ALLOC;
+  }
+  ReaderImpl * impl = new (memory) ReaderImpl{*allocator, nullptr, data_size, 0u};
+  if (data_size > 0u) {
+    impl->data = static_cast<uint8_t *>(allocator->allocate(data_size, allocator->state));
+    if (nullptr == impl->data) {
+      fclose(file);
+      allocator->deallocate(impl, allocator->state);
+      RMW_SET_ERROR_MSG("failed to allocate capture reader data");
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
+  const bool read = data_size == fread(impl->data, 1u, data_size, file);
+  fclose(file);
+  if (!read || !check_records(impl->data, data_size, header.record_count)) {
+    if (impl->data) {
+      allocator->deallocate(impl->data, allocator->state);
+    }
+    allocator->deallocate(impl, allocator->state);
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("capture file '%s' is truncated or corrupt", file_path);
+    return RMW_RET_ERROR;
+  }
+  reader->record_count = header.record_count;
+  reader->impl = impl;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_capture_reader_next(
+  rmw_implementation_capture_reader_t * reader,
+  rmw_implementation_capture_record_t * record,
+  bool * found)
+{
+  CHECK_CAPTURE_READER(reader);
+  RMW_CHECK_ARGUMENT_FOR_NULL(record, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(found, RMW_RET_INVALID_ARGUMENT);
+  ReaderImpl * impl = reader->impl;
+  if (impl->position == impl->data_size) {
+    *found = false;
+    return RMW_RET_OK;
+  }
+  // records were checked when initializing the reader
+  uint8_t * data = impl->data + impl->position;
+  RecordHeader header;
+  memcpy(&header, data, sizeof(header));
+  record->timestamp_ns = header.timestamp_ns;
+  record->direction = static_cast<rmw_implementation_capture_direction_t>(header.direction);
+  record->topic_name = reinterpret_cast<const char *>(data + sizeof(header));
+  record->serialized_message = rmw_get_zero_initialized_serialized_message();
+  record->serialized_message.buffer = data + sizeof(header) + header.topic_name_size;
+  record->serialized_message.buffer_length = static_cast<size_t>(header.payload_size);
+  record->serialized_message.buffer_capacity = static_cast<size_t>(header.payload_size);
+  impl->position += aligned_size(
+    sizeof(header) + header.topic_name_size + static_cast<size_t>(header.payload_size));
+  *found = true;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_capture_reader_fini(rmw_implementation_capture_reader_t * reader)
+{
+  CHECK_CAPTURE_READER(reader);
+  ReaderImpl * impl = reader->impl;
+  rcutils_allocator_t allocator = impl->allocator;
+  if (impl->data) {
+    allocator.deallocate(impl->data, allocator.state);
+  }
+  allocator.deallocate(impl, allocator.state);
+  *reader = rmw_implementation_get_zero_initialized_capture_reader();
+  return RMW_RET_OK;
+}
+}  // extern "C"
@@ -0,0 +1,26 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CAPTURE_HPP_
+#define CAPTURE_HPP_
+
+namespace rmw_implementation
+{
+
+/// Enable capture if requested via the environment.
+void enable_capture_from_env();
+
+}  // namespace rmw_implementation
+
+#endif  // CAPTURE_HPP_
@@ -0,0 +1,206 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/dispatch_table.h"
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rcpputils/shared_library.hpp"
+
+#include "rcutils/shared_library.h"
+
+#include "rmw/error_handling.h"
+
+#include "./forwarding.hpp"
+#include "./functions.hpp"
+
+namespace
+{
+
+struct LoadedImplementation
+{
+  std::string name;
+  std::shared_ptr<rcpputils::SharedLibrary> lib;
+  // Kept open as long as the library, i.e. for the lifetime of the process.
+  rcutils_shared_library_t handle = rcutils_get_zero_initialized_shared_library();
+  rmw_implementation_dispatch_table_t table;
+  // Implementation loaded before this one, never changed once published.
+  const LoadedImplementation * previous{nullptr};
+
+  ~LoadedImplementation()
+  {
+    if (rcutils_is_shared_library_loaded(&handle)) {
+      if (RCUTILS_RET_OK != rcutils_unload_shared_library(&handle)) {
+        rmw_reset_error();
+      }
+    }
+  }
+};
+
+std::mutex g_implementations_mutex;
+std::vector<std::unique_ptr<LoadedImplementation>> g_implementations;
+// Last loaded implementation, heading an append-only list of all of them
+// that can be walked without taking g_implementations_mutex.
+std::atomic<const LoadedImplementation *> g_last_implementation{nullptr};
+
+// Find the table an entity belongs to from the identifier it was stamped
+// with, which is the very pointer returned by rmw_get_implementation_identifier().
+const rmw_implementation_dispatch_table_t *
+find_table_by_identifier_pointer(const char * implementation_identifier)
+{
+  for (const LoadedImplementation * implementation =
+    g_last_implementation.load(std::memory_order_acquire);
+    nullptr != implementation; implementation = implementation->previous)
+  {
+    if (implementation->table.implementation_identifier == implementation_identifier) {
+      return &implementation->table;
+    }
+  }
+  return nullptr;
+}
+
+#define BIND_DISPATCH_TABLE_ENTRY(name, ...) \
+  implementation->table.name = reinterpret_cast<decltype(implementation->table.name)>( \
+    lookup_symbol(implementation->lib, #name)); \
+  if (!implementation->table.name) { \
+    /* error message set by lookup_symbol() */ \
+    return nullptr; \
+  }
+
+// Bind an entry to the same stub or fallback the process-wide dispatch table
+// would bind it to, if missing from the rmw implementation.
+#define BIND_DISPATCH_TABLE_ENTRY_OR(name, fallback) \
+  implementation->table.name = reinterpret_cast<decltype(implementation->table.name)>( \
+    find_symbol(implementation->handle, #name)); \
+  if (!implementation->table.name) { \
+    implementation->table.name = &fallback; \
+  }
+
+#define BIND_OPTIONAL_DISPATCH_TABLE_ENTRY(name, ...) \
+  BIND_DISPATCH_TABLE_ENTRY_OR(name, rmw_implementation::unsupported_ ## name)
+
+#define BIND_FALLBACK_DISPATCH_TABLE_ENTRY(name, ...) \
+  BIND_DISPATCH_TABLE_ENTRY_OR(name, table_fallback_ ## name)
+
+// Fallbacks of dispatch tables, which call functions of the table the entity
+// passed belongs to rather than those of the process-wide rmw implementation.
+
+rmw_ret_t
+table_fallback_rmw_publish_sequence(
+  const rmw_publisher_t * publisher,
+  const rmw_message_sequence_t * message_sequence,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  const rmw_implementation_dispatch_table_t * table =
+    find_table_by_identifier_pointer(publisher->implementation_identifier);
+  if (!table) {
+    RMW_SET_ERROR_MSG("publisher implementation identifier not loaded");
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION;
+  }
+  return rmw_implementation::publish_sequence_one_by_one(
+    table->rmw_publish, publisher, message_sequence, published, allocation);
+}
+
+std::unique_ptr<LoadedImplementation>
+load_implementation(const char * rmw_implementation)
+{
+  std::unique_ptr<LoadedImplementation> implementation(new LoadedImplementation());
+  implementation->name = rmw_implementation;
+  implementation->lib = load_library(implementation->name);
+  if (!implementation->lib) {
+    // error message set by load_library()
+    return nullptr;
+  }
+  if (!open_library_handle(implementation->lib, implementation->handle)) {
+    // error message set by open_library_handle()
+    return nullptr;
+  }
+  RMW_IMPLEMENTATION_FORWARDED_FNS(BIND_DISPATCH_TABLE_ENTRY)
+  RMW_IMPLEMENTATION_OPTIONAL_FNS(BIND_OPTIONAL_DISPATCH_TABLE_ENTRY)
+  RMW_IMPLEMENTATION_FALLBACK_FNS(BIND_FALLBACK_DISPATCH_TABLE_ENTRY)
+  RMW_IMPLEMENTATION_INIT_FN(BIND_DISPATCH_TABLE_ENTRY)
+  implementation->table.name = implementation->name.c_str();
+  implementation->table.implementation_identifier =
+    implementation->table.rmw_get_implementation_identifier();
+  return implementation;
+}
+
+}  // namespace
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+const rmw_implementation_dispatch_table_t *
+rmw_implementation_load(const char * rmw_implementation)
+{
+  if (!rmw_implementation) {
+    RMW_SET_ERROR_MSG("rmw_implementation argument is null");
+    return nullptr;
+  }
+  try {
+    std::lock_guard<std::mutex> lock(g_implementations_mutex);
+    for (const std::unique_ptr<LoadedImplementation> & implementation : g_implementations) {
+      if (implementation->name == rmw_implementation) {
+        return &implementation->table;
+      }
+    }
+    std::unique_ptr<LoadedImplementation> implementation = load_implementation(rmw_implementation);
+    if (!implementation) {
+      return nullptr;
+    }
+    implementation->previous = g_last_implementation.load(std::memory_order_relaxed);
+    g_implementations.push_back(std::move(implementation));
+    g_last_implementation.store(g_implementations.back().get(), std::memory_order_release);
+    return &g_implementations.back()->table;
+  } catch (const std::exception & e) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "failed to load rmw implementation '%s' due to %s",
+      rmw_implementation, e.what());
+    return nullptr;
+  }
+}
+
+const rmw_implementation_dispatch_table_t *
+rmw_implementation_find(const char * implementation_identifier)
+{
+  if (!implementation_identifier) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(g_implementations_mutex);
+  for (const std::unique_ptr<LoadedImplementation> & implementation : g_implementations) {
+    const char * identifier = implementation->table.implementation_identifier;
+    if (identifier == implementation_identifier ||
+      0 == std::strcmp(identifier, implementation_identifier))
+    {
+      return &implementation->table;
+    }
+  }
+  return nullptr;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstddef>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/extensions.h"
+
+#include "./forwarding.hpp"
+
+namespace rmw_implementation
+{
+
+// Fallbacks for functions with fallbacks missing from the loaded rmw
+// implementation.
+// These are only ever bound in the dispatch table, so call other functions
+// through it directly rather than through their forwarders.
+
+rmw_ret_t
+publish_sequence_one_by_one(
+  rmw_ret_t (* publish)(const rmw_publisher_t *, const void *, rmw_publisher_allocation_t *),
+  const rmw_publisher_t * publisher,
+  const rmw_message_sequence_t * message_sequence,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(message_sequence, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(published, RMW_RET_INVALID_ARGUMENT);
+
+  *published = 0u;
+  for (size_t i = 0u; i < message_sequence->size; ++i) {
+    rmw_ret_t ret = publish(publisher, message_sequence->data[i], allocation);
+    if (RMW_RET_OK != ret) {
+      // error message set by rmw_publish()
+      return ret;
+    }
+    ++(*published);
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+fallback_rmw_publish_sequence(
+  const rmw_publisher_t * publisher,
+  const rmw_message_sequence_t * message_sequence,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation)
+{
+  // dispatched once for all messages
+  return publish_sequence_one_by_one(
+    g_dispatch_table.rmw_publish.load(std::memory_order_acquire),
+    publisher, message_sequence, published, allocation);
+}
+
+// Stubs for optional functions missing from the loaded rmw implementation.
+
+// cppcheck-suppress preprocessorErrorDirective
+#define DEFINE_UNSUPPORTED(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType unsupported_ ## name ArgTypes \
+  { \
+    RMW_SET_ERROR_MSG(#name " is not supported by the rmw implementation"); \
+    return RMW_RET_UNSUPPORTED; \
+  }
+
+RMW_IMPLEMENTATION_OPTIONAL_FNS(DEFINE_UNSUPPORTED)
+
+}  // namespace rmw_implementation
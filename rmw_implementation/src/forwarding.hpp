@@ -0,0 +1,221 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FORWARDING_HPP_
+#define FORWARDING_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "rmw_implementation/rmw_interface.h"
+
+#define EXPAND(x) x
+
+#define ARG_VALUES_0(...)
+#define ARG_VALUES_1(t1) v1
+#define ARG_VALUES_2(t2, ...) v2, EXPAND(ARG_VALUES_1(__VA_ARGS__))
+#define ARG_VALUES_3(t3, ...) v3, EXPAND(ARG_VALUES_2(__VA_ARGS__))
+#define ARG_VALUES_4(t4, ...) v4, EXPAND(ARG_VALUES_3(__VA_ARGS__))
+#define ARG_VALUES_5(t5, ...) v5, EXPAND(ARG_VALUES_4(__VA_ARGS__))
+#define ARG_VALUES_6(t6, ...) v6, EXPAND(ARG_VALUES_5(__VA_ARGS__))
+#define ARG_VALUES_7(t7, ...) v7, EXPAND(ARG_VALUES_6(__VA_ARGS__))
+
+#define ARGS_0(...) __VA_ARGS__
+#define ARGS_1(t1) t1 v1
+#define ARGS_2(t2, ...) t2 v2, EXPAND(ARGS_1(__VA_ARGS__))
+#define ARGS_3(t3, ...) t3 v3, EXPAND(ARGS_2(__VA_ARGS__))
+#define ARGS_4(t4, ...) t4 v4, EXPAND(ARGS_3(__VA_ARGS__))
+#define ARGS_5(t5, ...) t5 v5, EXPAND(ARGS_4(__VA_ARGS__))
+#define ARGS_6(t6, ...) t6 v6, EXPAND(ARGS_5(__VA_ARGS__))
+#define ARGS_7(t7, ...) t7 v7, EXPAND(ARGS_6(__VA_ARGS__))
+
+namespace rmw_implementation
+{
+
+#define DISPATCH_TABLE_ENTRY(name, ReturnType, error_value, _NR, ArgTypes) \
+  std::atomic<ReturnType (*) ArgTypes> name;
+
+// Dispatch table of functions the forwarders jump to. Entries initially point
+// to resolvers that bind the actual symbol on first use, so that forwarding a
+// call never has to check whether it has been resolved.
+// Entries are atomic so that they can be bound from any thread, and so that
+// bound entries can be interposed on e.g. to profile calls.
+struct DispatchTable
+{
+  RMW_IMPLEMENTATION_API_FNS(DISPATCH_TABLE_ENTRY)
+};
+
+extern DispatchTable g_dispatch_table;
+
+// Functions of the rmw implementation as bound in the dispatch table, before
+// any interposer is stacked on these, for calls made by this library itself,
+// e.g. waits on graph guard conditions that are not to be profiled, timed or
+// delayed. Entries point to the resolvers of the dispatch table until bound.
+extern DispatchTable g_implementation_table;
+
+// Call a function of the rmw implementation, bypassing interposers.
+#define CALL_IMPLEMENTATION(name, ...) \
+  rmw_implementation::g_implementation_table.name.load(std::memory_order_acquire)(__VA_ARGS__)
+
+#define DECLARE_RESOLVER(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType resolve_ ## name(EXPAND(ARGS_ ## _NR ArgTypes));
+
+RMW_IMPLEMENTATION_API_FNS(DECLARE_RESOLVER)
+
+#define DECLARE_FALLBACK(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType fallback_ ## name(EXPAND(ARGS_ ## _NR ArgTypes));
+
+RMW_IMPLEMENTATION_FALLBACK_FNS(DECLARE_FALLBACK)
+
+// Publish a sequence of messages one at a time with the given rmw_publish(),
+// as the fallback of rmw_publish_sequence() does.
+rmw_ret_t
+publish_sequence_one_by_one(
+  rmw_ret_t (* publish)(const rmw_publisher_t *, const void *, rmw_publisher_allocation_t *),
+  const rmw_publisher_t * publisher,
+  const rmw_message_sequence_t * message_sequence,
+  size_t * published,
+  rmw_publisher_allocation_t * allocation);
+
+#define DECLARE_UNSUPPORTED(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType unsupported_ ## name ArgTypes;
+
+RMW_IMPLEMENTATION_OPTIONAL_FNS(DECLARE_UNSUPPORTED)
+
+#define SYMBOL_PRESENCE_ENTRY(name, ...) std::atomic<bool> name;
+
+// Whether functions that may be missing from the loaded rmw implementation
+// were found in it, as set when binding these.
+struct SymbolPresence
+{
+  RMW_IMPLEMENTATION_OPTIONAL_FNS(SYMBOL_PRESENCE_ENTRY)
+  RMW_IMPLEMENTATION_FALLBACK_FNS(SYMBOL_PRESENCE_ENTRY)
+};
+
+extern SymbolPresence g_symbol_presence;
+
+// Layer of interposers, e.g. profilers, forwarding calls to the functions in
+// its next table.
+// Layers stack on an entry of the dispatch table in the order they are
+// installed in, each calling the next function of the chain, down to the
+// function of the rmw implementation.
+struct InterposerLayer
+{
+  DispatchTable * next_table;
+  // Interposers installed by the layer, null for the entries not interposed on.
+  DispatchTable interposers;
+};
+
+// Serializes changes to the chains of interposers.
+extern std::mutex g_interposer_mutex;
+
+// There is one layer per kind of interposer, e.g. profiling or wait timing.
+constexpr size_t max_interposer_layer_count = 8u;
+
+// Layers of interposers installed so far, in no particular order.
+extern InterposerLayer g_interposer_layers[max_interposer_layer_count];
+extern size_t g_interposer_layer_count;
+
+// Get the layer forwarding to the functions of a next table, registering it
+// on first use, or null if there are more layers than there is room for.
+// Must be called with g_interposer_mutex held.
+InterposerLayer *
+get_interposer_layer(DispatchTable & next_table);
+
+// Find the link of the chain of interposers of an entry that calls a function:
+// the entry of the dispatch table if the function is the first one called, or
+// the entry of the next table of the layer calling it otherwise.
+// Must be called with g_interposer_mutex held.
+template<typename FunctionSignature>
+std::atomic<FunctionSignature> *
+find_interposer_link(std::atomic<FunctionSignature> DispatchTable::* entry, FunctionSignature fn)
+{
+  std::atomic<FunctionSignature> * link = &(g_dispatch_table.*entry);
+  while (true) {
+    FunctionSignature called = link->load(std::memory_order_relaxed);
+    if (called == fn) {
+      return link;
+    }
+    InterposerLayer * end = g_interposer_layers + g_interposer_layer_count;
+    InterposerLayer * layer = std::find_if(
+      g_interposer_layers, end,
+      [entry, called](const InterposerLayer & layer) {
+        return (layer.interposers.*entry).load(std::memory_order_relaxed) == called;
+      });
+    if (layer == end) {
+      // reached the function of the rmw implementation
+      return nullptr;
+    }
+    link = &(layer->next_table->*entry);
+  }
+}
+
+// Install an interposer on top of the chain of a bound entry of the dispatch
+// table, keeping the function it is stacked on in the matching entry of the
+// next table, to be called by the interposer.
+// Entries still pointing to their resolver are left alone, as resolving
+// would bind the entry again, and so are entries the interposer is already
+// installed on, wherever it is in the chain.
+template<typename FunctionSignature>
+void
+interpose_dispatch_table_entry(
+  DispatchTable & next_table,
+  std::atomic<FunctionSignature> DispatchTable::* entry,
+  FunctionSignature resolver,
+  FunctionSignature interposer)
+{
+  std::lock_guard<std::mutex> lock(g_interposer_mutex);
+  FunctionSignature fn = (g_dispatch_table.*entry).load(std::memory_order_acquire);
+  if (fn == resolver || find_interposer_link(entry, interposer)) {
+    return;
+  }
+  InterposerLayer * layer = get_interposer_layer(next_table);
+  if (!layer) {
+    return;
+  }
+  (layer->interposers.*entry).store(interposer, std::memory_order_relaxed);
+  (next_table.*entry).store(fn, std::memory_order_relaxed);
+  (g_dispatch_table.*entry).compare_exchange_strong(
+    fn, interposer, std::memory_order_release);
+}
+
+// Unlink an interposer from the chain of an entry of the dispatch table,
+// wherever it is in the chain, so that the function calling it calls the
+// function it is stacked on instead.
+// Calls already in the interposer still forward through its next table,
+// which is left as is.
+template<typename FunctionSignature>
+void
+restore_dispatch_table_entry(
+  DispatchTable & next_table,
+  std::atomic<FunctionSignature> DispatchTable::* entry,
+  FunctionSignature interposer)
+{
+  std::lock_guard<std::mutex> lock(g_interposer_mutex);
+  std::atomic<FunctionSignature> * link = find_interposer_link(entry, interposer);
+  if (link) {
+    link->store((next_table.*entry).load(std::memory_order_relaxed), std::memory_order_release);
+  }
+}
+
+#define INTERPOSE_DISPATCH_TABLE_ENTRY(next_table, name, interposer) \
+  interpose_dispatch_table_entry(next_table, &DispatchTable::name, &resolve_ ## name, &interposer);
+
+#define RESTORE_DISPATCH_TABLE_ENTRY(next_table, name, interposer) \
+  restore_dispatch_table_entry(next_table, &DispatchTable::name, &interposer);
+
+}  // namespace rmw_implementation
+
+#endif  // FORWARDING_HPP_
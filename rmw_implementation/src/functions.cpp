@@ -14,33 +14,49 @@
 
 #include "./functions.hpp"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <atomic>
 #include <cstddef>
 #include <stdexcept>
 
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "rcutils/allocator.h"
 #include "rcutils/format_string.h"
 #include "rcutils/get_env.h"
-#include "rcutils/types/string_array.h"
 
 #include "rcpputils/get_env.hpp"
 #include "rcpputils/shared_library.hpp"
 
 #include "rmw/error_handling.h"
-#include "rmw/event.h"
-#include "rmw/names_and_types.h"
-#include "rmw/get_node_info_and_types.h"
-#include "rmw/get_service_names_and_types.h"
-#include "rmw/get_topic_endpoint_info.h"
-#include "rmw/get_topic_names_and_types.h"
 #include "rmw/rmw.h"
 
+#include "rmw_implementation/capture.h"
+#include "rmw_implementation/features.h"
+#include "rmw_implementation/injection.h"
+#include "rmw_implementation/profiling.h"
+#include "rmw_implementation/rmw_interface.h"
+#include "rmw_implementation/wait_timing.h"
+
+#include "./capture.hpp"
+#include "./forwarding.hpp"
+#include "./preload.hpp"
+#include "./profiling.hpp"
+#include "./tracepoints.hpp"
+
 #define STRINGIFY_(s) #s
 #define STRINGIFY(s) STRINGIFY_(s)
 
+static std::mutex g_rmw_lib_mutex;
 static std::shared_ptr<rcpputils::SharedLibrary> g_rmw_lib = nullptr;
+static rcutils_shared_library_t g_rmw_lib_handle = rcutils_get_zero_initialized_shared_library();
 
 std::shared_ptr<rcpputils::SharedLibrary>
 load_library()
@@ -59,17 +75,35 @@ load_library()
     env_var = STRINGIFY(DEFAULT_RMW_IMPLEMENTATION);
   }
 
+  return load_library(env_var);
+}
+
+std::shared_ptr<rcpputils::SharedLibrary>
+load_library(const std::string & rmw_implementation)
+{
   std::string library_name;
   try {
-    library_name = rcpputils::get_platform_library_name(env_var);
+    library_name = rcpputils::get_platform_library_name(rmw_implementation);
   } catch (const std::exception & e) {
     RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
       "failed to compute shared library name due to %s", e.what());
     return nullptr;
   }
 
+  rmw_implementation::PreloadMode preload_mode;
+  if (!rmw_implementation::get_preload_mode(preload_mode)) {
+    // error message set by get_preload_mode()
+    return nullptr;
+  }
+
   try {
-    return std::make_shared<rcpputils::SharedLibrary>(library_name);
+    if (rmw_implementation::PreloadMode::none == preload_mode) {
+      return std::make_shared<rcpputils::SharedLibrary>(library_name);
+    }
+    auto preloaded_library =
+      std::make_shared<rmw_implementation::PreloadedSharedLibrary>(library_name, preload_mode);
+    return std::shared_ptr<rcpputils::SharedLibrary>(
+      preloaded_library, &preloaded_library->library);
   } catch (const std::exception & e) {
     RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
       "failed to load shared library '%s' due to %s",
@@ -81,14 +115,37 @@ load_library()
 std::shared_ptr<rcpputils::SharedLibrary>
 get_library()
 {
+  // only reached while resolving symbols, never when forwarding calls
+  std::lock_guard<std::mutex> lock(g_rmw_lib_mutex);
   if (!g_rmw_lib) {
     g_rmw_lib = load_library();
   }
   return g_rmw_lib;
 }
 
+const rcutils_shared_library_t *
+get_library_handle()
+{
+  // only reached while resolving symbols, never when forwarding calls
+  std::lock_guard<std::mutex> lock(g_rmw_lib_mutex);
+  if (!g_rmw_lib) {
+    g_rmw_lib = load_library();
+    if (!g_rmw_lib) {
+      // error message set by load_library()
+      return nullptr;
+    }
+  }
+  if (!rcutils_is_shared_library_loaded(&g_rmw_lib_handle)) {
+    if (!open_library_handle(g_rmw_lib, g_rmw_lib_handle)) {
+      // error message set by open_library_handle()
+      return nullptr;
+    }
+  }
+  return &g_rmw_lib_handle;
+}
+
 void *
-lookup_symbol(std::shared_ptr<rcpputils::SharedLibrary> lib, const std::string & symbol_name)
+lookup_symbol(const std::shared_ptr<rcpputils::SharedLibrary> & lib, const char * symbol_name)
 {
   if (!lib) {
     if (!rmw_error_is_set()) {
@@ -97,20 +154,44 @@ lookup_symbol(std::shared_ptr<rcpputils::SharedLibrary> lib, const std::string &
     return nullptr;
   }
 
-  if (!lib->has_symbol(symbol_name)) {
-    try {
-      std::string library_path = lib->get_library_path();
-      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
-        "failed to resolve symbol '%s' in shared library '%s'",
-        symbol_name.c_str(), library_path.c_str());
-    } catch (const std::exception & e) {
-      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
-        "failed to resolve symbol '%s' in shared library due to %s",
-        symbol_name.c_str(), e.what());
-    }
+  // Look the symbol up once, as checking for it first would take two lookups.
+  // Only failing to find it throws, and thus allocates.
+  try {
+    return lib->get_symbol(symbol_name);
+  } catch (const std::exception & e) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "failed to resolve symbol '%s' in shared library due to %s",
+      symbol_name, e.what());
     return nullptr;
   }
-  return lib->get_symbol(symbol_name);
+}
+
+bool
+open_library_handle(
+  const std::shared_ptr<rcpputils::SharedLibrary> & lib,
+  rcutils_shared_library_t & handle)
+{
+  handle = rcutils_get_zero_initialized_shared_library();
+  // the library is already loaded, so this only takes a reference to it
+  rcutils_ret_t ret = rcutils_load_shared_library(
+    &handle, lib->get_library_path().c_str(), rcutils_get_default_allocator());
+  if (RCUTILS_RET_OK != ret) {
+    // error message set by rcutils_load_shared_library()
+    return false;
+  }
+  return true;
+}
+
+void *
+find_symbol(const rcutils_shared_library_t & handle, const char * symbol_name)
+{
+  // Unlike rcutils_get_symbol(), neither sets an error message when missing.
+#ifdef _WIN32
+  return reinterpret_cast<void *>(
+    GetProcAddress(static_cast<HINSTANCE>(handle.lib_pointer), symbol_name));
+#else
+  return dlsym(handle.lib_pointer, symbol_name);
+#endif
 }
 
 void *
@@ -126,667 +207,287 @@ get_symbol(const char * symbol_name)
   }
 }
 
+namespace rmw_implementation
+{
+
+#define LAZY_DISPATCH_TABLE_ENTRY(name, ...) {&resolve_ ## name},
+
+DispatchTable g_dispatch_table = {
+  RMW_IMPLEMENTATION_API_FNS(LAZY_DISPATCH_TABLE_ENTRY)
+};
+
+DispatchTable g_implementation_table = {
+  RMW_IMPLEMENTATION_API_FNS(LAZY_DISPATCH_TABLE_ENTRY)
+};
+
+SymbolPresence g_symbol_presence = {};
+
+std::mutex g_interposer_mutex;
+InterposerLayer g_interposer_layers[max_interposer_layer_count] = {};
+size_t g_interposer_layer_count = 0u;
+
+InterposerLayer *
+get_interposer_layer(DispatchTable & next_table)
+{
+  for (size_t i = 0u; i < g_interposer_layer_count; ++i) {
+    if (g_interposer_layers[i].next_table == &next_table) {
+      return &g_interposer_layers[i];
+    }
+  }
+  if (g_interposer_layer_count == max_interposer_layer_count) {
+    return nullptr;
+  }
+  InterposerLayer * layer = &g_interposer_layers[g_interposer_layer_count++];
+  layer->next_table = &next_table;
+  return layer;
+}
+
+namespace
+{
+
+template<typename FunctionSignature>
+bool
+bind_symbol(
+  std::atomic<FunctionSignature> & entry, std::atomic<FunctionSignature> & implementation_entry,
+  FunctionSignature resolver, const char * symbol_name)
+{
+  if (entry.load(std::memory_order_acquire) != resolver) {
+    // already bound, and possibly interposed on since
+    return true;
+  }
+  void * symbol = get_symbol(symbol_name);
+  if (!symbol) {
+    // error message set by get_symbol()
+    return false;
+  }
+  // Concurrent resolvers of the same entry bind the same symbol, hence the
+  // entry is only bound if it still points to the resolver.
+  implementation_entry.store(
+    reinterpret_cast<FunctionSignature>(symbol), std::memory_order_release);
+  entry.compare_exchange_strong(
+    resolver, reinterpret_cast<FunctionSignature>(symbol), std::memory_order_release);
+  return true;
+}
+
+template<typename FunctionSignature>
+bool
+bind_symbol_or_fallback(
+  std::atomic<FunctionSignature> & entry, std::atomic<FunctionSignature> & implementation_entry,
+  FunctionSignature resolver, FunctionSignature fallback, const char * symbol_name,
+  std::atomic<bool> & present)
+{
+  if (entry.load(std::memory_order_acquire) != resolver) {
+    return true;
+  }
+  void * symbol = nullptr;
+  try {
+    const rcutils_shared_library_t * handle = get_library_handle();
+    if (!handle) {
+      // error message set by get_library_handle(), no fallback as nothing to fall back on
+      return false;
+    }
+    // expected to be missing, hence looked up without failing if so
+    symbol = find_symbol(*handle, symbol_name);
+  } catch (const std::exception & e) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "failed to get symbol '%s' due to %s",
+      symbol_name, e.what());
+    return false;
+  }
+  present.store(nullptr != symbol, std::memory_order_relaxed);
+  FunctionSignature function =
+    symbol ? reinterpret_cast<FunctionSignature>(symbol) : fallback;
+  implementation_entry.store(function, std::memory_order_release);
+  entry.compare_exchange_strong(resolver, function, std::memory_order_release);
+  return true;
+}
+
+// cppcheck-suppress preprocessorErrorDirective
+#define DEFINE_RESOLVER(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType resolve_ ## name(EXPAND(ARGS_ ## _NR ArgTypes)) \
+  { \
+    /* only reached by functions called before rmw_init */ \
+    if (!bind_symbol( \
+        g_dispatch_table.name, g_implementation_table.name, &resolve_ ## name, #name)) \
+    { \
+      return error_value; \
+    } \
+    return g_dispatch_table.name.load(std::memory_order_acquire)( \
+      EXPAND(ARG_VALUES_ ## _NR ArgTypes)); \
+  }
+
+// cppcheck-suppress preprocessorErrorDirective
+#define DEFINE_FALLBACK_RESOLVER(name, ReturnType, error_value, _NR, ArgTypes, fallback) \
+  ReturnType resolve_ ## name(EXPAND(ARGS_ ## _NR ArgTypes)) \
+  { \
+    if (!bind_symbol_or_fallback( \
+        g_dispatch_table.name, g_implementation_table.name, &resolve_ ## name, &fallback, \
+        #name, g_symbol_presence.name)) \
+    { \
+      return error_value; \
+    } \
+    return g_dispatch_table.name.load(std::memory_order_acquire)( \
+      EXPAND(ARG_VALUES_ ## _NR ArgTypes)); \
+  }
+
+#define DEFINE_OPTIONAL_RESOLVER(name, ReturnType, error_value, _NR, ArgTypes) \
+  DEFINE_FALLBACK_RESOLVER(name, ReturnType, error_value, _NR, ArgTypes, unsupported_ ## name)
+
+#define DEFINE_RESOLVER_WITH_FALLBACK(name, ReturnType, error_value, _NR, ArgTypes) \
+  DEFINE_FALLBACK_RESOLVER(name, ReturnType, error_value, _NR, ArgTypes, fallback_ ## name)
+
+}  // namespace
+
+RMW_IMPLEMENTATION_FORWARDED_FNS(DEFINE_RESOLVER)
+RMW_IMPLEMENTATION_OPTIONAL_FNS(DEFINE_OPTIONAL_RESOLVER)
+RMW_IMPLEMENTATION_FALLBACK_FNS(DEFINE_RESOLVER_WITH_FALLBACK)
+RMW_IMPLEMENTATION_INIT_FN(DEFINE_RESOLVER)
+
+}  // namespace rmw_implementation
+
+using rmw_implementation::g_dispatch_table;
+using rmw_implementation::bind_symbol;
+using rmw_implementation::bind_symbol_or_fallback;
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-#define EXPAND(x) x
-
-#define ARG_TYPES(...) __VA_ARGS__
-
-#define ARG_VALUES_0(...)
-#define ARG_VALUES_1(t1) v1
-#define ARG_VALUES_2(t2, ...) v2, EXPAND(ARG_VALUES_1(__VA_ARGS__))
-#define ARG_VALUES_3(t3, ...) v3, EXPAND(ARG_VALUES_2(__VA_ARGS__))
-#define ARG_VALUES_4(t4, ...) v4, EXPAND(ARG_VALUES_3(__VA_ARGS__))
-#define ARG_VALUES_5(t5, ...) v5, EXPAND(ARG_VALUES_4(__VA_ARGS__))
-#define ARG_VALUES_6(t6, ...) v6, EXPAND(ARG_VALUES_5(__VA_ARGS__))
-#define ARG_VALUES_7(t7, ...) v7, EXPAND(ARG_VALUES_6(__VA_ARGS__))
-
-#define ARGS_0(...) __VA_ARGS__
-#define ARGS_1(t1) t1 v1
-#define ARGS_2(t2, ...) t2 v2, EXPAND(ARGS_1(__VA_ARGS__))
-#define ARGS_3(t3, ...) t3 v3, EXPAND(ARGS_2(__VA_ARGS__))
-#define ARGS_4(t4, ...) t4 v4, EXPAND(ARGS_3(__VA_ARGS__))
-#define ARGS_5(t5, ...) t5 v5, EXPAND(ARGS_4(__VA_ARGS__))
-#define ARGS_6(t6, ...) t6 v6, EXPAND(ARGS_5(__VA_ARGS__))
-#define ARGS_7(t7, ...) t7 v7, EXPAND(ARGS_6(__VA_ARGS__))
-
-#define CALL_SYMBOL(symbol_name, ReturnType, error_value, ArgTypes, arg_values) \
-  if (!symbol_ ## symbol_name) { \
-    /* only necessary for functions called before rmw_init */ \
-    symbol_ ## symbol_name = get_symbol(#symbol_name); \
-  } \
-  if (!symbol_ ## symbol_name) { \
-    /* error message set by get_symbol() */ \
-    return error_value; \
-  } \
-  typedef ReturnType (* FunctionSignature)(ArgTypes); \
-  FunctionSignature func = reinterpret_cast<FunctionSignature>(symbol_ ## symbol_name); \
-  return func(arg_values);
-
+#ifdef RMW_IMPLEMENTATION_ENABLE_TRACEPOINTS
+// cppcheck-suppress preprocessorErrorDirective
+#define RMW_INTERFACE_FN(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType name(EXPAND(ARGS_ ## _NR ArgTypes)) \
+  { \
+    const void * handle = TRACEPOINT_HANDLE(name, _NR, ArgTypes); \
+    RMW_IMPLEMENTATION_TRACEPOINT_ENTRY(name, handle, TRACEPOINT_ARG_2_ ## _NR); \
+    ReturnType ret = g_dispatch_table.name.load(std::memory_order_acquire)( \
+      EXPAND(ARG_VALUES_ ## _NR ArgTypes)); \
+    RMW_IMPLEMENTATION_TRACEPOINT_EXIT(name, handle, ret); \
+    return ret; \
+  }
+#else
 // cppcheck-suppress preprocessorErrorDirective
-#define RMW_INTERFACE_FN(name, ReturnType, error_value, _NR, ...) \
-  void * symbol_ ## name = nullptr; \
-  ReturnType name(EXPAND(ARGS_ ## _NR(__VA_ARGS__))) \
+#define RMW_INTERFACE_FN(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType name(EXPAND(ARGS_ ## _NR ArgTypes)) \
   { \
-    CALL_SYMBOL( \
-      name, ReturnType, error_value, ARG_TYPES(__VA_ARGS__), \
-      EXPAND(ARG_VALUES_ ## _NR(__VA_ARGS__))); \
+    return g_dispatch_table.name.load(std::memory_order_acquire)( \
+      EXPAND(ARG_VALUES_ ## _NR ArgTypes)); \
   }
+#endif
+
+RMW_IMPLEMENTATION_FORWARDED_FNS(RMW_INTERFACE_FN)
+RMW_IMPLEMENTATION_OPTIONAL_FNS(RMW_INTERFACE_FN)
+RMW_IMPLEMENTATION_FALLBACK_FNS(RMW_INTERFACE_FN)
+
+#define PREFETCH_SYMBOL(name, ...) \
+  bind_symbol( \
+    g_dispatch_table.name, rmw_implementation::g_implementation_table.name, \
+    &rmw_implementation::resolve_ ## name, #name);
 
-RMW_INTERFACE_FN(
-  rmw_get_implementation_identifier,
-  const char *, nullptr,
-  0, ARG_TYPES(void))
-
-RMW_INTERFACE_FN(
-  rmw_init_options_init,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(rmw_init_options_t *, rcutils_allocator_t))
-
-RMW_INTERFACE_FN(
-  rmw_init_options_copy,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_init_options_t *, rmw_init_options_t *))
-
-RMW_INTERFACE_FN(
-  rmw_init_options_fini,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_init_options_t *))
-
-RMW_INTERFACE_FN(
-  rmw_shutdown,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_context_t *))
-
-RMW_INTERFACE_FN(
-  rmw_context_fini,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_context_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_serialization_format,
-  const char *, nullptr,
-  0, ARG_TYPES(void))
-
-RMW_INTERFACE_FN(
-  rmw_create_node,
-  rmw_node_t *, nullptr,
-  3, ARG_TYPES(
-    rmw_context_t *, const char *, const char *))
-
-RMW_INTERFACE_FN(
-  rmw_destroy_node,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_node_t *))
-
-RMW_INTERFACE_FN(
-  rmw_node_get_graph_guard_condition,
-  const rmw_guard_condition_t *, nullptr,
-  1, ARG_TYPES(const rmw_node_t *))
-
-RMW_INTERFACE_FN(
-  rmw_init_publisher_allocation,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(
-    const rosidl_message_type_support_t *,
-    const rosidl_runtime_c__Sequence__bound *,
-    rmw_publisher_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_fini_publisher_allocation,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_publisher_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_create_publisher,
-  rmw_publisher_t *, nullptr,
-  5, ARG_TYPES(
-    const rmw_node_t *, const rosidl_message_type_support_t *, const char *,
-    const rmw_qos_profile_t *, const rmw_publisher_options_t *))
-
-RMW_INTERFACE_FN(
-  rmw_destroy_publisher,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(rmw_node_t *, rmw_publisher_t *))
-
-RMW_INTERFACE_FN(
-  rmw_borrow_loaned_message,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(
-    const rmw_publisher_t *,
-    const rosidl_message_type_support_t *,
-    void **))
-
-RMW_INTERFACE_FN(
-  rmw_return_loaned_message_from_publisher,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_publisher_t *, void *))
-
-RMW_INTERFACE_FN(
-  rmw_publish,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_publisher_t *, const void *, rmw_publisher_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_publish_loaned_message,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_publisher_t *, void *, rmw_publisher_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_publisher_count_matched_subscriptions,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_publisher_t *, size_t *))
-
-RMW_INTERFACE_FN(
-  rmw_publisher_get_actual_qos,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_publisher_t *, rmw_qos_profile_t *))
-
-RMW_INTERFACE_FN(
-  rmw_publisher_event_init,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(rmw_event_t *, const rmw_publisher_t *, rmw_event_type_t))
-
-RMW_INTERFACE_FN(
-  rmw_publish_serialized_message,
-  rmw_ret_t, RMW_RET_ERROR,
-  3,
-  ARG_TYPES(
-    const rmw_publisher_t *, const rmw_serialized_message_t *,
-    rmw_publisher_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_serialized_message_size,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(
-    const rosidl_message_type_support_t *,
-    const rosidl_runtime_c__Sequence__bound *,
-    size_t *))
-
-RMW_INTERFACE_FN(
-  rmw_publisher_assert_liveliness,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(const rmw_publisher_t *))
-
-RMW_INTERFACE_FN(
-  rmw_serialize,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const void *, const rosidl_message_type_support_t *, rmw_serialized_message_t *))
-
-RMW_INTERFACE_FN(
-  rmw_deserialize,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_serialized_message_t *, const rosidl_message_type_support_t *, void *))
-
-RMW_INTERFACE_FN(
-  rmw_init_subscription_allocation,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(
-    const rosidl_message_type_support_t *,
-    const rosidl_runtime_c__Sequence__bound *,
-    rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_fini_subscription_allocation,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_create_subscription,
-  rmw_subscription_t *, nullptr,
-  5, ARG_TYPES(
-    const rmw_node_t *, const rosidl_message_type_support_t *, const char *,
-    const rmw_qos_profile_t *, const rmw_subscription_options_t *))
-
-RMW_INTERFACE_FN(
-  rmw_destroy_subscription,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(rmw_node_t *, rmw_subscription_t *))
-
-RMW_INTERFACE_FN(
-  rmw_subscription_count_matched_publishers,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_subscription_t *, size_t *))
-
-RMW_INTERFACE_FN(
-  rmw_subscription_get_actual_qos,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_subscription_t *, rmw_qos_profile_t *))
-
-RMW_INTERFACE_FN(
-  rmw_subscription_event_init,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(rmw_event_t *, const rmw_subscription_t *, rmw_event_type_t))
-
-RMW_INTERFACE_FN(
-  rmw_take,
-  rmw_ret_t, RMW_RET_ERROR,
-  4, ARG_TYPES(const rmw_subscription_t *, void *, bool *, rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_sequence,
-  rmw_ret_t, RMW_RET_ERROR,
-  6, ARG_TYPES(
-    const rmw_subscription_t *, size_t, rmw_message_sequence_t *,
-    rmw_message_info_sequence_t *, size_t *, rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_with_info,
-  rmw_ret_t, RMW_RET_ERROR,
-  5,
-  ARG_TYPES(
-    const rmw_subscription_t *, void *, bool *, rmw_message_info_t *,
-    rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_serialized_message,
-  rmw_ret_t, RMW_RET_ERROR,
-  4,
-  ARG_TYPES(
-    const rmw_subscription_t *, rmw_serialized_message_t *, bool *,
-    rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_serialized_message_with_info,
-  rmw_ret_t, RMW_RET_ERROR,
-  5, ARG_TYPES(
-    const rmw_subscription_t *, rmw_serialized_message_t *, bool *, rmw_message_info_t *,
-    rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_loaned_message,
-  rmw_ret_t, RMW_RET_ERROR,
-  4, ARG_TYPES(
-    const rmw_subscription_t *, void **, bool *, rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_loaned_message_with_info,
-  rmw_ret_t, RMW_RET_ERROR,
-  5, ARG_TYPES(
-    const rmw_subscription_t *, void **, bool *, rmw_message_info_t *,
-    rmw_subscription_allocation_t *))
-
-RMW_INTERFACE_FN(
-  rmw_return_loaned_message_from_subscription,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_subscription_t *, void *))
-
-RMW_INTERFACE_FN(
-  rmw_create_client,
-  rmw_client_t *, nullptr,
-  4, ARG_TYPES(
-    const rmw_node_t *, const rosidl_service_type_support_t *, const char *,
-    const rmw_qos_profile_t *))
-
-RMW_INTERFACE_FN(
-  rmw_destroy_client,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(rmw_node_t *, rmw_client_t *))
-
-RMW_INTERFACE_FN(
-  rmw_send_request,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_client_t *, const void *, int64_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_response,
-  rmw_ret_t, RMW_RET_ERROR,
-  4, ARG_TYPES(const rmw_client_t *, rmw_service_info_t *, void *, bool *))
-
-RMW_INTERFACE_FN(
-  rmw_create_service,
-  rmw_service_t *, nullptr,
-  4, ARG_TYPES(
-    const rmw_node_t *, const rosidl_service_type_support_t *, const char *,
-    const rmw_qos_profile_t *))
-
-RMW_INTERFACE_FN(
-  rmw_destroy_service,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(rmw_node_t *, rmw_service_t *))
-
-RMW_INTERFACE_FN(
-  rmw_take_request,
-  rmw_ret_t, RMW_RET_ERROR,
-  4, ARG_TYPES(const rmw_service_t *, rmw_service_info_t *, void *, bool *))
-
-RMW_INTERFACE_FN(
-  rmw_send_response,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_service_t *, rmw_request_id_t *, void *))
-
-RMW_INTERFACE_FN(
-  rmw_take_event,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_event_t *, void *, bool *))
-
-RMW_INTERFACE_FN(
-  rmw_create_guard_condition,
-  rmw_guard_condition_t *, nullptr,
-  1, ARG_TYPES(rmw_context_t *))
-
-RMW_INTERFACE_FN(
-  rmw_destroy_guard_condition,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_guard_condition_t *))
-
-RMW_INTERFACE_FN(
-  rmw_trigger_guard_condition,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(const rmw_guard_condition_t *))
-
-RMW_INTERFACE_FN(
-  rmw_create_wait_set,
-  rmw_wait_set_t *, nullptr,
-  2, ARG_TYPES(rmw_context_t *, size_t))
-
-RMW_INTERFACE_FN(
-  rmw_destroy_wait_set,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_wait_set_t *))
-
-RMW_INTERFACE_FN(
-  rmw_wait,
-  rmw_ret_t, RMW_RET_ERROR,
-  7, ARG_TYPES(
-    rmw_subscriptions_t *, rmw_guard_conditions_t *, rmw_services_t *, rmw_clients_t *,
-    rmw_events_t *, rmw_wait_set_t *, const rmw_time_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_publisher_names_and_types_by_node,
-  rmw_ret_t, RMW_RET_ERROR,
-  6, ARG_TYPES(
-    const rmw_node_t *, rcutils_allocator_t *, const char *, const char *, bool,
-    rmw_names_and_types_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_subscriber_names_and_types_by_node,
-  rmw_ret_t, RMW_RET_ERROR,
-  6, ARG_TYPES(
-    const rmw_node_t *, rcutils_allocator_t *, const char *, const char *, bool,
-    rmw_names_and_types_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_service_names_and_types_by_node,
-  rmw_ret_t, RMW_RET_ERROR,
-  5, ARG_TYPES(
-    const rmw_node_t *, rcutils_allocator_t *, const char *, const char *,
-    rmw_names_and_types_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_client_names_and_types_by_node,
-  rmw_ret_t, RMW_RET_ERROR,
-  5, ARG_TYPES(
-    const rmw_node_t *, rcutils_allocator_t *, const char *, const char *,
-    rmw_names_and_types_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_topic_names_and_types,
-  rmw_ret_t, RMW_RET_ERROR,
-  4, ARG_TYPES(
-    const rmw_node_t *, rcutils_allocator_t *, bool,
-    rmw_names_and_types_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_service_names_and_types,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(
-    const rmw_node_t *, rcutils_allocator_t *,
-    rmw_names_and_types_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_node_names,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_node_t *, rcutils_string_array_t *, rcutils_string_array_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_node_names_with_enclaves,
-  rmw_ret_t, RMW_RET_ERROR,
-  4, ARG_TYPES(
-    const rmw_node_t *, rcutils_string_array_t *,
-    rcutils_string_array_t *, rcutils_string_array_t *))
-
-RMW_INTERFACE_FN(
-  rmw_count_publishers,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_node_t *, const char *, size_t *))
-
-RMW_INTERFACE_FN(
-  rmw_count_subscribers,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_node_t *, const char *, size_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_gid_for_publisher,
-  rmw_ret_t, RMW_RET_ERROR,
-  2, ARG_TYPES(const rmw_publisher_t *, rmw_gid_t *))
-
-RMW_INTERFACE_FN(
-  rmw_compare_gids_equal,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_gid_t *, const rmw_gid_t *, bool *))
-
-RMW_INTERFACE_FN(
-  rmw_service_server_is_available,
-  rmw_ret_t, RMW_RET_ERROR,
-  3, ARG_TYPES(const rmw_node_t *, const rmw_client_t *, bool *))
-
-RMW_INTERFACE_FN(
-  rmw_set_log_severity,
-  rmw_ret_t, RMW_RET_ERROR,
-  1, ARG_TYPES(rmw_log_severity_t))
-
-RMW_INTERFACE_FN(
-  rmw_get_publishers_info_by_topic,
-  rmw_ret_t, RMW_RET_ERROR,
-  5, ARG_TYPES(
-    const rmw_node_t *,
-    rcutils_allocator_t *,
-    const char *,
-    bool,
-    rmw_topic_endpoint_info_array_t *))
-
-RMW_INTERFACE_FN(
-  rmw_get_subscriptions_info_by_topic,
-  rmw_ret_t, RMW_RET_ERROR,
-  5, ARG_TYPES(
-    const rmw_node_t *,
-    rcutils_allocator_t *,
-    const char *,
-    bool,
-    rmw_topic_endpoint_info_array_t *))
-
-RMW_INTERFACE_FN(
-  rmw_qos_profile_check_compatible,
-  rmw_ret_t, RMW_RET_ERROR,
-  5, ARG_TYPES(
-    const rmw_qos_profile_t,
-    const rmw_qos_profile_t,
-    rmw_qos_compatibility_type_t *,
-    char *,
-    size_t))
-
-#define GET_SYMBOL(x) symbol_ ## x = get_symbol(#x);
+#define PREFETCH_SYMBOL_OR_FALLBACK(name, fallback) \
+  bind_symbol_or_fallback( \
+    g_dispatch_table.name, rmw_implementation::g_implementation_table.name, \
+    &rmw_implementation::resolve_ ## name, &rmw_implementation::fallback, #name, \
+    rmw_implementation::g_symbol_presence.name);
+
+#define PREFETCH_OPTIONAL_SYMBOL(name, ...) \
+  PREFETCH_SYMBOL_OR_FALLBACK(name, unsupported_ ## name)
+
+#define PREFETCH_SYMBOL_WITH_FALLBACK(name, ...) \
+  PREFETCH_SYMBOL_OR_FALLBACK(name, fallback_ ## name)
 
 void prefetch_symbols(void)
 {
-  // get all symbols to avoid race conditions later since the passed
-  // symbol name is expected to be a std::string which requires allocation
-  GET_SYMBOL(rmw_get_implementation_identifier)
-  GET_SYMBOL(rmw_init_options_init)
-  GET_SYMBOL(rmw_init_options_copy)
-  GET_SYMBOL(rmw_init_options_fini)
-  GET_SYMBOL(rmw_shutdown)
-  GET_SYMBOL(rmw_context_fini)
-  GET_SYMBOL(rmw_get_serialization_format)
-  GET_SYMBOL(rmw_create_node)
-  GET_SYMBOL(rmw_destroy_node)
-  GET_SYMBOL(rmw_node_get_graph_guard_condition)
-  GET_SYMBOL(rmw_init_publisher_allocation);
-  GET_SYMBOL(rmw_fini_publisher_allocation);
-  GET_SYMBOL(rmw_create_publisher)
-  GET_SYMBOL(rmw_destroy_publisher)
-  GET_SYMBOL(rmw_borrow_loaned_message);
-  GET_SYMBOL(rmw_return_loaned_message_from_publisher);
-  GET_SYMBOL(rmw_publish)
-  GET_SYMBOL(rmw_publish_loaned_message)
-  GET_SYMBOL(rmw_publisher_count_matched_subscriptions)
-  GET_SYMBOL(rmw_publisher_get_actual_qos);
-  GET_SYMBOL(rmw_publisher_event_init)
-  GET_SYMBOL(rmw_publish_serialized_message)
-  GET_SYMBOL(rmw_publisher_assert_liveliness)
-  GET_SYMBOL(rmw_get_serialized_message_size)
-  GET_SYMBOL(rmw_serialize)
-  GET_SYMBOL(rmw_deserialize)
-  GET_SYMBOL(rmw_init_subscription_allocation)
-  GET_SYMBOL(rmw_fini_subscription_allocation)
-  GET_SYMBOL(rmw_create_subscription)
-  GET_SYMBOL(rmw_destroy_subscription)
-  GET_SYMBOL(rmw_subscription_count_matched_publishers);
-  GET_SYMBOL(rmw_subscription_get_actual_qos);
-  GET_SYMBOL(rmw_subscription_event_init)
-  GET_SYMBOL(rmw_take)
-  GET_SYMBOL(rmw_take_with_info)
-  GET_SYMBOL(rmw_take_serialized_message)
-  GET_SYMBOL(rmw_take_serialized_message_with_info)
-  GET_SYMBOL(rmw_take_loaned_message)
-  GET_SYMBOL(rmw_take_loaned_message_with_info)
-  GET_SYMBOL(rmw_return_loaned_message_from_subscription)
-  GET_SYMBOL(rmw_create_client)
-  GET_SYMBOL(rmw_destroy_client)
-  GET_SYMBOL(rmw_send_request)
-  GET_SYMBOL(rmw_take_response)
-  GET_SYMBOL(rmw_create_service)
-  GET_SYMBOL(rmw_destroy_service)
-  GET_SYMBOL(rmw_take_request)
-  GET_SYMBOL(rmw_send_response)
-  GET_SYMBOL(rmw_take_event)
-  GET_SYMBOL(rmw_create_guard_condition)
-  GET_SYMBOL(rmw_destroy_guard_condition)
-  GET_SYMBOL(rmw_trigger_guard_condition)
-  GET_SYMBOL(rmw_create_wait_set)
-  GET_SYMBOL(rmw_destroy_wait_set)
-  GET_SYMBOL(rmw_wait)
-  GET_SYMBOL(rmw_get_publisher_names_and_types_by_node)
-  GET_SYMBOL(rmw_get_subscriber_names_and_types_by_node)
-  GET_SYMBOL(rmw_get_service_names_and_types_by_node)
-  GET_SYMBOL(rmw_get_client_names_and_types_by_node)
-  GET_SYMBOL(rmw_get_topic_names_and_types)
-  GET_SYMBOL(rmw_get_service_names_and_types)
-  GET_SYMBOL(rmw_get_node_names)
-  GET_SYMBOL(rmw_get_node_names_with_enclaves)
-  GET_SYMBOL(rmw_count_publishers)
-  GET_SYMBOL(rmw_count_subscribers)
-  GET_SYMBOL(rmw_get_gid_for_publisher)
-  GET_SYMBOL(rmw_compare_gids_equal)
-  GET_SYMBOL(rmw_service_server_is_available)
-  GET_SYMBOL(rmw_set_log_severity)
-  GET_SYMBOL(rmw_get_publishers_info_by_topic)
-  GET_SYMBOL(rmw_get_subscriptions_info_by_topic)
-  GET_SYMBOL(rmw_qos_profile_check_compatible)
+  // get all symbols to avoid lazy resolution later, in calls that
+  // may be time sensitive
+  RMW_IMPLEMENTATION_FORWARDED_FNS(PREFETCH_SYMBOL)
+  RMW_IMPLEMENTATION_OPTIONAL_FNS(PREFETCH_OPTIONAL_SYMBOL)
+  RMW_IMPLEMENTATION_FALLBACK_FNS(PREFETCH_SYMBOL_WITH_FALLBACK)
+  RMW_IMPLEMENTATION_INIT_FN(PREFETCH_SYMBOL)
 }
 
-void * symbol_rmw_init = nullptr;
+#define CHECK_SYMBOL_PRESENT(name, ...) \
+  present = rmw_implementation::g_symbol_presence.name.load(std::memory_order_relaxed) && present;
+
+bool
+rmw_implementation_has_feature(rmw_implementation_feature_t feature)
+{
+  bool present = true;
+  switch (feature) {
+    case RMW_IMPLEMENTATION_FEATURE_LOANED_MESSAGES:
+      RMW_IMPLEMENTATION_LOANED_MESSAGES_FNS(PREFETCH_OPTIONAL_SYMBOL)
+      RMW_IMPLEMENTATION_LOANED_MESSAGES_FNS(CHECK_SYMBOL_PRESENT)
+      return present;
+    case RMW_IMPLEMENTATION_FEATURE_EVENTS:
+      RMW_IMPLEMENTATION_EVENTS_FNS(PREFETCH_OPTIONAL_SYMBOL)
+      RMW_IMPLEMENTATION_EVENTS_FNS(CHECK_SYMBOL_PRESENT)
+      return present;
+    case RMW_IMPLEMENTATION_FEATURE_PUBLISH_SEQUENCE:
+      PREFETCH_SYMBOL_OR_FALLBACK(rmw_publish_sequence, fallback_rmw_publish_sequence)
+      return rmw_implementation::g_symbol_presence.rmw_publish_sequence.load(
+        std::memory_order_relaxed);
+    default:
+      return false;
+  }
+}
 
 rmw_ret_t
 rmw_init(const rmw_init_options_t * options, rmw_context_t * context)
 {
+  RMW_IMPLEMENTATION_TRACEPOINT_ENTRY(rmw_init, options, context);
   prefetch_symbols();
-  if (!symbol_rmw_init) {
-    symbol_rmw_init = get_symbol("rmw_init");
-  }
-  if (!symbol_rmw_init) {
-    return RMW_RET_ERROR;
-  }
-
-  typedef rmw_ret_t (* FunctionSignature)(const rmw_init_options_t *, rmw_context_t *);
-  FunctionSignature func = reinterpret_cast<FunctionSignature>(symbol_rmw_init);
-  return func(options, context);
+  rmw_implementation::enable_profiling_from_env();
+  rmw_implementation::enable_capture_from_env();
+  rmw_ret_t ret = g_dispatch_table.rmw_init.load(std::memory_order_acquire)(options, context);
+  RMW_IMPLEMENTATION_TRACEPOINT_EXIT(rmw_init, options, ret);
+  return ret;
 }
 
 #ifdef __cplusplus
 }
 #endif
 
+#define CHECK_SYMBOL_RESOLVED(name, ...) \
+  if (g_dispatch_table.name.load(std::memory_order_acquire) == \
+    &rmw_implementation::resolve_ ## name) \
+  { \
+    return false; \
+  }
+
+bool
+all_symbols_resolved()
+{
+  RMW_IMPLEMENTATION_API_FNS(CHECK_SYMBOL_RESOLVED)
+  return true;
+}
+
+#define RESET_DISPATCH_TABLE_ENTRY(name, ...) \
+  g_dispatch_table.name.store(&rmw_implementation::resolve_ ## name, std::memory_order_release); \
+  rmw_implementation::g_implementation_table.name.store( \
+    &rmw_implementation::resolve_ ## name, std::memory_order_release);
+
+#define RESET_SYMBOL_PRESENCE(name, ...) \
+  rmw_implementation::g_symbol_presence.name.store(false, std::memory_order_relaxed);
+
 void
 unload_library()
 {
-  symbol_rmw_get_implementation_identifier = nullptr;
-  symbol_rmw_init_options_init = nullptr;
-  symbol_rmw_init_options_copy = nullptr;
-  symbol_rmw_init_options_fini = nullptr;
-  symbol_rmw_shutdown = nullptr;
-  symbol_rmw_context_fini = nullptr;
-  symbol_rmw_get_serialization_format = nullptr;
-  symbol_rmw_create_node = nullptr;
-  symbol_rmw_destroy_node = nullptr;
-  symbol_rmw_node_get_graph_guard_condition = nullptr;
-  symbol_rmw_init_publisher_allocation = nullptr;
-  symbol_rmw_fini_publisher_allocation = nullptr;
-  symbol_rmw_create_publisher = nullptr;
-  symbol_rmw_destroy_publisher = nullptr;
-  symbol_rmw_borrow_loaned_message = nullptr;
-  symbol_rmw_return_loaned_message_from_publisher = nullptr;
-  symbol_rmw_publish = nullptr;
-  symbol_rmw_publish_loaned_message = nullptr;
-  symbol_rmw_publisher_count_matched_subscriptions = nullptr;
-  symbol_rmw_publisher_get_actual_qos = nullptr;
-  symbol_rmw_publisher_event_init = nullptr;
-  symbol_rmw_publish_serialized_message = nullptr;
-  symbol_rmw_get_serialized_message_size = nullptr;
-  symbol_rmw_publisher_assert_liveliness = nullptr;
-  symbol_rmw_serialize = nullptr;
-  symbol_rmw_deserialize = nullptr;
-  symbol_rmw_init_subscription_allocation = nullptr;
-  symbol_rmw_fini_subscription_allocation = nullptr;
-  symbol_rmw_create_subscription = nullptr;
-  symbol_rmw_destroy_subscription = nullptr;
-  symbol_rmw_subscription_count_matched_publishers = nullptr;
-  symbol_rmw_subscription_get_actual_qos = nullptr;
-  symbol_rmw_subscription_event_init = nullptr;
-  symbol_rmw_take = nullptr;
-  symbol_rmw_take_sequence = nullptr;
-  symbol_rmw_take_with_info = nullptr;
-  symbol_rmw_take_serialized_message = nullptr;
-  symbol_rmw_take_serialized_message_with_info = nullptr;
-  symbol_rmw_take_loaned_message = nullptr;
-  symbol_rmw_take_loaned_message_with_info = nullptr;
-  symbol_rmw_return_loaned_message_from_subscription = nullptr;
-  symbol_rmw_create_client = nullptr;
-  symbol_rmw_destroy_client = nullptr;
-  symbol_rmw_send_request = nullptr;
-  symbol_rmw_take_response = nullptr;
-  symbol_rmw_create_service = nullptr;
-  symbol_rmw_destroy_service = nullptr;
-  symbol_rmw_take_request = nullptr;
-  symbol_rmw_send_response = nullptr;
-  symbol_rmw_take_event = nullptr;
-  symbol_rmw_create_guard_condition = nullptr;
-  symbol_rmw_destroy_guard_condition = nullptr;
-  symbol_rmw_trigger_guard_condition = nullptr;
-  symbol_rmw_create_wait_set = nullptr;
-  symbol_rmw_destroy_wait_set = nullptr;
-  symbol_rmw_wait = nullptr;
-  symbol_rmw_get_publisher_names_and_types_by_node = nullptr;
-  symbol_rmw_get_subscriber_names_and_types_by_node = nullptr;
-  symbol_rmw_get_service_names_and_types_by_node = nullptr;
-  symbol_rmw_get_client_names_and_types_by_node = nullptr;
-  symbol_rmw_get_topic_names_and_types = nullptr;
-  symbol_rmw_get_service_names_and_types = nullptr;
-  symbol_rmw_get_node_names = nullptr;
-  symbol_rmw_get_node_names_with_enclaves = nullptr;
-  symbol_rmw_count_publishers = nullptr;
-  symbol_rmw_count_subscribers = nullptr;
-  symbol_rmw_get_gid_for_publisher = nullptr;
-  symbol_rmw_compare_gids_equal = nullptr;
-  symbol_rmw_service_server_is_available = nullptr;
-  symbol_rmw_set_log_severity = nullptr;
-  symbol_rmw_get_publishers_info_by_topic = nullptr;
-  symbol_rmw_get_subscriptions_info_by_topic = nullptr;
-  symbol_rmw_qos_profile_check_compatible = nullptr;
-  symbol_rmw_init = nullptr;
+  // held back messages are published through other interposers, if any
+  rmw_implementation_injection_disable();
+  if (RMW_RET_OK != rmw_implementation_capture_disable()) {
+    rmw_reset_error();
+  }
+  rmw_implementation_wait_timing_disable();
+  rmw_implementation_profiling_disable();
+  RMW_IMPLEMENTATION_API_FNS(RESET_DISPATCH_TABLE_ENTRY)
+  RMW_IMPLEMENTATION_OPTIONAL_FNS(RESET_SYMBOL_PRESENCE)
+  RMW_IMPLEMENTATION_FALLBACK_FNS(RESET_SYMBOL_PRESENCE)
+  std::lock_guard<std::mutex> lock(g_rmw_lib_mutex);
+  if (rcutils_is_shared_library_loaded(&g_rmw_lib_handle)) {
+    if (RCUTILS_RET_OK != rcutils_unload_shared_library(&g_rmw_lib_handle)) {
+      rmw_reset_error();
+    }
+  }
   g_rmw_lib.reset();
 }
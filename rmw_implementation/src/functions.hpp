@@ -20,15 +20,34 @@
 
 #include "rcpputils/shared_library.hpp"
 
-#include "./visibility_control.h"
+#include "rcutils/shared_library.h"
+
+#include "rmw_implementation/visibility_control.h"
 
 RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
 std::shared_ptr<rcpputils::SharedLibrary> load_library();
 
+RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
+std::shared_ptr<rcpputils::SharedLibrary> load_library(const std::string & rmw_implementation);
+
 RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
 void * lookup_symbol(
-  std::shared_ptr<rcpputils::SharedLibrary> lib,
-  const std::string & symbol_name);
+  const std::shared_ptr<rcpputils::SharedLibrary> & lib,
+  const char * symbol_name);
+
+/// Open a handle to a loaded library, to look up symbols that may be missing.
+/**
+ * The handle holds a reference to the library of its own, which must be
+ * released with rcutils_unload_shared_library().
+ */
+RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
+bool open_library_handle(
+  const std::shared_ptr<rcpputils::SharedLibrary> & lib,
+  rcutils_shared_library_t & handle);
+
+/// Look a symbol up once, returning `NULL` if missing without setting an error.
+RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
+void * find_symbol(const rcutils_shared_library_t & handle, const char * symbol_name);
 
 #ifdef __cplusplus
 extern "C"
@@ -42,6 +61,9 @@ void prefetch_symbols(void);
 }
 #endif
 
+RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
+bool all_symbols_resolved();
+
 RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
 void unload_library();
 
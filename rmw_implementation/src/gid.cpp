@@ -0,0 +1,186 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/gid.h"
+
+#include <new>
+#include <unordered_set>
+
+#include "rmw/error_handling.h"
+
+#include "./allocator.hpp"
+
+namespace
+{
+
+struct GidHash
+{
+  size_t operator()(const rmw_gid_t & gid) const
+  {
+    return rmw_implementation_gid_hash(&gid);
+  }
+};
+
+struct GidEqual
+{
+  bool operator()(const rmw_gid_t & lhs, const rmw_gid_t & rhs) const
+  {
+    return rmw_implementation_gid_equal(&lhs, &rhs);
+  }
+};
+
+using GidSet = std::unordered_set<
+  rmw_gid_t, GidHash, GidEqual, rmw_implementation::RcutilsAllocator<rmw_gid_t>>;
+
+}  // namespace
+
+struct rmw_implementation_gid_set_impl_s
+{
+  explicit rmw_implementation_gid_set_impl_s(const rcutils_allocator_t & allocator)
+  : allocator(allocator),
+    gids(0u, GidHash(), GidEqual(), GidSet::allocator_type(allocator))
+  {
+  }
+
+  rcutils_allocator_t allocator;
+  GidSet gids;
+};
+
+#define CHECK_GID_SET(set) \
+  do { \
+    RMW_CHECK_ARGUMENT_FOR_NULL(set, RMW_RET_INVALID_ARGUMENT); \
+    RMW_CHECK_FOR_NULL_WITH_MSG( \
+      (set)->impl, "gid set is not initialized", return RMW_RET_INVALID_ARGUMENT); \
+  } while (0)
+
+extern "C"
+{
+rmw_implementation_gid_set_t
+rmw_implementation_get_zero_initialized_gid_set(void)
+{
+  rmw_implementation_gid_set_t set;
+  set.size = 0u;
+  set.impl = nullptr;
+  return set;
+}
+
+rmw_ret_t
+rmw_implementation_gid_set_init(
+  rmw_implementation_gid_set_t * set,
+  const rcutils_allocator_t * allocator)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(set, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != set->impl) {
+    RMW_SET_ERROR_MSG("gid set is already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  void * memory = allocator->allocate(
+    sizeof(rmw_implementation_gid_set_impl_t), allocator->state);
+  if (nullptr == memory) {
+    RMW_SET_ERROR_MSG("failed to allocate gid set");
+    return RMW_RET_BAD_ALLOC;
+  }
+  try {
+    set->impl = new (memory) rmw_implementation_gid_set_impl_t(*allocator);
+  } catch (const std::bad_alloc &) {
+    allocator->deallocate(memory, allocator->state);
+    RMW_SET_ERROR_MSG("failed to allocate gid set");
+    return RMW_RET_BAD_ALLOC;
+  }
+  set->size = 0u;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_gid_set_fini(rmw_implementation_gid_set_t * set)
+{
+  CHECK_GID_SET(set);
+
+  rmw_implementation_gid_set_impl_t * impl = set->impl;
+  rcutils_allocator_t allocator = impl->allocator;
+  impl->~rmw_implementation_gid_set_impl_t();
+  allocator.deallocate(impl, allocator.state);
+  *set = rmw_implementation_get_zero_initialized_gid_set();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_gid_set_insert(
+  rmw_implementation_gid_set_t * set,
+  const rmw_gid_t * gid,
+  bool * inserted)
+{
+  CHECK_GID_SET(set);
+  RMW_CHECK_ARGUMENT_FOR_NULL(gid, RMW_RET_INVALID_ARGUMENT);
+
+  bool gid_inserted = false;
+  try {
+    gid_inserted = set->impl->gids.insert(*gid).second;
+  } catch (const std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate gid set entry");
+    return RMW_RET_BAD_ALLOC;
+  }
+  set->size = set->impl->gids.size();
+  if (inserted) {
+    *inserted = gid_inserted;
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_gid_set_remove(
+  rmw_implementation_gid_set_t * set,
+  const rmw_gid_t * gid,
+  bool * removed)
+{
+  CHECK_GID_SET(set);
+  RMW_CHECK_ARGUMENT_FOR_NULL(gid, RMW_RET_INVALID_ARGUMENT);
+
+  const bool gid_removed = set->impl->gids.erase(*gid) > 0u;
+  set->size = set->impl->gids.size();
+  if (removed) {
+    *removed = gid_removed;
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_gid_set_contains(
+  const rmw_implementation_gid_set_t * set,
+  const rmw_gid_t * gid,
+  bool * contains)
+{
+  CHECK_GID_SET(set);
+  RMW_CHECK_ARGUMENT_FOR_NULL(gid, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(contains, RMW_RET_INVALID_ARGUMENT);
+
+  *contains = set->impl->gids.count(*gid) > 0u;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_gid_set_clear(rmw_implementation_gid_set_t * set)
+{
+  CHECK_GID_SET(set);
+
+  set->impl->gids.clear();
+  set->size = 0u;
+  return RMW_RET_OK;
+}
+}  // extern "C"
@@ -0,0 +1,543 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/graph_cache.h"
+
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/get_node_info_and_types.h"
+#include "rmw/get_service_names_and_types.h"
+#include "rmw/get_topic_names_and_types.h"
+#include "rmw/rmw.h"
+#include "rmw/sanity_checks.h"
+
+#include "./graph_guard_condition.hpp"
+
+namespace
+{
+
+struct NameAndTypes
+{
+  std::string name;
+  std::vector<std::string> types;
+};
+
+using NamesAndTypes = std::vector<NameAndTypes>;
+
+struct NodeInfo
+{
+  std::string name;
+  std::string namespace_;
+  std::string enclave;
+};
+
+}  // namespace
+
+struct rmw_implementation_graph_cache_impl_s
+{
+  rmw_implementation_graph_cache_impl_s(
+    const rmw_node_t * node,
+    bool watch_graph_guard_condition,
+    const rcutils_allocator_t & allocator)
+  : node(node), watch_graph_guard_condition(watch_graph_guard_condition), allocator(allocator)
+  {
+  }
+
+  // Drop the snapshot, must be called with the mutex held.
+  void clear()
+  {
+    has_topic_names_and_types[0] = has_topic_names_and_types[1] = false;
+    topic_names_and_types[0].clear();
+    topic_names_and_types[1].clear();
+    has_service_names_and_types = false;
+    service_names_and_types.clear();
+    has_nodes = false;
+    nodes.clear();
+    publisher_counts.clear();
+    subscriber_counts.clear();
+  }
+
+  const rmw_node_t * node;
+  // Whether the graph guard condition is watched, or left to the caller, which
+  // invalidates the cache instead.
+  const bool watch_graph_guard_condition;
+  rmw_implementation::GraphGuardConditionWatcher graph_guard_condition_watcher;
+  rcutils_allocator_t allocator;
+  std::mutex mutex;
+
+  // Snapshot, indexed by no_demangle for topics.
+  bool has_topic_names_and_types[2]{false, false};
+  NamesAndTypes topic_names_and_types[2];
+  bool has_service_names_and_types{false};
+  NamesAndTypes service_names_and_types;
+  bool has_nodes{false};
+  std::vector<NodeInfo> nodes;
+  std::map<std::string, size_t> publisher_counts;
+  std::map<std::string, size_t> subscriber_counts;
+};
+
+namespace
+{
+
+using CacheImpl = rmw_implementation_graph_cache_impl_t;
+
+// Drop the snapshot if the graph changed since last checked.
+// Must be called with the cache mutex held.
+rmw_ret_t
+check_graph_guard_condition(CacheImpl * impl)
+{
+  if (!impl->watch_graph_guard_condition) {
+    return RMW_RET_OK;
+  }
+  bool triggered = false;
+  rmw_ret_t ret = impl->graph_guard_condition_watcher.check(triggered);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  if (triggered) {
+    impl->clear();
+  }
+  return RMW_RET_OK;
+}
+
+// Move names and types returned by the rmw implementation into a snapshot.
+rmw_ret_t
+take_names_and_types(rmw_names_and_types_t * names_and_types, NamesAndTypes & snapshot)
+{
+  rmw_ret_t ret = RMW_RET_OK;
+  try {
+    snapshot.reserve(names_and_types->names.size);
+    for (size_t i = 0u; i < names_and_types->names.size; ++i) {
+      const rcutils_string_array_t & types = names_and_types->types[i];
+      snapshot.push_back({names_and_types->names.data[i], {types.data, types.data + types.size}});
+    }
+  } catch (const std::bad_alloc &) {
+    snapshot.clear();
+    RMW_SET_ERROR_MSG("failed to allocate graph cache snapshot");
+    ret = RMW_RET_BAD_ALLOC;
+  }
+  if (RMW_RET_OK != rmw_names_and_types_fini(names_and_types)) {
+    // leaked, nothing else to do
+    rmw_reset_error();
+  }
+  return ret;
+}
+
+// Copy names and types of a snapshot into an initialized array of the same size.
+bool
+copy_names_and_types_into(
+  const NamesAndTypes & snapshot,
+  rcutils_allocator_t * allocator,
+  rmw_names_and_types_t * names_and_types)
+{
+  for (size_t i = 0u; i < snapshot.size(); ++i) {
+    names_and_types->names.data[i] = rcutils_strdup(snapshot[i].name.c_str(), *allocator);
+    if (nullptr == names_and_types->names.data[i]) {
+      return false;
+    }
+    if (RCUTILS_RET_OK != rcutils_string_array_init(
+        &names_and_types->types[i], snapshot[i].types.size(), allocator))
+    {
+      rmw_reset_error();
+      return false;
+    }
+    for (size_t j = 0u; j < snapshot[i].types.size(); ++j) {
+      names_and_types->types[i].data[j] = rcutils_strdup(snapshot[i].types[j].c_str(), *allocator);
+      if (nullptr == names_and_types->types[i].data[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+rmw_ret_t
+copy_names_and_types(
+  const NamesAndTypes & snapshot,
+  rcutils_allocator_t * allocator,
+  rmw_names_and_types_t * names_and_types)
+{
+  if (snapshot.empty()) {
+    return RMW_RET_OK;
+  }
+  rmw_ret_t ret = rmw_names_and_types_init(names_and_types, snapshot.size(), allocator);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  if (!copy_names_and_types_into(snapshot, allocator, names_and_types)) {
+    if (RMW_RET_OK != rmw_names_and_types_fini(names_and_types)) {
+      rmw_reset_error();
+    }
+    RMW_SET_ERROR_MSG("failed to allocate names and types");
+    return RMW_RET_BAD_ALLOC;
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+copy_node_field(
+  const std::vector<NodeInfo> & snapshot,
+  std::string NodeInfo::* field,
+  rcutils_allocator_t * allocator,
+  rcutils_string_array_t * strings)
+{
+  if (RCUTILS_RET_OK != rcutils_string_array_init(strings, snapshot.size(), allocator)) {
+    rmw_reset_error();
+    RMW_SET_ERROR_MSG("failed to allocate node names");
+    return RMW_RET_BAD_ALLOC;
+  }
+  for (size_t i = 0u; i < snapshot.size(); ++i) {
+    strings->data[i] = rcutils_strdup((snapshot[i].*field).c_str(), *allocator);
+    if (nullptr == strings->data[i]) {
+      if (RCUTILS_RET_OK != rcutils_string_array_fini(strings)) {
+        rmw_reset_error();
+      }
+      RMW_SET_ERROR_MSG("failed to allocate node names");
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
+  return RMW_RET_OK;
+}
+
+void
+fini_string_arrays(rcutils_string_array_t * arrays[], size_t count)
+{
+  for (size_t i = 0u; i < count; ++i) {
+    if (nullptr != arrays[i] && RCUTILS_RET_OK != rcutils_string_array_fini(arrays[i])) {
+      // leaked, nothing else to do
+      rmw_reset_error();
+    }
+  }
+}
+
+rmw_ret_t
+take_nodes(CacheImpl * impl)
+{
+  rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+  rcutils_string_array_t node_namespaces = rcutils_get_zero_initialized_string_array();
+  rcutils_string_array_t enclaves = rcutils_get_zero_initialized_string_array();
+  rmw_ret_t ret = rmw_get_node_names_with_enclaves(
+    impl->node, &node_names, &node_namespaces, &enclaves);
+  if (RMW_RET_OK == ret) {
+    try {
+      impl->nodes.reserve(node_names.size);
+      for (size_t i = 0u; i < node_names.size; ++i) {
+        impl->nodes.push_back({node_names.data[i], node_namespaces.data[i], enclaves.data[i]});
+      }
+      impl->has_nodes = true;
+    } catch (const std::bad_alloc &) {
+      impl->nodes.clear();
+      RMW_SET_ERROR_MSG("failed to allocate graph cache snapshot");
+      ret = RMW_RET_BAD_ALLOC;
+    }
+  }
+  rcutils_string_array_t * arrays[] = {&node_names, &node_namespaces, &enclaves};
+  fini_string_arrays(arrays, sizeof(arrays) / sizeof(arrays[0]));
+  return ret;
+}
+
+// Get node names with enclaves or not, depending on whether enclaves is NULL.
+rmw_ret_t
+get_node_names(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_string_array_t * node_names,
+  rcutils_string_array_t * node_namespaces,
+  rcutils_string_array_t * enclaves)
+{
+  CacheImpl * impl = cache->impl;
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  rmw_ret_t ret = check_graph_guard_condition(impl);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  if (!impl->has_nodes) {
+    ret = take_nodes(impl);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+  }
+  ret = copy_node_field(impl->nodes, &NodeInfo::name, &impl->allocator, node_names);
+  if (RMW_RET_OK == ret) {
+    ret = copy_node_field(impl->nodes, &NodeInfo::namespace_, &impl->allocator, node_namespaces);
+  }
+  if (RMW_RET_OK == ret && nullptr != enclaves) {
+    ret = copy_node_field(impl->nodes, &NodeInfo::enclave, &impl->allocator, enclaves);
+  }
+  if (RMW_RET_OK != ret) {
+    rcutils_string_array_t * arrays[] = {node_names, node_namespaces, enclaves};
+    fini_string_arrays(arrays, sizeof(arrays) / sizeof(arrays[0]));
+  }
+  return ret;
+}
+
+using CountFunction = rmw_ret_t (*)(const rmw_node_t *, const char *, size_t *);
+
+rmw_ret_t
+count_endpoints(
+  rmw_implementation_graph_cache_t * cache,
+  std::map<std::string, size_t> CacheImpl::* counts_field,
+  CountFunction count_function,
+  const char * topic_name,
+  size_t * count)
+{
+  CacheImpl * impl = cache->impl;
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  rmw_ret_t ret = check_graph_guard_condition(impl);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  std::map<std::string, size_t> & counts = impl->*counts_field;
+  try {
+    auto it = counts.find(topic_name);
+    if (counts.end() != it) {
+      *count = it->second;
+      return RMW_RET_OK;
+    }
+    size_t topic_count = 0u;
+    ret = count_function(impl->node, topic_name, &topic_count);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    counts.emplace(topic_name, topic_count);
+    *count = topic_count;
+  } catch (const std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate graph cache snapshot");
+    return RMW_RET_BAD_ALLOC;
+  }
+  return RMW_RET_OK;
+}
+
+}  // namespace
+
+#define CHECK_CACHE(cache) \
+  do { \
+    RMW_CHECK_ARGUMENT_FOR_NULL(cache, RMW_RET_INVALID_ARGUMENT); \
+    RMW_CHECK_FOR_NULL_WITH_MSG( \
+      cache->impl, "graph cache is not initialized", return RMW_RET_INVALID_ARGUMENT); \
+  } while (0)
+
+extern "C"
+{
+rmw_implementation_graph_cache_t
+rmw_implementation_get_zero_initialized_graph_cache(void)
+{
+  rmw_implementation_graph_cache_t cache;
+  cache.impl = nullptr;
+  return cache;
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_init(
+  rmw_implementation_graph_cache_t * cache,
+  const rmw_node_t * node,
+  bool watch_graph_guard_condition,
+  const rcutils_allocator_t * allocator)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(cache, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != cache->impl) {
+    RMW_SET_ERROR_MSG("graph cache is already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(node, RMW_RET_INVALID_ARGUMENT);
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  void * memory = allocator->allocate(sizeof(CacheImpl), allocator->state);
+  if (nullptr == memory) {
+    RMW_SET_ERROR_MSG("failed to allocate graph cache");
+    return RMW_RET_BAD_ALLOC;
+  }
+  CacheImpl * impl = new (memory) CacheImpl(node, watch_graph_guard_condition, *allocator);
+  if (watch_graph_guard_condition) {
+    rmw_ret_t ret = impl->graph_guard_condition_watcher.init(node);
+    if (RMW_RET_OK != ret) {
+      impl->~CacheImpl();
+      allocator->deallocate(memory, allocator->state);
+      return ret;
+    }
+  }
+  cache->impl = impl;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_fini(rmw_implementation_graph_cache_t * cache)
+{
+  CHECK_CACHE(cache);
+  CacheImpl * impl = cache->impl;
+  rmw_ret_t ret = impl->graph_guard_condition_watcher.fini();
+  rcutils_allocator_t allocator = impl->allocator;
+  impl->~CacheImpl();
+  allocator.deallocate(impl, allocator.state);
+  *cache = rmw_implementation_get_zero_initialized_graph_cache();
+  return ret;
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_invalidate(rmw_implementation_graph_cache_t * cache)
+{
+  CHECK_CACHE(cache);
+  std::lock_guard<std::mutex> lock(cache->impl->mutex);
+  cache->impl->clear();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_get_topic_names_and_types(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_allocator_t * allocator,
+  bool no_demangle,
+  rmw_names_and_types_t * topic_names_and_types)
+{
+  CHECK_CACHE(cache);
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(topic_names_and_types, RMW_RET_INVALID_ARGUMENT);
+  if (RMW_RET_OK != rmw_names_and_types_check_zero(topic_names_and_types)) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  CacheImpl * impl = cache->impl;
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  rmw_ret_t ret = check_graph_guard_condition(impl);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  const size_t index = no_demangle ? 1u : 0u;
+  if (!impl->has_topic_names_and_types[index]) {
+    rmw_names_and_types_t result = rmw_get_zero_initialized_names_and_types();
+    ret = rmw_get_topic_names_and_types(impl->node, &impl->allocator, no_demangle, &result);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    ret = take_names_and_types(&result, impl->topic_names_and_types[index]);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    impl->has_topic_names_and_types[index] = true;
+  }
+  return copy_names_and_types(
+    impl->topic_names_and_types[index], allocator, topic_names_and_types);
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_get_service_names_and_types(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_allocator_t * allocator,
+  rmw_names_and_types_t * service_names_and_types)
+{
+  CHECK_CACHE(cache);
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(service_names_and_types, RMW_RET_INVALID_ARGUMENT);
+  if (RMW_RET_OK != rmw_names_and_types_check_zero(service_names_and_types)) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  CacheImpl * impl = cache->impl;
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  rmw_ret_t ret = check_graph_guard_condition(impl);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  if (!impl->has_service_names_and_types) {
+    rmw_names_and_types_t result = rmw_get_zero_initialized_names_and_types();
+    ret = rmw_get_service_names_and_types(impl->node, &impl->allocator, &result);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    ret = take_names_and_types(&result, impl->service_names_and_types);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    impl->has_service_names_and_types = true;
+  }
+  return copy_names_and_types(impl->service_names_and_types, allocator, service_names_and_types);
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_get_node_names(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_string_array_t * node_names,
+  rcutils_string_array_t * node_namespaces)
+{
+  CHECK_CACHE(cache);
+  if (RMW_RET_OK != rmw_check_zero_rmw_string_array(node_names)) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  if (RMW_RET_OK != rmw_check_zero_rmw_string_array(node_namespaces)) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  return get_node_names(cache, node_names, node_namespaces, nullptr);
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_get_node_names_with_enclaves(
+  rmw_implementation_graph_cache_t * cache,
+  rcutils_string_array_t * node_names,
+  rcutils_string_array_t * node_namespaces,
+  rcutils_string_array_t * enclaves)
+{
+  CHECK_CACHE(cache);
+  if (RMW_RET_OK != rmw_check_zero_rmw_string_array(node_names)) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  if (RMW_RET_OK != rmw_check_zero_rmw_string_array(node_namespaces)) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  if (RMW_RET_OK != rmw_check_zero_rmw_string_array(enclaves)) {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  return get_node_names(cache, node_names, node_namespaces, enclaves);
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_count_publishers(
+  rmw_implementation_graph_cache_t * cache,
+  const char * topic_name,
+  size_t * count)
+{
+  CHECK_CACHE(cache);
+  RMW_CHECK_ARGUMENT_FOR_NULL(topic_name, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(count, RMW_RET_INVALID_ARGUMENT);
+  return count_endpoints(
+    cache, &CacheImpl::publisher_counts, rmw_count_publishers, topic_name, count);
+}
+
+rmw_ret_t
+rmw_implementation_graph_cache_count_subscribers(
+  rmw_implementation_graph_cache_t * cache,
+  const char * topic_name,
+  size_t * count)
+{
+  CHECK_CACHE(cache);
+  RMW_CHECK_ARGUMENT_FOR_NULL(topic_name, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(count, RMW_RET_INVALID_ARGUMENT);
+  return count_endpoints(
+    cache, &CacheImpl::subscriber_counts, rmw_count_subscribers, topic_name, count);
+}
+}  // extern "C"
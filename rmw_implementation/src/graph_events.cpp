@@ -0,0 +1,565 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/graph_events.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/get_topic_endpoint_info.h"
+#include "rmw/get_topic_names_and_types.h"
+#include "rmw/names_and_types.h"
+#include "rmw/rmw.h"
+#include "rmw/topic_endpoint_info_array.h"
+
+#include "./graph_guard_condition.hpp"
+
+namespace
+{
+
+using Gid = std::array<uint8_t, RMW_GID_STORAGE_SIZE>;
+
+// Endpoints are identified by kind, topic and gid, in this order.
+using EndpointKey = std::tuple<bool, std::string, Gid>;
+
+struct EndpointInfo
+{
+  std::string topic_type;
+  std::string node_name;
+  std::string node_namespace;
+  rmw_qos_profile_t qos_profile;
+};
+
+using Snapshot = std::map<EndpointKey, EndpointInfo>;
+
+struct Event
+{
+  rmw_implementation_graph_event_type_t type;
+  std::string topic_name;
+  Gid gid;
+  EndpointInfo info;
+};
+
+struct GraphSnapshotSource;
+
+}  // namespace
+
+struct rmw_implementation_graph_event_stream_impl_s
+{
+  explicit rmw_implementation_graph_event_stream_impl_s(const rcutils_allocator_t & allocator)
+  : allocator(allocator)
+  {
+  }
+
+  rcutils_allocator_t allocator;
+  std::mutex mutex;
+
+  // Node the stream was initialized for.
+  const rmw_node_t * node{nullptr};
+  GraphSnapshotSource * source{nullptr};
+  // Sequence number of the next change to copy from the source, guarded by
+  // the source mutex.
+  uint64_t next_sequence{0u};
+  // Changes not taken yet.
+  std::deque<Event> pending;
+  // Changes taken last, which taken events point into.
+  std::vector<Event> taken;
+};
+
+namespace
+{
+
+using StreamImpl = rmw_implementation_graph_event_stream_impl_t;
+
+// Snapshot of the graph of a context, shared by all streams of nodes in the
+// context so that each change in the graph is handled once, however many
+// nodes there are: all nodes of a context see the same graph, hence the
+// snapshot is taken through the node of any of its streams.
+// Streams watching graph guard conditions and streams updated by their
+// callers have sources of their own.
+struct GraphSnapshotSource
+{
+  GraphSnapshotSource(const rmw_node_t * node, bool watch_graph_guard_condition)
+  : context(node->context), watch_graph_guard_condition(watch_graph_guard_condition),
+    node(node), allocator(rcutils_get_default_allocator())
+  {
+  }
+
+  const rmw_context_t * context;
+  const bool watch_graph_guard_condition;
+  // Node queried through, and whose graph guard condition is watched, guarded
+  // by mutex.
+  const rmw_node_t * node;
+  rmw_implementation::GraphGuardConditionWatcher graph_guard_condition_watcher;
+  // Whether the graph guard condition of the node is being watched, which it
+  // is not by sources updated by their callers, nor for a while when another
+  // node is queried through.
+  bool watching{false};
+  // Allocator used for queries, as streams may each use a different one.
+  rcutils_allocator_t allocator;
+  std::mutex mutex;
+
+  // Whether the snapshot is current, i.e. no trigger went unhandled.
+  bool up_to_date{false};
+  Snapshot snapshot;
+  // Changes not copied to every stream yet, the first of which has sequence
+  // number first_sequence.
+  std::deque<Event> changes;
+  uint64_t first_sequence{0u};
+  // Streams of nodes in the context, guarded by both g_sources_mutex and mutex.
+  std::vector<StreamImpl *> streams;
+};
+
+std::mutex g_sources_mutex;
+std::vector<GraphSnapshotSource *> g_sources;
+
+using GetInfoByTopicFunction = rmw_ret_t (*)(
+  const rmw_node_t *, rcutils_allocator_t *, const char *, bool,
+  rmw_topic_endpoint_info_array_t *);
+
+// Add endpoints of one kind on a topic to a snapshot.
+rmw_ret_t
+add_endpoints(
+  GraphSnapshotSource * source,
+  const char * topic_name,
+  bool publishers,
+  Snapshot & snapshot)
+{
+  GetInfoByTopicFunction get_info_by_topic =
+    publishers ? rmw_get_publishers_info_by_topic : rmw_get_subscriptions_info_by_topic;
+  rmw_topic_endpoint_info_array_t endpoints = rmw_get_zero_initialized_topic_endpoint_info_array();
+  rmw_ret_t ret = get_info_by_topic(
+    source->node, &source->allocator, topic_name, false, &endpoints);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  try {
+    for (size_t i = 0u; i < endpoints.size; ++i) {
+      const rmw_topic_endpoint_info_t & endpoint = endpoints.info_array[i];
+      Gid gid;
+      std::copy_n(endpoint.endpoint_gid, gid.size(), gid.begin());
+      snapshot.emplace(
+        EndpointKey{publishers, topic_name, gid},
+        EndpointInfo{
+          endpoint.topic_type, endpoint.node_name, endpoint.node_namespace,
+          endpoint.qos_profile});
+    }
+  } catch (const std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate graph snapshot");
+    ret = RMW_RET_BAD_ALLOC;
+  }
+  if (RMW_RET_OK != rmw_topic_endpoint_info_array_fini(&endpoints, &source->allocator)) {
+    // leaked, nothing else to do
+    rmw_reset_error();
+  }
+  return ret;
+}
+
+rmw_ret_t
+take_snapshot(GraphSnapshotSource * source, Snapshot & snapshot)
+{
+  rmw_names_and_types_t topic_names_and_types = rmw_get_zero_initialized_names_and_types();
+  rmw_ret_t ret = rmw_get_topic_names_and_types(
+    source->node, &source->allocator, false, &topic_names_and_types);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  for (size_t i = 0u; RMW_RET_OK == ret && i < topic_names_and_types.names.size; ++i) {
+    const char * topic_name = topic_names_and_types.names.data[i];
+    ret = add_endpoints(source, topic_name, true, snapshot);
+    if (RMW_RET_OK == ret) {
+      ret = add_endpoints(source, topic_name, false, snapshot);
+    }
+  }
+  if (RMW_RET_OK != rmw_names_and_types_fini(&topic_names_and_types)) {
+    rmw_reset_error();
+  }
+  return ret;
+}
+
+Event
+make_event(bool added, const Snapshot::value_type & endpoint)
+{
+  const bool publisher = std::get<0>(endpoint.first);
+  rmw_implementation_graph_event_type_t type;
+  if (publisher) {
+    type = added ?
+      RMW_IMPLEMENTATION_GRAPH_EVENT_PUBLISHER_ADDED :
+      RMW_IMPLEMENTATION_GRAPH_EVENT_PUBLISHER_REMOVED;
+  } else {
+    type = added ?
+      RMW_IMPLEMENTATION_GRAPH_EVENT_SUBSCRIPTION_ADDED :
+      RMW_IMPLEMENTATION_GRAPH_EVENT_SUBSCRIPTION_REMOVED;
+  }
+  return {type, std::get<1>(endpoint.first), std::get<2>(endpoint.first), endpoint.second};
+}
+
+// Queue changes from the current snapshot to the next one in a single pass,
+// as both are sorted.
+void
+queue_changes(GraphSnapshotSource * source, const Snapshot & next)
+{
+  const Snapshot & current = source->snapshot;
+  auto it = current.begin();
+  auto next_it = next.begin();
+  while (it != current.end() || next_it != next.end()) {
+    if (next_it == next.end() || (it != current.end() && it->first < next_it->first)) {
+      source->changes.push_back(make_event(false, *it++));
+    } else if (it == current.end() || next_it->first < it->first) {
+      source->changes.push_back(make_event(true, *next_it++));
+    } else {
+      ++it;
+      ++next_it;
+    }
+  }
+}
+
+// Must be called with the source mutex held.
+rmw_ret_t
+update_source(GraphSnapshotSource * source)
+{
+  Snapshot next;
+  rmw_ret_t ret = take_snapshot(source, next);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  const size_t changes_size = source->changes.size();
+  try {
+    queue_changes(source, next);
+  } catch (const std::bad_alloc &) {
+    // drop partial changes, these are queued anew on the next update
+    source->changes.resize(changes_size);
+    RMW_SET_ERROR_MSG("failed to allocate graph events");
+    return RMW_RET_BAD_ALLOC;
+  }
+  source->snapshot.swap(next);
+  source->up_to_date = true;
+  return RMW_RET_OK;
+}
+
+// Drop changes copied to every stream. Must be called with the source mutex held.
+void
+drop_copied_changes(GraphSnapshotSource * source)
+{
+  uint64_t min_sequence = source->first_sequence + source->changes.size();
+  for (const StreamImpl * impl : source->streams) {
+    min_sequence = std::min(min_sequence, impl->next_sequence);
+  }
+  for (; source->first_sequence < min_sequence; ++source->first_sequence) {
+    source->changes.pop_front();
+  }
+}
+
+// Copy changes of the source not seen by the stream yet to its own.
+// Must be called with both the stream and the source mutex held.
+rmw_ret_t
+copy_changes(StreamImpl * impl)
+{
+  GraphSnapshotSource * source = impl->source;
+  const uint64_t end_sequence = source->first_sequence + source->changes.size();
+  rmw_ret_t ret = RMW_RET_OK;
+  try {
+    for (; impl->next_sequence < end_sequence; ++impl->next_sequence) {
+      impl->pending.push_back(
+        source->changes[static_cast<size_t>(impl->next_sequence - source->first_sequence)]);
+    }
+  } catch (const std::bad_alloc &) {
+    // changes left are copied on the next update
+    RMW_SET_ERROR_MSG("failed to allocate graph events");
+    ret = RMW_RET_BAD_ALLOC;
+  }
+  drop_copied_changes(source);
+  return ret;
+}
+
+// Update the source if it is not current, or if forced to, and copy its
+// changes to the stream. Must be called with the stream mutex held.
+rmw_ret_t
+update(StreamImpl * impl, bool force)
+{
+  GraphSnapshotSource * source = impl->source;
+  std::lock_guard<std::mutex> lock(source->mutex);
+  if (source->watch_graph_guard_condition && !source->watching) {
+    rmw_ret_t ret = source->graph_guard_condition_watcher.init(source->node);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    source->watching = true;
+    // triggers may have gone unseen in the meantime
+    source->up_to_date = false;
+  }
+  if (!force && source->watching) {
+    bool triggered = false;
+    rmw_ret_t ret = source->graph_guard_condition_watcher.check(triggered);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    if (triggered) {
+      source->up_to_date = false;
+    }
+  }
+  if (force || !source->up_to_date) {
+    rmw_ret_t ret = update_source(source);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+  }
+  return copy_changes(impl);
+}
+
+// Destroy the source once it has no streams left.
+// Must be called with g_sources_mutex held.
+rmw_ret_t
+release_source(GraphSnapshotSource * source)
+{
+  if (!source->streams.empty()) {
+    return RMW_RET_OK;
+  }
+  g_sources.erase(std::find(g_sources.begin(), g_sources.end(), source));
+  rmw_ret_t ret = RMW_RET_OK;
+  if (source->watching) {
+    ret = source->graph_guard_condition_watcher.fini();
+  }
+  delete source;
+  return ret;
+}
+
+// Register the stream with the source of the context of the node, creating
+// the source if there is none. Changes of the source are seen from now on, the
+// endpoints of its snapshot being queued as added.
+rmw_ret_t
+register_stream(StreamImpl * impl, const rmw_node_t * node, bool watch_graph_guard_condition)
+{
+  std::lock_guard<std::mutex> lock(g_sources_mutex);
+  auto it = std::find_if(
+    g_sources.begin(), g_sources.end(),
+    [node, watch_graph_guard_condition](const GraphSnapshotSource * source) {
+      return source->context == node->context &&
+             source->watch_graph_guard_condition == watch_graph_guard_condition;
+    });
+  GraphSnapshotSource * source = nullptr;
+  if (it != g_sources.end()) {
+    source = *it;
+  } else {
+    source = new (std::nothrow) GraphSnapshotSource(node, watch_graph_guard_condition);
+    if (nullptr == source) {
+      RMW_SET_ERROR_MSG("failed to allocate graph event stream");
+      return RMW_RET_BAD_ALLOC;
+    }
+    try {
+      g_sources.push_back(source);
+    } catch (const std::bad_alloc &) {
+      delete source;
+      RMW_SET_ERROR_MSG("failed to allocate graph event stream");
+      return RMW_RET_BAD_ALLOC;
+    }
+    if (watch_graph_guard_condition) {
+      rmw_ret_t ret = source->graph_guard_condition_watcher.init(node);
+      if (RMW_RET_OK != ret) {
+        g_sources.pop_back();
+        delete source;
+        return ret;
+      }
+      source->watching = true;
+    }
+  }
+
+  bool registered = false;
+  {
+    std::lock_guard<std::mutex> source_lock(source->mutex);
+    try {
+      for (const Snapshot::value_type & endpoint : source->snapshot) {
+        impl->pending.push_back(make_event(true, endpoint));
+      }
+      source->streams.push_back(impl);
+      registered = true;
+    } catch (const std::bad_alloc &) {
+      impl->pending.clear();
+    }
+    impl->node = node;
+    impl->source = source;
+    impl->next_sequence = source->first_sequence + source->changes.size();
+  }
+  if (!registered) {
+    if (RMW_RET_OK != release_source(source)) {
+      rmw_reset_error();
+    }
+    RMW_SET_ERROR_MSG("failed to allocate graph event stream");
+    return RMW_RET_BAD_ALLOC;
+  }
+  return RMW_RET_OK;
+}
+
+// Unregister the stream from its source, querying through the node of another
+// stream if the node of the stream may no longer be queried through.
+rmw_ret_t
+unregister_stream(StreamImpl * impl)
+{
+  std::lock_guard<std::mutex> lock(g_sources_mutex);
+  GraphSnapshotSource * source = impl->source;
+  rmw_ret_t ret = RMW_RET_OK;
+  {
+    std::lock_guard<std::mutex> source_lock(source->mutex);
+    source->streams.erase(std::find(source->streams.begin(), source->streams.end(), impl));
+    drop_copied_changes(source);
+    const bool node_released = std::none_of(
+      source->streams.begin(), source->streams.end(),
+      [source](const StreamImpl * other) {return other->node == source->node;});
+    if (node_released && !source->streams.empty()) {
+      // the graph guard condition of the next node is watched on next update
+      if (source->watching) {
+        ret = source->graph_guard_condition_watcher.fini();
+        source->watching = false;
+      }
+      source->node = source->streams.front()->node;
+    }
+  }
+  rmw_ret_t release_ret = release_source(source);
+  if (RMW_RET_OK == ret) {
+    return release_ret;
+  }
+  if (RMW_RET_OK != release_ret) {
+    // keep the first error
+    rmw_reset_error();
+  }
+  return ret;
+}
+
+}  // namespace
+
+#define CHECK_STREAM(stream) \
+  do { \
+    RMW_CHECK_ARGUMENT_FOR_NULL(stream, RMW_RET_INVALID_ARGUMENT); \
+    RMW_CHECK_FOR_NULL_WITH_MSG( \
+      stream->impl, "graph event stream is not initialized", return RMW_RET_INVALID_ARGUMENT); \
+  } while (0)
+
+extern "C"
+{
+rmw_implementation_graph_event_stream_t
+rmw_implementation_get_zero_initialized_graph_event_stream(void)
+{
+  rmw_implementation_graph_event_stream_t stream;
+  stream.impl = nullptr;
+  return stream;
+}
+
+rmw_ret_t
+rmw_implementation_graph_event_stream_init(
+  rmw_implementation_graph_event_stream_t * stream,
+  const rmw_node_t * node,
+  bool watch_graph_guard_condition,
+  const rcutils_allocator_t * allocator)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(stream, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != stream->impl) {
+    RMW_SET_ERROR_MSG("graph event stream is already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(node, RMW_RET_INVALID_ARGUMENT);
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  void * memory = allocator->allocate(sizeof(StreamImpl), allocator->state);
+  if (nullptr == memory) {
+    RMW_SET_ERROR_MSG("failed to allocate graph event stream");
+    return RMW_RET_BAD_ALLOC;
+  }
+  StreamImpl * impl = new (memory) StreamImpl(*allocator);
+  rmw_ret_t ret = register_stream(impl, node, watch_graph_guard_condition);
+  if (RMW_RET_OK != ret) {
+    impl->~StreamImpl();
+    allocator->deallocate(memory, allocator->state);
+    return ret;
+  }
+  stream->impl = impl;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_graph_event_stream_fini(rmw_implementation_graph_event_stream_t * stream)
+{
+  CHECK_STREAM(stream);
+  StreamImpl * impl = stream->impl;
+  rmw_ret_t ret = unregister_stream(impl);
+  rcutils_allocator_t allocator = impl->allocator;
+  impl->~StreamImpl();
+  allocator.deallocate(impl, allocator.state);
+  *stream = rmw_implementation_get_zero_initialized_graph_event_stream();
+  return ret;
+}
+
+rmw_ret_t
+rmw_implementation_graph_event_stream_update(rmw_implementation_graph_event_stream_t * stream)
+{
+  CHECK_STREAM(stream);
+  std::lock_guard<std::mutex> lock(stream->impl->mutex);
+  return update(stream->impl, true);
+}
+
+rmw_ret_t
+rmw_implementation_graph_event_stream_take(
+  rmw_implementation_graph_event_stream_t * stream,
+  rmw_implementation_graph_event_t * events,
+  size_t capacity,
+  size_t * count)
+{
+  CHECK_STREAM(stream);
+  RMW_CHECK_ARGUMENT_FOR_NULL(events, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(count, RMW_RET_INVALID_ARGUMENT);
+  *count = 0u;
+
+  StreamImpl * impl = stream->impl;
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  rmw_ret_t ret = update(impl, false);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  impl->taken.clear();
+  const size_t taken_count = std::min(capacity, impl->pending.size());
+  try {
+    impl->taken.reserve(taken_count);
+  } catch (const std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate graph events");
+    return RMW_RET_BAD_ALLOC;
+  }
+  for (size_t i = 0u; i < taken_count; ++i) {
+    impl->taken.push_back(std::move(impl->pending.front()));
+    impl->pending.pop_front();
+    const Event & event = impl->taken.back();
+    events[i].type = event.type;
+    events[i].topic_name = event.topic_name.c_str();
+    events[i].topic_type = event.info.topic_type.c_str();
+    events[i].node_name = event.info.node_name.c_str();
+    events[i].node_namespace = event.info.node_namespace.c_str();
+    std::copy(event.gid.begin(), event.gid.end(), events[i].endpoint_gid);
+    events[i].qos_profile = event.info.qos_profile;
+  }
+  *count = taken_count;
+  return RMW_RET_OK;
+}
+}  // extern "C"
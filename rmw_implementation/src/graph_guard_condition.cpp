@@ -0,0 +1,154 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "./graph_guard_condition.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "./forwarding.hpp"
+
+namespace rmw_implementation
+{
+
+// Triggers of the graph guard condition of a node, seen by any of its
+// watchers, counted for all of them.
+struct GraphGuardConditionTriggers
+{
+  const rmw_node_t * node;
+  // Number of triggers seen so far.
+  std::atomic<uint64_t> count{0u};
+  // Number of watchers, guarded by g_triggers_mutex.
+  size_t watcher_count{0u};
+};
+
+namespace
+{
+
+std::mutex g_triggers_mutex;
+std::vector<GraphGuardConditionTriggers *> g_triggers;
+
+// Get the triggers of the graph guard condition of a node, adding a watcher.
+rmw_ret_t
+acquire_triggers(const rmw_node_t * node, GraphGuardConditionTriggers ** triggers)
+{
+  std::lock_guard<std::mutex> lock(g_triggers_mutex);
+  auto it = std::find_if(
+    g_triggers.begin(), g_triggers.end(),
+    [node](const GraphGuardConditionTriggers * triggers) {return triggers->node == node;});
+  if (it != g_triggers.end()) {
+    *triggers = *it;
+  } else {
+    GraphGuardConditionTriggers * new_triggers = new (std::nothrow) GraphGuardConditionTriggers();
+    if (nullptr == new_triggers) {
+      RMW_SET_ERROR_MSG("failed to allocate graph guard condition watcher");
+      return RMW_RET_BAD_ALLOC;
+    }
+    new_triggers->node = node;
+    try {
+      g_triggers.push_back(new_triggers);
+    } catch (const std::bad_alloc &) {
+      delete new_triggers;
+      RMW_SET_ERROR_MSG("failed to allocate graph guard condition watcher");
+      return RMW_RET_BAD_ALLOC;
+    }
+    *triggers = new_triggers;
+  }
+  ++(*triggers)->watcher_count;
+  return RMW_RET_OK;
+}
+
+// Remove a watcher of the triggers, destroying these after the last one.
+void
+release_triggers(GraphGuardConditionTriggers * triggers)
+{
+  std::lock_guard<std::mutex> lock(g_triggers_mutex);
+  if (0u != --triggers->watcher_count) {
+    return;
+  }
+  g_triggers.erase(std::find(g_triggers.begin(), g_triggers.end(), triggers));
+  delete triggers;
+}
+
+}  // namespace
+
+rmw_ret_t
+GraphGuardConditionWatcher::init(const rmw_node_t * node)
+{
+  // calls of the library itself are left out of profiles, timings and injections
+  const rmw_guard_condition_t * graph_guard_condition = CALL_IMPLEMENTATION(
+    rmw_node_get_graph_guard_condition, node);
+  if (nullptr == graph_guard_condition) {
+    return RMW_RET_ERROR;
+  }
+  GraphGuardConditionTriggers * triggers = nullptr;
+  rmw_ret_t ret = acquire_triggers(node, &triggers);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  rmw_wait_set_t * wait_set = CALL_IMPLEMENTATION(rmw_create_wait_set, node->context, 1u);
+  if (nullptr == wait_set) {
+    release_triggers(triggers);
+    return RMW_RET_ERROR;
+  }
+  graph_guard_condition_ = graph_guard_condition;
+  wait_set_ = wait_set;
+  triggers_ = triggers;
+  seen_trigger_count_ = triggers->count.load(std::memory_order_acquire);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+GraphGuardConditionWatcher::fini()
+{
+  if (nullptr == wait_set_) {
+    return RMW_RET_OK;
+  }
+  rmw_ret_t ret = CALL_IMPLEMENTATION(rmw_destroy_wait_set, wait_set_);
+  release_triggers(triggers_);
+  graph_guard_condition_ = nullptr;
+  wait_set_ = nullptr;
+  triggers_ = nullptr;
+  return ret;
+}
+
+rmw_ret_t
+GraphGuardConditionWatcher::check(bool & triggered)
+{
+  triggered = false;
+  // rmw_wait() clears guard conditions that were not triggered
+  void * guard_conditions_storage[1] = {graph_guard_condition_->data};
+  rmw_guard_conditions_t guard_conditions = {1u, guard_conditions_storage};
+  const rmw_time_t timeout = {0u, 0u};
+  rmw_ret_t ret = CALL_IMPLEMENTATION(
+    rmw_wait, nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set_, &timeout);
+  if (RMW_RET_OK == ret && nullptr != guard_conditions.guard_conditions[0]) {
+    triggers_->count.fetch_add(1u, std::memory_order_acq_rel);
+  } else if (RMW_RET_OK != ret && RMW_RET_TIMEOUT != ret) {
+    return ret;
+  }
+  // triggers seen by other watchers of the node are seen as well
+  const uint64_t trigger_count = triggers_->count.load(std::memory_order_acquire);
+  triggered = trigger_count != seen_trigger_count_;
+  seen_trigger_count_ = trigger_count;
+  return RMW_RET_OK;
+}
+
+}  // namespace rmw_implementation
@@ -0,0 +1,80 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef GRAPH_GUARD_CONDITION_HPP_
+#define GRAPH_GUARD_CONDITION_HPP_
+
+#include <cstdint>
+
+#include "rmw/types.h"
+
+namespace rmw_implementation
+{
+
+struct GraphGuardConditionTriggers;
+
+/// Watch the graph guard condition of a node, without blocking.
+/**
+ * Checking waits on the graph guard condition with a wait set of the watcher
+ * and a zero timeout.
+ * Waiting on the graph guard condition consumes its triggers, hence the
+ * triggers seen by the watchers of a node are counted for all of them; each
+ * watcher sees every trigger once.
+ * The graph guard condition must not be waited on elsewhere, e.g. by the
+ * graph listener of rcl.
+ *
+ * Watchers are not thread-safe, callers must serialize their use.
+ */
+class GraphGuardConditionWatcher
+{
+public:
+  GraphGuardConditionWatcher() = default;
+
+  GraphGuardConditionWatcher(const GraphGuardConditionWatcher &) = delete;
+  GraphGuardConditionWatcher & operator=(const GraphGuardConditionWatcher &) = delete;
+
+  /**
+   * Triggers seen before are not seen.
+   *
+   * \return `RMW_RET_OK` if successful, or
+   * \return `RMW_RET_BAD_ALLOC` if memory allocation fails, or
+   * \return `RMW_RET_ERROR` if the graph guard condition of `node` cannot be
+   *   waited on.
+   */
+  rmw_ret_t init(const rmw_node_t * node);
+
+  /**
+   * \return `RMW_RET_OK` if successful, or
+   * \return an error returned by rmw_destroy_wait_set().
+   */
+  rmw_ret_t fini();
+
+  /**
+   * \param[out] triggered whether the graph guard condition was triggered
+   *   since last checked.
+   * \return `RMW_RET_OK` if successful, or
+   * \return an error returned by rmw_wait().
+   */
+  rmw_ret_t check(bool & triggered);
+
+private:
+  const rmw_guard_condition_t * graph_guard_condition_{nullptr};
+  rmw_wait_set_t * wait_set_{nullptr};
+  GraphGuardConditionTriggers * triggers_{nullptr};
+  uint64_t seen_trigger_count_{0u};
+};
+
+}  // namespace rmw_implementation
+
+#endif  // GRAPH_GUARD_CONDITION_HPP_
@@ -0,0 +1,241 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/graph_wait.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "./forwarding.hpp"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// Re-evaluate conditions at least this often, as not every change they may
+// depend on triggers the graph guard condition.
+constexpr std::chrono::milliseconds poll_period{10};
+
+Clock::time_point
+get_deadline(const rmw_time_t * timeout)
+{
+  // Too long a timeout to be told apart from waiting indefinitely
+  constexpr uint64_t max_timeout_sec = 60ull * 60ull * 24ull * 365ull * 100ull;
+  if (nullptr == timeout || timeout->sec >= max_timeout_sec) {
+    return Clock::time_point::max();
+  }
+  return Clock::now() + std::chrono::duration_cast<Clock::duration>(
+    std::chrono::seconds(timeout->sec) + std::chrono::nanoseconds(timeout->nsec));
+}
+
+struct MatchedSubscriptionsCondition
+{
+  const rmw_publisher_t * publisher;
+  size_t count;
+};
+
+rmw_ret_t
+check_matched_subscriptions(void * data, bool * holds)
+{
+  auto condition = static_cast<MatchedSubscriptionsCondition *>(data);
+  size_t count = 0u;
+  rmw_ret_t ret = rmw_publisher_count_matched_subscriptions(condition->publisher, &count);
+  *holds = condition->count == count;
+  return ret;
+}
+
+struct MatchedPublishersCondition
+{
+  const rmw_subscription_t * subscription;
+  size_t count;
+};
+
+rmw_ret_t
+check_matched_publishers(void * data, bool * holds)
+{
+  auto condition = static_cast<MatchedPublishersCondition *>(data);
+  size_t count = 0u;
+  rmw_ret_t ret = rmw_subscription_count_matched_publishers(condition->subscription, &count);
+  *holds = condition->count == count;
+  return ret;
+}
+
+using CountFunction = rmw_ret_t (*)(const rmw_node_t *, const char *, size_t *);
+
+struct EndpointCountCondition
+{
+  CountFunction count_endpoints;
+  const rmw_node_t * node;
+  const char * topic_name;
+  size_t count;
+};
+
+rmw_ret_t
+check_endpoint_count(void * data, bool * holds)
+{
+  auto condition = static_cast<EndpointCountCondition *>(data);
+  size_t count = 0u;
+  rmw_ret_t ret = condition->count_endpoints(condition->node, condition->topic_name, &count);
+  *holds = condition->count == count;
+  return ret;
+}
+
+struct ServiceServerCondition
+{
+  const rmw_node_t * node;
+  const rmw_client_t * client;
+};
+
+rmw_ret_t
+check_service_server(void * data, bool * holds)
+{
+  auto condition = static_cast<ServiceServerCondition *>(data);
+  return rmw_service_server_is_available(condition->node, condition->client, holds);
+}
+
+}  // namespace
+
+extern "C"
+{
+rmw_ret_t
+rmw_implementation_wait_for_graph_condition(
+  const rmw_node_t * node,
+  rmw_implementation_graph_condition_t condition,
+  void * data,
+  const rmw_time_t * timeout)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(node, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(condition, RMW_RET_INVALID_ARGUMENT);
+
+  const Clock::time_point deadline = get_deadline(timeout);
+  bool holds = false;
+  rmw_ret_t ret = condition(data, &holds);
+  if (RMW_RET_OK != ret || holds) {
+    return ret;
+  }
+
+  const rmw_guard_condition_t * graph_guard_condition = rmw_node_get_graph_guard_condition(node);
+  if (nullptr == graph_guard_condition) {
+    return RMW_RET_ERROR;
+  }
+  // waits of the library itself are left out of profiles, timings and injections
+  rmw_wait_set_t * wait_set = CALL_IMPLEMENTATION(rmw_create_wait_set, node->context, 1u);
+  if (nullptr == wait_set) {
+    return RMW_RET_ERROR;
+  }
+  void * guard_conditions_storage[1];
+  while (true) {
+    const Clock::time_point now = Clock::now();
+    if (now >= deadline) {
+      ret = RMW_RET_TIMEOUT;
+      break;
+    }
+    const auto wait_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::min<Clock::duration>(deadline - now, poll_period));
+    rmw_time_t wait_timeout;
+    wait_timeout.sec = static_cast<uint64_t>(wait_duration.count() / 1000000000);
+    wait_timeout.nsec = static_cast<uint64_t>(wait_duration.count() % 1000000000);
+    // rmw_wait() clears guard conditions that were not triggered
+    guard_conditions_storage[0] = graph_guard_condition->data;
+    rmw_guard_conditions_t guard_conditions = {1u, guard_conditions_storage};
+    ret = CALL_IMPLEMENTATION(
+      rmw_wait, nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set, &wait_timeout);
+    if (RMW_RET_OK != ret && RMW_RET_TIMEOUT != ret) {
+      break;
+    }
+    ret = condition(data, &holds);
+    if (RMW_RET_OK != ret || holds) {
+      break;
+    }
+  }
+  rmw_ret_t destroy_ret = CALL_IMPLEMENTATION(rmw_destroy_wait_set, wait_set);
+  if (RMW_RET_OK != destroy_ret) {
+    if (RMW_RET_OK == ret || RMW_RET_TIMEOUT == ret) {
+      return destroy_ret;
+    }
+    // keep the first error
+    rmw_reset_error();
+  }
+  return ret;
+}
+
+rmw_ret_t
+rmw_implementation_wait_for_matched_subscriptions(
+  const rmw_node_t * node,
+  const rmw_publisher_t * publisher,
+  size_t count,
+  const rmw_time_t * timeout)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  MatchedSubscriptionsCondition condition{publisher, count};
+  return rmw_implementation_wait_for_graph_condition(
+    node, check_matched_subscriptions, &condition, timeout);
+}
+
+rmw_ret_t
+rmw_implementation_wait_for_matched_publishers(
+  const rmw_node_t * node,
+  const rmw_subscription_t * subscription,
+  size_t count,
+  const rmw_time_t * timeout)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  MatchedPublishersCondition condition{subscription, count};
+  return rmw_implementation_wait_for_graph_condition(
+    node, check_matched_publishers, &condition, timeout);
+}
+
+rmw_ret_t
+rmw_implementation_wait_for_publishers(
+  const rmw_node_t * node,
+  const char * topic_name,
+  size_t count,
+  const rmw_time_t * timeout)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(topic_name, RMW_RET_INVALID_ARGUMENT);
+  EndpointCountCondition condition{rmw_count_publishers, node, topic_name, count};
+  return rmw_implementation_wait_for_graph_condition(
+    node, check_endpoint_count, &condition, timeout);
+}
+
+rmw_ret_t
+rmw_implementation_wait_for_subscribers(
+  const rmw_node_t * node,
+  const char * topic_name,
+  size_t count,
+  const rmw_time_t * timeout)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(topic_name, RMW_RET_INVALID_ARGUMENT);
+  EndpointCountCondition condition{rmw_count_subscribers, node, topic_name, count};
+  return rmw_implementation_wait_for_graph_condition(
+    node, check_endpoint_count, &condition, timeout);
+}
+
+rmw_ret_t
+rmw_implementation_wait_for_service_server(
+  const rmw_node_t * node,
+  const rmw_client_t * client,
+  const rmw_time_t * timeout)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(client, RMW_RET_INVALID_ARGUMENT);
+  ServiceServerCondition condition{node, client};
+  return rmw_implementation_wait_for_graph_condition(
+    node, check_service_server, &condition, timeout);
+}
+}  // extern "C"
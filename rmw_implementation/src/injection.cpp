@@ -0,0 +1,603 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/injection.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/serialized_message.h"
+
+#include "./forwarding.hpp"
+#include "./functions.hpp"
+
+namespace rmw_implementation
+{
+namespace
+{
+
+using Injection = rmw_implementation_injection_t;
+
+// Serializes enabling and disabling injection.
+std::mutex g_injection_mutex;
+std::atomic<bool> g_injection_enabled{false};
+
+// Injections of topics that have their own, and of all other topics.
+std::mutex g_injections_mutex;
+std::map<std::string, Injection, std::less<>> g_topic_injections;
+bool g_has_default_injection = false;
+Injection g_default_injection;
+
+// Incremented whenever injections are set, and whenever the topic names they
+// are cached by may be freed, i.e. entities destroyed, for threads to drop the
+// injections they cached. Starts at 1 so that threads without any drop none.
+std::atomic<uint64_t> g_injections_generation{1u};
+
+void
+invalidate_cached_injections()
+{
+  g_injections_generation.fetch_add(1u, std::memory_order_release);
+}
+
+// Look the injection of a topic up, or the one of all topics if `topic_name`
+// is NULL.
+bool
+find_injection(const char * topic_name, Injection & injection)
+{
+  std::lock_guard<std::mutex> lock(g_injections_mutex);
+  if (topic_name) {
+    auto it = g_topic_injections.find(topic_name);
+    if (it != g_topic_injections.end()) {
+      injection = it->second;
+      return true;
+    }
+  }
+  if (g_has_default_injection) {
+    injection = g_default_injection;
+    return true;
+  }
+  return false;
+}
+
+struct CachedInjection
+{
+  bool found;
+  Injection injection;
+};
+
+// Get the injection of the topic of an entity, if any and if injection is
+// enabled. Injections are looked up once per entity topic name and per
+// thread, then cached by pointer until injections change, so that calls made
+// for an entity neither lock nor compare topic names.
+bool
+get_injection(const char * topic_name, Injection & injection)
+{
+  if (!g_injection_enabled.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  thread_local uint64_t t_generation = 0u;
+  thread_local std::unordered_map<const char *, CachedInjection> t_injections;
+  const uint64_t generation = g_injections_generation.load(std::memory_order_acquire);
+  if (t_generation != generation) {
+    t_injections.clear();
+    t_generation = generation;
+  }
+  auto it = t_injections.find(topic_name);
+  if (it == t_injections.end()) {
+    CachedInjection cached;
+    cached.found = find_injection(topic_name, cached.injection);
+    try {
+      it = t_injections.emplace(topic_name, cached).first;
+    } catch (const std::bad_alloc &) {
+      // looked up again on the next call
+      injection = cached.injection;
+      return cached.found;
+    }
+  }
+  injection = it->second.injection;
+  return it->second.found;
+}
+
+std::atomic<uint64_t> g_seed{0u};
+// Incremented on reseeding, for threads to reseed their generator lazily.
+std::atomic<uint32_t> g_seed_generation{0u};
+std::atomic<uint32_t> g_thread_count{0u};
+
+std::mt19937_64 &
+get_random_engine()
+{
+  thread_local const uint32_t thread_index = g_thread_count.fetch_add(1u);
+  thread_local uint32_t seed_generation = 0u;
+  thread_local std::mt19937_64 engine;
+  const uint32_t current_seed_generation = g_seed_generation.load(std::memory_order_acquire);
+  if (seed_generation != current_seed_generation) {
+    const uint64_t seed = g_seed.load(std::memory_order_relaxed);
+    std::seed_seq seed_sequence{
+      static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32u), thread_index};
+    engine.seed(seed_sequence);
+    seed_generation = current_seed_generation;
+  }
+  return engine;
+}
+
+bool
+draw(double probability)
+{
+  if (probability <= 0.0) {
+    return false;
+  }
+  if (probability >= 1.0) {
+    return true;
+  }
+  return std::uniform_real_distribution<double>(0.0, 1.0)(get_random_engine()) < probability;
+}
+
+std::atomic<uint64_t> g_delayed_count{0u};
+std::atomic<uint64_t> g_total_delay_ns{0u};
+std::atomic<uint64_t> g_dropped_count{0u};
+std::atomic<uint64_t> g_reordered_count{0u};
+
+void
+delay(const Injection & injection)
+{
+  uint64_t delay_ns = injection.latency_ns;
+  if (injection.jitter_ns > 0u) {
+    delay_ns += std::uniform_int_distribution<uint64_t>(0u, injection.jitter_ns)(
+      get_random_engine());
+  }
+  if (0u == delay_ns) {
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<int64_t>(delay_ns)));
+  g_delayed_count.fetch_add(1u, std::memory_order_relaxed);
+  g_total_delay_ns.fetch_add(delay_ns, std::memory_order_relaxed);
+}
+
+// Functions the injectors forward to, as swapped out of the dispatch table.
+DispatchTable g_injected_table;
+
+// Serialized messages held back to be published after the next message of
+// their publisher, guarded by the held messages mutex. Messages are only held
+// back while injection is enabled, so that none are left once disabled.
+std::mutex g_held_messages_mutex;
+std::unordered_map<const rmw_publisher_t *, rmw_serialized_message_t> g_held_messages;
+
+void
+fini_held_message(rmw_serialized_message_t & held_message)
+{
+  if (RMW_RET_OK != rmw_serialized_message_fini(&held_message)) {
+    // buffer is leaked, nothing else to do
+    rmw_reset_error();
+  }
+}
+
+bool
+hold_message(
+  const rmw_publisher_t * publisher,
+  const rmw_serialized_message_t * serialized_message)
+{
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_serialized_message_t held_message = rmw_get_zero_initialized_serialized_message();
+  if (RMW_RET_OK != rmw_serialized_message_init(
+      &held_message, serialized_message->buffer_length, &allocator))
+  {
+    rmw_reset_error();
+    return false;
+  }
+  if (serialized_message->buffer_length > 0u) {
+    memcpy(held_message.buffer, serialized_message->buffer, serialized_message->buffer_length);
+  }
+  held_message.buffer_length = serialized_message->buffer_length;
+  bool held = false;
+  {
+    std::lock_guard<std::mutex> lock(g_held_messages_mutex);
+    if (g_injection_enabled.load(std::memory_order_relaxed)) {
+      try {
+        held = g_held_messages.emplace(publisher, held_message).second;
+      } catch (const std::bad_alloc &) {
+      }
+    }
+  }
+  if (!held) {
+    fini_held_message(held_message);
+  }
+  return held;
+}
+
+bool
+take_held_message(const rmw_publisher_t * publisher, rmw_serialized_message_t & held_message)
+{
+  std::lock_guard<std::mutex> lock(g_held_messages_mutex);
+  auto it = g_held_messages.find(publisher);
+  if (it == g_held_messages.end()) {
+    return false;
+  }
+  held_message = it->second;
+  g_held_messages.erase(it);
+  return true;
+}
+
+void
+publish_held_message(const rmw_publisher_t * publisher, rmw_serialized_message_t & held_message)
+{
+  rmw_ret_t ret = g_injected_table.rmw_publish_serialized_message.load(
+    std::memory_order_relaxed)(publisher, &held_message, nullptr);
+  if (RMW_RET_OK != ret) {
+    // as if dropped, the original call has returned already
+    rmw_reset_error();
+    g_dropped_count.fetch_add(1u, std::memory_order_relaxed);
+  }
+  fini_held_message(held_message);
+}
+
+rmw_ret_t
+inject_rmw_destroy_publisher(rmw_node_t * node, rmw_publisher_t * publisher)
+{
+  rmw_serialized_message_t held_message;
+  if (take_held_message(publisher, held_message)) {
+    publish_held_message(publisher, held_message);
+  }
+  // before its topic name is freed, and possibly reused
+  invalidate_cached_injections();
+  return g_injected_table.rmw_destroy_publisher.load(std::memory_order_relaxed)(node, publisher);
+}
+
+rmw_ret_t
+inject_rmw_destroy_subscription(rmw_node_t * node, rmw_subscription_t * subscription)
+{
+  // before its topic name is freed, and possibly reused
+  invalidate_cached_injections();
+  return g_injected_table.rmw_destroy_subscription.load(std::memory_order_relaxed)(
+    node, subscription);
+}
+
+rmw_ret_t
+inject_rmw_publish(
+  const rmw_publisher_t * publisher,
+  const void * ros_message,
+  rmw_publisher_allocation_t * allocation)
+{
+  Injection injection;
+  if (publisher && get_injection(publisher->topic_name, injection)) {
+    delay(injection);
+    if (draw(injection.drop_probability)) {
+      g_dropped_count.fetch_add(1u, std::memory_order_relaxed);
+      return RMW_RET_OK;
+    }
+  }
+  return g_injected_table.rmw_publish.load(std::memory_order_relaxed)(
+    publisher, ros_message, allocation);
+}
+
+rmw_ret_t
+inject_rmw_publish_serialized_message(
+  const rmw_publisher_t * publisher,
+  const rmw_serialized_message_t * serialized_message,
+  rmw_publisher_allocation_t * allocation)
+{
+  auto rmw_publish_serialized_message =
+    g_injected_table.rmw_publish_serialized_message.load(std::memory_order_relaxed);
+  Injection injection;
+  if (!publisher || !serialized_message || !get_injection(publisher->topic_name, injection)) {
+    return rmw_publish_serialized_message(publisher, serialized_message, allocation);
+  }
+  delay(injection);
+  if (draw(injection.drop_probability)) {
+    g_dropped_count.fetch_add(1u, std::memory_order_relaxed);
+    return RMW_RET_OK;
+  }
+  rmw_serialized_message_t held_message;
+  const bool has_held_message = take_held_message(publisher, held_message);
+  if (!has_held_message && draw(injection.reorder_probability) &&
+    hold_message(publisher, serialized_message))
+  {
+    g_reordered_count.fetch_add(1u, std::memory_order_relaxed);
+    return RMW_RET_OK;
+  }
+  rmw_ret_t ret = rmw_publish_serialized_message(publisher, serialized_message, allocation);
+  if (has_held_message) {
+    if (RMW_RET_OK == ret) {
+      publish_held_message(publisher, held_message);
+    } else {
+      // not to overwrite the error of the call
+      g_dropped_count.fetch_add(1u, std::memory_order_relaxed);
+      fini_held_message(held_message);
+    }
+  }
+  return ret;
+}
+
+// Delay taking a message, if there is an injection for the subscription.
+bool
+before_take(const rmw_subscription_t * subscription, Injection & injection)
+{
+  if (!subscription || !get_injection(subscription->topic_name, injection)) {
+    return false;
+  }
+  delay(injection);
+  return true;
+}
+
+// Drop a message taken, if there is an injection for the subscription.
+void
+after_take(bool inject, const Injection & injection, rmw_ret_t ret, bool * taken)
+{
+  if (inject && RMW_RET_OK == ret && *taken && draw(injection.drop_probability)) {
+    *taken = false;
+    g_dropped_count.fetch_add(1u, std::memory_order_relaxed);
+  }
+}
+
+rmw_ret_t
+inject_rmw_take(
+  const rmw_subscription_t * subscription,
+  void * ros_message,
+  bool * taken,
+  rmw_subscription_allocation_t * allocation)
+{
+  Injection injection;
+  const bool inject = before_take(subscription, injection);
+  rmw_ret_t ret = g_injected_table.rmw_take.load(std::memory_order_relaxed)(
+    subscription, ros_message, taken, allocation);
+  after_take(inject, injection, ret, taken);
+  return ret;
+}
+
+rmw_ret_t
+inject_rmw_take_with_info(
+  const rmw_subscription_t * subscription,
+  void * ros_message,
+  bool * taken,
+  rmw_message_info_t * message_info,
+  rmw_subscription_allocation_t * allocation)
+{
+  Injection injection;
+  const bool inject = before_take(subscription, injection);
+  rmw_ret_t ret = g_injected_table.rmw_take_with_info.load(std::memory_order_relaxed)(
+    subscription, ros_message, taken, message_info, allocation);
+  after_take(inject, injection, ret, taken);
+  return ret;
+}
+
+rmw_ret_t
+inject_rmw_take_serialized_message(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message,
+  bool * taken,
+  rmw_subscription_allocation_t * allocation)
+{
+  Injection injection;
+  const bool inject = before_take(subscription, injection);
+  rmw_ret_t ret = g_injected_table.rmw_take_serialized_message.load(std::memory_order_relaxed)(
+    subscription, serialized_message, taken, allocation);
+  after_take(inject, injection, ret, taken);
+  return ret;
+}
+
+rmw_ret_t
+inject_rmw_take_serialized_message_with_info(
+  const rmw_subscription_t * subscription,
+  rmw_serialized_message_t * serialized_message,
+  bool * taken,
+  rmw_message_info_t * message_info,
+  rmw_subscription_allocation_t * allocation)
+{
+  Injection injection;
+  const bool inject = before_take(subscription, injection);
+  rmw_ret_t ret = g_injected_table.rmw_take_serialized_message_with_info.load(
+    std::memory_order_relaxed)(subscription, serialized_message, taken, message_info, allocation);
+  after_take(inject, injection, ret, taken);
+  return ret;
+}
+
+rmw_ret_t
+inject_rmw_wait(
+  rmw_subscriptions_t * subscriptions,
+  rmw_guard_conditions_t * guard_conditions,
+  rmw_services_t * services,
+  rmw_clients_t * clients,
+  rmw_events_t * events,
+  rmw_wait_set_t * wait_set,
+  const rmw_time_t * wait_timeout)
+{
+  rmw_ret_t ret = g_injected_table.rmw_wait.load(std::memory_order_relaxed)(
+    subscriptions, guard_conditions, services, clients, events, wait_set, wait_timeout);
+  Injection injection;
+  // waits are for no topic in particular
+  if (RMW_RET_OK == ret && get_injection(nullptr, injection)) {
+    delay(injection);
+  }
+  return ret;
+}
+
+#define INJECTED_FNS(X) \
+  X(rmw_destroy_publisher) \
+  X(rmw_destroy_subscription) \
+  X(rmw_publish) \
+  X(rmw_publish_serialized_message) \
+  X(rmw_take) \
+  X(rmw_take_with_info) \
+  X(rmw_take_serialized_message) \
+  X(rmw_take_serialized_message_with_info) \
+  X(rmw_wait)
+
+#define INSTALL_INJECTOR(name) \
+  INTERPOSE_DISPATCH_TABLE_ENTRY(g_injected_table, name, inject_ ## name)
+
+#define UNINSTALL_INJECTOR(name) \
+  RESTORE_DISPATCH_TABLE_ENTRY(g_injected_table, name, inject_ ## name)
+
+rmw_ret_t
+enable_injection(uint64_t seed)
+{
+  std::lock_guard<std::mutex> lock(g_injection_mutex);
+  // only bound entries can be injected into
+  prefetch_symbols();
+  if (!all_symbols_resolved()) {
+    // error message set by prefetch_symbols()
+    return RMW_RET_ERROR;
+  }
+  g_seed.store(seed, std::memory_order_relaxed);
+  g_seed_generation.fetch_add(1u, std::memory_order_release);
+  INJECTED_FNS(INSTALL_INJECTOR)
+  // entities may have been destroyed meanwhile
+  invalidate_cached_injections();
+  std::lock_guard<std::mutex> held_messages_lock(g_held_messages_mutex);
+  g_injection_enabled.store(true);
+  return RMW_RET_OK;
+}
+
+void
+disable_injection()
+{
+  std::lock_guard<std::mutex> lock(g_injection_mutex);
+  INJECTED_FNS(UNINSTALL_INJECTOR)
+  std::unordered_map<const rmw_publisher_t *, rmw_serialized_message_t> held_messages;
+  {
+    std::lock_guard<std::mutex> held_messages_lock(g_held_messages_mutex);
+    g_injection_enabled.store(false);
+    held_messages.swap(g_held_messages);
+  }
+  for (auto & entry : held_messages) {
+    publish_held_message(entry.first, entry.second);
+  }
+}
+
+bool
+check_probability(double probability, const char * name)
+{
+  // also false for NaN
+  if (!(probability >= 0.0 && probability <= 1.0)) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("%s must be between 0 and 1", name);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace rmw_implementation
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+rmw_implementation_injection_t
+rmw_implementation_get_zero_initialized_injection(void)
+{
+  rmw_implementation_injection_t injection;
+  injection.latency_ns = 0u;
+  injection.jitter_ns = 0u;
+  injection.drop_probability = 0.0;
+  injection.reorder_probability = 0.0;
+  return injection;
+}
+
+rmw_ret_t
+rmw_implementation_injection_set(
+  const char * topic_name,
+  const rmw_implementation_injection_t * injection)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(injection, RMW_RET_INVALID_ARGUMENT);
+  if (!rmw_implementation::check_probability(injection->drop_probability, "drop_probability") ||
+    !rmw_implementation::check_probability(
+      injection->reorder_probability, "reorder_probability"))
+  {
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  std::lock_guard<std::mutex> lock(rmw_implementation::g_injections_mutex);
+  if (!topic_name) {
+    rmw_implementation::g_default_injection = *injection;
+    rmw_implementation::g_has_default_injection = true;
+    rmw_implementation::invalidate_cached_injections();
+    return RMW_RET_OK;
+  }
+  try {
+    rmw_implementation::g_topic_injections[topic_name] = *injection;
+  } catch (const std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate injection");
+    return RMW_RET_BAD_ALLOC;
+  }
+  rmw_implementation::invalidate_cached_injections();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_injection_clear(void)
+{
+  std::lock_guard<std::mutex> lock(rmw_implementation::g_injections_mutex);
+  rmw_implementation::g_topic_injections.clear();
+  rmw_implementation::g_has_default_injection = false;
+  rmw_implementation::invalidate_cached_injections();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_injection_enable(uint64_t seed)
+{
+  return rmw_implementation::enable_injection(seed);
+}
+
+rmw_ret_t
+rmw_implementation_injection_disable(void)
+{
+  rmw_implementation::disable_injection();
+  return RMW_RET_OK;
+}
+
+bool
+rmw_implementation_injection_is_enabled(void)
+{
+  return rmw_implementation::g_injection_enabled.load();
+}
+
+rmw_ret_t
+rmw_implementation_injection_get_stats(rmw_implementation_injection_stats_t * stats)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(stats, RMW_RET_INVALID_ARGUMENT);
+  stats->delayed_count = rmw_implementation::g_delayed_count.load(std::memory_order_relaxed);
+  stats->total_delay_ns = rmw_implementation::g_total_delay_ns.load(std::memory_order_relaxed);
+  stats->dropped_count = rmw_implementation::g_dropped_count.load(std::memory_order_relaxed);
+  stats->reordered_count = rmw_implementation::g_reordered_count.load(std::memory_order_relaxed);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_injection_reset_stats(void)
+{
+  rmw_implementation::g_delayed_count.store(0u, std::memory_order_relaxed);
+  rmw_implementation::g_total_delay_ns.store(0u, std::memory_order_relaxed);
+  rmw_implementation::g_dropped_count.store(0u, std::memory_order_relaxed);
+  rmw_implementation::g_reordered_count.store(0u, std::memory_order_relaxed);
+  return RMW_RET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,255 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/message_loan_pool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "./allocator.hpp"
+
+struct rmw_implementation_message_loan_pool_impl_s
+{
+  rmw_implementation_message_loan_pool_impl_s(
+    const rmw_publisher_t * publisher,
+    const rosidl_message_type_support_t * type_support,
+    size_t message_size,
+    const rcutils_allocator_t & allocator)
+  : publisher(publisher), type_support(type_support), message_size(message_size),
+    allocator(allocator), free_messages(FreeList::allocator_type(allocator))
+  {
+  }
+
+  using FreeList = std::vector<void *, rmw_implementation::RcutilsAllocator<void *>>;
+
+  const rmw_publisher_t * publisher;
+  const rosidl_message_type_support_t * type_support;
+  size_t message_size;
+  rcutils_allocator_t allocator;
+  std::mutex mutex;
+  // Free list, with room for all messages created so that publishing or
+  // returning them never allocates.
+  FreeList free_messages;
+  size_t message_count{0u};
+};
+
+namespace
+{
+
+using PoolImpl = rmw_implementation_message_loan_pool_impl_t;
+
+// Create a message and make room for it in the free list.
+// Must be called with the pool mutex held.
+rmw_ret_t
+create_message(PoolImpl * impl, void ** ros_message)
+{
+  try {
+    // grow geometrically, as messages are created one at a time
+    if (impl->free_messages.capacity() <= impl->message_count) {
+      impl->free_messages.reserve(
+        std::max(2u * impl->free_messages.capacity(), impl->message_count + 1u));
+    }
+  } catch (const std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate message loan pool");
+    return RMW_RET_BAD_ALLOC;
+  }
+  rcutils_allocator_t & allocator = impl->allocator;
+  void * message = allocator.allocate(impl->message_size, allocator.state);
+  if (nullptr == message) {
+    RMW_SET_ERROR_MSG("failed to allocate message");
+    return RMW_RET_BAD_ALLOC;
+  }
+  ++impl->message_count;
+  *ros_message = message;
+  return RMW_RET_OK;
+}
+
+// Put a message taken from the pool back into it.
+rmw_ret_t
+release_message(PoolImpl * impl, void * ros_message)
+{
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  if (impl->free_messages.size() >= impl->message_count) {
+    RMW_SET_ERROR_MSG("message was not taken from the pool");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  // never allocates, as room was made when creating the message
+  impl->free_messages.push_back(ros_message);
+  return RMW_RET_OK;
+}
+
+void
+destroy_pool_impl(PoolImpl * impl)
+{
+  rcutils_allocator_t allocator = impl->allocator;
+  for (void * message : impl->free_messages) {
+    allocator.deallocate(message, allocator.state);
+  }
+  impl->~PoolImpl();
+  allocator.deallocate(impl, allocator.state);
+}
+
+}  // namespace
+
+#define CHECK_POOL(pool) \
+  do { \
+    RMW_CHECK_ARGUMENT_FOR_NULL(pool, RMW_RET_INVALID_ARGUMENT); \
+    RMW_CHECK_FOR_NULL_WITH_MSG( \
+      pool->impl, "message loan pool is not initialized", return RMW_RET_INVALID_ARGUMENT); \
+  } while (0)
+
+extern "C"
+{
+rmw_implementation_message_loan_pool_t
+rmw_implementation_get_zero_initialized_message_loan_pool(void)
+{
+  rmw_implementation_message_loan_pool_t pool;
+  pool.loans_messages = false;
+  pool.impl = nullptr;
+  return pool;
+}
+
+rmw_ret_t
+rmw_implementation_message_loan_pool_init(
+  rmw_implementation_message_loan_pool_t * pool,
+  const rmw_publisher_t * publisher,
+  const rosidl_message_type_support_t * type_support,
+  size_t message_size,
+  size_t initial_count,
+  const rcutils_allocator_t * allocator)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(pool, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != pool->impl) {
+    RMW_SET_ERROR_MSG("message loan pool is already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  if (0u == message_size) {
+    RMW_SET_ERROR_MSG("message_size is zero");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  void * memory = allocator->allocate(sizeof(PoolImpl), allocator->state);
+  if (nullptr == memory) {
+    RMW_SET_ERROR_MSG("failed to allocate message loan pool");
+    return RMW_RET_BAD_ALLOC;
+  }
+  PoolImpl * impl = new (memory) PoolImpl(publisher, type_support, message_size, *allocator);
+  const bool loans_messages = publisher->can_loan_messages;
+  if (!loans_messages) {
+    for (size_t i = 0u; i < initial_count; ++i) {
+      void * message = nullptr;
+      rmw_ret_t ret = create_message(impl, &message);
+      if (RMW_RET_OK != ret) {
+        destroy_pool_impl(impl);
+        return ret;
+      }
+      impl->free_messages.push_back(message);
+    }
+  }
+  pool->loans_messages = loans_messages;
+  pool->impl = impl;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_message_loan_pool_fini(rmw_implementation_message_loan_pool_t * pool)
+{
+  CHECK_POOL(pool);
+  if (pool->impl->free_messages.size() != pool->impl->message_count) {
+    RMW_SET_ERROR_MSG("messages have not been published nor returned to the pool");
+    return RMW_RET_ERROR;
+  }
+  destroy_pool_impl(pool->impl);
+  *pool = rmw_implementation_get_zero_initialized_message_loan_pool();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_message_loan_pool_borrow(
+  rmw_implementation_message_loan_pool_t * pool,
+  void ** ros_message)
+{
+  CHECK_POOL(pool);
+  RMW_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != *ros_message) {
+    RMW_SET_ERROR_MSG("ros_message does not point to NULL");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  PoolImpl * impl = pool->impl;
+  if (pool->loans_messages) {
+    return rmw_borrow_loaned_message(impl->publisher, impl->type_support, ros_message);
+  }
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  if (impl->free_messages.empty()) {
+    return create_message(impl, ros_message);
+  }
+  *ros_message = impl->free_messages.back();
+  impl->free_messages.pop_back();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_message_loan_pool_publish(
+  rmw_implementation_message_loan_pool_t * pool,
+  void * ros_message,
+  rmw_publisher_allocation_t * allocation)
+{
+  CHECK_POOL(pool);
+  RMW_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+
+  PoolImpl * impl = pool->impl;
+  if (pool->loans_messages) {
+    return rmw_publish_loaned_message(impl->publisher, ros_message, allocation);
+  }
+  {
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    if (impl->free_messages.size() >= impl->message_count) {
+      RMW_SET_ERROR_MSG("message was not taken from the pool");
+      return RMW_RET_INVALID_ARGUMENT;
+    }
+  }
+  rmw_ret_t ret = rmw_publish(impl->publisher, ros_message, allocation);
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+  return release_message(impl, ros_message);
+}
+
+rmw_ret_t
+rmw_implementation_message_loan_pool_return(
+  rmw_implementation_message_loan_pool_t * pool,
+  void * ros_message)
+{
+  CHECK_POOL(pool);
+  RMW_CHECK_ARGUMENT_FOR_NULL(ros_message, RMW_RET_INVALID_ARGUMENT);
+
+  PoolImpl * impl = pool->impl;
+  if (pool->loans_messages) {
+    return rmw_return_loaned_message_from_publisher(impl->publisher, ros_message);
+  }
+  return release_message(impl, ros_message);
+}
+}  // extern "C"
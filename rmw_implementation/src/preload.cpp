@@ -0,0 +1,198 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "./preload.hpp"
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+#ifdef __linux__
+#include <link.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "rcutils/get_env.h"
+
+#include "rmw/error_handling.h"
+
+namespace rmw_implementation
+{
+
+bool
+get_preload_mode(PreloadMode & mode)
+{
+  const char * value = nullptr;
+  const char * error = rcutils_get_env(RMW_IMPLEMENTATION_PRELOAD_ENV_VAR, &value);
+  if (error) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "failed to fetch " RMW_IMPLEMENTATION_PRELOAD_ENV_VAR " from environment due to %s", error);
+    return false;
+  }
+  if (!value || '\0' == value[0] || 0 == strcmp(value, "none")) {
+    mode = PreloadMode::none;
+  } else if (0 == strcmp(value, "bind_now")) {
+    mode = PreloadMode::bind_now;
+  } else if (0 == strcmp(value, "prefault")) {
+    mode = PreloadMode::prefault;
+  } else if (0 == strcmp(value, "lock")) {
+    mode = PreloadMode::lock;
+  } else {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "unknown " RMW_IMPLEMENTATION_PRELOAD_ENV_VAR " value '%s', expected one of "
+      "'none', 'bind_now', 'prefault' or 'lock'", value);
+    return false;
+  }
+  return true;
+}
+
+#ifdef __linux__
+namespace
+{
+
+// Collect the base addresses of the objects loaded so far.
+int
+collect_loaded_objects(struct dl_phdr_info * info, size_t, void * data)
+{
+  std::vector<ElfW(Addr)> * loaded_objects = static_cast<std::vector<ElfW(Addr)> *>(data);
+  try {
+    loaded_objects->push_back(info->dlpi_addr);
+  } catch (const std::bad_alloc &) {
+    // not to throw through dl_iterate_phdr(), objects left out are preloaded anyway
+    return 1;
+  }
+  return 0;
+}
+
+struct TextSegmentsRequest
+{
+  ElfW(Addr) base_address;
+  // Objects loaded before the library, which are left as is.
+  const std::vector<ElfW(Addr)> * loaded_objects;
+  PreloadMode mode;
+  int error;
+};
+
+// Fault in or lock the text segments of the library, and of its dependencies
+// that were not loaded before it.
+int
+load_text_segments(struct dl_phdr_info * info, size_t, void * data)
+{
+  TextSegmentsRequest * request = static_cast<TextSegmentsRequest *>(data);
+  const std::vector<ElfW(Addr)> & loaded_objects = *request->loaded_objects;
+  if (info->dlpi_addr != request->base_address && std::find(
+      loaded_objects.begin(), loaded_objects.end(), info->dlpi_addr) != loaded_objects.end())
+  {
+    return 0;
+  }
+
+  const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+    const ElfW(Phdr) & header = info->dlpi_phdr[i];
+    if (PT_LOAD != header.p_type || !(header.p_flags & PF_X)) {
+      continue;
+    }
+    uintptr_t start = static_cast<uintptr_t>(info->dlpi_addr + header.p_vaddr);
+    uintptr_t end = start + static_cast<uintptr_t>(header.p_memsz);
+    start &= ~(page_size - 1);
+    end = (end + page_size - 1) & ~(page_size - 1);
+    void * address = reinterpret_cast<void *>(start);
+    size_t length = static_cast<size_t>(end - start);
+
+    if (PreloadMode::lock == request->mode) {
+      // also faults all pages in
+      if (0 != mlock(address, length)) {
+        request->error = errno;
+        return 1;
+      }
+      continue;
+    }
+    // only a hint, so failing is not an error
+    (void)madvise(address, length, MADV_WILLNEED);
+    for (uintptr_t page = start; page < end; page += page_size) {
+      (void)*reinterpret_cast<volatile const char *>(page);
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+#endif
+
+PreloadedLibrary::PreloadedLibrary(const std::string & library_name, PreloadMode mode)
+: handle_(nullptr)
+{
+  if (PreloadMode::none == mode) {
+    return;
+  }
+#ifdef _WIN32
+  // Windows binds all symbols when loading a library anyway.
+  if (PreloadMode::bind_now != mode) {
+    throw std::runtime_error("prefaulting or locking libraries is not supported on Windows");
+  }
+#else
+#ifdef __linux__
+  std::vector<ElfW(Addr)> loaded_objects;
+  if (PreloadMode::bind_now != mode) {
+    dl_iterate_phdr(collect_loaded_objects, &loaded_objects);
+  }
+#endif
+  handle_ = dlopen(library_name.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle_) {
+    throw std::runtime_error(std::string("failed to preload library: ") + dlerror());
+  }
+  if (PreloadMode::bind_now == mode) {
+    return;
+  }
+#ifdef __linux__
+  struct link_map * link_map = nullptr;
+  if (0 != dlinfo(handle_, RTLD_DI_LINKMAP, &link_map)) {
+    std::string error = dlerror();
+    dlclose(handle_);
+    throw std::runtime_error("failed to get address of preloaded library: " + error);
+  }
+  TextSegmentsRequest request{link_map->l_addr, &loaded_objects, mode, 0};
+  dl_iterate_phdr(load_text_segments, &request);
+  if (0 != request.error) {
+    dlclose(handle_);
+    throw std::runtime_error(
+      std::string("failed to lock preloaded library in memory: ") + std::strerror(request.error));
+  }
+#else
+  dlclose(handle_);
+  throw std::runtime_error("prefaulting or locking libraries is only supported on Linux");
+#endif
+#endif
+}
+
+PreloadedLibrary::~PreloadedLibrary()
+{
+#ifndef _WIN32
+  if (handle_) {
+    // pages are unlocked as these are unmapped
+    dlclose(handle_);
+  }
+#endif
+}
+
+}  // namespace rmw_implementation
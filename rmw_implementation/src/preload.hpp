@@ -0,0 +1,91 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PRELOAD_HPP_
+#define PRELOAD_HPP_
+
+#include <string>
+
+#include "rcpputils/shared_library.hpp"
+
+#include "rmw_implementation/visibility_control.h"
+
+/// Environment variable selecting how rmw implementations are preloaded.
+#define RMW_IMPLEMENTATION_PRELOAD_ENV_VAR "RMW_IMPLEMENTATION_PRELOAD"
+
+namespace rmw_implementation
+{
+
+/// How much of an rmw implementation to load ahead of its first use.
+enum class PreloadMode
+{
+  /// Load as usual, binding symbols lazily.
+  none,
+  /// Bind all symbols of the library and its dependencies when loading it.
+  bind_now,
+  /// Bind all symbols, and fault in the text segments of the library and of
+  /// the dependencies it loads.
+  prefault,
+  /// Bind all symbols, and lock the text segments of the library and of the
+  /// dependencies it loads in memory.
+  lock,
+};
+
+/// Get the preload mode selected via the environment.
+/**
+ * \param[out] mode preload mode, `none` unless selected.
+ * \return `true` if successful, or
+ * \return `false` if the environment variable has an unknown value.
+ */
+RMW_IMPLEMENTATION_DEFAULT_VISIBILITY
+bool get_preload_mode(PreloadMode & mode);
+
+/// Reference to a library, opened ahead of loading it as a shared library.
+/**
+ * Symbols of a library are bound when it is first opened, thus opening it
+ * with eager binding before loading it as usual has all its symbols bound.
+ * \throws std::runtime_error if the library cannot be opened, or if its text
+ *   segments cannot be locked in memory.
+ */
+class PreloadedLibrary
+{
+public:
+  PreloadedLibrary(const std::string & library_name, PreloadMode mode);
+
+  ~PreloadedLibrary();
+
+  PreloadedLibrary(const PreloadedLibrary &) = delete;
+  PreloadedLibrary & operator=(const PreloadedLibrary &) = delete;
+
+private:
+  void * handle_;
+};
+
+/// Shared library preloaded according to a preload mode.
+struct PreloadedSharedLibrary
+{
+  PreloadedSharedLibrary(const std::string & library_name, PreloadMode mode)
+  : preloaded(library_name, mode), library(library_name)
+  {
+  }
+
+  // Declared first, so that the library is unloaded before its reference is
+  // released.
+  PreloadedLibrary preloaded;
+  rcpputils::SharedLibrary library;
+};
+
+}  // namespace rmw_implementation
+
+#endif  // PRELOAD_HPP_
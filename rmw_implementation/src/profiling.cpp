@@ -0,0 +1,411 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/profiling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "rcutils/get_env.h"
+
+#include "rmw/error_handling.h"
+
+#include "./forwarding.hpp"
+#include "./functions.hpp"
+#include "./profiling.hpp"
+
+namespace rmw_implementation
+{
+namespace
+{
+
+#define FUNCTION_INDEX(name, ...) name ## _index,
+
+enum FunctionIndex
+{
+  RMW_IMPLEMENTATION_API_FNS(FUNCTION_INDEX)
+  function_count
+};
+
+#define FUNCTION_NAME(name, ...) #name,
+
+const char * const function_names[function_count] = {
+  RMW_IMPLEMENTATION_API_FNS(FUNCTION_NAME)
+};
+
+constexpr size_t histogram_size = RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE;
+
+struct FunctionCounters
+{
+  uint64_t call_count;
+  uint64_t total_duration_ns;
+  uint64_t duration_histogram[histogram_size];
+};
+
+struct Counters
+{
+  FunctionCounters functions[function_count];
+
+  void add(const Counters & other)
+  {
+    for (size_t i = 0; i < function_count; ++i) {
+      functions[i].call_count += other.functions[i].call_count;
+      functions[i].total_duration_ns += other.functions[i].total_duration_ns;
+      for (size_t j = 0; j < histogram_size; ++j) {
+        functions[i].duration_histogram[j] += other.functions[i].duration_histogram[j];
+      }
+    }
+  }
+
+  void subtract(const Counters & other)
+  {
+    for (size_t i = 0; i < function_count; ++i) {
+      functions[i].call_count -= other.functions[i].call_count;
+      functions[i].total_duration_ns -= other.functions[i].total_duration_ns;
+      for (size_t j = 0; j < histogram_size; ++j) {
+        functions[i].duration_histogram[j] -= other.functions[i].duration_histogram[j];
+      }
+    }
+  }
+};
+
+struct AtomicFunctionCounters
+{
+  std::atomic<uint64_t> call_count;
+  std::atomic<uint64_t> total_duration_ns;
+  std::atomic<uint64_t> duration_histogram[histogram_size];
+};
+
+// Counters of a single thread. Only that thread writes to them, hence
+// increments need not be atomic read-modify-writes, while snapshots may
+// still read them from any other thread.
+struct ThreadCounters
+{
+  AtomicFunctionCounters functions[function_count];
+
+  void load(Counters & counters) const
+  {
+    for (size_t i = 0; i < function_count; ++i) {
+      counters.functions[i].call_count =
+        functions[i].call_count.load(std::memory_order_relaxed);
+      counters.functions[i].total_duration_ns =
+        functions[i].total_duration_ns.load(std::memory_order_relaxed);
+      for (size_t j = 0; j < histogram_size; ++j) {
+        counters.functions[i].duration_histogram[j] =
+          functions[i].duration_histogram[j].load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+void
+increment(std::atomic<uint64_t> & counter, uint64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Counters of threads that made profiled calls. Those of exited threads are
+// retired, i.e. added up. The baseline holds counts as of the last reset.
+std::mutex g_counters_mutex;
+std::vector<const ThreadCounters *> g_thread_counters;
+Counters g_retired_counters;
+Counters g_baseline_counters;
+
+void
+sum_counters(Counters & sum)
+{
+  sum = g_retired_counters;
+  Counters counters;
+  for (const ThreadCounters * thread_counters : g_thread_counters) {
+    thread_counters->load(counters);
+    sum.add(counters);
+  }
+}
+
+class ThreadCountersRegistration
+{
+public:
+  ThreadCountersRegistration()
+  : counters_(new (std::nothrow) ThreadCounters())
+  {
+    if (!counters_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(g_counters_mutex);
+    try {
+      g_thread_counters.push_back(counters_);
+    } catch (const std::bad_alloc &) {
+      delete counters_;
+      counters_ = nullptr;
+    }
+  }
+
+  ~ThreadCountersRegistration()
+  {
+    if (!counters_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(g_counters_mutex);
+    g_thread_counters.erase(
+      std::remove(g_thread_counters.begin(), g_thread_counters.end(), counters_),
+      g_thread_counters.end());
+    Counters counters;
+    counters_->load(counters);
+    g_retired_counters.add(counters);
+    delete counters_;
+  }
+
+  ThreadCounters * counters_;
+};
+
+// Counters of this thread, cached outside of their registration as accessing
+// thread locals that need constructing is slower.
+thread_local ThreadCounters * t_counters = nullptr;
+
+ThreadCounters *
+get_thread_counters()
+{
+  if (!t_counters) {
+    // Registered on the first profiled call made by each thread. Calls made by
+    // threads for which counters could not be allocated are not counted.
+    static thread_local ThreadCountersRegistration registration;
+    t_counters = registration.counters_;
+  }
+  return t_counters;
+}
+
+class ProfiledCall
+{
+public:
+  explicit ProfiledCall(FunctionIndex function)
+  : function_(function), start_(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~ProfiledCall()
+  {
+    auto duration = std::chrono::steady_clock::now() - start_;
+    uint64_t duration_ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    ThreadCounters * thread_counters = get_thread_counters();
+    if (!thread_counters) {
+      return;
+    }
+    AtomicFunctionCounters & counters = thread_counters->functions[function_];
+    increment(counters.call_count, 1u);
+    increment(counters.total_duration_ns, duration_ns);
+    increment(counters.duration_histogram[histogram_bucket(duration_ns)], 1u);
+  }
+
+private:
+  FunctionIndex function_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Functions the profilers forward to, as swapped out of the dispatch table.
+DispatchTable g_profiled_table;
+
+#define DEFINE_PROFILER(name, ReturnType, error_value, _NR, ArgTypes) \
+  ReturnType profile_ ## name(EXPAND(ARGS_ ## _NR ArgTypes)) \
+  { \
+    ProfiledCall call(name ## _index); \
+    return g_profiled_table.name.load(std::memory_order_relaxed)( \
+      EXPAND(ARG_VALUES_ ## _NR ArgTypes)); \
+  }
+
+RMW_IMPLEMENTATION_API_FNS(DEFINE_PROFILER)
+
+std::mutex g_profiling_mutex;
+std::atomic<bool> g_profiling_enabled{false};
+
+#define INSTALL_PROFILER(name, ...) \
+  INTERPOSE_DISPATCH_TABLE_ENTRY(g_profiled_table, name, profile_ ## name)
+
+#define UNINSTALL_PROFILER(name, ...) \
+  RESTORE_DISPATCH_TABLE_ENTRY(g_profiled_table, name, profile_ ## name)
+
+rmw_ret_t
+enable_profiling()
+{
+  std::lock_guard<std::mutex> lock(g_profiling_mutex);
+  // only bound entries can be profiled
+  prefetch_symbols();
+  if (!all_symbols_resolved()) {
+    // error message set by prefetch_symbols()
+    return RMW_RET_ERROR;
+  }
+  RMW_IMPLEMENTATION_API_FNS(INSTALL_PROFILER)
+  g_profiling_enabled.store(true);
+  return RMW_RET_OK;
+}
+
+void
+disable_profiling()
+{
+  std::lock_guard<std::mutex> lock(g_profiling_mutex);
+  RMW_IMPLEMENTATION_API_FNS(UNINSTALL_PROFILER)
+  g_profiling_enabled.store(false);
+}
+
+}  // namespace
+
+size_t
+histogram_bucket(uint64_t duration_ns)
+{
+  size_t bucket = 0;
+  while (duration_ns > 1 && bucket < histogram_size - 1) {
+    duration_ns >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+void
+enable_profiling_from_env()
+{
+  const char * value = nullptr;
+  if (rcutils_get_env(RMW_IMPLEMENTATION_PROFILING_ENV_VAR, &value) || !value) {
+    return;
+  }
+  if (strcmp(value, "1") == 0) {
+    // calls are still forwarded if profiling cannot be enabled
+    enable_profiling();
+  }
+}
+
+}  // namespace rmw_implementation
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+rmw_ret_t
+rmw_implementation_profiling_enable(void)
+{
+  return rmw_implementation::enable_profiling();
+}
+
+rmw_ret_t
+rmw_implementation_profiling_disable(void)
+{
+  rmw_implementation::disable_profiling();
+  return RMW_RET_OK;
+}
+
+bool
+rmw_implementation_profiling_is_enabled(void)
+{
+  return rmw_implementation::g_profiling_enabled.load();
+}
+
+size_t
+rmw_implementation_profile_count(void)
+{
+  return rmw_implementation::function_count;
+}
+
+rmw_ret_t
+rmw_implementation_profile_snapshot(rmw_implementation_function_profile_t * profiles, size_t count)
+{
+  using rmw_implementation::Counters;
+  using rmw_implementation::function_count;
+
+  RMW_CHECK_ARGUMENT_FOR_NULL(profiles, RMW_RET_INVALID_ARGUMENT);
+  if (count < function_count) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "profiles array too small, %zu profiles needed", static_cast<size_t>(function_count));
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  Counters sum;
+  std::lock_guard<std::mutex> lock(rmw_implementation::g_counters_mutex);
+  rmw_implementation::sum_counters(sum);
+  sum.subtract(rmw_implementation::g_baseline_counters);
+  for (size_t i = 0; i < function_count; ++i) {
+    profiles[i].function_name = rmw_implementation::function_names[i];
+    profiles[i].call_count = sum.functions[i].call_count;
+    profiles[i].total_duration_ns = sum.functions[i].total_duration_ns;
+    memcpy(
+      profiles[i].duration_histogram, sum.functions[i].duration_histogram,
+      sizeof(profiles[i].duration_histogram));
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_profile_reset(void)
+{
+  std::lock_guard<std::mutex> lock(rmw_implementation::g_counters_mutex);
+  rmw_implementation::sum_counters(rmw_implementation::g_baseline_counters);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_profile_export(FILE * stream)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(stream, RMW_RET_INVALID_ARGUMENT);
+
+  std::vector<rmw_implementation_function_profile_t> profiles;
+  try {
+    profiles.resize(rmw_implementation_profile_count());
+  } catch (const std::exception & e) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to allocate profiles due to %s", e.what());
+    return RMW_RET_ERROR;
+  }
+  rmw_ret_t ret = rmw_implementation_profile_snapshot(profiles.data(), profiles.size());
+  if (RMW_RET_OK != ret) {
+    return ret;
+  }
+
+  bool ok = fprintf(stream, "function,call_count,total_duration_ns") >= 0;
+  for (size_t j = 0; ok && j < RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE; ++j) {
+    ok = fprintf(stream, ",histogram_%zu", j) >= 0;
+  }
+  ok = ok && fprintf(stream, "\n") >= 0;
+  for (const rmw_implementation_function_profile_t & profile : profiles) {
+    if (!ok) {
+      break;
+    }
+    if (0u == profile.call_count) {
+      continue;
+    }
+    ok = fprintf(
+      stream, "%s,%" PRIu64 ",%" PRIu64, profile.function_name,
+      profile.call_count, profile.total_duration_ns) >= 0;
+    for (size_t j = 0; ok && j < RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE; ++j) {
+      ok = fprintf(stream, ",%" PRIu64, profile.duration_histogram[j]) >= 0;
+    }
+    ok = ok && fprintf(stream, "\n") >= 0;
+  }
+  if (!ok) {
+    RMW_SET_ERROR_MSG("failed to write profiles");
+    return RMW_RET_ERROR;
+  }
+  return RMW_RET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,32 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PROFILING_HPP_
+#define PROFILING_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rmw_implementation
+{
+
+/// Get the histogram bucket of a duration, see rmw_implementation_function_profile_t.
+size_t histogram_bucket(uint64_t duration_ns);
+
+/// Enable profiling if requested via the environment.
+void enable_profiling_from_env();
+
+}  // namespace rmw_implementation
+
+#endif  // PROFILING_HPP_
@@ -0,0 +1,226 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/serialized_message_pool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "./allocator.hpp"
+
+struct rmw_implementation_serialized_message_pool_impl_s
+{
+  explicit rmw_implementation_serialized_message_pool_impl_s(const rcutils_allocator_t & allocator)
+  : allocator(allocator), free_messages(FreeList::allocator_type(allocator))
+  {
+  }
+
+  using FreeList = std::vector<
+    rmw_serialized_message_t *, rmw_implementation::RcutilsAllocator<rmw_serialized_message_t *>>;
+
+  rcutils_allocator_t allocator;
+  std::mutex mutex;
+  // Free list, with room for all serialized messages created so that
+  // releasing them never allocates.
+  FreeList free_messages;
+  size_t message_count{0u};
+};
+
+namespace
+{
+
+using PoolImpl = rmw_implementation_serialized_message_pool_impl_t;
+
+void
+destroy_serialized_message(rmw_serialized_message_t * serialized_message)
+{
+  rcutils_allocator_t allocator = serialized_message->allocator;
+  if (RMW_RET_OK != rmw_serialized_message_fini(serialized_message)) {
+    // buffer is leaked, nothing else to do
+    rmw_reset_error();
+  }
+  allocator.deallocate(serialized_message, allocator.state);
+}
+
+// Create a serialized message and make room for it in the free list.
+// Must be called with the pool mutex held.
+rmw_ret_t
+create_serialized_message(
+  PoolImpl * impl, size_t capacity, rmw_serialized_message_t ** serialized_message)
+{
+  try {
+    // grow geometrically, as messages are created one at a time
+    if (impl->free_messages.capacity() <= impl->message_count) {
+      impl->free_messages.reserve(
+        std::max(2u * impl->free_messages.capacity(), impl->message_count + 1u));
+    }
+  } catch (const std::bad_alloc &) {
+    RMW_SET_ERROR_MSG("failed to allocate serialized message pool");
+    return RMW_RET_BAD_ALLOC;
+  }
+  rcutils_allocator_t & allocator = impl->allocator;
+  auto message = static_cast<rmw_serialized_message_t *>(
+    allocator.allocate(sizeof(rmw_serialized_message_t), allocator.state));
+  if (nullptr == message) {
+    RMW_SET_ERROR_MSG("failed to allocate serialized message");
+    return RMW_RET_BAD_ALLOC;
+  }
+  *message = rmw_get_zero_initialized_serialized_message();
+  if (RMW_RET_OK != rmw_serialized_message_init(message, capacity, &allocator)) {
+    allocator.deallocate(message, allocator.state);
+    rmw_reset_error();
+    RMW_SET_ERROR_MSG("failed to allocate serialized message buffer");
+    return RMW_RET_BAD_ALLOC;
+  }
+  ++impl->message_count;
+  *serialized_message = message;
+  return RMW_RET_OK;
+}
+
+void
+destroy_pool_impl(PoolImpl * impl)
+{
+  for (rmw_serialized_message_t * serialized_message : impl->free_messages) {
+    destroy_serialized_message(serialized_message);
+  }
+  rcutils_allocator_t allocator = impl->allocator;
+  impl->~PoolImpl();
+  allocator.deallocate(impl, allocator.state);
+}
+
+}  // namespace
+
+extern "C"
+{
+rmw_implementation_serialized_message_pool_t
+rmw_implementation_get_zero_initialized_serialized_message_pool(void)
+{
+  rmw_implementation_serialized_message_pool_t pool;
+  pool.buffer_capacity = 0u;
+  pool.impl = nullptr;
+  return pool;
+}
+
+rmw_ret_t
+rmw_implementation_serialized_message_pool_init(
+  rmw_implementation_serialized_message_pool_t * pool,
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  size_t initial_capacity,
+  size_t initial_count,
+  const rcutils_allocator_t * allocator)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(pool, RMW_RET_INVALID_ARGUMENT);
+  if (nullptr != pool->impl) {
+    RMW_SET_ERROR_MSG("serialized message pool is already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_support, RMW_RET_INVALID_ARGUMENT);
+  if (!rcutils_allocator_is_valid(allocator)) {
+    RMW_SET_ERROR_MSG("allocator is invalid");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  size_t buffer_capacity = 0u;
+  if (RMW_RET_OK != rmw_get_serialized_message_size(
+      type_support, message_bounds, &buffer_capacity))
+  {
+    // e.g. unsupported, or unbounded type
+    rmw_reset_error();
+    buffer_capacity = initial_capacity;
+  }
+
+  void * memory = allocator->allocate(sizeof(PoolImpl), allocator->state);
+  if (nullptr == memory) {
+    RMW_SET_ERROR_MSG("failed to allocate serialized message pool");
+    return RMW_RET_BAD_ALLOC;
+  }
+  PoolImpl * impl = new (memory) PoolImpl(*allocator);
+  for (size_t i = 0u; i < initial_count; ++i) {
+    rmw_serialized_message_t * serialized_message = nullptr;
+    rmw_ret_t ret = create_serialized_message(impl, buffer_capacity, &serialized_message);
+    if (RMW_RET_OK != ret) {
+      destroy_pool_impl(impl);
+      return ret;
+    }
+    impl->free_messages.push_back(serialized_message);
+  }
+  pool->buffer_capacity = buffer_capacity;
+  pool->impl = impl;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_serialized_message_pool_fini(
+  rmw_implementation_serialized_message_pool_t * pool)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(pool, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    pool->impl, "serialized message pool is not initialized", return RMW_RET_INVALID_ARGUMENT);
+  if (pool->impl->free_messages.size() != pool->impl->message_count) {
+    RMW_SET_ERROR_MSG("serialized messages have not been released to the pool");
+    return RMW_RET_ERROR;
+  }
+  destroy_pool_impl(pool->impl);
+  *pool = rmw_implementation_get_zero_initialized_serialized_message_pool();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_serialized_message_pool_acquire(
+  rmw_implementation_serialized_message_pool_t * pool,
+  rmw_serialized_message_t ** serialized_message)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(pool, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    pool->impl, "serialized message pool is not initialized", return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(serialized_message, RMW_RET_INVALID_ARGUMENT);
+
+  PoolImpl * impl = pool->impl;
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  if (impl->free_messages.empty()) {
+    return create_serialized_message(impl, pool->buffer_capacity, serialized_message);
+  }
+  *serialized_message = impl->free_messages.back();
+  impl->free_messages.pop_back();
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_serialized_message_pool_release(
+  rmw_implementation_serialized_message_pool_t * pool,
+  rmw_serialized_message_t * serialized_message)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(pool, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    pool->impl, "serialized message pool is not initialized", return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(serialized_message, RMW_RET_INVALID_ARGUMENT);
+
+  PoolImpl * impl = pool->impl;
+  std::lock_guard<std::mutex> lock(impl->mutex);
+  if (impl->free_messages.size() >= impl->message_count) {
+    RMW_SET_ERROR_MSG("serialized message was not taken from the pool");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+  serialized_message->buffer_length = 0u;
+  // never allocates, as room was made when creating the serialized message
+  impl->free_messages.push_back(serialized_message);
+  return RMW_RET_OK;
+}
+}  // extern "C"
@@ -0,0 +1,137 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TRACEPOINTS_HPP_
+#define TRACEPOINTS_HPP_
+
+// Static tracepoints on entry and exit of forwarded functions, compiled out
+// unless the RMW_IMPLEMENTATION_ENABLE_TRACEPOINTS CMake option is set.
+// These are USDT probes of the rmw_implementation provider, named after the
+// function with an _entry or _exit suffix e.g. rmw_publish_entry, which can
+// be traced with LTTng (as userspace probes), perf, SystemTap or bpftrace.
+// Entry probes carry the handle, i.e. the first argument but for rmw_wait
+// which is traced by its wait set, and the second argument if a pointer,
+// notably the message for rmw_publish and rmw_take. Exit probes carry the
+// handle and the return value.
+
+#ifdef RMW_IMPLEMENTATION_ENABLE_TRACEPOINTS
+
+#include <sys/sdt.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+
+#include "rmw/types.h"
+
+#include "./forwarding.hpp"
+
+namespace rmw_implementation
+{
+
+template<typename T>
+inline const void *
+tracepoint_pointer(T * value)
+{
+  return value;
+}
+
+// Non-pointer arguments are not traced.
+template<typename T>
+inline const void *
+tracepoint_pointer(const T &)
+{
+  return nullptr;
+}
+
+constexpr bool
+tracepoint_name_equal(const char * lhs, const char * rhs)
+{
+  return *lhs == *rhs && ('\0' == *lhs || tracepoint_name_equal(lhs + 1, rhs + 1));
+}
+
+// Position of the handle amongst the arguments of a forwarded function,
+// which rmw_wait takes after the arrays of entities to wait on.
+constexpr size_t
+tracepoint_handle_position(const char * name)
+{
+  return tracepoint_name_equal(name, "rmw_wait") ? 5u : 0u;
+}
+
+template<size_t Position>
+inline const void *
+tracepoint_handle()
+{
+  return nullptr;
+}
+
+template<size_t Position, typename ... Args>
+inline const void *
+tracepoint_handle(const Args & ... args)
+{
+  return tracepoint_pointer(std::get<Position>(std::tie(args ...)));
+}
+
+inline int64_t
+tracepoint_return_value(rmw_ret_t value)
+{
+  return value;
+}
+
+template<typename T>
+inline int64_t
+tracepoint_return_value(T * value)
+{
+  return static_cast<int64_t>(reinterpret_cast<intptr_t>(value));
+}
+
+}  // namespace rmw_implementation
+
+// Handle of a forwarded function taking _NR arguments, as named by the
+// ARGS_N macros.
+#define TRACEPOINT_HANDLE(name, _NR, ArgTypes) \
+  rmw_implementation::tracepoint_handle< \
+    rmw_implementation::tracepoint_handle_position(#name)>( \
+    EXPAND(ARG_VALUES_ ## _NR ArgTypes))
+
+// Second argument value of a forwarded function taking _NR arguments.
+#define TRACEPOINT_ARG_2_0 nullptr
+#define TRACEPOINT_ARG_2_1 nullptr
+#define TRACEPOINT_ARG_2_2 v1
+#define TRACEPOINT_ARG_2_3 v2
+#define TRACEPOINT_ARG_2_4 v3
+#define TRACEPOINT_ARG_2_5 v4
+#define TRACEPOINT_ARG_2_6 v5
+#define TRACEPOINT_ARG_2_7 v6
+
+#define RMW_IMPLEMENTATION_TRACEPOINT_ENTRY(name, handle, arg) \
+  STAP_PROBE2( \
+    rmw_implementation, name ## _entry, \
+    rmw_implementation::tracepoint_pointer(handle), \
+    rmw_implementation::tracepoint_pointer(arg))
+
+#define RMW_IMPLEMENTATION_TRACEPOINT_EXIT(name, handle, ret) \
+  STAP_PROBE2( \
+    rmw_implementation, name ## _exit, \
+    rmw_implementation::tracepoint_pointer(handle), \
+    rmw_implementation::tracepoint_return_value(ret))
+
+#else
+
+#define RMW_IMPLEMENTATION_TRACEPOINT_ENTRY(name, handle, arg) ((void)0)
+#define RMW_IMPLEMENTATION_TRACEPOINT_EXIT(name, handle, ret) ((void)0)
+
+#endif
+
+#endif  // TRACEPOINTS_HPP_
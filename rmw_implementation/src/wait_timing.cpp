@@ -0,0 +1,254 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_implementation/wait_timing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+#include "rmw/error_handling.h"
+
+#include "./forwarding.hpp"
+#include "./functions.hpp"
+#include "./profiling.hpp"
+
+namespace rmw_implementation
+{
+namespace
+{
+
+constexpr size_t histogram_size = RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE;
+
+struct AtomicDurations
+{
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> total_duration_ns;
+  std::atomic<uint64_t> histogram[histogram_size];
+
+  void add(uint64_t duration_ns)
+  {
+    count.fetch_add(1u, std::memory_order_relaxed);
+    total_duration_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+    histogram[histogram_bucket(duration_ns)].fetch_add(1u, std::memory_order_relaxed);
+  }
+
+  void load(uint64_t & count_out, uint64_t & total_duration_ns_out, uint64_t * histogram_out) const
+  {
+    count_out = count.load(std::memory_order_relaxed);
+    total_duration_ns_out = total_duration_ns.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < histogram_size; ++i) {
+      histogram_out[i] = histogram[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  void reset()
+  {
+    count.store(0u, std::memory_order_relaxed);
+    total_duration_ns.store(0u, std::memory_order_relaxed);
+    for (std::atomic<uint64_t> & bucket : histogram) {
+      bucket.store(0u, std::memory_order_relaxed);
+    }
+  }
+};
+
+AtomicDurations g_wait_durations;
+AtomicDurations g_wakeup_latencies;
+
+int64_t
+now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Last time guard conditions were triggered at, by the guard condition data
+// that wait sets hold.
+// Slots are picked by address and shared on collisions, so that recording
+// triggers never allocates nor locks; triggers overwritten by others are
+// then missed, as may be those recorded while being looked up.
+struct TriggerSlot
+{
+  std::atomic<const void *> guard_condition_data;
+  std::atomic<int64_t> time_ns;
+};
+
+constexpr size_t trigger_slot_count = 256u;
+TriggerSlot g_trigger_slots[trigger_slot_count];
+
+TriggerSlot &
+get_trigger_slot(const void * guard_condition_data)
+{
+  // low bits are mostly alignment
+  const uintptr_t address = reinterpret_cast<uintptr_t>(guard_condition_data);
+  return g_trigger_slots[(address >> 4) % trigger_slot_count];
+}
+
+// Get the time a guard condition was last triggered at, or the lowest time
+// if unknown.
+int64_t
+get_trigger_time_ns(const void * guard_condition_data)
+{
+  const TriggerSlot & slot = get_trigger_slot(guard_condition_data);
+  if (slot.guard_condition_data.load(std::memory_order_acquire) != guard_condition_data) {
+    return std::numeric_limits<int64_t>::min();
+  }
+  return slot.time_ns.load(std::memory_order_relaxed);
+}
+
+std::mutex g_wait_timing_mutex;
+std::atomic<bool> g_wait_timing_enabled{false};
+
+// Functions the timers forward to, as swapped out of the dispatch table.
+DispatchTable g_timed_table;
+
+rmw_ret_t
+time_rmw_trigger_guard_condition(const rmw_guard_condition_t * guard_condition)
+{
+  if (guard_condition && g_wait_timing_enabled.load(std::memory_order_relaxed)) {
+    TriggerSlot & slot = get_trigger_slot(guard_condition->data);
+    slot.time_ns.store(now_ns(), std::memory_order_relaxed);
+    slot.guard_condition_data.store(guard_condition->data, std::memory_order_release);
+  }
+  return g_timed_table.rmw_trigger_guard_condition.load(std::memory_order_relaxed)(
+    guard_condition);
+}
+
+rmw_ret_t
+time_rmw_wait(
+  rmw_subscriptions_t * subscriptions,
+  rmw_guard_conditions_t * guard_conditions,
+  rmw_services_t * services,
+  rmw_clients_t * clients,
+  rmw_events_t * events,
+  rmw_wait_set_t * wait_set,
+  const rmw_time_t * wait_timeout)
+{
+  auto rmw_wait = g_timed_table.rmw_wait.load(std::memory_order_relaxed);
+  if (!g_wait_timing_enabled.load(std::memory_order_relaxed)) {
+    return rmw_wait(
+      subscriptions, guard_conditions, services, clients, events, wait_set, wait_timeout);
+  }
+  const int64_t start_ns = now_ns();
+  rmw_ret_t ret = rmw_wait(
+    subscriptions, guard_conditions, services, clients, events, wait_set, wait_timeout);
+  const int64_t end_ns = now_ns();
+  g_wait_durations.add(static_cast<uint64_t>(end_ns - start_ns));
+
+  if (RMW_RET_OK != ret || !guard_conditions) {
+    return ret;
+  }
+  // guard conditions left in the wait set are those that were triggered
+  int64_t first_trigger_ns = std::numeric_limits<int64_t>::max();
+  for (size_t i = 0u; i < guard_conditions->guard_condition_count; ++i) {
+    const void * guard_condition_data = guard_conditions->guard_conditions[i];
+    if (!guard_condition_data) {
+      continue;
+    }
+    const int64_t trigger_ns = get_trigger_time_ns(guard_condition_data);
+    if (trigger_ns >= start_ns && trigger_ns < first_trigger_ns) {
+      first_trigger_ns = trigger_ns;
+    }
+  }
+  if (first_trigger_ns <= end_ns) {
+    g_wakeup_latencies.add(static_cast<uint64_t>(end_ns - first_trigger_ns));
+  }
+  return ret;
+}
+
+#define TIMED_FNS(X) \
+  X(rmw_trigger_guard_condition) \
+  X(rmw_wait)
+
+#define INSTALL_TIMER(name) \
+  INTERPOSE_DISPATCH_TABLE_ENTRY(g_timed_table, name, time_ ## name)
+
+#define UNINSTALL_TIMER(name) \
+  RESTORE_DISPATCH_TABLE_ENTRY(g_timed_table, name, time_ ## name)
+
+rmw_ret_t
+enable_wait_timing()
+{
+  std::lock_guard<std::mutex> lock(g_wait_timing_mutex);
+  // only bound entries can be timed
+  prefetch_symbols();
+  if (!all_symbols_resolved()) {
+    // error message set by prefetch_symbols()
+    return RMW_RET_ERROR;
+  }
+  TIMED_FNS(INSTALL_TIMER)
+  g_wait_timing_enabled.store(true);
+  return RMW_RET_OK;
+}
+
+void
+disable_wait_timing()
+{
+  std::lock_guard<std::mutex> lock(g_wait_timing_mutex);
+  TIMED_FNS(UNINSTALL_TIMER)
+  g_wait_timing_enabled.store(false);
+}
+
+}  // namespace
+}  // namespace rmw_implementation
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+rmw_ret_t
+rmw_implementation_wait_timing_enable(void)
+{
+  return rmw_implementation::enable_wait_timing();
+}
+
+rmw_ret_t
+rmw_implementation_wait_timing_disable(void)
+{
+  rmw_implementation::disable_wait_timing();
+  return RMW_RET_OK;
+}
+
+bool
+rmw_implementation_wait_timing_is_enabled(void)
+{
+  return rmw_implementation::g_wait_timing_enabled.load();
+}
+
+rmw_ret_t
+rmw_implementation_wait_timing_snapshot(rmw_implementation_wait_timing_t * timing)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(timing, RMW_RET_INVALID_ARGUMENT);
+  rmw_implementation::g_wait_durations.load(
+    timing->wait_count, timing->total_wait_duration_ns, timing->wait_duration_histogram);
+  rmw_implementation::g_wakeup_latencies.load(
+    timing->wakeup_count, timing->total_wakeup_latency_ns, timing->wakeup_latency_histogram);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_implementation_wait_timing_reset(void)
+{
+  rmw_implementation::g_wait_durations.reset();
+  rmw_implementation::g_wakeup_latencies.reset();
+  return RMW_RET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
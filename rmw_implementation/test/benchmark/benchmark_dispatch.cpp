@@ -0,0 +1,173 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/gid.h"
+#include "rmw_implementation/profiling.h"
+
+#include "../../src/functions.hpp"
+
+using performance_test_fixture::PerformanceTest;
+
+BENCHMARK_F(PerformanceTest, forwarded_call)(benchmark::State & st)
+{
+  prefetch_symbols();
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    const char * identifier = rmw_get_implementation_identifier();
+    benchmark::DoNotOptimize(identifier);
+  }
+
+  unload_library();
+}
+
+BENCHMARK_F(PerformanceTest, profiled_forwarded_call)(benchmark::State & st)
+{
+  if (RMW_RET_OK != rmw_implementation_profiling_enable()) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    return;
+  }
+  // registers counters of this thread
+  rmw_get_implementation_identifier();
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    const char * identifier = rmw_get_implementation_identifier();
+    benchmark::DoNotOptimize(identifier);
+  }
+
+  rmw_implementation_profiling_disable();
+  unload_library();
+}
+
+BENCHMARK_F(PerformanceTest, direct_call)(benchmark::State & st)
+{
+  std::shared_ptr<rcpputils::SharedLibrary> lib = load_library();
+  void * symbol = lookup_symbol(lib, "rmw_get_implementation_identifier");
+  if (!symbol) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    return;
+  }
+  typedef const char * (* FunctionSignature)(void);
+  FunctionSignature func = reinterpret_cast<FunctionSignature>(symbol);
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    const char * identifier = func();
+    benchmark::DoNotOptimize(identifier);
+  }
+}
+
+// Not a fixture, as allocation tracking is not meant to be shared by threads.
+// Calls are made without prefetching symbols first, so that threads race to
+// resolve them before hitting the already resolved path.
+static void concurrent_forwarded_call(benchmark::State & st)
+{
+  for (auto _ : st) {
+    const char * format = rmw_get_serialization_format();
+    benchmark::DoNotOptimize(format);
+  }
+}
+BENCHMARK(concurrent_forwarded_call)->ThreadRange(1, 16)->UseRealTime();
+
+namespace
+{
+
+// GIDs of N entities of the rmw implementation.
+std::vector<rmw_gid_t>
+make_gids(size_t count)
+{
+  std::vector<rmw_gid_t> gids(count);
+  for (size_t i = 0u; i < count; ++i) {
+    gids[i].implementation_identifier = rmw_get_implementation_identifier();
+    memcpy(gids[i].data, &i, sizeof(i));
+  }
+  return gids;
+}
+
+}  // namespace
+
+// Look up the last of N GIDs, as message filters do with the publisher GID of
+// each message taken, comparing GIDs one by one through the rmw implementation.
+BENCHMARK_DEFINE_F(PerformanceTest, forwarded_gid_lookup)(benchmark::State & st)
+{
+  const std::vector<rmw_gid_t> gids = make_gids(static_cast<size_t>(st.range(0)));
+  const rmw_gid_t gid = gids.back();
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    bool found = false;
+    for (const rmw_gid_t & known_gid : gids) {
+      if (RMW_RET_OK != rmw_compare_gids_equal(&known_gid, &gid, &found)) {
+        st.SkipWithError(rmw_get_error_string().str);
+        rmw_reset_error();
+        break;
+      }
+      if (found) {
+        break;
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+
+  unload_library();
+}
+BENCHMARK_REGISTER_F(PerformanceTest, forwarded_gid_lookup)->RangeMultiplier(8)->Range(1, 512);
+
+// Look up the last of N GIDs in a GID set.
+BENCHMARK_DEFINE_F(PerformanceTest, gid_set_lookup)(benchmark::State & st)
+{
+  const std::vector<rmw_gid_t> gids = make_gids(static_cast<size_t>(st.range(0)));
+  const rmw_gid_t gid = gids.back();
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_gid_set_t set = rmw_implementation_get_zero_initialized_gid_set();
+  rmw_ret_t ret = rmw_implementation_gid_set_init(&set, &allocator);
+  for (size_t i = 0u; i < gids.size() && RMW_RET_OK == ret; ++i) {
+    ret = rmw_implementation_gid_set_insert(&set, &gids[i], nullptr);
+  }
+  if (RMW_RET_OK != ret) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    rmw_implementation_gid_set_fini(&set);
+    return;
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    bool found = false;
+    if (RMW_RET_OK != rmw_implementation_gid_set_contains(&set, &gid, &found)) {
+      st.SkipWithError(rmw_get_error_string().str);
+      rmw_reset_error();
+      break;
+    }
+    benchmark::DoNotOptimize(found);
+  }
+
+  rmw_implementation_gid_set_fini(&set);
+  unload_library();
+}
+BENCHMARK_REGISTER_F(PerformanceTest, gid_set_lookup)->RangeMultiplier(8)->Range(1, 512);
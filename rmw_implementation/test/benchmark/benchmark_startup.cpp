@@ -0,0 +1,171 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "../../src/functions.hpp"
+
+using performance_test_fixture::PerformanceTest;
+
+namespace
+{
+
+bool init_options_init(benchmark::State & st, rmw_init_options_t * init_options)
+{
+  *init_options = rmw_get_zero_initialized_init_options();
+  rmw_ret_t ret = rmw_init_options_init(init_options, rcutils_get_default_allocator());
+  if (RMW_RET_OK != ret) {
+    st.SkipWithError(rmw_get_error_string().str);
+    return false;
+  }
+  init_options->enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+  if (nullptr == init_options->enclave) {
+    st.SkipWithError("failed to allocate enclave");
+    rmw_init_options_fini(init_options);
+    return false;
+  }
+  return true;
+}
+
+// Initialize a context, finalizing the init options if it cannot be.
+bool context_init(
+  benchmark::State & st, rmw_init_options_t * init_options, rmw_context_t * context)
+{
+  rmw_ret_t ret = rmw_init(init_options, context);
+  if (RMW_RET_OK != ret) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    rmw_init_options_fini(init_options);
+    return false;
+  }
+  return true;
+}
+
+bool init(benchmark::State & st, rmw_init_options_t * init_options, rmw_context_t * context)
+{
+  if (!init_options_init(st, init_options)) {
+    return false;
+  }
+  *context = rmw_get_zero_initialized_context();
+  return context_init(st, init_options, context);
+}
+
+bool shutdown(rmw_init_options_t * init_options, rmw_context_t * context)
+{
+  return RMW_RET_OK == rmw_shutdown(context) &&
+         RMW_RET_OK == rmw_context_fini(context) &&
+         RMW_RET_OK == rmw_init_options_fini(init_options);
+}
+
+}  // namespace
+
+BENCHMARK_F(PerformanceTest, rmw_init)(benchmark::State & st)
+{
+  rmw_init_options_t init_options;
+  rmw_context_t context;
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    st.PauseTiming();
+    if (!init_options_init(st, &init_options)) {
+      break;
+    }
+    context = rmw_get_zero_initialized_context();
+    st.ResumeTiming();
+
+    if (!context_init(st, &init_options, &context)) {
+      break;
+    }
+
+    st.PauseTiming();
+    if (!shutdown(&init_options, &context)) {
+      st.SkipWithError(rmw_get_error_string().str);
+      break;
+    }
+    st.ResumeTiming();
+  }
+  rmw_reset_error();
+}
+
+BENCHMARK_F(PerformanceTest, first_rmw_create_node)(benchmark::State & st)
+{
+  rmw_init_options_t init_options;
+  rmw_context_t context;
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    st.PauseTiming();
+    if (!init(st, &init_options, &context)) {
+      break;
+    }
+    st.ResumeTiming();
+
+    rmw_node_t * node = rmw_create_node(&context, "my_node", "/my_ns");
+    if (!node) {
+      st.SkipWithError(rmw_get_error_string().str);
+      break;
+    }
+
+    st.PauseTiming();
+    if (RMW_RET_OK != rmw_destroy_node(node) || !shutdown(&init_options, &context)) {
+      st.SkipWithError(rmw_get_error_string().str);
+      break;
+    }
+    st.ResumeTiming();
+  }
+  rmw_reset_error();
+}
+
+BENCHMARK_F(PerformanceTest, init_shutdown_cycle)(benchmark::State & st)
+{
+  rmw_init_options_t init_options;
+  rmw_context_t context;
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    if (!init(st, &init_options, &context)) {
+      break;
+    }
+    if (!shutdown(&init_options, &context)) {
+      st.SkipWithError(rmw_get_error_string().str);
+      break;
+    }
+  }
+  rmw_reset_error();
+}
+
+BENCHMARK_F(PerformanceTest, load_init_shutdown_unload_cycle)(benchmark::State & st)
+{
+  rmw_init_options_t init_options;
+  rmw_context_t context;
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    if (!init(st, &init_options, &context)) {
+      break;
+    }
+    if (!shutdown(&init_options, &context)) {
+      st.SkipWithError(rmw_get_error_string().str);
+      break;
+    }
+    unload_library();
+  }
+  rmw_reset_error();
+}
@@ -16,6 +16,10 @@
 
 #include "performance_test_fixture/performance_test_fixture.hpp"
 
+#include "rmw/error_handling.h"
+
+#include "rmw_implementation/rmw_interface.h"
+
 #include "../../src/functions.hpp"
 
 using performance_test_fixture::PerformanceTest;
@@ -35,3 +39,77 @@ BENCHMARK_F(PerformanceTest, lookup_symbol)(benchmark::State & st)
     lookup_symbol(lib, "rmw_init");
   }
 }
+
+BENCHMARK_F(PerformanceTest, lookup_symbol_after_load)(benchmark::State & st)
+{
+  std::shared_ptr<rcpputils::SharedLibrary> lib = load_library();
+  if (!lib) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    return;
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    void * symbol = lookup_symbol(lib, "rmw_publish");
+    benchmark::DoNotOptimize(symbol);
+  }
+}
+
+BENCHMARK_F(PerformanceTest, load_library_cold)(benchmark::State & st)
+{
+  // Only cold if nothing else keeps the rmw implementation loaded, and if it
+  // can be unloaded at all, which is not the case for many implementations.
+  for (auto _ : st) {
+    std::shared_ptr<rcpputils::SharedLibrary> lib = load_library();
+    if (!lib) {
+      st.SkipWithError(rmw_get_error_string().str);
+      rmw_reset_error();
+      break;
+    }
+  }
+}
+
+BENCHMARK_F(PerformanceTest, load_library_warm)(benchmark::State & st)
+{
+  std::shared_ptr<rcpputils::SharedLibrary> loaded_lib = load_library();
+  if (!loaded_lib) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    return;
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    std::shared_ptr<rcpputils::SharedLibrary> lib = load_library();
+    benchmark::DoNotOptimize(lib);
+  }
+}
+
+#define SYMBOL_NAME(name, ...) #name,
+
+static const char * const symbol_names[] = {
+  RMW_IMPLEMENTATION_API_FNS(SYMBOL_NAME)
+};
+
+static constexpr int number_of_symbols =
+  static_cast<int>(sizeof(symbol_names) / sizeof(symbol_names[0]));
+
+BENCHMARK_DEFINE_F(PerformanceTest, lookup_each_symbol)(benchmark::State & st)
+{
+  const char * symbol_name = symbol_names[st.range(0)];
+  st.SetLabel(symbol_name);
+  std::shared_ptr<rcpputils::SharedLibrary> lib = load_library();
+  if (!lib) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    return;
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    void * symbol = lookup_symbol(lib, symbol_name);
+    benchmark::DoNotOptimize(symbol);
+  }
+}
+BENCHMARK_REGISTER_F(PerformanceTest, lookup_each_symbol)->DenseRange(0, number_of_symbols - 1);
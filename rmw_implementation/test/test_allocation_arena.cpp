@@ -0,0 +1,267 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "rcutils/allocator.h"
+#include "rcutils/testing/fault_injection.h"
+
+#include "rmw/error_handling.h"
+
+#include "rmw_implementation/allocation_arena.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+const rosidl_message_type_support_t *
+get_no_message_typesupport_handle(const rosidl_message_type_support_t *, const char *)
+{
+  return nullptr;
+}
+
+// Type support no rmw implementation knows about, which is enough for rmw
+// implementations that do not support preallocation.
+const rosidl_message_type_support_t unknown_type_support = {
+  "not_a_typesupport_identifier", nullptr, get_no_message_typesupport_handle};
+
+const rosidl_message_type_support_t other_unknown_type_support = {
+  "not_a_typesupport_identifier_either", nullptr, get_no_message_typesupport_handle};
+
+// Entities are only told apart by address.
+const rmw_publisher_t publisher{};
+const rmw_publisher_t other_publisher{};
+const rmw_subscription_t subscription{};
+
+}  // namespace
+
+TEST(AllocationArena, bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_allocation_arena_t arena =
+    rmw_implementation_get_zero_initialized_allocation_arena();
+
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_init(nullptr, &allocator));
+  rmw_reset_error();
+  rcutils_allocator_t invalid_allocator = rcutils_get_zero_initialized_allocator();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_init(&arena, &invalid_allocator));
+  rmw_reset_error();
+
+  rmw_publisher_allocation_t * publisher_allocation = nullptr;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &unknown_type_support, nullptr, &publisher_allocation));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_release(&arena, &publisher));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_fini(&arena));
+  rmw_reset_error();
+
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_init(&arena, &allocator)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_init(&arena, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_publisher_allocation(
+      nullptr, &publisher, &unknown_type_support, nullptr, &publisher_allocation));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, nullptr, &unknown_type_support, nullptr, &publisher_allocation));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, nullptr, nullptr, &publisher_allocation));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &unknown_type_support, nullptr, nullptr));
+  rmw_reset_error();
+  rmw_subscription_allocation_t * subscription_allocation = nullptr;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_subscription_allocation(
+      nullptr, &subscription, &unknown_type_support, nullptr, &subscription_allocation));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, nullptr, &unknown_type_support, nullptr, &subscription_allocation));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, &subscription, nullptr, nullptr, &subscription_allocation));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, &subscription, &unknown_type_support, nullptr, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_release(nullptr, &publisher));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_release(&arena, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_allocation_arena_fini(nullptr));
+  rmw_reset_error();
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_fini(&arena));
+  unload_library();
+}
+
+TEST(AllocationArena, get_allocations) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_allocation_arena_t arena =
+    rmw_implementation_get_zero_initialized_allocation_arena();
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_init(&arena, &allocator)) <<
+    rmw_get_error_string().str;
+
+  rmw_publisher_allocation_t * publisher_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &unknown_type_support, nullptr, &publisher_allocation)) <<
+    rmw_get_error_string().str;
+  // unsupported preallocation is not an error
+  EXPECT_FALSE(rmw_error_is_set());
+  rmw_publisher_allocation_t * same_publisher_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &unknown_type_support, nullptr, &same_publisher_allocation)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(publisher_allocation, same_publisher_allocation);
+  rmw_publisher_allocation_t * other_publisher_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &other_unknown_type_support, nullptr, &other_publisher_allocation)) <<
+    rmw_get_error_string().str;
+  if (nullptr != publisher_allocation) {
+    EXPECT_NE(publisher_allocation, other_publisher_allocation);
+  }
+  // publishers do not share allocations, even for the same type
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &other_publisher, &unknown_type_support, nullptr, &other_publisher_allocation)) <<
+    rmw_get_error_string().str;
+  if (nullptr != publisher_allocation) {
+    EXPECT_NE(publisher_allocation, other_publisher_allocation);
+  }
+
+  rmw_subscription_allocation_t * subscription_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, &subscription, &unknown_type_support, nullptr, &subscription_allocation)) <<
+    rmw_get_error_string().str;
+  EXPECT_FALSE(rmw_error_is_set());
+  rmw_subscription_allocation_t * same_subscription_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, &subscription, &unknown_type_support, nullptr, &same_subscription_allocation)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(subscription_allocation, same_subscription_allocation);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_fini(&arena)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(nullptr, arena.impl);
+  unload_library();
+}
+
+TEST(AllocationArena, release_allocations) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_allocation_arena_t arena =
+    rmw_implementation_get_zero_initialized_allocation_arena();
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_init(&arena, &allocator)) <<
+    rmw_get_error_string().str;
+
+  // releasing an entity without allocations has no effect
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_release(&arena, &publisher)) <<
+    rmw_get_error_string().str;
+
+  rmw_publisher_allocation_t * publisher_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &unknown_type_support, nullptr, &publisher_allocation)) <<
+    rmw_get_error_string().str;
+  rmw_publisher_allocation_t * other_type_publisher_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &other_unknown_type_support, nullptr,
+      &other_type_publisher_allocation)) << rmw_get_error_string().str;
+  rmw_subscription_allocation_t * subscription_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, &subscription, &unknown_type_support, nullptr, &subscription_allocation)) <<
+    rmw_get_error_string().str;
+
+  // all allocations of the publisher are released, and only these
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_release(&arena, &publisher)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_release(&arena, &publisher)) <<
+    rmw_get_error_string().str;
+  rmw_subscription_allocation_t * same_subscription_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, &subscription, &unknown_type_support, nullptr, &same_subscription_allocation)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(subscription_allocation, same_subscription_allocation);
+
+  // memory of released allocations is reused, e.g. for an entity created in
+  // place of the released one
+  rmw_publisher_allocation_t * new_publisher_allocation = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &other_publisher, &unknown_type_support, nullptr, &new_publisher_allocation)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(publisher_allocation, new_publisher_allocation);
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, &publisher, &unknown_type_support, nullptr, &new_publisher_allocation)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(other_type_publisher_allocation, new_publisher_allocation);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_release(&arena, &subscription)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_fini(&arena)) <<
+    rmw_get_error_string().str;
+  unload_library();
+}
+
+TEST(AllocationArena, init_and_get_with_internal_errors) {
+  RCUTILS_FAULT_INJECTION_TEST(
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    rmw_implementation_allocation_arena_t arena =
+      rmw_implementation_get_zero_initialized_allocation_arena();
+    rmw_ret_t ret = rmw_implementation_allocation_arena_init(&arena, &allocator);
+    if (RMW_RET_OK == ret) {
+      rmw_publisher_allocation_t * publisher_allocation = nullptr;
+      ret = rmw_implementation_allocation_arena_get_publisher_allocation(
+        &arena, &publisher, &unknown_type_support, nullptr, &publisher_allocation);
+      if (RMW_RET_OK != ret) {
+        rmw_reset_error();
+      }
+      rmw_subscription_allocation_t * subscription_allocation = nullptr;
+      ret = rmw_implementation_allocation_arena_get_subscription_allocation(
+        &arena, &subscription, &unknown_type_support, nullptr, &subscription_allocation);
+      if (RMW_RET_OK != ret) {
+        rmw_reset_error();
+      }
+      EXPECT_EQ(RMW_RET_OK, rmw_implementation_allocation_arena_fini(&arena));
+    } else {
+      rmw_reset_error();
+    }
+    unload_library();
+  });
+}
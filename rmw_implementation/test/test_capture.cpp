@@ -0,0 +1,191 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/capture.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+constexpr char capture_file_path[] = "test_capture.rmwcap";
+
+rmw_implementation_capture_stats_t
+get_capture_stats()
+{
+  rmw_implementation_capture_stats_t stats;
+  rmw_ret_t ret = rmw_implementation_capture_get_stats(&stats);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  return stats;
+}
+
+void
+write_file(const char * file_path, const void * data, size_t size)
+{
+  FILE * file = fopen(file_path, "wb");
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(size, fwrite(data, 1u, size, file));
+  EXPECT_EQ(0, fclose(file));
+}
+
+}  // namespace
+
+TEST(Capture, bad_arguments) {
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_enable(nullptr, nullptr));
+  rmw_reset_error();
+  rmw_implementation_capture_options_t options = rmw_implementation_get_default_capture_options();
+  options.max_file_size = 8u;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_enable(capture_file_path, &options));
+  rmw_reset_error();
+  options = rmw_implementation_get_default_capture_options();
+  options.thread_buffer_size = 0u;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_enable(capture_file_path, &options));
+  rmw_reset_error();
+  EXPECT_FALSE(rmw_implementation_capture_is_enabled());
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_get_stats(nullptr));
+  rmw_reset_error();
+
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_capture_reader_t reader =
+    rmw_implementation_get_zero_initialized_capture_reader();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_capture_reader_init(nullptr, capture_file_path, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_reader_init(&reader, nullptr, &allocator));
+  rmw_reset_error();
+  rcutils_allocator_t invalid_allocator = rcutils_get_zero_initialized_allocator();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_capture_reader_init(&reader, capture_file_path, &invalid_allocator));
+  rmw_reset_error();
+  rmw_implementation_capture_record_t record;
+  bool found = false;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_reader_next(&reader, &record, &found));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_reader_fini(&reader));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_reader_fini(nullptr));
+  rmw_reset_error();
+}
+
+TEST(Capture, enable_and_disable) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_capture_enable(capture_file_path, nullptr)) <<
+    rmw_get_error_string().str;
+  EXPECT_TRUE(rmw_implementation_capture_is_enabled());
+  EXPECT_EQ(RMW_RET_ERROR, rmw_implementation_capture_enable(capture_file_path, nullptr));
+  rmw_reset_error();
+
+  // only messages successfully published are captured
+  rmw_publisher_t publisher{};
+  publisher.implementation_identifier = "not-an-rmw-implementation-identifier";
+  publisher.topic_name = "/test";
+  uint8_t buffer[4] = {1u, 2u, 3u, 4u};
+  rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+  serialized_message.buffer = buffer;
+  serialized_message.buffer_length = sizeof(buffer);
+  serialized_message.buffer_capacity = sizeof(buffer);
+  EXPECT_NE(RMW_RET_OK, rmw_publish_serialized_message(&publisher, &serialized_message, nullptr));
+  rmw_reset_error();
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_capture_disable()) << rmw_get_error_string().str;
+  EXPECT_FALSE(rmw_implementation_capture_is_enabled());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_capture_disable());
+  rmw_implementation_capture_stats_t stats = get_capture_stats();
+  EXPECT_EQ(0u, stats.record_count);
+  EXPECT_EQ(0u, stats.dropped_count);
+  EXPECT_EQ(0u, stats.byte_count);
+
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_capture_reader_t reader =
+    rmw_implementation_get_zero_initialized_capture_reader();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_capture_reader_init(&reader, capture_file_path, &allocator)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(0u, reader.record_count);
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_capture_reader_init(&reader, capture_file_path, &allocator));
+  rmw_reset_error();
+  rmw_implementation_capture_record_t record;
+  bool found = true;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_reader_next(&reader, nullptr, &found));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_capture_reader_next(&reader, &record, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_capture_reader_next(&reader, &record, &found));
+  EXPECT_FALSE(found);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_capture_reader_fini(&reader));
+  EXPECT_EQ(nullptr, reader.impl);
+
+  EXPECT_EQ(0, std::remove(capture_file_path));
+  unload_library();
+}
+
+TEST(Capture, disabled_on_unload) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_capture_enable(capture_file_path, nullptr)) <<
+    rmw_get_error_string().str;
+  unload_library();
+  EXPECT_FALSE(rmw_implementation_capture_is_enabled());
+  EXPECT_EQ(0, std::remove(capture_file_path));
+}
+
+TEST(Capture, read_bad_files) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_capture_reader_t reader =
+    rmw_implementation_get_zero_initialized_capture_reader();
+  EXPECT_EQ(
+    RMW_RET_ERROR,
+    rmw_implementation_capture_reader_init(&reader, "not-a-capture-file.rmwcap", &allocator));
+  rmw_reset_error();
+
+  const char not_a_capture[] = "not a capture file, not a capture file";
+  write_file(capture_file_path, not_a_capture, sizeof(not_a_capture));
+  EXPECT_EQ(
+    RMW_RET_ERROR, rmw_implementation_capture_reader_init(&reader, capture_file_path, &allocator));
+  rmw_reset_error();
+
+  // capture file header claiming records that are missing
+  struct
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t data_size;
+    uint64_t record_count;
+  } header = {{'R', 'M', 'W', 'C', 'A', 'P', 'T', '\0'}, 1u, 0u, 64u, 1u};
+  write_file(capture_file_path, &header, sizeof(header));
+  EXPECT_EQ(
+    RMW_RET_ERROR, rmw_implementation_capture_reader_init(&reader, capture_file_path, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(nullptr, reader.impl);
+
+  EXPECT_EQ(0, std::remove(capture_file_path));
+}
@@ -0,0 +1,97 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/dispatch_table.h"
+
+#define STRINGIFY_(s) #s
+#define STRINGIFY(s) STRINGIFY_(s)
+
+TEST(DispatchTable, bad_load) {
+  EXPECT_EQ(nullptr, rmw_implementation_load(nullptr));
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+
+  EXPECT_EQ(nullptr, rmw_implementation_load("not_an_rmw_implementation"));
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+
+  EXPECT_EQ(nullptr, rmw_implementation_find(nullptr));
+  EXPECT_EQ(nullptr, rmw_implementation_find("not_an_rmw_implementation_identifier"));
+}
+
+TEST(DispatchTable, nominal_load_and_find) {
+  const rmw_implementation_dispatch_table_t * table =
+    rmw_implementation_load(STRINGIFY(DEFAULT_RMW_IMPLEMENTATION));
+  ASSERT_NE(nullptr, table) << rmw_get_error_string().str;
+  EXPECT_STREQ(STRINGIFY(DEFAULT_RMW_IMPLEMENTATION), table->name);
+  ASSERT_NE(nullptr, table->implementation_identifier);
+  EXPECT_STREQ(table->rmw_get_implementation_identifier(), table->implementation_identifier);
+
+  EXPECT_EQ(table, rmw_implementation_load(STRINGIFY(DEFAULT_RMW_IMPLEMENTATION)));
+  EXPECT_EQ(table, rmw_implementation_find(table->implementation_identifier));
+}
+
+TEST(DispatchTable, init_and_shutdown_through_table) {
+  const rmw_implementation_dispatch_table_t * table =
+    rmw_implementation_load(STRINGIFY(DEFAULT_RMW_IMPLEMENTATION));
+  ASSERT_NE(nullptr, table) << rmw_get_error_string().str;
+
+  rmw_init_options_t init_options = rmw_get_zero_initialized_init_options();
+  rmw_ret_t ret = table->rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(table, rmw_implementation_find(init_options.implementation_identifier));
+
+  rmw_context_t context = rmw_get_zero_initialized_context();
+  ret = table->rmw_init(&init_options, &context);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(table, rmw_implementation_find(context.implementation_identifier));
+
+  ret = table->rmw_shutdown(&context);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = table->rmw_context_fini(&context);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = table->rmw_init_options_fini(&init_options);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+}
+
+TEST(DispatchTable, missing_functions_fall_back) {
+  const rmw_implementation_dispatch_table_t * table =
+    rmw_implementation_load(STRINGIFY(DEFAULT_RMW_IMPLEMENTATION));
+  ASSERT_NE(nullptr, table) << rmw_get_error_string().str;
+
+#define EXPECT_ENTRY_BOUND(name, ...) EXPECT_NE(nullptr, table->name) << #name;
+  RMW_IMPLEMENTATION_API_FNS(EXPECT_ENTRY_BOUND)
+#undef EXPECT_ENTRY_BOUND
+
+  // whether the rmw implementation has it or not, publishing a sequence
+  // goes through the table the publisher belongs to
+  rmw_publisher_t publisher{};
+  publisher.implementation_identifier = table->implementation_identifier;
+  rmw_message_sequence_t message_sequence = rmw_get_zero_initialized_message_sequence();
+  size_t published = 1u;
+  EXPECT_EQ(
+    RMW_RET_OK, table->rmw_publish_sequence(&publisher, &message_sequence, &published, nullptr)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(0u, published);
+  EXPECT_NE(
+    RMW_RET_OK, table->rmw_publish_sequence(nullptr, &message_sequence, &published, nullptr));
+  rmw_reset_error();
+}
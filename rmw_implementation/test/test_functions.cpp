@@ -15,12 +15,18 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "rcutils/env.h"
 #include "rcutils/get_env.h"
 #include "rcutils/testing/fault_injection.h"
 
 #include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/extensions.h"
+#include "rmw_implementation/features.h"
 
 #include "../src/functions.hpp"
 
@@ -45,6 +51,38 @@ TEST(Functions, nominal_load_and_lookup) {
   rmw_reset_error();
 }
 
+TEST(Functions, nominal_find_symbol) {
+  std::shared_ptr<rcpputils::SharedLibrary> lib = load_library();
+  ASSERT_NE(nullptr, lib) << rmw_get_error_string().str;
+  rcutils_shared_library_t handle;
+  ASSERT_TRUE(open_library_handle(lib, handle)) << rmw_get_error_string().str;
+  EXPECT_NE(nullptr, find_symbol(handle, "rmw_init"));
+  EXPECT_EQ(nullptr, find_symbol(handle, "not_an_rmw_function"));
+  EXPECT_FALSE(rmw_error_is_set());
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_unload_shared_library(&handle));
+}
+
+TEST(Functions, load_with_bad_preload_mode) {
+  EXPECT_TRUE(rcutils_set_env("RMW_IMPLEMENTATION_PRELOAD", "not_a_preload_mode"));
+
+  EXPECT_EQ(nullptr, load_library());
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+
+  EXPECT_TRUE(rcutils_set_env("RMW_IMPLEMENTATION_PRELOAD", nullptr));
+}
+
+TEST(Functions, load_and_lookup_with_preload_modes) {
+  // locking may exceed the memory lock limit, hence not tested
+  for (const char * preload_mode : {"none", "bind_now", "prefault"}) {
+    EXPECT_TRUE(rcutils_set_env("RMW_IMPLEMENTATION_PRELOAD", preload_mode));
+    std::shared_ptr<rcpputils::SharedLibrary> lib = load_library();
+    ASSERT_NE(nullptr, lib) << preload_mode << ": " << rmw_get_error_string().str;
+    EXPECT_NE(nullptr, lookup_symbol(lib, "rmw_init")) << rmw_get_error_string().str;
+  }
+  EXPECT_TRUE(rcutils_set_env("RMW_IMPLEMENTATION_PRELOAD", nullptr));
+}
+
 TEST(Functions, load_and_lookup_with_internal_errors) {
   RCUTILS_FAULT_INJECTION_TEST(
   {
@@ -58,5 +96,83 @@ TEST(Functions, load_and_lookup_with_internal_errors) {
 
 TEST(Functions, nominal_prefetch_and_unload) {
   prefetch_symbols();
+  EXPECT_TRUE(all_symbols_resolved()) << rmw_get_error_string().str;
+  unload_library();
+  EXPECT_FALSE(all_symbols_resolved());
+}
+
+TEST(Functions, nominal_lazy_dispatch_and_unload) {
+  EXPECT_NE(nullptr, rmw_get_implementation_identifier()) << rmw_get_error_string().str;
+  unload_library();
+  EXPECT_NE(nullptr, rmw_get_implementation_identifier()) << rmw_get_error_string().str;
+  unload_library();
+}
+
+TEST(Functions, fallback_dispatch) {
+  // the rmw implementation may or may not have it
+  size_t published = 0u;
+  rmw_message_sequence_t sequence = rmw_get_zero_initialized_message_sequence();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_publish_sequence(nullptr, &sequence, &published, nullptr));
+  rmw_reset_error();
+  unload_library();
+
+  prefetch_symbols();
+  EXPECT_TRUE(all_symbols_resolved()) << rmw_get_error_string().str;
+  EXPECT_FALSE(rmw_error_is_set());
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_publish_sequence(nullptr, &sequence, &published, nullptr));
+  rmw_reset_error();
+  unload_library();
+}
+
+TEST(Functions, feature_probing) {
+  // the rmw implementation may or may not have these
+  const bool has_loaned_messages =
+    rmw_implementation_has_feature(RMW_IMPLEMENTATION_FEATURE_LOANED_MESSAGES);
+  const bool has_events = rmw_implementation_has_feature(RMW_IMPLEMENTATION_FEATURE_EVENTS);
+  const bool has_publish_sequence =
+    rmw_implementation_has_feature(RMW_IMPLEMENTATION_FEATURE_PUBLISH_SEQUENCE);
+  EXPECT_FALSE(rmw_error_is_set());
+  EXPECT_FALSE(rmw_implementation_has_feature(static_cast<rmw_implementation_feature_t>(-1)));
+
+  if (!has_loaned_messages) {
+    EXPECT_EQ(RMW_RET_UNSUPPORTED, rmw_return_loaned_message_from_subscription(nullptr, nullptr));
+    EXPECT_TRUE(rmw_error_is_set());
+    rmw_reset_error();
+  }
+  unload_library();
+
+  // missing features do not prevent resolving all symbols
+  prefetch_symbols();
+  EXPECT_TRUE(all_symbols_resolved());
+  EXPECT_FALSE(rmw_error_is_set());
+  EXPECT_EQ(
+    has_loaned_messages,
+    rmw_implementation_has_feature(RMW_IMPLEMENTATION_FEATURE_LOANED_MESSAGES));
+  EXPECT_EQ(has_events, rmw_implementation_has_feature(RMW_IMPLEMENTATION_FEATURE_EVENTS));
+  EXPECT_EQ(
+    has_publish_sequence,
+    rmw_implementation_has_feature(RMW_IMPLEMENTATION_FEATURE_PUBLISH_SEQUENCE));
+  unload_library();
+}
+
+TEST(Functions, concurrent_lazy_dispatch) {
+  constexpr size_t number_of_threads = 8u;
+  std::vector<const char *> formats(number_of_threads, nullptr);
+  std::vector<std::thread> threads;
+  for (size_t i = 0u; i < number_of_threads; ++i) {
+    threads.emplace_back(
+      [&formats, i]() {
+        formats[i] = rmw_get_serialization_format();
+      });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  ASSERT_NE(nullptr, formats[0]) << rmw_get_error_string().str;
+  for (const char * format : formats) {
+    EXPECT_EQ(formats[0], format);
+  }
   unload_library();
 }
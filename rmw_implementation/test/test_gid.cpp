@@ -0,0 +1,213 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+
+#include "rmw_implementation/gid.h"
+
+namespace
+{
+
+constexpr char identifier[] = "some_rmw_implementation";
+
+rmw_gid_t
+make_gid(uint8_t value)
+{
+  rmw_gid_t gid{};
+  gid.implementation_identifier = identifier;
+  gid.data[RMW_GID_STORAGE_SIZE - 1u] = value;
+  return gid;
+}
+
+// Allocator counting live allocations, failing once the limit is reached.
+struct AllocationCount
+{
+  size_t live;
+  size_t limit;
+};
+
+void *
+counting_allocate(size_t size, void * state)
+{
+  AllocationCount * count = static_cast<AllocationCount *>(state);
+  if (count->live == count->limit) {
+    return nullptr;
+  }
+  ++count->live;
+  return rcutils_get_default_allocator().allocate(size, nullptr);
+}
+
+void
+counting_deallocate(void * pointer, void * state)
+{
+  --static_cast<AllocationCount *>(state)->live;
+  rcutils_get_default_allocator().deallocate(pointer, nullptr);
+}
+
+rcutils_allocator_t
+get_counting_allocator(AllocationCount * count)
+{
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  allocator.allocate = counting_allocate;
+  allocator.deallocate = counting_deallocate;
+  allocator.state = count;
+  return allocator;
+}
+
+}  // namespace
+
+TEST(Gid, equal_and_hash) {
+  const rmw_gid_t gid = make_gid(1u);
+  rmw_gid_t same_gid = make_gid(1u);
+  EXPECT_TRUE(rmw_implementation_gid_equal(&gid, &same_gid));
+  EXPECT_EQ(rmw_implementation_gid_hash(&gid), rmw_implementation_gid_hash(&same_gid));
+
+  // identifiers are compared by value
+  const std::string same_identifier(identifier);
+  same_gid.implementation_identifier = same_identifier.c_str();
+  EXPECT_TRUE(rmw_implementation_gid_equal(&gid, &same_gid));
+
+  const rmw_gid_t other_gid = make_gid(2u);
+  EXPECT_FALSE(rmw_implementation_gid_equal(&gid, &other_gid));
+  EXPECT_NE(rmw_implementation_gid_hash(&gid), rmw_implementation_gid_hash(&other_gid));
+
+  rmw_gid_t gid_of_other_rmw = make_gid(1u);
+  gid_of_other_rmw.implementation_identifier = "other_rmw_implementation";
+  EXPECT_FALSE(rmw_implementation_gid_equal(&gid, &gid_of_other_rmw));
+  gid_of_other_rmw.implementation_identifier = nullptr;
+  EXPECT_FALSE(rmw_implementation_gid_equal(&gid, &gid_of_other_rmw));
+  EXPECT_FALSE(rmw_implementation_gid_equal(&gid_of_other_rmw, &gid));
+}
+
+TEST(GidSet, init_and_fini_with_bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_init(nullptr, &allocator));
+  rmw_reset_error();
+  rmw_implementation_gid_set_t set = rmw_implementation_get_zero_initialized_gid_set();
+  rcutils_allocator_t invalid_allocator = rcutils_get_zero_initialized_allocator();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_init(&set, &invalid_allocator));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_init(&set, nullptr));
+  rmw_reset_error();
+
+  const rmw_gid_t gid = make_gid(1u);
+  bool result = false;
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_insert(&set, &gid, &result));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_remove(&set, &gid, &result));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_contains(&set, &gid, &result));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_clear(&set));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_fini(&set));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_fini(nullptr));
+  rmw_reset_error();
+
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_gid_set_init(&set, &allocator)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_init(&set, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_insert(&set, nullptr, &result));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_remove(&set, nullptr, &result));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_contains(&set, nullptr, &result));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_gid_set_contains(&set, &gid, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_fini(&set));
+  EXPECT_EQ(nullptr, set.impl);
+}
+
+TEST(GidSet, insert_remove_and_contains) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_gid_set_t set = rmw_implementation_get_zero_initialized_gid_set();
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_gid_set_init(&set, &allocator)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(0u, set.size);
+
+  constexpr uint8_t gid_count = 100u;
+  for (uint8_t i = 0u; i < gid_count; ++i) {
+    const rmw_gid_t gid = make_gid(i);
+    bool inserted = false;
+    ASSERT_EQ(RMW_RET_OK, rmw_implementation_gid_set_insert(&set, &gid, &inserted)) <<
+      rmw_get_error_string().str;
+    EXPECT_TRUE(inserted);
+  }
+  EXPECT_EQ(gid_count, set.size);
+  const rmw_gid_t first_gid = make_gid(0u);
+  bool inserted = true;
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_insert(&set, &first_gid, &inserted));
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_insert(&set, &first_gid, nullptr));
+  EXPECT_EQ(gid_count, set.size);
+
+  bool contains = false;
+  const rmw_gid_t last_gid = make_gid(gid_count - 1u);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_contains(&set, &last_gid, &contains));
+  EXPECT_TRUE(contains);
+  const rmw_gid_t unknown_gid = make_gid(gid_count);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_contains(&set, &unknown_gid, &contains));
+  EXPECT_FALSE(contains);
+
+  bool removed = false;
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_remove(&set, &last_gid, &removed));
+  EXPECT_TRUE(removed);
+  EXPECT_EQ(gid_count - 1u, set.size);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_contains(&set, &last_gid, &contains));
+  EXPECT_FALSE(contains);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_remove(&set, &last_gid, &removed));
+  EXPECT_FALSE(removed);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_remove(&set, &unknown_gid, nullptr));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_clear(&set));
+  EXPECT_EQ(0u, set.size);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_contains(&set, &first_gid, &contains));
+  EXPECT_FALSE(contains);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_fini(&set));
+}
+
+TEST(GidSet, entries_use_the_allocator) {
+  AllocationCount count{0u, SIZE_MAX};
+  rcutils_allocator_t allocator = get_counting_allocator(&count);
+  rmw_implementation_gid_set_t set = rmw_implementation_get_zero_initialized_gid_set();
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_gid_set_init(&set, &allocator)) <<
+    rmw_get_error_string().str;
+  const size_t init_count = count.live;
+  const rmw_gid_t gid = make_gid(1u);
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_gid_set_insert(&set, &gid, nullptr)) <<
+    rmw_get_error_string().str;
+  EXPECT_LT(init_count, count.live);
+
+  // failing to allocate entries leaves the set as it was
+  count.limit = count.live;
+  const rmw_gid_t other_gid = make_gid(2u);
+  EXPECT_EQ(RMW_RET_BAD_ALLOC, rmw_implementation_gid_set_insert(&set, &other_gid, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(1u, set.size);
+  count.limit = SIZE_MAX;
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_fini(&set));
+  EXPECT_EQ(0u, count.live);
+}
@@ -0,0 +1,350 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/graph_cache.h"
+#include "rmw_implementation/profiling.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+uint64_t
+get_call_count(const char * function_name)
+{
+  std::vector<rmw_implementation_function_profile_t> profiles(
+    rmw_implementation_profile_count());
+  rmw_ret_t ret = rmw_implementation_profile_snapshot(profiles.data(), profiles.size());
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  for (const rmw_implementation_function_profile_t & profile : profiles) {
+    if (0 == strcmp(function_name, profile.function_name)) {
+      return profile.call_count;
+    }
+  }
+  ADD_FAILURE() << "no profile for " << function_name;
+  return 0u;
+}
+
+}  // namespace
+
+TEST(GraphCache, bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_graph_cache_t cache = rmw_implementation_get_zero_initialized_graph_cache();
+
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_init(nullptr, nullptr, true, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_init(&cache, nullptr, true, &allocator));
+  rmw_reset_error();
+
+  rmw_names_and_types_t names_and_types = rmw_get_zero_initialized_names_and_types();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_topic_names_and_types(
+      &cache, &allocator, false, &names_and_types));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_service_names_and_types(
+      &cache, &allocator, &names_and_types));
+  rmw_reset_error();
+  rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+  rcutils_string_array_t node_namespaces = rcutils_get_zero_initialized_string_array();
+  rcutils_string_array_t enclaves = rcutils_get_zero_initialized_string_array();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_node_names(
+      &cache, &node_names, &node_namespaces));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_node_names_with_enclaves(
+      &cache, &node_names, &node_namespaces, &enclaves));
+  rmw_reset_error();
+  size_t count = 0u;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_count_publishers(&cache, "/test_topic", &count));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_count_subscribers(&cache, "/test_topic", &count));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_invalidate(&cache));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_invalidate(nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_fini(&cache));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_fini(nullptr));
+  rmw_reset_error();
+  unload_library();
+}
+
+class GraphCacheUse : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns");
+    ASSERT_NE(nullptr, node) << rmw_get_error_string().str;
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    ret = rmw_implementation_graph_cache_init(&cache, node, true, &allocator);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    rmw_ret_t ret;
+    if (nullptr != cache.impl) {
+      ret = rmw_implementation_graph_cache_fini(&cache);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    if (nullptr != node) {
+      ret = rmw_destroy_node(node);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_init_options_fini(&init_options);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    unload_library();
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_implementation_graph_cache_t cache{rmw_implementation_get_zero_initialized_graph_cache()};
+};
+
+TEST_F(GraphCacheUse, queries_with_bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rcutils_allocator_t invalid_allocator = rcutils_get_zero_initialized_allocator();
+  rmw_names_and_types_t names_and_types = rmw_get_zero_initialized_names_and_types();
+
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_init(&cache, node, true, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_topic_names_and_types(
+      &cache, &invalid_allocator, false, &names_and_types));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_topic_names_and_types(
+      &cache, &allocator, false, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_service_names_and_types(
+      &cache, &invalid_allocator, &names_and_types));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_service_names_and_types(
+      &cache, &allocator, nullptr));
+  rmw_reset_error();
+
+  rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_node_names(
+      &cache, &node_names, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_cache_get_node_names_with_enclaves(
+      &cache, &node_names, &node_names, nullptr));
+  rmw_reset_error();
+
+  size_t count = 0u;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_count_publishers(&cache, nullptr, &count));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_count_publishers(&cache, "/test_topic", nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_count_subscribers(&cache, nullptr, &count));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_cache_count_subscribers(&cache, "/test_topic", nullptr));
+  rmw_reset_error();
+}
+
+TEST_F(GraphCacheUse, queries_are_served_from_snapshot) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+
+  // the graph may still change while the node is discovered, but not on every query
+  constexpr size_t query_count = 100u;
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  for (size_t i = 0u; i < query_count; ++i) {
+    rmw_names_and_types_t topic_names_and_types = rmw_get_zero_initialized_names_and_types();
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_implementation_graph_cache_get_topic_names_and_types(
+        &cache, &allocator, false, &topic_names_and_types)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_names_and_types_fini(&topic_names_and_types));
+    size_t count = 0u;
+    ASSERT_EQ(
+      RMW_RET_OK,
+      rmw_implementation_graph_cache_count_publishers(&cache, "/test_topic", &count)) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(0u, count);
+  }
+  const uint64_t topic_queries = get_call_count("rmw_get_topic_names_and_types");
+  EXPECT_LE(1u, topic_queries);
+  EXPECT_GT(query_count, topic_queries);
+  const uint64_t count_queries = get_call_count("rmw_count_publishers");
+  EXPECT_LE(1u, count_queries);
+  EXPECT_GT(query_count, count_queries);
+
+  // invalidated snapshots are taken anew
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_graph_cache_invalidate(&cache));
+  rmw_names_and_types_t topic_names_and_types = rmw_get_zero_initialized_names_and_types();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_cache_get_topic_names_and_types(
+      &cache, &allocator, false, &topic_names_and_types)) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_names_and_types_fini(&topic_names_and_types));
+  EXPECT_LT(topic_queries, get_call_count("rmw_get_topic_names_and_types"));
+
+  // so are they when the graph changes
+  const uint64_t node_queries = get_call_count("rmw_get_node_names_with_enclaves");
+  rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+  rcutils_string_array_t node_namespaces = rcutils_get_zero_initialized_string_array();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_cache_get_node_names(
+      &cache, &node_names, &node_namespaces)) << rmw_get_error_string().str;
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_names));
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_namespaces));
+  EXPECT_EQ(node_queries + 1u, get_call_count("rmw_get_node_names_with_enclaves"));
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_trigger_guard_condition(rmw_node_get_graph_guard_condition(node))) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_cache_get_node_names(
+      &cache, &node_names, &node_namespaces)) << rmw_get_error_string().str;
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_names));
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_namespaces));
+  EXPECT_LE(node_queries + 2u, get_call_count("rmw_get_node_names_with_enclaves"));
+
+  // waits on the graph guard condition are not profiled
+  EXPECT_EQ(0u, get_call_count("rmw_wait"));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+}
+
+TEST_F(GraphCacheUse, graph_changes_seen_by_all_caches_of_a_node) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_graph_cache_t other_cache =
+    rmw_implementation_get_zero_initialized_graph_cache();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_cache_init(&other_cache, node, true, &allocator)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+
+  auto get_node_names = [](rmw_implementation_graph_cache_t * graph_cache) {
+      rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+      rcutils_string_array_t node_namespaces = rcutils_get_zero_initialized_string_array();
+      ASSERT_EQ(
+        RMW_RET_OK, rmw_implementation_graph_cache_get_node_names(
+          graph_cache, &node_names, &node_namespaces)) << rmw_get_error_string().str;
+      EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_names));
+      EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_namespaces));
+    };
+  get_node_names(&cache);
+  get_node_names(&other_cache);
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+
+  // the trigger is seen by both caches, once
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_trigger_guard_condition(rmw_node_get_graph_guard_condition(node))) <<
+    rmw_get_error_string().str;
+  get_node_names(&cache);
+  EXPECT_EQ(1u, get_call_count("rmw_get_node_names_with_enclaves"));
+  get_node_names(&other_cache);
+  EXPECT_EQ(2u, get_call_count("rmw_get_node_names_with_enclaves"));
+  get_node_names(&cache);
+  get_node_names(&other_cache);
+  EXPECT_EQ(2u, get_call_count("rmw_get_node_names_with_enclaves"));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_graph_cache_fini(&other_cache));
+}
+
+TEST_F(GraphCacheUse, unwatched_caches_are_invalidated_by_callers) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_graph_cache_t unwatched_cache =
+    rmw_implementation_get_zero_initialized_graph_cache();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_cache_init(&unwatched_cache, node, false, &allocator)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+
+  auto count_publishers = [&unwatched_cache]() {
+      size_t count = 0u;
+      ASSERT_EQ(
+        RMW_RET_OK, rmw_implementation_graph_cache_count_publishers(
+          &unwatched_cache, "/test_topic", &count)) << rmw_get_error_string().str;
+      EXPECT_EQ(0u, count);
+    };
+  count_publishers();
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+
+  // triggers are left to the caller, e.g. to the graph listener of rcl
+  const rmw_guard_condition_t * graph_guard_condition = rmw_node_get_graph_guard_condition(node);
+  ASSERT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(graph_guard_condition)) <<
+    rmw_get_error_string().str;
+  count_publishers();
+  EXPECT_EQ(0u, get_call_count("rmw_count_publishers"));
+  rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, 1u);
+  ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+  void * guard_conditions_storage[1] = {graph_guard_condition->data};
+  rmw_guard_conditions_t guard_conditions = {1u, guard_conditions_storage};
+  const rmw_time_t timeout = {0u, 0u};
+  EXPECT_EQ(
+    RMW_RET_OK, rmw_wait(
+      nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set, &timeout)) <<
+    rmw_get_error_string().str;
+  EXPECT_NE(nullptr, guard_conditions.guard_conditions[0]);
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set)) << rmw_get_error_string().str;
+
+  // which invalidates the cache
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_graph_cache_invalidate(&unwatched_cache));
+  count_publishers();
+  EXPECT_EQ(1u, get_call_count("rmw_count_publishers"));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_graph_cache_fini(&unwatched_cache));
+}
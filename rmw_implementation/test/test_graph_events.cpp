@@ -0,0 +1,339 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/graph_events.h"
+#include "rmw_implementation/profiling.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+uint64_t
+get_call_count(const char * function_name)
+{
+  std::vector<rmw_implementation_function_profile_t> profiles(
+    rmw_implementation_profile_count());
+  rmw_ret_t ret = rmw_implementation_profile_snapshot(profiles.data(), profiles.size());
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  for (const rmw_implementation_function_profile_t & profile : profiles) {
+    if (0 == strcmp(function_name, profile.function_name)) {
+      return profile.call_count;
+    }
+  }
+  ADD_FAILURE() << "no profile for " << function_name;
+  return 0u;
+}
+
+}  // namespace
+
+TEST(GraphEventStream, bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_graph_event_stream_t stream =
+    rmw_implementation_get_zero_initialized_graph_event_stream();
+
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_event_stream_init(nullptr, nullptr, true, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_event_stream_init(&stream, nullptr, true, &allocator));
+  rmw_reset_error();
+
+  rmw_implementation_graph_event_t events[1];
+  size_t count = 0u;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_event_stream_take(&stream, events, 1u, &count));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_event_stream_take(nullptr, events, 1u, &count));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_event_stream_update(&stream));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_event_stream_update(nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_event_stream_fini(&stream));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_graph_event_stream_fini(nullptr));
+  rmw_reset_error();
+  unload_library();
+}
+
+class GraphEventStreamUse : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns");
+    ASSERT_NE(nullptr, node) << rmw_get_error_string().str;
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    ret = rmw_implementation_graph_event_stream_init(&stream, node, true, &allocator);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    rmw_ret_t ret;
+    if (nullptr != stream.impl) {
+      ret = rmw_implementation_graph_event_stream_fini(&stream);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    if (nullptr != node) {
+      ret = rmw_destroy_node(node);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_init_options_fini(&init_options);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    unload_library();
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_implementation_graph_event_stream_t stream{
+    rmw_implementation_get_zero_initialized_graph_event_stream()};
+};
+
+TEST_F(GraphEventStreamUse, take_with_bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_event_stream_init(&stream, node, true, &allocator));
+  rmw_reset_error();
+
+  rmw_implementation_graph_event_t events[1];
+  size_t count = 0u;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_event_stream_take(&stream, nullptr, 1u, &count));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_graph_event_stream_take(&stream, events, 1u, nullptr));
+  rmw_reset_error();
+}
+
+TEST_F(GraphEventStreamUse, snapshots_are_taken_on_change) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+
+  // the graph may still change while the node is discovered, but not on every take
+  constexpr size_t take_count = 100u;
+  rmw_implementation_graph_event_t events[8];
+  for (size_t i = 0u; i < take_count; ++i) {
+    size_t count = 0u;
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_implementation_graph_event_stream_take(&stream, events, 8u, &count)) <<
+      rmw_get_error_string().str;
+    EXPECT_GE(8u, count);
+  }
+  const uint64_t topic_queries = get_call_count("rmw_get_topic_names_and_types");
+  EXPECT_LE(1u, topic_queries);
+  EXPECT_GT(take_count, topic_queries);
+
+  // nothing is taken when there is no room for it
+  size_t count = 1u;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_event_stream_take(&stream, events, 0u, &count)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(0u, count);
+
+  // snapshots are taken on update, or when the graph changes
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_graph_event_stream_update(&stream)) <<
+    rmw_get_error_string().str;
+  EXPECT_LT(topic_queries, get_call_count("rmw_get_topic_names_and_types"));
+  const uint64_t updated_topic_queries = get_call_count("rmw_get_topic_names_and_types");
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_trigger_guard_condition(rmw_node_get_graph_guard_condition(node))) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_event_stream_take(&stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  EXPECT_LT(updated_topic_queries, get_call_count("rmw_get_topic_names_and_types"));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+}
+
+TEST_F(GraphEventStreamUse, snapshots_are_shared_by_streams_of_a_node) {
+  rmw_implementation_graph_event_stream_t other_stream =
+    rmw_implementation_get_zero_initialized_graph_event_stream();
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_init(&other_stream, node, true, &allocator)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+
+  // both streams see the same events from a single snapshot per trigger
+  rmw_implementation_graph_event_t events[8];
+  for (size_t i = 0u; i < 3u; ++i) {
+    ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_trigger_guard_condition(rmw_node_get_graph_guard_condition(node))) <<
+      rmw_get_error_string().str;
+    size_t count = 0u;
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_implementation_graph_event_stream_take(&stream, events, 8u, &count)) <<
+      rmw_get_error_string().str;
+    size_t other_count = 0u;
+    ASSERT_EQ(
+      RMW_RET_OK,
+      rmw_implementation_graph_event_stream_take(&other_stream, events, 8u, &other_count)) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(count, other_count);
+    EXPECT_EQ(1u, get_call_count("rmw_get_topic_names_and_types"));
+  }
+
+  // streams initialized later start from the shared snapshot
+  rmw_implementation_graph_event_stream_t late_stream =
+    rmw_implementation_get_zero_initialized_graph_event_stream();
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_event_stream_init(&late_stream, node, true, &allocator)) <<
+    rmw_get_error_string().str;
+  size_t count = 0u;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_event_stream_take(&late_stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(0u, get_call_count("rmw_get_topic_names_and_types"));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_graph_event_stream_fini(&late_stream)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_graph_event_stream_fini(&other_stream)) <<
+    rmw_get_error_string().str;
+}
+
+TEST_F(GraphEventStreamUse, snapshots_are_shared_by_streams_of_a_context) {
+  rmw_node_t * other_node = rmw_create_node(&context, "my_other_test_node", "/my_test_ns");
+  ASSERT_NE(nullptr, other_node) << rmw_get_error_string().str;
+  rmw_implementation_graph_event_stream_t other_stream =
+    rmw_implementation_get_zero_initialized_graph_event_stream();
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_init(&other_stream, other_node, true, &allocator)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+
+  // streams of both nodes see the same events from a single snapshot per trigger
+  rmw_implementation_graph_event_t events[8];
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_trigger_guard_condition(rmw_node_get_graph_guard_condition(node))) <<
+    rmw_get_error_string().str;
+  size_t count = 0u;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_event_stream_take(&stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  const uint64_t topic_queries = get_call_count("rmw_get_topic_names_and_types");
+  EXPECT_EQ(1u, topic_queries);
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_take(&other_stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(topic_queries, get_call_count("rmw_get_topic_names_and_types"));
+
+  // snapshots are taken through the other node once the first one has no streams
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_graph_event_stream_fini(&stream)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+  node = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_take(&other_stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  const uint64_t switched_topic_queries = get_call_count("rmw_get_topic_names_and_types");
+  EXPECT_LT(topic_queries, switched_topic_queries);
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_trigger_guard_condition(rmw_node_get_graph_guard_condition(other_node))) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_take(&other_stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  EXPECT_LT(switched_topic_queries, get_call_count("rmw_get_topic_names_and_types"));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_graph_event_stream_fini(&other_stream)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(other_node)) << rmw_get_error_string().str;
+}
+
+TEST_F(GraphEventStreamUse, unwatched_streams_are_updated_by_callers) {
+  rmw_implementation_graph_event_stream_t unwatched_stream =
+    rmw_implementation_get_zero_initialized_graph_event_stream();
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_init(&unwatched_stream, node, false, &allocator)) <<
+    rmw_get_error_string().str;
+  rmw_implementation_graph_event_t events[8];
+  size_t count = 0u;
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_take(&unwatched_stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+
+  // triggers are left to the caller, which updates the stream
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_trigger_guard_condition(rmw_node_get_graph_guard_condition(node))) <<
+    rmw_get_error_string().str;
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_graph_event_stream_take(&unwatched_stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(0u, get_call_count("rmw_get_topic_names_and_types"));
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_graph_event_stream_update(&unwatched_stream)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(1u, get_call_count("rmw_get_topic_names_and_types"));
+
+  // the watching stream of the node still sees the trigger
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_graph_event_stream_take(&stream, events, 8u, &count)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(2u, get_call_count("rmw_get_topic_names_and_types"));
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_graph_event_stream_fini(&unwatched_stream)) <<
+    rmw_get_error_string().str;
+}
@@ -0,0 +1,170 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/graph_wait.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+// Condition holding once evaluated a number of times.
+struct CountdownCondition
+{
+  size_t remaining;
+};
+
+rmw_ret_t
+check_countdown(void * data, bool * holds)
+{
+  auto condition = static_cast<CountdownCondition *>(data);
+  if (0u != condition->remaining) {
+    --condition->remaining;
+  }
+  *holds = 0u == condition->remaining;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+check_never(void *, bool * holds)
+{
+  *holds = false;
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+check_failing(void *, bool *)
+{
+  RMW_SET_ERROR_MSG("condition failed");
+  return RMW_RET_ERROR;
+}
+
+}  // namespace
+
+class GraphWait : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns");
+    ASSERT_NE(nullptr, node) << rmw_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    rmw_ret_t ret;
+    if (nullptr != node) {
+      ret = rmw_destroy_node(node);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_init_options_fini(&init_options);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    unload_library();
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+};
+
+TEST_F(GraphWait, bad_arguments) {
+  const rmw_time_t timeout{0u, 0u};
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_wait_for_graph_condition(nullptr, check_never, nullptr, &timeout));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_wait_for_graph_condition(node, nullptr, nullptr, &timeout));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_wait_for_matched_subscriptions(node, nullptr, 0u, &timeout));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_wait_for_matched_publishers(node, nullptr, 0u, &timeout));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_wait_for_publishers(node, nullptr, 0u, &timeout));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_wait_for_subscribers(node, nullptr, 0u, &timeout));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_wait_for_service_server(node, nullptr, &timeout));
+  rmw_reset_error();
+}
+
+TEST_F(GraphWait, wait_for_condition) {
+  // conditions are evaluated until these hold
+  CountdownCondition condition{3u};
+  EXPECT_EQ(
+    RMW_RET_OK, rmw_implementation_wait_for_graph_condition(
+      node, check_countdown, &condition, nullptr)) << rmw_get_error_string().str;
+  EXPECT_EQ(0u, condition.remaining);
+
+  // up to the timeout
+  const rmw_time_t timeout{0u, 50000000u};
+  const auto start_time = std::chrono::steady_clock::now();
+  EXPECT_EQ(
+    RMW_RET_TIMEOUT,
+    rmw_implementation_wait_for_graph_condition(node, check_never, nullptr, &timeout));
+  EXPECT_LE(std::chrono::milliseconds(50), std::chrono::steady_clock::now() - start_time);
+  EXPECT_FALSE(rmw_error_is_set());
+
+  // stopping on errors
+  EXPECT_EQ(
+    RMW_RET_ERROR,
+    rmw_implementation_wait_for_graph_condition(node, check_failing, nullptr, &timeout));
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+
+  // graph conditions already holding do not wait
+  EXPECT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_wait_for_publishers(node, "/test_graph_wait", 0u, &timeout)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_wait_for_subscribers(node, "/test_graph_wait", 0u, &timeout)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(
+    RMW_RET_TIMEOUT,
+    rmw_implementation_wait_for_publishers(node, "/test_graph_wait", 1u, &timeout));
+  EXPECT_FALSE(rmw_error_is_set());
+}
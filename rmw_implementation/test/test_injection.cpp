@@ -0,0 +1,202 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/injection.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+rmw_implementation_injection_stats_t
+get_injection_stats()
+{
+  rmw_implementation_injection_stats_t stats;
+  rmw_ret_t ret = rmw_implementation_injection_get_stats(&stats);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  return stats;
+}
+
+}  // namespace
+
+TEST(Injection, bad_arguments) {
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_injection_set("/test", nullptr));
+  rmw_reset_error();
+  rmw_implementation_injection_t injection = rmw_implementation_get_zero_initialized_injection();
+  injection.drop_probability = 1.5;
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_injection_set("/test", &injection));
+  rmw_reset_error();
+  injection.drop_probability = 0.0;
+  injection.reorder_probability = -0.5;
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_injection_set(nullptr, &injection));
+  rmw_reset_error();
+  injection.reorder_probability = std::numeric_limits<double>::quiet_NaN();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_injection_set(nullptr, &injection));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_injection_get_stats(nullptr));
+  rmw_reset_error();
+}
+
+TEST(Injection, drop_and_reorder) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_reset_stats());
+  rmw_implementation_injection_t injection = rmw_implementation_get_zero_initialized_injection();
+  injection.drop_probability = 1.0;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_set("/dropped", &injection));
+  injection = rmw_implementation_get_zero_initialized_injection();
+  injection.reorder_probability = 1.0;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_set("/reordered", &injection));
+
+  // calls made to the rmw implementation fail, as entities are not its own
+  rmw_publisher_t publisher{};
+  publisher.implementation_identifier = "not-an-rmw-implementation-identifier";
+  publisher.topic_name = "/dropped";
+  int ros_message = 0;
+  EXPECT_NE(RMW_RET_OK, rmw_publish(&publisher, &ros_message, nullptr));
+  rmw_reset_error();
+
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_enable(42u)) << rmw_get_error_string().str;
+  EXPECT_TRUE(rmw_implementation_injection_is_enabled());
+  EXPECT_EQ(RMW_RET_OK, rmw_publish(&publisher, &ros_message, nullptr));
+  EXPECT_EQ(1u, get_injection_stats().dropped_count);
+  publisher.topic_name = "/other";
+  EXPECT_NE(RMW_RET_OK, rmw_publish(&publisher, &ros_message, nullptr));
+  rmw_reset_error();
+
+  // held back, then discarded as the next message fails to be published
+  publisher.topic_name = "/reordered";
+  uint8_t buffer[4] = {1u, 2u, 3u, 4u};
+  rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+  serialized_message.buffer = buffer;
+  serialized_message.buffer_length = sizeof(buffer);
+  serialized_message.buffer_capacity = sizeof(buffer);
+  EXPECT_EQ(RMW_RET_OK, rmw_publish_serialized_message(&publisher, &serialized_message, nullptr));
+  rmw_implementation_injection_stats_t stats = get_injection_stats();
+  EXPECT_EQ(1u, stats.reordered_count);
+  EXPECT_EQ(1u, stats.dropped_count);
+  EXPECT_NE(RMW_RET_OK, rmw_publish_serialized_message(&publisher, &serialized_message, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(2u, get_injection_stats().dropped_count);
+
+  // held back, then published on disable
+  EXPECT_EQ(RMW_RET_OK, rmw_publish_serialized_message(&publisher, &serialized_message, nullptr));
+  EXPECT_EQ(2u, get_injection_stats().reordered_count);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_disable());
+  EXPECT_FALSE(rmw_implementation_injection_is_enabled());
+  EXPECT_FALSE(rmw_error_is_set());
+  EXPECT_EQ(3u, get_injection_stats().dropped_count);
+  EXPECT_NE(RMW_RET_OK, rmw_publish_serialized_message(&publisher, &serialized_message, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(2u, get_injection_stats().reordered_count);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_reset_stats());
+  EXPECT_EQ(0u, get_injection_stats().dropped_count);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_clear());
+  unload_library();
+}
+
+TEST(Injection, set_while_enabled) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_reset_stats());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_enable(0u)) << rmw_get_error_string().str;
+
+  // injections looked up by earlier calls are looked up anew once set
+  rmw_publisher_t publisher{};
+  publisher.implementation_identifier = "not-an-rmw-implementation-identifier";
+  publisher.topic_name = "/test";
+  int ros_message = 0;
+  EXPECT_NE(RMW_RET_OK, rmw_publish(&publisher, &ros_message, nullptr));
+  rmw_reset_error();
+  rmw_implementation_injection_t injection = rmw_implementation_get_zero_initialized_injection();
+  injection.drop_probability = 1.0;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_set("/test", &injection));
+  EXPECT_EQ(RMW_RET_OK, rmw_publish(&publisher, &ros_message, nullptr));
+  EXPECT_EQ(1u, get_injection_stats().dropped_count);
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_clear());
+  EXPECT_NE(RMW_RET_OK, rmw_publish(&publisher, &ros_message, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(1u, get_injection_stats().dropped_count);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_disable());
+  unload_library();
+}
+
+TEST(Injection, disabled_on_unload) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_enable(0u)) << rmw_get_error_string().str;
+  unload_library();
+  EXPECT_FALSE(rmw_implementation_injection_is_enabled());
+}
+
+TEST(Injection, wait_latency) {
+  rmw_init_options_t init_options = rmw_get_zero_initialized_init_options();
+  rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+  ASSERT_STREQ("/", init_options.enclave);
+  rmw_context_t context = rmw_get_zero_initialized_context();
+  ret = rmw_init(&init_options, &context);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rmw_guard_condition_t * guard_condition = rmw_create_guard_condition(&context);
+  ASSERT_NE(nullptr, guard_condition) << rmw_get_error_string().str;
+  rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, 1u);
+  ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+
+  rmw_implementation_injection_t injection = rmw_implementation_get_zero_initialized_injection();
+  injection.latency_ns = 20000000u;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_set(nullptr, &injection));
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_reset_stats());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_enable(0u)) << rmw_get_error_string().str;
+
+  void * guard_conditions_storage[1] = {guard_condition->data};
+  rmw_guard_conditions_t guard_conditions;
+  guard_conditions.guard_condition_count = 1u;
+  guard_conditions.guard_conditions = guard_conditions_storage;
+  const rmw_time_t zero_timeout{0u, 0u};
+  // not delayed on timeout
+  EXPECT_EQ(
+    RMW_RET_TIMEOUT,
+    rmw_wait(nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set, &zero_timeout));
+  EXPECT_EQ(0u, get_injection_stats().delayed_count);
+
+  ASSERT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(guard_condition));
+  guard_conditions_storage[0] = guard_condition->data;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(
+    RMW_RET_OK,
+    rmw_wait(nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set, &zero_timeout));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  rmw_implementation_injection_stats_t stats = get_injection_stats();
+  EXPECT_EQ(1u, stats.delayed_count);
+  EXPECT_EQ(20000000u, stats.total_delay_ns);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_disable());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_clear());
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set)) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_guard_condition(guard_condition)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&init_options)) << rmw_get_error_string().str;
+  unload_library();
+}
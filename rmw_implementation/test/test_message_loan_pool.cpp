@@ -0,0 +1,249 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/testing/fault_injection.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/message_loan_pool.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+const rosidl_message_type_support_t *
+get_no_message_typesupport_handle(const rosidl_message_type_support_t *, const char *)
+{
+  return nullptr;
+}
+
+const rosidl_message_type_support_t unknown_type_support = {
+  "not_a_typesupport_identifier", nullptr, get_no_message_typesupport_handle};
+
+struct Message
+{
+  uint64_t data[4];
+};
+
+// Publisher no rmw implementation knows about, which cannot loan messages.
+// It is enough for the pool, as long as publishing with it is expected to fail.
+rmw_publisher_t
+get_unknown_publisher()
+{
+  rmw_publisher_t publisher{};
+  publisher.implementation_identifier = "not-an-rmw-implementation-identifier";
+  publisher.topic_name = "/test";
+  publisher.can_loan_messages = false;
+  return publisher;
+}
+
+}  // namespace
+
+TEST(MessageLoanPool, bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_publisher_t publisher = get_unknown_publisher();
+  rmw_implementation_message_loan_pool_t pool =
+    rmw_implementation_get_zero_initialized_message_loan_pool();
+
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_init(
+      nullptr, &publisher, &unknown_type_support, sizeof(Message), 0u, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_init(
+      &pool, nullptr, &unknown_type_support, sizeof(Message), 0u, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, nullptr, sizeof(Message), 0u, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, &unknown_type_support, 0u, 0u, &allocator));
+  rmw_reset_error();
+  rcutils_allocator_t invalid_allocator = rcutils_get_zero_initialized_allocator();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, &unknown_type_support, sizeof(Message), 0u, &invalid_allocator));
+  rmw_reset_error();
+
+  void * ros_message = nullptr;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_borrow(&pool, &ros_message));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_fini(&pool));
+  rmw_reset_error();
+
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, &unknown_type_support, sizeof(Message), 0u, &allocator)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, &unknown_type_support, sizeof(Message), 0u, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_borrow(nullptr, &ros_message));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_borrow(&pool, nullptr));
+  rmw_reset_error();
+  Message foreign_message{};
+  ros_message = &foreign_message;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_borrow(&pool, &ros_message));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_message_loan_pool_publish(&pool, nullptr, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_message_loan_pool_publish(&pool, &foreign_message, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_return(&pool, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_return(&pool, &foreign_message));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_message_loan_pool_fini(nullptr));
+  rmw_reset_error();
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_fini(&pool));
+  unload_library();
+}
+
+TEST(MessageLoanPool, borrow_and_return) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_publisher_t publisher = get_unknown_publisher();
+  rmw_implementation_message_loan_pool_t pool =
+    rmw_implementation_get_zero_initialized_message_loan_pool();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, &unknown_type_support, sizeof(Message), 2u, &allocator)) <<
+    rmw_get_error_string().str;
+  EXPECT_FALSE(pool.loans_messages);
+
+  // more messages than preallocated
+  std::vector<void *> ros_messages(3u, nullptr);
+  for (void *& ros_message : ros_messages) {
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_implementation_message_loan_pool_borrow(&pool, &ros_message)) <<
+      rmw_get_error_string().str;
+    ASSERT_NE(nullptr, ros_message);
+    // storage for a whole message
+    *static_cast<Message *>(ros_message) = Message{{1u, 2u, 3u, 4u}};
+  }
+  EXPECT_NE(ros_messages[0], ros_messages[1]);
+  EXPECT_NE(ros_messages[1], ros_messages[2]);
+
+  // messages are reused
+  void * ros_message = ros_messages.back();
+  ros_messages.pop_back();
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_return(&pool, ros_message));
+  void * reused_ros_message = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_message_loan_pool_borrow(&pool, &reused_ros_message));
+  EXPECT_EQ(ros_message, reused_ros_message);
+  ros_messages.push_back(reused_ros_message);
+
+  // messages that fail to be published are still borrowed
+  EXPECT_NE(
+    RMW_RET_OK, rmw_implementation_message_loan_pool_publish(&pool, reused_ros_message, nullptr));
+  rmw_reset_error();
+
+  // messages must all be returned first
+  EXPECT_EQ(RMW_RET_ERROR, rmw_implementation_message_loan_pool_fini(&pool));
+  rmw_reset_error();
+  for (void * ros_message : ros_messages) {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_return(&pool, ros_message));
+  }
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_fini(&pool));
+  EXPECT_EQ(nullptr, pool.impl);
+  unload_library();
+}
+
+TEST(MessageLoanPool, borrow_and_return_from_many_threads) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_publisher_t publisher = get_unknown_publisher();
+  rmw_implementation_message_loan_pool_t pool =
+    rmw_implementation_get_zero_initialized_message_loan_pool();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, &unknown_type_support, sizeof(Message), 1u, &allocator)) <<
+    rmw_get_error_string().str;
+
+  constexpr size_t thread_count = 8u;
+  constexpr size_t iterations = 1000u;
+  std::vector<std::thread> threads;
+  for (size_t i = 0u; i < thread_count; ++i) {
+    threads.emplace_back(
+      [&pool]() {
+        for (size_t j = 0u; j < iterations; ++j) {
+          void * ros_message = nullptr;
+          ASSERT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_borrow(&pool, &ros_message));
+          static_cast<Message *>(ros_message)->data[0] = j;
+          ASSERT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_return(&pool, ros_message));
+        }
+      });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_fini(&pool));
+  unload_library();
+}
+
+TEST(MessageLoanPool, init_and_borrow_with_internal_errors) {
+  RCUTILS_FAULT_INJECTION_TEST(
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    rmw_publisher_t publisher = get_unknown_publisher();
+    rmw_implementation_message_loan_pool_t pool =
+      rmw_implementation_get_zero_initialized_message_loan_pool();
+    rmw_ret_t ret = rmw_implementation_message_loan_pool_init(
+      &pool, &publisher, &unknown_type_support, sizeof(Message), 2u, &allocator);
+    if (RMW_RET_OK == ret) {
+      std::vector<void *> ros_messages;
+      for (size_t i = 0u; i < 3u; ++i) {
+        void * ros_message = nullptr;
+        ret = rmw_implementation_message_loan_pool_borrow(&pool, &ros_message);
+        if (RMW_RET_OK != ret) {
+          EXPECT_EQ(RMW_RET_BAD_ALLOC, ret);
+          rmw_reset_error();
+          break;
+        }
+        ros_messages.push_back(ros_message);
+      }
+      for (void * ros_message : ros_messages) {
+        EXPECT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_return(&pool, ros_message));
+      }
+      EXPECT_EQ(RMW_RET_OK, rmw_implementation_message_loan_pool_fini(&pool));
+    } else {
+      rmw_reset_error();
+    }
+    unload_library();
+  });
+}
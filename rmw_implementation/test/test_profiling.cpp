@@ -0,0 +1,167 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/profiling.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+rmw_implementation_function_profile_t
+get_profile(const char * function_name)
+{
+  std::vector<rmw_implementation_function_profile_t> profiles(
+    rmw_implementation_profile_count());
+  rmw_ret_t ret = rmw_implementation_profile_snapshot(profiles.data(), profiles.size());
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  for (const rmw_implementation_function_profile_t & profile : profiles) {
+    if (0 == strcmp(function_name, profile.function_name)) {
+      return profile;
+    }
+  }
+  ADD_FAILURE() << "no profile for " << function_name;
+  return rmw_implementation_function_profile_t();
+}
+
+uint64_t
+histogram_sum(const rmw_implementation_function_profile_t & profile)
+{
+  uint64_t sum = 0u;
+  for (uint64_t count : profile.duration_histogram) {
+    sum += count;
+  }
+  return sum;
+}
+
+}  // namespace
+
+TEST(Profiling, bad_arguments) {
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_profile_snapshot(nullptr, 0u));
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+
+  rmw_implementation_function_profile_t profile;
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_profile_snapshot(&profile, 1u));
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_profile_export(nullptr));
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+}
+
+TEST(Profiling, nominal_enable_and_disable) {
+  EXPECT_FALSE(rmw_implementation_profiling_is_enabled());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  EXPECT_TRUE(rmw_implementation_profiling_is_enabled());
+  EXPECT_TRUE(all_symbols_resolved());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable());
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE(nullptr, rmw_get_serialization_format());
+  }
+  rmw_implementation_function_profile_t profile = get_profile("rmw_get_serialization_format");
+  EXPECT_EQ(10u, profile.call_count);
+  EXPECT_EQ(10u, histogram_sum(profile));
+  EXPECT_EQ(0u, get_profile("rmw_get_implementation_identifier").call_count);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_FALSE(rmw_implementation_profiling_is_enabled());
+  EXPECT_NE(nullptr, rmw_get_serialization_format());
+  EXPECT_EQ(10u, get_profile("rmw_get_serialization_format").call_count);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+  EXPECT_EQ(0u, get_profile("rmw_get_serialization_format").call_count);
+
+  unload_library();
+}
+
+TEST(Profiling, unload_disables_profiling) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  unload_library();
+  EXPECT_FALSE(rmw_implementation_profiling_is_enabled());
+  EXPECT_FALSE(all_symbols_resolved());
+
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+  EXPECT_NE(nullptr, rmw_get_serialization_format());
+  EXPECT_EQ(0u, get_profile("rmw_get_serialization_format").call_count);
+
+  unload_library();
+}
+
+TEST(Profiling, calls_from_many_threads) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+
+  constexpr size_t thread_count = 8u;
+  constexpr size_t calls_per_thread = 100u;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back(
+      []() {
+        for (size_t j = 0; j < calls_per_thread; ++j) {
+          EXPECT_NE(nullptr, rmw_get_serialization_format());
+        }
+      });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  // counts of exited threads are kept
+  EXPECT_EQ(
+    thread_count * calls_per_thread, get_profile("rmw_get_serialization_format").call_count);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  unload_library();
+}
+
+TEST(Profiling, export_profiles) {
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  EXPECT_NE(nullptr, rmw_get_serialization_format());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+
+  FILE * stream = tmpfile();
+  ASSERT_NE(nullptr, stream);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_profile_export(stream));
+  rewind(stream);
+  std::string contents;
+  char buffer[256];
+  while (fgets(buffer, sizeof(buffer), stream)) {
+    contents += buffer;
+  }
+  fclose(stream);
+
+  EXPECT_EQ(0u, contents.find("function,call_count,total_duration_ns,histogram_0,"));
+  EXPECT_NE(std::string::npos, contents.find("\nrmw_get_serialization_format,1,"));
+  EXPECT_EQ(std::string::npos, contents.find("\nrmw_get_implementation_identifier,"));
+
+  unload_library();
+}
@@ -0,0 +1,226 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/testing/fault_injection.h"
+
+#include "rmw/error_handling.h"
+
+#include "rmw_implementation/serialized_message_pool.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+const rosidl_message_type_support_t *
+get_no_message_typesupport_handle(const rosidl_message_type_support_t *, const char *)
+{
+  return nullptr;
+}
+
+// Type support no rmw implementation knows about, which is enough for the
+// pool as it only asks for the serialized size of messages.
+const rosidl_message_type_support_t unknown_type_support = {
+  "not_a_typesupport_identifier", nullptr, get_no_message_typesupport_handle};
+
+constexpr size_t initial_capacity = 64u;
+
+}  // namespace
+
+TEST(SerializedMessagePool, bad_arguments) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_serialized_message_pool_t pool =
+    rmw_implementation_get_zero_initialized_serialized_message_pool();
+
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_init(
+      nullptr, &unknown_type_support, nullptr, initial_capacity, 0u, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_init(
+      &pool, nullptr, nullptr, initial_capacity, 0u, &allocator));
+  rmw_reset_error();
+  rcutils_allocator_t invalid_allocator = rcutils_get_zero_initialized_allocator();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_init(
+      &pool, &unknown_type_support, nullptr, initial_capacity, 0u, &invalid_allocator));
+  rmw_reset_error();
+
+  rmw_serialized_message_t * serialized_message = nullptr;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_serialized_message_pool_acquire(&pool, &serialized_message));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_fini(&pool));
+  rmw_reset_error();
+
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_serialized_message_pool_init(
+      &pool, &unknown_type_support, nullptr, initial_capacity, 0u, &allocator)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_init(
+      &pool, &unknown_type_support, nullptr, initial_capacity, 0u, &allocator));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_acquire(nullptr, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_acquire(&pool, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_release(&pool, nullptr));
+  rmw_reset_error();
+  rmw_serialized_message_t foreign_message = rmw_get_zero_initialized_serialized_message();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_implementation_serialized_message_pool_release(&pool, &foreign_message));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_serialized_message_pool_fini(nullptr));
+  rmw_reset_error();
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_serialized_message_pool_fini(&pool));
+  unload_library();
+}
+
+TEST(SerializedMessagePool, acquire_and_release) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_serialized_message_pool_t pool =
+    rmw_implementation_get_zero_initialized_serialized_message_pool();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_serialized_message_pool_init(
+      &pool, &unknown_type_support, nullptr, initial_capacity, 2u, &allocator)) <<
+    rmw_get_error_string().str;
+  // no rmw implementation can tell the serialized size of an unknown type
+  EXPECT_EQ(initial_capacity, pool.buffer_capacity);
+  EXPECT_FALSE(rmw_error_is_set());
+
+  // more serialized messages than created up front
+  std::vector<rmw_serialized_message_t *> serialized_messages(3u, nullptr);
+  for (rmw_serialized_message_t *& serialized_message : serialized_messages) {
+    ASSERT_EQ(
+      RMW_RET_OK, rmw_implementation_serialized_message_pool_acquire(&pool, &serialized_message)) <<
+      rmw_get_error_string().str;
+    ASSERT_NE(nullptr, serialized_message);
+    EXPECT_EQ(0u, serialized_message->buffer_length);
+    EXPECT_LE(initial_capacity, serialized_message->buffer_capacity);
+  }
+  EXPECT_NE(serialized_messages[0], serialized_messages[1]);
+  EXPECT_NE(serialized_messages[1], serialized_messages[2]);
+
+  // serialized messages keep their buffer but not their content
+  rmw_serialized_message_t * serialized_message = serialized_messages.back();
+  serialized_messages.pop_back();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_serialized_message_resize(serialized_message, 4u * initial_capacity));
+  serialized_message->buffer_length = 10u;
+  uint8_t * buffer = serialized_message->buffer;
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_serialized_message_pool_release(&pool, serialized_message));
+  rmw_serialized_message_t * reused_serialized_message = nullptr;
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_implementation_serialized_message_pool_acquire(&pool, &reused_serialized_message));
+  EXPECT_EQ(serialized_message, reused_serialized_message);
+  EXPECT_EQ(buffer, reused_serialized_message->buffer);
+  EXPECT_EQ(4u * initial_capacity, reused_serialized_message->buffer_capacity);
+  EXPECT_EQ(0u, reused_serialized_message->buffer_length);
+  serialized_messages.push_back(reused_serialized_message);
+
+  // serialized messages must all be released first
+  EXPECT_EQ(RMW_RET_ERROR, rmw_implementation_serialized_message_pool_fini(&pool));
+  rmw_reset_error();
+  for (rmw_serialized_message_t * serialized_message : serialized_messages) {
+    EXPECT_EQ(
+      RMW_RET_OK, rmw_implementation_serialized_message_pool_release(&pool, serialized_message));
+  }
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_serialized_message_pool_fini(&pool));
+  EXPECT_EQ(nullptr, pool.impl);
+  unload_library();
+}
+
+TEST(SerializedMessagePool, acquire_and_release_from_many_threads) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_serialized_message_pool_t pool =
+    rmw_implementation_get_zero_initialized_serialized_message_pool();
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_implementation_serialized_message_pool_init(
+      &pool, &unknown_type_support, nullptr, initial_capacity, 1u, &allocator)) <<
+    rmw_get_error_string().str;
+
+  constexpr size_t thread_count = 8u;
+  constexpr size_t iterations = 1000u;
+  std::vector<std::thread> threads;
+  for (size_t i = 0u; i < thread_count; ++i) {
+    threads.emplace_back(
+      [&pool]() {
+        for (size_t j = 0u; j < iterations; ++j) {
+          rmw_serialized_message_t * serialized_message = nullptr;
+          ASSERT_EQ(
+            RMW_RET_OK,
+            rmw_implementation_serialized_message_pool_acquire(&pool, &serialized_message));
+          serialized_message->buffer_length = 1u;
+          ASSERT_EQ(
+            RMW_RET_OK,
+            rmw_implementation_serialized_message_pool_release(&pool, serialized_message));
+        }
+      });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_serialized_message_pool_fini(&pool));
+  unload_library();
+}
+
+TEST(SerializedMessagePool, init_and_acquire_with_internal_errors) {
+  RCUTILS_FAULT_INJECTION_TEST(
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    rmw_implementation_serialized_message_pool_t pool =
+      rmw_implementation_get_zero_initialized_serialized_message_pool();
+    rmw_ret_t ret = rmw_implementation_serialized_message_pool_init(
+      &pool, &unknown_type_support, nullptr, initial_capacity, 2u, &allocator);
+    if (RMW_RET_OK == ret) {
+      std::vector<rmw_serialized_message_t *> serialized_messages;
+      for (size_t i = 0u; i < 3u; ++i) {
+        rmw_serialized_message_t * serialized_message = nullptr;
+        ret = rmw_implementation_serialized_message_pool_acquire(&pool, &serialized_message);
+        if (RMW_RET_OK != ret) {
+          EXPECT_EQ(RMW_RET_BAD_ALLOC, ret);
+          rmw_reset_error();
+          break;
+        }
+        serialized_messages.push_back(serialized_message);
+      }
+      for (rmw_serialized_message_t * serialized_message : serialized_messages) {
+        EXPECT_EQ(
+          RMW_RET_OK,
+          rmw_implementation_serialized_message_pool_release(&pool, serialized_message));
+      }
+      EXPECT_EQ(RMW_RET_OK, rmw_implementation_serialized_message_pool_fini(&pool));
+    } else {
+      rmw_reset_error();
+    }
+    unload_library();
+  });
+}
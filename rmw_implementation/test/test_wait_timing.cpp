@@ -0,0 +1,222 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/profiling.h"
+#include "rmw_implementation/wait_timing.h"
+
+#include "../src/functions.hpp"
+
+namespace
+{
+
+uint64_t
+histogram_sum(const uint64_t (& histogram)[RMW_IMPLEMENTATION_PROFILE_HISTOGRAM_SIZE])
+{
+  uint64_t sum = 0u;
+  for (uint64_t count : histogram) {
+    sum += count;
+  }
+  return sum;
+}
+
+rmw_implementation_wait_timing_t
+get_wait_timing()
+{
+  rmw_implementation_wait_timing_t timing;
+  rmw_ret_t ret = rmw_implementation_wait_timing_snapshot(&timing);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  return timing;
+}
+
+uint64_t
+get_call_count(const char * function_name)
+{
+  std::vector<rmw_implementation_function_profile_t> profiles(
+    rmw_implementation_profile_count());
+  rmw_ret_t ret = rmw_implementation_profile_snapshot(profiles.data(), profiles.size());
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  for (const rmw_implementation_function_profile_t & profile : profiles) {
+    if (0 == strcmp(function_name, profile.function_name)) {
+      return profile.call_count;
+    }
+  }
+  ADD_FAILURE() << "no profile for " << function_name;
+  return 0u;
+}
+
+}  // namespace
+
+TEST(WaitTiming, bad_arguments) {
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_implementation_wait_timing_snapshot(nullptr));
+  EXPECT_TRUE(rmw_error_is_set());
+  rmw_reset_error();
+}
+
+class WaitTimingUse : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    guard_condition = rmw_create_guard_condition(&context);
+    ASSERT_NE(nullptr, guard_condition) << rmw_get_error_string().str;
+    wait_set = rmw_create_wait_set(&context, 1u);
+    ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+
+    ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_reset());
+    ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_enable()) << rmw_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_disable());
+    rmw_ret_t ret;
+    if (nullptr != wait_set) {
+      ret = rmw_destroy_wait_set(wait_set);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    if (nullptr != guard_condition) {
+      ret = rmw_destroy_guard_condition(guard_condition);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_init_options_fini(&init_options);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    unload_library();
+  }
+
+  // Wait on the guard condition only.
+  rmw_ret_t wait(const rmw_time_t & timeout)
+  {
+    guard_conditions_storage[0] = guard_condition->data;
+    rmw_guard_conditions_t guard_conditions;
+    guard_conditions.guard_condition_count = 1u;
+    guard_conditions.guard_conditions = guard_conditions_storage;
+    return rmw_wait(nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set, &timeout);
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_guard_condition_t * guard_condition{nullptr};
+  rmw_wait_set_t * wait_set{nullptr};
+  void * guard_conditions_storage[1];
+};
+
+TEST_F(WaitTimingUse, nominal_enable_and_disable) {
+  EXPECT_TRUE(rmw_implementation_wait_timing_is_enabled());
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_enable());
+
+  const rmw_time_t zero_timeout{0u, 0u};
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  rmw_implementation_wait_timing_t timing = get_wait_timing();
+  EXPECT_EQ(1u, timing.wait_count);
+  EXPECT_EQ(1u, histogram_sum(timing.wait_duration_histogram));
+  EXPECT_EQ(0u, timing.wakeup_count);
+
+  // triggered before waiting, so not a wake-up
+  ASSERT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(guard_condition));
+  EXPECT_EQ(RMW_RET_OK, wait(zero_timeout));
+  timing = get_wait_timing();
+  EXPECT_EQ(2u, timing.wait_count);
+  EXPECT_EQ(0u, timing.wakeup_count);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_disable());
+  EXPECT_FALSE(rmw_implementation_wait_timing_is_enabled());
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  EXPECT_EQ(2u, get_wait_timing().wait_count);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_reset());
+  EXPECT_EQ(0u, get_wait_timing().wait_count);
+}
+
+TEST_F(WaitTimingUse, wakeup_latency) {
+  std::thread trigger_thread(
+    [this]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      EXPECT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(guard_condition));
+    });
+  const rmw_time_t timeout{1u, 0u};
+  EXPECT_EQ(RMW_RET_OK, wait(timeout));
+  trigger_thread.join();
+
+  rmw_implementation_wait_timing_t timing = get_wait_timing();
+  EXPECT_EQ(1u, timing.wait_count);
+  // the trigger may come before waiting does on a loaded machine, unseen then
+  EXPECT_GE(1u, timing.wakeup_count);
+  EXPECT_EQ(timing.wakeup_count, histogram_sum(timing.wakeup_latency_histogram));
+  // blocked until triggered, then woken up
+  EXPECT_LE(timing.total_wakeup_latency_ns, timing.total_wait_duration_ns);
+}
+
+TEST_F(WaitTimingUse, stacked_on_profiling) {
+  const rmw_time_t zero_timeout{0u, 0u};
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_disable());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profile_reset());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_enable()) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  EXPECT_EQ(1u, get_call_count("rmw_wait"));
+  EXPECT_EQ(1u, get_wait_timing().wait_count);
+
+  // profiling is disabled from under wait timing
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  EXPECT_EQ(1u, get_call_count("rmw_wait"));
+  EXPECT_EQ(2u, get_wait_timing().wait_count);
+
+  // then enabled again on top of it
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable()) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  EXPECT_EQ(2u, get_call_count("rmw_wait"));
+  EXPECT_EQ(3u, get_wait_timing().wait_count);
+
+  // enabling layers already installed leaves these where they are
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_enable());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_enable());
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  EXPECT_EQ(3u, get_call_count("rmw_wait"));
+  EXPECT_EQ(4u, get_wait_timing().wait_count);
+
+  // wait timing is disabled from under profiling
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_disable());
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  EXPECT_EQ(4u, get_call_count("rmw_wait"));
+  EXPECT_EQ(4u, get_wait_timing().wait_count);
+
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_profiling_disable());
+  EXPECT_EQ(RMW_RET_TIMEOUT, wait(zero_timeout));
+  EXPECT_EQ(4u, get_call_count("rmw_wait"));
+}
@@ -0,0 +1,246 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if defined(__linux__)
+#include <malloc.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+#include "./rmw_fixture.hpp"
+
+namespace
+{
+
+constexpr char footprint_namespace[] = "/benchmark_footprint";
+
+#if defined(__GLIBC__)
+constexpr bool heap_usage_available = true;
+#else
+constexpr bool heap_usage_available = false;
+#endif
+
+// Bytes of heap memory in use by the process, including chunks mapped on
+// their own, or zero where that cannot be told.
+int64_t
+heap_bytes_in_use()
+{
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+  const struct mallinfo2 info = mallinfo2();
+#else
+  const struct mallinfo info = mallinfo();
+#endif
+  return static_cast<int64_t>(info.uordblks) + static_cast<int64_t>(info.hblkhd);
+#else
+  return 0;
+#endif
+}
+
+// Memory footprint of creating N entities of a kind, then destroying them.
+// Besides the heap_allocations counter of the fixture, which counts the
+// allocations made creating the N entities of an iteration, the
+// heap_bytes_per_entity counter reports heap memory in use per entity created,
+// and the leaked_bytes_per_entity counter heap memory still in use per entity
+// after destroying them, on glibc.
+class FootprintTest : public RMWFixture
+{
+public:
+  FootprintTest()
+  : RMWFixture("benchmark_footprint_node", footprint_namespace)
+  {
+  }
+
+protected:
+  // Names of N entities, made up front for their allocations not to count.
+  static std::vector<std::string> names(const char * prefix, size_t count)
+  {
+    std::vector<std::string> entity_names;
+    for (size_t i = 0u; i < count; ++i) {
+      entity_names.push_back(std::string(prefix) + std::to_string(i));
+    }
+    return entity_names;
+  }
+
+  // Create N entities with `create(i)`, then destroy them with `destroy()`,
+  // in each iteration, after doing so once for lazy initialization not to count.
+  template<typename CreateT, typename DestroyT>
+  void measure_footprint(benchmark::State & st, size_t count, CreateT create, DestroyT destroy)
+  {
+    using EntityT = decltype(create(size_t{0u}));
+    std::vector<EntityT> entities;
+    entities.reserve(count);
+    auto create_entities = [&]() {
+        for (size_t i = 0u; i < count; ++i) {
+          EntityT entity = create(i);
+          if (nullptr == entity) {
+            skip_with_rmw_error(st);
+            return false;
+          }
+          entities.push_back(entity);
+        }
+        return true;
+      };
+    auto destroy_entities = [&]() {
+        bool destroyed = true;
+        for (EntityT entity : entities) {
+          if (RMW_RET_OK != destroy(entity) && destroyed) {
+            skip_with_rmw_error(st);
+            destroyed = false;
+          }
+        }
+        entities.clear();
+        return destroyed;
+      };
+    const bool created = create_entities();
+    if (!destroy_entities() || !created) {
+      return;
+    }
+
+    int64_t total_created_bytes = 0;
+    // Memory allocated by other threads meanwhile is freed eventually, whereas
+    // memory leaked on destroy is retained after every iteration.
+    int64_t min_retained_bytes = std::numeric_limits<int64_t>::max();
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      const int64_t bytes_before = heap_bytes_in_use();
+      if (!create_entities()) {
+        destroy_entities();
+        break;
+      }
+      set_are_allocation_measurements_active(false);
+      const int64_t bytes_created = heap_bytes_in_use();
+      const bool destroyed = destroy_entities();
+      const int64_t bytes_after = heap_bytes_in_use();
+      set_are_allocation_measurements_active(true);
+      if (!destroyed) {
+        break;
+      }
+      total_created_bytes += bytes_created - bytes_before;
+      min_retained_bytes = std::min(min_retained_bytes, bytes_after - bytes_before);
+    }
+
+    if (!heap_usage_available || st.error_occurred() || 0 == st.iterations()) {
+      return;
+    }
+    const double entity_count = static_cast<double>(count);
+    st.counters["heap_bytes_per_entity"] = static_cast<double>(total_created_bytes) /
+      (static_cast<double>(st.iterations()) * entity_count);
+    const int64_t leaked_bytes = std::max<int64_t>(min_retained_bytes, 0);
+    st.counters["leaked_bytes_per_entity"] = static_cast<double>(leaked_bytes) / entity_count;
+    if (leaked_bytes > 0) {
+      st.SetLabel(std::string(rmw_get_implementation_identifier()) + " (leaks on destroy)");
+    }
+  }
+};
+
+// N entities by their history depth, or wait set capacity, as benchmark arguments.
+void entity_sizes(benchmark::internal::Benchmark * b)
+{
+  for (int64_t count : {1, 8, 64}) {
+    for (int64_t depth : {1, 10, 100, 1000}) {
+      b->Args({count, depth});
+    }
+  }
+}
+
+}  // namespace
+
+BENCHMARK_DEFINE_F(FootprintTest, create_destroy_nodes)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  const std::vector<std::string> node_names = names("benchmark_footprint_node_", count);
+  measure_footprint(
+    st, count,
+    [&](size_t i) {
+      return rmw_create_node(&context, node_names[i].c_str(), footprint_namespace);
+    },
+    [](rmw_node_t * footprint_node) {
+      return rmw_destroy_node(footprint_node);
+    });
+}
+BENCHMARK_REGISTER_F(FootprintTest, create_destroy_nodes)
+->RangeMultiplier(8)->Range(1, 64)->Unit(benchmark::kMillisecond);
+
+// N publishers, each on a topic of its own, of a given history depth.
+BENCHMARK_DEFINE_F(FootprintTest, create_destroy_publishers)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  const std::vector<std::string> topic_names = names("/benchmark_footprint/topic_", count);
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = static_cast<size_t>(st.range(1));
+  rmw_publisher_options_t options = rmw_get_default_publisher_options();
+  measure_footprint(
+    st, count,
+    [&](size_t i) {
+      return rmw_create_publisher(
+        node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), topic_names[i].c_str(),
+        &qos_profile, &options);
+    },
+    [this](rmw_publisher_t * pub) {
+      return rmw_destroy_publisher(node, pub);
+    });
+}
+BENCHMARK_REGISTER_F(FootprintTest, create_destroy_publishers)
+->Apply(entity_sizes)->Unit(benchmark::kMillisecond);
+
+// N subscriptions, each on a topic of its own, of a given history depth.
+BENCHMARK_DEFINE_F(FootprintTest, create_destroy_subscriptions)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  const std::vector<std::string> topic_names = names("/benchmark_footprint/topic_", count);
+  rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+  qos_profile.depth = static_cast<size_t>(st.range(1));
+  rmw_subscription_options_t options = rmw_get_default_subscription_options();
+  measure_footprint(
+    st, count,
+    [&](size_t i) {
+      return rmw_create_subscription(
+        node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), topic_names[i].c_str(),
+        &qos_profile, &options);
+    },
+    [this](rmw_subscription_t * sub) {
+      return rmw_destroy_subscription(node, sub);
+    });
+}
+BENCHMARK_REGISTER_F(FootprintTest, create_destroy_subscriptions)
+->Apply(entity_sizes)->Unit(benchmark::kMillisecond);
+
+// N wait sets of a given capacity.
+BENCHMARK_DEFINE_F(FootprintTest, create_destroy_wait_sets)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  const size_t capacity = static_cast<size_t>(st.range(1));
+  measure_footprint(
+    st, count,
+    [&](size_t) {
+      return rmw_create_wait_set(&context, capacity);
+    },
+    [](rmw_wait_set_t * wait_set) {
+      return rmw_destroy_wait_set(wait_set);
+    });
+}
+BENCHMARK_REGISTER_F(FootprintTest, create_destroy_wait_sets)
+->Apply(entity_sizes)->Unit(benchmark::kMicrosecond);
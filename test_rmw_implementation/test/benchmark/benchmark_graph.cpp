@@ -0,0 +1,304 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/get_topic_endpoint_info.h"
+#include "rmw/get_topic_names_and_types.h"
+#include "rmw/names_and_types.h"
+#include "rmw/rmw.h"
+#include "rmw/topic_endpoint_info_array.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+#include "./rmw_fixture.hpp"
+
+namespace
+{
+
+// Discovery of larger graphs takes much longer than that of a single
+// endpoint, giving up only when it clearly does not converge.
+constexpr std::chrono::seconds discovery_timeout{60};
+constexpr std::chrono::milliseconds discovery_poll_period{1};
+
+constexpr char graph_namespace[] = "/benchmark_graph";
+
+// Graph of N nodes, each with a publisher and a subscription on each of M
+// topics, observed from another node in the same process.
+class GraphTest : public RMWFixture
+{
+public:
+  GraphTest()
+  : RMWFixture("benchmark_graph_observer", "/")
+  {
+  }
+
+protected:
+  void tear_down_entities() override
+  {
+    destroy_graph();
+  }
+
+  static std::string topic_name(size_t index)
+  {
+    return std::string(graph_namespace) + "/topic_" + std::to_string(index);
+  }
+
+  bool create_graph(benchmark::State & st, size_t node_count, size_t topic_count)
+  {
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+    rmw_publisher_options_t publisher_options = rmw_get_default_publisher_options();
+    rmw_subscription_options_t subscription_options = rmw_get_default_subscription_options();
+    for (size_t i = 0u; i < node_count; ++i) {
+      const std::string node_name = "benchmark_graph_node_" + std::to_string(i);
+      rmw_node_t * graph_node = rmw_create_node(&context, node_name.c_str(), graph_namespace);
+      if (nullptr == graph_node) {
+        skip_with_rmw_error(st);
+        return false;
+      }
+      graph_nodes.push_back(graph_node);
+      for (size_t j = 0u; j < topic_count; ++j) {
+        const std::string name = topic_name(j);
+        rmw_publisher_t * pub = rmw_create_publisher(
+          graph_node, ts, name.c_str(), &rmw_qos_profile_default, &publisher_options);
+        if (nullptr == pub) {
+          skip_with_rmw_error(st);
+          return false;
+        }
+        publishers.emplace_back(graph_node, pub);
+        rmw_subscription_t * sub = rmw_create_subscription(
+          graph_node, ts, name.c_str(), &rmw_qos_profile_default, &subscription_options);
+        if (nullptr == sub) {
+          skip_with_rmw_error(st);
+          return false;
+        }
+        subscriptions.emplace_back(graph_node, sub);
+      }
+    }
+    return true;
+  }
+
+  void destroy_graph()
+  {
+    for (const auto & entry : subscriptions) {
+      rmw_destroy_subscription(entry.first, entry.second);
+    }
+    subscriptions.clear();
+    for (const auto & entry : publishers) {
+      rmw_destroy_publisher(entry.first, entry.second);
+    }
+    publishers.clear();
+    for (rmw_node_t * graph_node : graph_nodes) {
+      rmw_destroy_node(graph_node);
+    }
+    graph_nodes.clear();
+  }
+
+  // Wait until the observer node sees the given number of graph nodes, and
+  // as many publishers and subscriptions on each of the given topics.
+  bool wait_for_discovery(benchmark::State & st, size_t node_count, size_t topic_count)
+  {
+    const auto start_time = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start_time < discovery_timeout) {
+      bool converged = false;
+      if (!check_discovery(st, node_count, topic_count, converged)) {
+        return false;
+      }
+      if (converged) {
+        return true;
+      }
+      std::this_thread::sleep_for(discovery_poll_period);
+    }
+    st.SkipWithError("graph discovery did not converge");
+    return false;
+  }
+
+  std::vector<rmw_node_t *> graph_nodes;
+  std::vector<std::pair<rmw_node_t *, rmw_publisher_t *>> publishers;
+  std::vector<std::pair<rmw_node_t *, rmw_subscription_t *>> subscriptions;
+
+private:
+  bool check_discovery(
+    benchmark::State & st, size_t node_count, size_t topic_count, bool & converged)
+  {
+    converged = false;
+    rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+    rcutils_string_array_t node_namespaces = rcutils_get_zero_initialized_string_array();
+    if (RMW_RET_OK != rmw_get_node_names(node, &node_names, &node_namespaces)) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    size_t discovered_node_count = 0u;
+    for (size_t i = 0u; i < node_namespaces.size; ++i) {
+      if (0 == strcmp(graph_namespace, node_namespaces.data[i])) {
+        ++discovered_node_count;
+      }
+    }
+    rcutils_string_array_fini(&node_names);
+    rcutils_string_array_fini(&node_namespaces);
+    if (node_count != discovered_node_count) {
+      return true;
+    }
+    for (size_t j = 0u; j < topic_count; ++j) {
+      const std::string name = topic_name(j);
+      size_t publisher_count = 0u;
+      size_t subscriber_count = 0u;
+      if (RMW_RET_OK != rmw_count_publishers(node, name.c_str(), &publisher_count) ||
+        RMW_RET_OK != rmw_count_subscribers(node, name.c_str(), &subscriber_count))
+      {
+        skip_with_rmw_error(st);
+        return false;
+      }
+      if (node_count != publisher_count || node_count != subscriber_count) {
+        return true;
+      }
+    }
+    converged = true;
+    return true;
+  }
+};
+
+// N nodes by M topics, as benchmark arguments.
+void graph_sizes(benchmark::internal::Benchmark * b)
+{
+  for (int64_t node_count : {1, 4, 16, 64}) {
+    for (int64_t topic_count : {1, 4, 16}) {
+      b->Args({node_count, topic_count});
+    }
+  }
+}
+
+}  // namespace
+
+// Time from creating N nodes with M publishers and M subscriptions each to
+// discovering all of them from another node.
+BENCHMARK_DEFINE_F(GraphTest, discovery_convergence)(benchmark::State & st)
+{
+  const size_t node_count = static_cast<size_t>(st.range(0));
+  const size_t topic_count = static_cast<size_t>(st.range(1));
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    const auto start_time = std::chrono::steady_clock::now();
+    if (!create_graph(st, node_count, topic_count) ||
+      !wait_for_discovery(st, node_count, topic_count))
+    {
+      break;
+    }
+    st.SetIterationTime(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+    destroy_graph();
+    // Start the next iteration from an empty graph
+    if (!wait_for_discovery(st, 0u, topic_count)) {
+      break;
+    }
+  }
+}
+BENCHMARK_REGISTER_F(GraphTest, discovery_convergence)
+->Apply(graph_sizes)->Iterations(3)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(GraphTest, get_node_names)(benchmark::State & st)
+{
+  const size_t node_count = static_cast<size_t>(st.range(0));
+  const size_t topic_count = static_cast<size_t>(st.range(1));
+  if (!create_graph(st, node_count, topic_count) ||
+    !wait_for_discovery(st, node_count, topic_count))
+  {
+    return;
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+    rcutils_string_array_t node_namespaces = rcutils_get_zero_initialized_string_array();
+    if (RMW_RET_OK != rmw_get_node_names(node, &node_names, &node_namespaces)) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    rcutils_string_array_fini(&node_names);
+    rcutils_string_array_fini(&node_namespaces);
+  }
+}
+BENCHMARK_REGISTER_F(GraphTest, get_node_names)
+->Apply(graph_sizes)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(GraphTest, get_topic_names_and_types)(benchmark::State & st)
+{
+  const size_t node_count = static_cast<size_t>(st.range(0));
+  const size_t topic_count = static_cast<size_t>(st.range(1));
+  if (!create_graph(st, node_count, topic_count) ||
+    !wait_for_discovery(st, node_count, topic_count))
+  {
+    return;
+  }
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    rmw_names_and_types_t topic_names_and_types = rmw_get_zero_initialized_names_and_types();
+    if (RMW_RET_OK != rmw_get_topic_names_and_types(
+        node, &allocator, false, &topic_names_and_types))
+    {
+      skip_with_rmw_error(st);
+      break;
+    }
+    rmw_names_and_types_fini(&topic_names_and_types);
+  }
+}
+BENCHMARK_REGISTER_F(GraphTest, get_topic_names_and_types)
+->Apply(graph_sizes)->Unit(benchmark::kMicrosecond);
+
+// Query the N publishers on one of M topics.
+BENCHMARK_DEFINE_F(GraphTest, get_publishers_info_by_topic)(benchmark::State & st)
+{
+  const size_t node_count = static_cast<size_t>(st.range(0));
+  const size_t topic_count = static_cast<size_t>(st.range(1));
+  if (!create_graph(st, node_count, topic_count) ||
+    !wait_for_discovery(st, node_count, topic_count))
+  {
+    return;
+  }
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  const std::string name = topic_name(topic_count / 2u);
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    rmw_topic_endpoint_info_array_t publishers_info =
+      rmw_get_zero_initialized_topic_endpoint_info_array();
+    if (RMW_RET_OK != rmw_get_publishers_info_by_topic(
+        node, &allocator, name.c_str(), false, &publishers_info))
+    {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (node_count != publishers_info.size) {
+      st.SkipWithError("unexpected number of publishers");
+      rmw_topic_endpoint_info_array_fini(&publishers_info, &allocator);
+      break;
+    }
+    rmw_topic_endpoint_info_array_fini(&publishers_info, &allocator);
+  }
+}
+BENCHMARK_REGISTER_F(GraphTest, get_publishers_info_by_topic)
+->Apply(graph_sizes)->Unit(benchmark::kMicrosecond);
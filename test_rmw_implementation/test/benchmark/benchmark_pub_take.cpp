@@ -0,0 +1,373 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <string>
+
+#include "rcutils/allocator.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/graph_wait.h"
+
+#include "rosidl_runtime_c/string_functions.h"
+
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/msg/strings.h"
+
+#include "../config.hpp"
+#include "./rmw_fixture.hpp"
+
+namespace
+{
+
+constexpr rmw_time_t wait_timeout{1, 0};
+
+class PublishTakeTest : public RMWFixture
+{
+public:
+  PublishTakeTest()
+  : RMWFixture("benchmark_pub_take_node", "/benchmark_ns")
+  {
+  }
+
+protected:
+  bool set_up_entities(benchmark::State & st) override
+  {
+    wait_set = rmw_create_wait_set(&context, 1u);
+    if (nullptr == wait_set) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  void tear_down_entities() override
+  {
+    if (nullptr != pub) {
+      rmw_destroy_publisher(node, pub);
+      pub = nullptr;
+    }
+    if (nullptr != sub) {
+      rmw_destroy_subscription(node, sub);
+      sub = nullptr;
+    }
+    if (nullptr != wait_set) {
+      rmw_destroy_wait_set(wait_set);
+      wait_set = nullptr;
+    }
+  }
+
+  // Create a publisher and a subscription of the given type and wait for
+  // these to match, so that nothing published in the benchmark is lost.
+  bool create_pub_sub(
+    benchmark::State & st, const rosidl_message_type_support_t * ts, size_t depth = 1u)
+  {
+    if (st.error_occurred()) {
+      return false;
+    }
+    rmw_qos_profile_t qos_profile = rmw_qos_profile_default;
+    qos_profile.history = RMW_QOS_POLICY_HISTORY_KEEP_LAST;
+    qos_profile.depth = depth;
+    qos_profile.reliability = RMW_QOS_POLICY_RELIABILITY_RELIABLE;
+    rmw_subscription_options_t subscription_options = rmw_get_default_subscription_options();
+    sub = rmw_create_subscription(node, ts, topic_name, &qos_profile, &subscription_options);
+    if (nullptr == sub) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    rmw_publisher_options_t publisher_options = rmw_get_default_publisher_options();
+    pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &publisher_options);
+    if (nullptr == pub) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+
+    rmw_ret_t ret = rmw_implementation_wait_for_matched_subscriptions(
+      node, pub, 1u, &rmw_intraprocess_discovery_timeout);
+    if (RMW_RET_OK == ret) {
+      ret = rmw_implementation_wait_for_matched_publishers(
+        node, sub, 1u, &rmw_intraprocess_discovery_timeout);
+    }
+    if (RMW_RET_TIMEOUT == ret) {
+      st.SkipWithError("publisher and subscription did not match");
+      return false;
+    }
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  // Wait for the subscription to have data.
+  bool wait_for_data(benchmark::State & st)
+  {
+    void * subscribers[1] = {sub->data};
+    rmw_subscriptions_t subscriptions{1u, subscribers};
+    rmw_ret_t ret = rmw_wait(
+      &subscriptions, nullptr, nullptr, nullptr, nullptr, wait_set, &wait_timeout);
+    if (RMW_RET_TIMEOUT == ret) {
+      st.SkipWithError("timed out waiting for data");
+      rmw_reset_error();
+      return false;
+    }
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  rmw_wait_set_t * wait_set{nullptr};
+  rmw_publisher_t * pub{nullptr};
+  rmw_subscription_t * sub{nullptr};
+  const char * const topic_name = "/benchmark_pub_take";
+};
+
+}  // namespace
+
+// Latency of a message going through rmw_publish(), rmw_wait() and rmw_take().
+BENCHMARK_F(PublishTakeTest, publish_wait_take)(benchmark::State & st)
+{
+  if (!create_pub_sub(st, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes))) {
+    return;
+  }
+  test_msgs__msg__BasicTypes input_message{};
+  test_msgs__msg__BasicTypes output_message{};
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    ++input_message.int64_value;
+    rmw_ret_t ret = rmw_publish(pub, &input_message, nullptr);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!wait_for_data(st)) {
+      break;
+    }
+    bool taken = false;
+    ret = rmw_take(sub, &output_message, &taken, nullptr);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!taken) {
+      st.SkipWithError("no message taken after waiting for data");
+      break;
+    }
+  }
+  st.SetItemsProcessed(st.iterations());
+}
+
+// Same as publish_wait_take, but loaning messages from the rmw implementation.
+BENCHMARK_F(PublishTakeTest, loaned_publish_wait_take)(benchmark::State & st)
+{
+  if (!create_pub_sub(st, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes))) {
+    return;
+  }
+  if (!pub->can_loan_messages || !sub->can_loan_messages) {
+    st.SkipWithError("rmw implementation cannot loan messages");
+    return;
+  }
+  int64_t value = 0;
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    void * input_message = nullptr;
+    rmw_ret_t ret = rmw_borrow_loaned_message(
+      pub, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), &input_message);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    static_cast<test_msgs__msg__BasicTypes *>(input_message)->int64_value = ++value;
+    ret = rmw_publish_loaned_message(pub, input_message, nullptr);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!wait_for_data(st)) {
+      break;
+    }
+    void * output_message = nullptr;
+    bool taken = false;
+    ret = rmw_take_loaned_message(sub, &output_message, &taken, nullptr);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!taken) {
+      st.SkipWithError("no message taken after waiting for data");
+      break;
+    }
+    ret = rmw_return_loaned_message_from_subscription(sub, output_message);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+  }
+  st.SetItemsProcessed(st.iterations());
+}
+
+// Throughput of publish_wait_take for increasing message sizes.
+BENCHMARK_DEFINE_F(PublishTakeTest, publish_wait_take_by_size)(benchmark::State & st)
+{
+  if (!create_pub_sub(st, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings))) {
+    return;
+  }
+  const size_t size = static_cast<size_t>(st.range(0));
+  const std::string payload(size, 'x');
+  test_msgs__msg__Strings input_message;
+  test_msgs__msg__Strings output_message;
+  if (!test_msgs__msg__Strings__init(&input_message)) {
+    st.SkipWithError("failed to initialize message");
+    return;
+  }
+  if (!test_msgs__msg__Strings__init(&output_message)) {
+    test_msgs__msg__Strings__fini(&input_message);
+    st.SkipWithError("failed to initialize message");
+    return;
+  }
+  if (!rosidl_runtime_c__String__assignn(&input_message.string_value, payload.data(), size)) {
+    st.SkipWithError("failed to fill message");
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    rmw_ret_t ret = rmw_publish(pub, &input_message, nullptr);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!wait_for_data(st)) {
+      break;
+    }
+    bool taken = false;
+    ret = rmw_take(sub, &output_message, &taken, nullptr);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!taken) {
+      st.SkipWithError("no message taken after waiting for data");
+      break;
+    }
+  }
+  st.SetItemsProcessed(st.iterations());
+  st.SetBytesProcessed(st.iterations() * static_cast<int64_t>(size));
+
+  test_msgs__msg__Strings__fini(&output_message);
+  test_msgs__msg__Strings__fini(&input_message);
+}
+BENCHMARK_REGISTER_F(PublishTakeTest, publish_wait_take_by_size)
+->RangeMultiplier(16)->Range(16, 1 << 20);
+
+// Taking a batch of messages one by one with rmw_take().
+BENCHMARK_DEFINE_F(PublishTakeTest, publish_batch_take)(benchmark::State & st)
+{
+  const size_t batch_size = static_cast<size_t>(st.range(0));
+  if (!create_pub_sub(st, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), batch_size)) {
+    return;
+  }
+  test_msgs__msg__BasicTypes input_message{};
+  test_msgs__msg__BasicTypes output_message{};
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    for (size_t i = 0u; i < batch_size; ++i) {
+      ++input_message.int64_value;
+      if (RMW_RET_OK != rmw_publish(pub, &input_message, nullptr)) {
+        skip_with_rmw_error(st);
+        break;
+      }
+    }
+    size_t total_taken = 0u;
+    while (!st.error_occurred() && total_taken < batch_size && wait_for_data(st)) {
+      bool taken = true;
+      while (taken && total_taken < batch_size) {
+        if (RMW_RET_OK != rmw_take(sub, &output_message, &taken, nullptr)) {
+          skip_with_rmw_error(st);
+          break;
+        }
+        total_taken += taken ? 1u : 0u;
+      }
+    }
+    if (st.error_occurred()) {
+      break;
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(batch_size));
+}
+BENCHMARK_REGISTER_F(PublishTakeTest, publish_batch_take)->Arg(1)->Arg(10)->Arg(100);
+
+// Same as publish_batch_take, but taking with rmw_take_sequence().
+BENCHMARK_DEFINE_F(PublishTakeTest, publish_batch_take_sequence)(benchmark::State & st)
+{
+  const size_t batch_size = static_cast<size_t>(st.range(0));
+  if (!create_pub_sub(st, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), batch_size)) {
+    return;
+  }
+  test_msgs__msg__BasicTypes input_message{};
+  test_msgs__msg__BasicTypes__Sequence * output_messages =
+    test_msgs__msg__BasicTypes__Sequence__create(batch_size);
+  if (nullptr == output_messages) {
+    st.SkipWithError("failed to create messages");
+    return;
+  }
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_message_sequence_t sequence = rmw_get_zero_initialized_message_sequence();
+  rmw_message_info_sequence_t info_sequence = rmw_get_zero_initialized_message_info_sequence();
+  if (RMW_RET_OK != rmw_message_sequence_init(&sequence, batch_size, &allocator) ||
+    RMW_RET_OK != rmw_message_info_sequence_init(&info_sequence, batch_size, &allocator))
+  {
+    skip_with_rmw_error(st);
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    for (size_t i = 0u; i < batch_size; ++i) {
+      ++input_message.int64_value;
+      if (RMW_RET_OK != rmw_publish(pub, &input_message, nullptr)) {
+        skip_with_rmw_error(st);
+        break;
+      }
+    }
+    size_t total_taken = 0u;
+    while (!st.error_occurred() && total_taken < batch_size && wait_for_data(st)) {
+      for (size_t i = 0u; i < batch_size - total_taken; ++i) {
+        sequence.data[i] = &output_messages->data[i];
+      }
+      size_t taken = 0u;
+      if (RMW_RET_OK != rmw_take_sequence(
+          sub, batch_size - total_taken, &sequence, &info_sequence, &taken, nullptr))
+      {
+        skip_with_rmw_error(st);
+        break;
+      }
+      total_taken += taken;
+    }
+    if (st.error_occurred()) {
+      break;
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(batch_size));
+
+  rmw_message_info_sequence_fini(&info_sequence);
+  rmw_message_sequence_fini(&sequence);
+  test_msgs__msg__BasicTypes__Sequence__destroy(output_messages);
+}
+BENCHMARK_REGISTER_F(PublishTakeTest, publish_batch_take_sequence)->Arg(1)->Arg(10)->Arg(100);
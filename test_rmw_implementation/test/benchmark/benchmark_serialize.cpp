@@ -0,0 +1,237 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rcutils/allocator.h"
+
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/msg/unbounded_sequences.h"
+#include "test_msgs/msg/unbounded_sequences.hpp"
+
+#include "./rmw_fixture.hpp"
+
+using performance_test_fixture::PerformanceTest;
+
+namespace
+{
+
+// Messages carrying a payload of st.range(0) bytes, for both C and C++ type supports.
+class SerializeTest : public PerformanceTest
+{
+public:
+  void SetUp(benchmark::State & st) override
+  {
+    payload_size = static_cast<size_t>(st.range(0));
+    if (!test_msgs__msg__UnboundedSequences__init(&c_message)) {
+      st.SkipWithError("failed to initialize message");
+    } else if (!test_msgs__msg__UnboundedSequences__init(&c_output_message)) {
+      test_msgs__msg__UnboundedSequences__fini(&c_message);
+      st.SkipWithError("failed to initialize message");
+    } else {
+      c_messages_initialized = true;
+      rosidl_runtime_c__uint8__Sequence__fini(&c_message.uint8_values);
+      if (!rosidl_runtime_c__uint8__Sequence__init(&c_message.uint8_values, payload_size)) {
+        st.SkipWithError("failed to fill message");
+      }
+    }
+    cpp_message.uint8_values.resize(payload_size);
+    st.SetLabel(rmw_get_implementation_identifier());
+    PerformanceTest::SetUp(st);
+  }
+
+  void TearDown(benchmark::State & st) override
+  {
+    PerformanceTest::TearDown(st);
+    if (c_messages_initialized) {
+      test_msgs__msg__UnboundedSequences__fini(&c_output_message);
+      test_msgs__msg__UnboundedSequences__fini(&c_message);
+      c_messages_initialized = false;
+    }
+  }
+
+protected:
+  // Serialize into the same serialized message on every iteration, which
+  // only allocates while it grows.
+  void serialize_reusing_buffer(
+    benchmark::State & st, const void * message, const rosidl_message_type_support_t * ts)
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+    if (RMW_RET_OK != rmw_serialized_message_init(&serialized_message, 0u, &allocator)) {
+      skip_with_rmw_error(st);
+      return;
+    }
+    // also loads the rmw implementation
+    if (RMW_RET_OK != rmw_serialize(message, ts, &serialized_message)) {
+      skip_with_rmw_error(st);
+    }
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      if (RMW_RET_OK != rmw_serialize(message, ts, &serialized_message)) {
+        skip_with_rmw_error(st);
+        break;
+      }
+    }
+    st.SetBytesProcessed(st.iterations() * static_cast<int64_t>(payload_size));
+
+    rmw_serialized_message_fini(&serialized_message);
+  }
+
+  // Serialize into a new serialized message on every iteration.
+  void serialize_into_new_buffer(
+    benchmark::State & st, const void * message, const rosidl_message_type_support_t * ts)
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    // loads the rmw implementation
+    rmw_get_serialization_format();
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+      if (RMW_RET_OK != rmw_serialized_message_init(&serialized_message, 0u, &allocator)) {
+        skip_with_rmw_error(st);
+        break;
+      }
+      rmw_ret_t ret = rmw_serialize(message, ts, &serialized_message);
+      if (RMW_RET_OK != rmw_serialized_message_fini(&serialized_message) || RMW_RET_OK != ret) {
+        skip_with_rmw_error(st);
+        break;
+      }
+    }
+    st.SetBytesProcessed(st.iterations() * static_cast<int64_t>(payload_size));
+  }
+
+  // Deserialize into the same message on every iteration.
+  void deserialize(
+    benchmark::State & st, const void * message, void * output_message,
+    const rosidl_message_type_support_t * ts)
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+    if (RMW_RET_OK != rmw_serialized_message_init(&serialized_message, 0u, &allocator)) {
+      skip_with_rmw_error(st);
+      return;
+    }
+    if (RMW_RET_OK != rmw_serialize(message, ts, &serialized_message) ||
+      RMW_RET_OK != rmw_deserialize(&serialized_message, ts, output_message))
+    {
+      skip_with_rmw_error(st);
+    }
+    reset_heap_counters();
+
+    for (auto _ : st) {
+      if (RMW_RET_OK != rmw_deserialize(&serialized_message, ts, output_message)) {
+        skip_with_rmw_error(st);
+        break;
+      }
+    }
+    st.SetBytesProcessed(st.iterations() * static_cast<int64_t>(payload_size));
+
+    rmw_serialized_message_fini(&serialized_message);
+  }
+
+  const rosidl_message_type_support_t * c_ts{
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences)};
+  const rosidl_message_type_support_t * cpp_ts{
+    rosidl_typesupport_cpp::get_message_type_support_handle<test_msgs::msg::UnboundedSequences>()};
+  size_t payload_size{0u};
+  bool c_messages_initialized{false};
+  test_msgs__msg__UnboundedSequences c_message{};
+  test_msgs__msg__UnboundedSequences c_output_message{};
+  test_msgs::msg::UnboundedSequences cpp_message;
+  test_msgs::msg::UnboundedSequences cpp_output_message;
+};
+
+}  // namespace
+
+BENCHMARK_DEFINE_F(SerializeTest, serialize_c_reusing_buffer)(benchmark::State & st)
+{
+  serialize_reusing_buffer(st, &c_message, c_ts);
+}
+BENCHMARK_REGISTER_F(SerializeTest, serialize_c_reusing_buffer)
+->RangeMultiplier(16)->Range(1, 16 << 20);
+
+BENCHMARK_DEFINE_F(SerializeTest, serialize_c_into_new_buffer)(benchmark::State & st)
+{
+  serialize_into_new_buffer(st, &c_message, c_ts);
+}
+BENCHMARK_REGISTER_F(SerializeTest, serialize_c_into_new_buffer)
+->RangeMultiplier(16)->Range(1, 16 << 20);
+
+BENCHMARK_DEFINE_F(SerializeTest, deserialize_c)(benchmark::State & st)
+{
+  deserialize(st, &c_message, &c_output_message, c_ts);
+}
+BENCHMARK_REGISTER_F(SerializeTest, deserialize_c)
+->RangeMultiplier(16)->Range(1, 16 << 20);
+
+BENCHMARK_DEFINE_F(SerializeTest, serialize_cpp_reusing_buffer)(benchmark::State & st)
+{
+  serialize_reusing_buffer(st, &cpp_message, cpp_ts);
+}
+BENCHMARK_REGISTER_F(SerializeTest, serialize_cpp_reusing_buffer)
+->RangeMultiplier(16)->Range(1, 16 << 20);
+
+BENCHMARK_DEFINE_F(SerializeTest, serialize_cpp_into_new_buffer)(benchmark::State & st)
+{
+  serialize_into_new_buffer(st, &cpp_message, cpp_ts);
+}
+BENCHMARK_REGISTER_F(SerializeTest, serialize_cpp_into_new_buffer)
+->RangeMultiplier(16)->Range(1, 16 << 20);
+
+BENCHMARK_DEFINE_F(SerializeTest, deserialize_cpp)(benchmark::State & st)
+{
+  deserialize(st, &cpp_message, &cpp_output_message, cpp_ts);
+}
+BENCHMARK_REGISTER_F(SerializeTest, deserialize_cpp)
+->RangeMultiplier(16)->Range(1, 16 << 20);
+
+BENCHMARK_F(PerformanceTest, get_serialized_message_size)(benchmark::State & st)
+{
+  const rosidl_message_type_support_t * ts{
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes)};
+  size_t size = 0u;
+  rmw_ret_t ret = rmw_get_serialized_message_size(ts, nullptr, &size);
+  if (RMW_RET_UNSUPPORTED == ret) {
+    st.SkipWithError("rmw_get_serialized_message_size is not supported");
+    rmw_reset_error();
+    return;
+  }
+  if (RMW_RET_OK != ret) {
+    st.SkipWithError(rmw_get_error_string().str);
+    rmw_reset_error();
+    return;
+  }
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    ret = rmw_get_serialized_message_size(ts, nullptr, &size);
+    if (RMW_RET_OK != ret) {
+      st.SkipWithError(rmw_get_error_string().str);
+      rmw_reset_error();
+      break;
+    }
+    benchmark::DoNotOptimize(size);
+  }
+}
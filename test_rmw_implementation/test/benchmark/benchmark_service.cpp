@@ -0,0 +1,381 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "test_msgs/srv/basic_types.h"
+
+#include "../config.hpp"
+#include "./rmw_fixture.hpp"
+
+namespace
+{
+
+constexpr rmw_time_t wait_timeout{1, 0};
+constexpr std::chrono::milliseconds availability_poll_period{1};
+
+// Report the 50th, 99th and 99.9th percentiles of latency samples, in
+// nanoseconds, as p50_ns, p99_ns and p999_ns counters.
+void set_latency_counters(benchmark::State & st, std::vector<std::chrono::nanoseconds> & samples)
+{
+  if (samples.empty()) {
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto percentile = [&samples](double fraction) {
+      const size_t index = std::min(
+        static_cast<size_t>(fraction * static_cast<double>(samples.size())),
+        samples.size() - 1u);
+      return benchmark::Counter(static_cast<double>(samples[index].count()));
+    };
+  st.counters["p50_ns"] = percentile(0.5);
+  st.counters["p99_ns"] = percentile(0.99);
+  st.counters["p999_ns"] = percentile(0.999);
+}
+
+class ServiceTest : public RMWFixture
+{
+public:
+  ServiceTest()
+  : RMWFixture("benchmark_service_node", "/benchmark_ns")
+  {
+  }
+
+protected:
+  bool set_up_entities(benchmark::State & st) override
+  {
+    stop_guard_condition = rmw_create_guard_condition(&context);
+    if (nullptr == stop_guard_condition) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    server_wait_set = rmw_create_wait_set(&context, 2u);
+    if (nullptr == server_wait_set) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  void tear_down_entities() override
+  {
+    stop_server();
+    if (nullptr != client_wait_set) {
+      rmw_destroy_wait_set(client_wait_set);
+      client_wait_set = nullptr;
+    }
+    for (rmw_client_t * client : clients) {
+      rmw_destroy_client(node, client);
+    }
+    clients.clear();
+    if (nullptr != srv) {
+      rmw_destroy_service(node, srv);
+      srv = nullptr;
+    }
+    if (nullptr != server_wait_set) {
+      rmw_destroy_wait_set(server_wait_set);
+      server_wait_set = nullptr;
+    }
+    if (nullptr != stop_guard_condition) {
+      rmw_destroy_guard_condition(stop_guard_condition);
+      stop_guard_condition = nullptr;
+    }
+  }
+
+  bool create_service(benchmark::State & st)
+  {
+    srv = rmw_create_service(node, ts, service_name, &rmw_qos_profile_services_default);
+    if (nullptr == srv) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  bool create_clients(benchmark::State & st, size_t count)
+  {
+    for (size_t i = 0u; i < count; ++i) {
+      rmw_client_t * client =
+        rmw_create_client(node, ts, service_name, &rmw_qos_profile_services_default);
+      if (nullptr == client) {
+        skip_with_rmw_error(st);
+        return false;
+      }
+      clients.push_back(client);
+    }
+    client_wait_set = rmw_create_wait_set(&context, count);
+    if (nullptr == client_wait_set) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    clients_storage.resize(count);
+    return true;
+  }
+
+  // Wait for the server to be available to a client, returning how long it took.
+  bool wait_for_server(
+    benchmark::State & st, const rmw_client_t * client, std::chrono::nanoseconds & delay)
+  {
+    const auto start_time = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start_time < rmw_intraprocess_discovery_delay * 10) {
+      bool is_available = false;
+      if (RMW_RET_OK != rmw_service_server_is_available(node, client, &is_available)) {
+        skip_with_rmw_error(st);
+        return false;
+      }
+      if (is_available) {
+        delay = std::chrono::steady_clock::now() - start_time;
+        return true;
+      }
+      std::this_thread::sleep_for(availability_poll_period);
+    }
+    st.SkipWithError("service server did not become available");
+    return false;
+  }
+
+  bool wait_for_server(benchmark::State & st, const rmw_client_t * client)
+  {
+    std::chrono::nanoseconds delay;
+    return wait_for_server(st, client, delay);
+  }
+
+  // Serve requests from another thread, as a service server process would.
+  void start_server()
+  {
+    stop_requested = false;
+    server_ret = RMW_RET_OK;
+    server_thread = std::thread([this]() {serve();});
+  }
+
+  void stop_server()
+  {
+    if (!server_thread.joinable()) {
+      return;
+    }
+    stop_requested = true;
+    rmw_trigger_guard_condition(stop_guard_condition);
+    server_thread.join();
+  }
+
+  // Wait for responses to all clients, recording round-trip latencies since
+  // the given request times.
+  bool take_responses(
+    benchmark::State & st,
+    const std::vector<std::chrono::steady_clock::time_point> & request_times,
+    std::vector<std::chrono::nanoseconds> & latencies)
+  {
+    std::vector<bool> & pending = pending_responses;
+    pending.assign(clients.size(), true);
+    size_t pending_count = clients.size();
+    test_msgs__srv__BasicTypes_Response response{};
+    while (0u != pending_count) {
+      size_t waited_count = 0u;
+      for (size_t i = 0u; i < clients.size(); ++i) {
+        if (pending[i]) {
+          clients_storage[waited_count++] = clients[i]->data;
+        }
+      }
+      rmw_clients_t clients_argument{waited_count, clients_storage.data()};
+      rmw_ret_t ret = rmw_wait(
+        nullptr, nullptr, nullptr, &clients_argument, nullptr, client_wait_set, &wait_timeout);
+      if (RMW_RET_TIMEOUT == ret) {
+        st.SkipWithError("timed out waiting for responses");
+        rmw_reset_error();
+        return false;
+      }
+      if (RMW_RET_OK != ret) {
+        skip_with_rmw_error(st);
+        return false;
+      }
+      for (size_t i = 0u; i < clients.size(); ++i) {
+        if (!pending[i]) {
+          continue;
+        }
+        rmw_service_info_t info;
+        bool taken = false;
+        if (RMW_RET_OK != rmw_take_response(clients[i], &info, &response, &taken)) {
+          skip_with_rmw_error(st);
+          return false;
+        }
+        if (taken) {
+          latencies.push_back(std::chrono::steady_clock::now() - request_times[i]);
+          pending[i] = false;
+          --pending_count;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool check_server(benchmark::State & st)
+  {
+    if (RMW_RET_OK != server_ret) {
+      st.SkipWithError(server_error.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  rmw_service_t * srv{nullptr};
+  std::vector<rmw_client_t *> clients;
+  rmw_wait_set_t * client_wait_set{nullptr};
+  std::vector<void *> clients_storage;
+  std::vector<bool> pending_responses;
+  const rosidl_service_type_support_t * ts{
+    ROSIDL_GET_SRV_TYPE_SUPPORT(test_msgs, srv, BasicTypes)};
+  const char * const service_name = "/benchmark_service";
+
+private:
+  void serve()
+  {
+    test_msgs__srv__BasicTypes_Request request{};
+    test_msgs__srv__BasicTypes_Response response{};
+    while (!stop_requested) {
+      void * services_storage[1] = {srv->data};
+      void * guard_conditions_storage[1] = {stop_guard_condition->data};
+      rmw_services_t services_argument{1u, services_storage};
+      rmw_guard_conditions_t guard_conditions_argument{1u, guard_conditions_storage};
+      rmw_ret_t ret = rmw_wait(
+        nullptr, &guard_conditions_argument, &services_argument, nullptr, nullptr,
+        server_wait_set, &wait_timeout);
+      if (RMW_RET_TIMEOUT == ret) {
+        continue;
+      }
+      bool taken = RMW_RET_OK == ret;
+      while (RMW_RET_OK == ret && taken) {
+        rmw_service_info_t info;
+        ret = rmw_take_request(srv, &info, &request, &taken);
+        if (RMW_RET_OK == ret && taken) {
+          response.int64_value = request.int64_value;
+          ret = rmw_send_response(srv, &info.request_id, &response);
+        }
+      }
+      if (RMW_RET_OK != ret) {
+        // Errors are thread local, keep it for the benchmark thread
+        server_error = rmw_get_error_string().str;
+        rmw_reset_error();
+        server_ret = ret;
+        break;
+      }
+    }
+  }
+
+  rmw_guard_condition_t * stop_guard_condition{nullptr};
+  rmw_wait_set_t * server_wait_set{nullptr};
+  std::thread server_thread;
+  std::atomic<bool> stop_requested{false};
+  std::atomic<rmw_ret_t> server_ret{RMW_RET_OK};
+  std::string server_error;
+};
+
+}  // namespace
+
+// Round trip of a request from each of N clients, sent concurrently, to a
+// server on another thread and back, reporting round-trip latency
+// percentiles and the sustained request rate as items per second.
+BENCHMARK_DEFINE_F(ServiceTest, round_trip)(benchmark::State & st)
+{
+  const size_t client_count = static_cast<size_t>(st.range(0));
+  if (!create_service(st) || !create_clients(st, client_count)) {
+    return;
+  }
+  for (const rmw_client_t * client : clients) {
+    if (!wait_for_server(st, client)) {
+      return;
+    }
+  }
+  std::vector<std::chrono::steady_clock::time_point> request_times(client_count);
+  std::vector<std::chrono::nanoseconds> latencies;
+  latencies.reserve(static_cast<size_t>(st.max_iterations) * client_count);
+  test_msgs__srv__BasicTypes_Request request{};
+  start_server();
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    ++request.int64_value;
+    for (size_t i = 0u; i < client_count; ++i) {
+      int64_t sequence_number = 0;
+      request_times[i] = std::chrono::steady_clock::now();
+      if (RMW_RET_OK != rmw_send_request(clients[i], &request, &sequence_number)) {
+        skip_with_rmw_error(st);
+        break;
+      }
+    }
+    if (st.error_occurred() || !take_responses(st, request_times, latencies)) {
+      break;
+    }
+  }
+  stop_server();
+  if (!check_server(st)) {
+    return;
+  }
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(client_count));
+  set_latency_counters(st, latencies);
+}
+BENCHMARK_REGISTER_F(ServiceTest, round_trip)
+->RangeMultiplier(4)->Range(1, 64)->UseRealTime();
+
+// Time from creating a service to rmw_service_server_is_available() turning
+// true for an existing client.
+BENCHMARK_DEFINE_F(ServiceTest, server_is_available_after_creation)(benchmark::State & st)
+{
+  if (!create_clients(st, 1u)) {
+    return;
+  }
+  std::vector<std::chrono::nanoseconds> delays;
+  delays.reserve(static_cast<size_t>(st.max_iterations));
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    std::chrono::nanoseconds delay;
+    if (!create_service(st) || !wait_for_server(st, clients[0], delay)) {
+      break;
+    }
+    st.SetIterationTime(std::chrono::duration<double>(delay).count());
+    delays.push_back(delay);
+    if (RMW_RET_OK != rmw_destroy_service(node, srv)) {
+      srv = nullptr;
+      skip_with_rmw_error(st);
+      break;
+    }
+    srv = nullptr;
+    // Start the next iteration without a server
+    const auto start_time = std::chrono::steady_clock::now();
+    bool is_available = true;
+    while (is_available &&
+      std::chrono::steady_clock::now() - start_time < rmw_intraprocess_discovery_delay * 10)
+    {
+      if (RMW_RET_OK != rmw_service_server_is_available(node, clients[0], &is_available)) {
+        skip_with_rmw_error(st);
+        break;
+      }
+      std::this_thread::sleep_for(availability_poll_period);
+    }
+    if (st.error_occurred()) {
+      break;
+    }
+  }
+  set_latency_counters(st, delays);
+}
+BENCHMARK_REGISTER_F(ServiceTest, server_is_available_after_creation)
+->Iterations(20)->UseManualTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,388 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "rmw_implementation/graph_wait.h"
+
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/srv/basic_types.h"
+
+#include "../config.hpp"
+#include "./rmw_fixture.hpp"
+
+namespace
+{
+
+constexpr rmw_time_t wait_timeout{1, 0};
+
+class WaitSetTest : public RMWFixture
+{
+public:
+  WaitSetTest()
+  : RMWFixture("benchmark_wait_set_node", "/benchmark_ns")
+  {
+  }
+
+protected:
+  void tear_down_entities() override
+  {
+    if (nullptr != wait_set) {
+      rmw_destroy_wait_set(wait_set);
+      wait_set = nullptr;
+    }
+    for (rmw_service_t * srv : services) {
+      rmw_destroy_service(node, srv);
+    }
+    services.clear();
+    service_handles.clear();
+    for (rmw_guard_condition_t * gc : guard_conditions) {
+      rmw_destroy_guard_condition(gc);
+    }
+    guard_conditions.clear();
+    guard_condition_handles.clear();
+    for (rmw_subscription_t * sub : subscriptions) {
+      rmw_destroy_subscription(node, sub);
+    }
+    subscriptions.clear();
+    subscription_handles.clear();
+    if (nullptr != pub) {
+      rmw_destroy_publisher(node, pub);
+      pub = nullptr;
+    }
+  }
+
+  bool add_guard_conditions(benchmark::State & st, size_t count)
+  {
+    for (size_t i = 0u; i < count && !st.error_occurred(); ++i) {
+      rmw_guard_condition_t * gc = rmw_create_guard_condition(&context);
+      if (nullptr == gc) {
+        skip_with_rmw_error(st);
+        break;
+      }
+      guard_conditions.push_back(gc);
+      guard_condition_handles.push_back(gc->data);
+    }
+    return !st.error_occurred();
+  }
+
+  // Add subscriptions to a topic nothing is published to.
+  bool add_idle_subscriptions(benchmark::State & st, size_t count)
+  {
+    return add_subscriptions(st, "/benchmark_wait_set_idle", count);
+  }
+
+  // Add a subscription and a publisher to a topic, and wait for these to match.
+  bool add_active_subscription(benchmark::State & st)
+  {
+    if (!add_subscriptions(st, active_topic_name, 1u)) {
+      return false;
+    }
+    rmw_publisher_options_t options = rmw_get_default_publisher_options();
+    pub = rmw_create_publisher(
+      node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), active_topic_name,
+      &rmw_qos_profile_default, &options);
+    if (nullptr == pub) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    rmw_ret_t ret = rmw_implementation_wait_for_matched_subscriptions(
+      node, pub, 1u, &rmw_intraprocess_discovery_timeout);
+    if (RMW_RET_OK == ret) {
+      ret = rmw_implementation_wait_for_matched_publishers(
+        node, subscriptions.back(), 1u, &rmw_intraprocess_discovery_timeout);
+    }
+    if (RMW_RET_TIMEOUT == ret) {
+      st.SkipWithError("publisher and subscription did not match");
+      return false;
+    }
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  bool add_services(benchmark::State & st, size_t count)
+  {
+    for (size_t i = 0u; i < count && !st.error_occurred(); ++i) {
+      const std::string service_name = "/benchmark_wait_set_service_" + std::to_string(i);
+      rmw_service_t * srv = rmw_create_service(
+        node, ROSIDL_GET_SRV_TYPE_SUPPORT(test_msgs, srv, BasicTypes), service_name.c_str(),
+        &rmw_qos_profile_services_default);
+      if (nullptr == srv) {
+        skip_with_rmw_error(st);
+        break;
+      }
+      services.push_back(srv);
+      service_handles.push_back(srv->data);
+    }
+    return !st.error_occurred();
+  }
+
+  bool create_wait_set(benchmark::State & st)
+  {
+    if (st.error_occurred()) {
+      return false;
+    }
+    wait_set = rmw_create_wait_set(
+      &context, subscription_handles.size() + guard_condition_handles.size() +
+      service_handles.size());
+    if (nullptr == wait_set) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    subscriptions_storage.resize(subscription_handles.size());
+    guard_conditions_storage.resize(guard_condition_handles.size());
+    services_storage.resize(service_handles.size());
+    return true;
+  }
+
+  // Wait on all entities, which have to be passed again to every rmw_wait()
+  // call as it clears entities that are not ready, like rcl and executors do.
+  bool wait(benchmark::State & st)
+  {
+    return check_wait(st, wait_once());
+  }
+
+  rmw_ret_t wait_once()
+  {
+    std::copy(
+      subscription_handles.begin(), subscription_handles.end(), subscriptions_storage.begin());
+    std::copy(
+      guard_condition_handles.begin(), guard_condition_handles.end(),
+      guard_conditions_storage.begin());
+    std::copy(service_handles.begin(), service_handles.end(), services_storage.begin());
+    rmw_subscriptions_t subscriptions_argument{
+      subscriptions_storage.size(), subscriptions_storage.data()};
+    rmw_guard_conditions_t guard_conditions_argument{
+      guard_conditions_storage.size(), guard_conditions_storage.data()};
+    rmw_services_t services_argument{services_storage.size(), services_storage.data()};
+    return rmw_wait(
+      &subscriptions_argument, &guard_conditions_argument, &services_argument,
+      nullptr, nullptr, wait_set, &wait_timeout);
+  }
+
+  bool check_wait(benchmark::State & st, rmw_ret_t ret)
+  {
+    if (RMW_RET_TIMEOUT == ret) {
+      st.SkipWithError("timed out waiting");
+      rmw_reset_error();
+      return false;
+    }
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  rmw_publisher_t * pub{nullptr};
+  rmw_wait_set_t * wait_set{nullptr};
+  std::vector<rmw_subscription_t *> subscriptions;
+  std::vector<rmw_guard_condition_t *> guard_conditions;
+  std::vector<rmw_service_t *> services;
+  std::vector<void *> subscription_handles;
+  std::vector<void *> guard_condition_handles;
+  std::vector<void *> service_handles;
+  std::vector<void *> subscriptions_storage;
+  std::vector<void *> guard_conditions_storage;
+  std::vector<void *> services_storage;
+  const char * const active_topic_name = "/benchmark_wait_set_active";
+
+private:
+  bool add_subscriptions(benchmark::State & st, const char * topic_name, size_t count)
+  {
+    rmw_subscription_options_t options = rmw_get_default_subscription_options();
+    for (size_t i = 0u; i < count && !st.error_occurred(); ++i) {
+      rmw_subscription_t * sub = rmw_create_subscription(
+        node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), topic_name,
+        &rmw_qos_profile_default, &options);
+      if (nullptr == sub) {
+        skip_with_rmw_error(st);
+        break;
+      }
+      subscriptions.push_back(sub);
+      subscription_handles.push_back(sub->data);
+    }
+    return !st.error_occurred();
+  }
+};
+
+}  // namespace
+
+// rmw_wait() on N guard conditions, one of which is triggered.
+BENCHMARK_DEFINE_F(WaitSetTest, wait_guard_conditions)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  if (!add_guard_conditions(st, count) || !create_wait_set(st)) {
+    return;
+  }
+  rmw_guard_condition_t * triggered_gc = guard_conditions[count / 2u];
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    if (RMW_RET_OK != rmw_trigger_guard_condition(triggered_gc)) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!wait(st)) {
+      break;
+    }
+  }
+}
+BENCHMARK_REGISTER_F(WaitSetTest, wait_guard_conditions)
+->RangeMultiplier(10)->Range(1, 10000)->MeasureProcessCPUTime()->UseRealTime();
+
+// rmw_wait() on N subscriptions, one of which has a message.
+BENCHMARK_DEFINE_F(WaitSetTest, wait_subscriptions)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  if (!add_idle_subscriptions(st, count - 1u) || !add_active_subscription(st) ||
+    !create_wait_set(st))
+  {
+    return;
+  }
+  rmw_subscription_t * active_sub = subscriptions.back();
+  test_msgs__msg__BasicTypes message{};
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    if (RMW_RET_OK != rmw_publish(pub, &message, nullptr)) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!wait(st)) {
+      break;
+    }
+    bool taken = false;
+    if (RMW_RET_OK != rmw_take(active_sub, &message, &taken, nullptr)) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!taken) {
+      st.SkipWithError("no message taken after waiting for data");
+      break;
+    }
+  }
+}
+BENCHMARK_REGISTER_F(WaitSetTest, wait_subscriptions)
+->RangeMultiplier(8)->Range(1, 4096)->MeasureProcessCPUTime()->UseRealTime();
+
+// rmw_wait() on N entities, a third of each kind, one guard condition being triggered.
+BENCHMARK_DEFINE_F(WaitSetTest, wait_mixed_entities)(benchmark::State & st)
+{
+  const size_t count = std::max<size_t>(static_cast<size_t>(st.range(0)) / 3u, 1u);
+  if (!add_idle_subscriptions(st, count) || !add_services(st, count) ||
+    !add_guard_conditions(st, count) || !create_wait_set(st))
+  {
+    return;
+  }
+  rmw_guard_condition_t * triggered_gc = guard_conditions[count / 2u];
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    if (RMW_RET_OK != rmw_trigger_guard_condition(triggered_gc)) {
+      skip_with_rmw_error(st);
+      break;
+    }
+    if (!wait(st)) {
+      break;
+    }
+  }
+}
+BENCHMARK_REGISTER_F(WaitSetTest, wait_mixed_entities)
+->RangeMultiplier(8)->Range(3, 4096)->MeasureProcessCPUTime()->UseRealTime();
+
+// Latency from triggering one of N guard conditions in another thread to
+// rmw_wait() returning, reported as the wakeup_latency_ns counter.
+BENCHMARK_DEFINE_F(WaitSetTest, wait_guard_conditions_wakeup)(benchmark::State & st)
+{
+  const size_t count = static_cast<size_t>(st.range(0));
+  if (!add_guard_conditions(st, count) || !create_wait_set(st)) {
+    return;
+  }
+  rmw_guard_condition_t * triggered_gc = guard_conditions[count / 2u];
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool trigger_requested = false;
+  bool done = false;
+  std::chrono::steady_clock::time_point trigger_time;
+  rmw_ret_t trigger_ret = RMW_RET_OK;
+  std::string trigger_error;
+  std::thread trigger_thread(
+    [&]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        cv.wait(lock, [&]() {return trigger_requested || done;});
+        if (done) {
+          break;
+        }
+        trigger_requested = false;
+        trigger_time = std::chrono::steady_clock::now();
+        trigger_ret = rmw_trigger_guard_condition(triggered_gc);
+        if (RMW_RET_OK != trigger_ret) {
+          // Errors are thread local, keep it for the benchmark thread
+          trigger_error = rmw_get_error_string().str;
+          rmw_reset_error();
+          break;
+        }
+      }
+    });
+  std::chrono::nanoseconds total_wakeup_latency{0};
+  reset_heap_counters();
+
+  for (auto _ : st) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      trigger_requested = true;
+    }
+    cv.notify_one();
+    const rmw_ret_t wait_ret = wait_once();
+    const auto wakeup_time = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    // a failed trigger times the wait out, report why
+    if (RMW_RET_OK != trigger_ret) {
+      st.SkipWithError(trigger_error.c_str());
+      rmw_reset_error();
+      break;
+    }
+    if (!check_wait(st, wait_ret)) {
+      break;
+    }
+    total_wakeup_latency += wakeup_time - trigger_time;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  cv.notify_one();
+  trigger_thread.join();
+  st.counters["wakeup_latency_ns"] = benchmark::Counter(
+    static_cast<double>(total_wakeup_latency.count()), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_REGISTER_F(WaitSetTest, wait_guard_conditions_wakeup)
+->RangeMultiplier(10)->Range(1, 10000)->MeasureProcessCPUTime()->UseRealTime();
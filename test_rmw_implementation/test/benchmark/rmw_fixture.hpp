@@ -0,0 +1,130 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BENCHMARK__RMW_FIXTURE_HPP_
+#define BENCHMARK__RMW_FIXTURE_HPP_
+
+#include "performance_test_fixture/performance_test_fixture.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/rmw.h"
+
+#include "../isolation.hpp"
+
+namespace
+{
+
+// Skip a benchmark, reporting the rmw error that made it fail.
+void
+skip_with_rmw_error(benchmark::State & st)
+{
+  st.SkipWithError(rmw_get_error_string().str);
+  rmw_reset_error();
+}
+
+// Benchmarks with an rmw context and a node, isolated from other processes.
+// Fixtures are reused by all runs of a benchmark, hence the context and the
+// node are created on each SetUp() and destroyed on each TearDown(), along
+// with the entities of derived fixtures.
+class RMWFixture : public performance_test_fixture::PerformanceTest
+{
+public:
+  RMWFixture(const char * node_name, const char * node_namespace)
+  : node_name_(node_name), node_namespace_(node_namespace)
+  {
+  }
+
+  void SetUp(benchmark::State & st) override
+  {
+    if (init(st) && set_up_entities(st)) {
+      st.SetLabel(rmw_get_implementation_identifier());
+    }
+    PerformanceTest::SetUp(st);
+  }
+
+  void TearDown(benchmark::State & st) override
+  {
+    PerformanceTest::TearDown(st);
+    tear_down_entities();
+    if (nullptr != node) {
+      rmw_destroy_node(node);
+      node = nullptr;
+    }
+    rmw_shutdown(&context);
+    rmw_context_fini(&context);
+    context = rmw_get_zero_initialized_context();
+    rmw_init_options_fini(&init_options);
+    init_options = rmw_get_zero_initialized_init_options();
+    rmw_reset_error();
+  }
+
+protected:
+  // Create entities of the fixture once the node is, skipping the benchmark
+  // if any cannot be.
+  virtual bool set_up_entities(benchmark::State &)
+  {
+    return true;
+  }
+
+  // Destroy entities of the fixture, whether created or not, before the node.
+  virtual void tear_down_entities()
+  {
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+
+private:
+  bool init(benchmark::State & st)
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    rmw_ret_t ret = rmw_init_options_init(&init_options, allocator);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    init_options.enclave = rcutils_strdup("/", allocator);
+    if (nullptr == init_options.enclave) {
+      st.SkipWithError("failed to allocate enclave");
+      return false;
+    }
+    ret = isolate_init_options(&init_options);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    ret = rmw_init(&init_options, &context);
+    if (RMW_RET_OK != ret) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    node = rmw_create_node(&context, node_name_, node_namespace_);
+    if (nullptr == node) {
+      skip_with_rmw_error(st);
+      return false;
+    }
+    return true;
+  }
+
+  const char * node_name_;
+  const char * node_namespace_;
+};
+
+}  // namespace
+
+#endif  // BENCHMARK__RMW_FIXTURE_HPP_
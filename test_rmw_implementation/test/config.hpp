@@ -17,6 +17,8 @@
 
 #include <chrono>
 
+#include "rmw/types.h"
+
 namespace
 {
 
@@ -30,6 +32,11 @@ namespace
 
 std::chrono::milliseconds rmw_intraprocess_discovery_delay{100};
 
+// Same as ten times the delay above, for tests waiting for discovery with
+// the functions declared in rmw_implementation/graph_wait.h, which return as
+// soon as discovery is done.
+rmw_time_t rmw_intraprocess_discovery_timeout{1u, 0u};
+
 }  // namespace
 
 #endif  // CONFIG_HPP_
@@ -0,0 +1,69 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ISOLATION_HPP_
+#define ISOLATION_HPP_
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "rcutils/get_env.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/init_options.h"
+#include "rmw/ret_types.h"
+
+namespace
+{
+
+// Apply the ROS_DOMAIN_ID and ROS_LOCALHOST_ONLY environment variables to
+// init options, as rcl would, so that each test process can be isolated
+// from others running in parallel, see CMakeLists.txt.
+// Unset or empty variables leave init options untouched.
+rmw_ret_t
+isolate_init_options(rmw_init_options_t * init_options)
+{
+  const char * value = nullptr;
+  const char * error = rcutils_get_env("ROS_DOMAIN_ID", &value);
+  if (nullptr != error) {
+    RMW_SET_ERROR_MSG(error);
+    return RMW_RET_ERROR;
+  }
+  if (nullptr != value && '\0' != value[0]) {
+    char * end = nullptr;
+    errno = 0;
+    const unsigned long domain_id = std::strtoul(value, &end, 10);  // NOLINT(runtime/int)
+    if (0 != errno || '\0' != *end || RMW_DEFAULT_DOMAIN_ID == domain_id) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("ROS_DOMAIN_ID is not a domain id: '%s'", value);
+      return RMW_RET_ERROR;
+    }
+    init_options->domain_id = domain_id;
+  }
+
+  error = rcutils_get_env("ROS_LOCALHOST_ONLY", &value);
+  if (nullptr != error) {
+    RMW_SET_ERROR_MSG(error);
+    return RMW_RET_ERROR;
+  }
+  if (nullptr != value && '\0' != value[0]) {
+    init_options->localhost_only = 0 == std::strcmp(value, "1") ?
+      RMW_LOCALHOST_ONLY_ENABLED : RMW_LOCALHOST_ONLY_DISABLED;
+  }
+  return RMW_RET_OK;
+}
+
+}  // namespace
+
+#endif  // ISOLATION_HPP_
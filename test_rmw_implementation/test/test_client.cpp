@@ -23,9 +23,12 @@
 #include "rmw/rmw.h"
 #include "rmw/error_handling.h"
 
+#include "rmw_implementation/graph_wait.h"
+
 #include "test_msgs/srv/basic_types.h"
 
 #include "./config.hpp"
+#include "./isolation.hpp"
 #include "./testing_macros.hpp"
 
 #ifdef RMW_IMPLEMENTATION
@@ -50,6 +53,8 @@ protected:
     });
     init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     ret = rmw_init(&init_options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     constexpr char node_name[] = "my_test_node";
@@ -398,12 +403,11 @@ TEST_F(CLASSNAME(TestClientUse, RMW_IMPLEMENTATION), service_server_is_available
 
   rmw_service_t * service = rmw_create_service(node, ts, service_name, &qos_profile);
   ASSERT_NE(nullptr, client) << rcutils_get_error_string().str;
-  SLEEP_AND_RETRY_UNTIL(rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10) {
-    ret = rmw_service_server_is_available(node, client, &is_available);
-    if (RMW_RET_OK == ret && is_available) {
-      break;
-    }
-  }
+  ret = rmw_implementation_wait_for_service_server(
+    node, client, &rmw_intraprocess_discovery_timeout);
+  EXPECT_EQ(ret, RMW_RET_OK) << rmw_get_error_string().str;
+  rmw_reset_error();
+  ret = rmw_service_server_is_available(node, client, &is_available);
   EXPECT_EQ(ret, RMW_RET_OK) << rmw_get_error_string().str;
   EXPECT_TRUE(is_available) << rmw_get_error_string().str;
   rmw_reset_error();
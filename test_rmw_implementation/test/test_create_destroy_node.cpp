@@ -22,6 +22,7 @@
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
+#include "./isolation.hpp"
 #include "./testing_macros.hpp"
 
 
@@ -42,6 +43,8 @@ protected:
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", options.enclave);
+    ret = isolate_init_options(&options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     context = rmw_get_zero_initialized_context();
     ret = rmw_init(&options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
@@ -147,6 +150,8 @@ protected:
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", options.enclave);
+    ret = isolate_init_options(&options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     options.localhost_only = RMW_LOCALHOST_ONLY_ENABLED;
     context = rmw_get_zero_initialized_context();
     ret = rmw_init(&options, &context);
@@ -14,6 +14,12 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "osrf_testing_tools_cpp/scope_exit.hpp"
 
 #include "rcutils/allocator.h"
@@ -27,7 +33,13 @@
 #include "rmw/rmw.h"
 #include "rmw/sanity_checks.h"
 
+#include "rmw_implementation/graph_cache.h"
+#include "rmw_implementation/graph_events.h"
+
+#include "test_msgs/msg/basic_types.h"
+
 #include "./config.hpp"
+#include "./isolation.hpp"
 #include "./testing_macros.hpp"
 
 #ifdef RMW_IMPLEMENTATION
@@ -52,6 +64,8 @@ protected:
     });
     init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     ret = rmw_init(&init_options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     node = rmw_create_node(&context, node_name, node_namespace);
@@ -913,3 +927,160 @@ TEST_F(CLASSNAME(TestGraphAPI, RMW_IMPLEMENTATION), count_subscribers_with_bad_a
   EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_count_subscribers(node, topic_name, nullptr));
   rmw_reset_error();
 }
+
+namespace
+{
+
+std::vector<std::string>
+sorted_names(const rmw_names_and_types_t & names_and_types)
+{
+  std::vector<std::string> names(
+    names_and_types.names.data, names_and_types.names.data + names_and_types.names.size);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+}  // namespace
+
+TEST_F(CLASSNAME(TestGraphAPI, RMW_IMPLEMENTATION), graph_cache_stays_consistent) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_graph_cache_t cache = rmw_implementation_get_zero_initialized_graph_cache();
+  rmw_ret_t ret = rmw_implementation_graph_cache_init(&cache, node, true, &allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    rmw_ret_t ret = rmw_implementation_graph_cache_fini(&cache);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+
+  constexpr char topic_name[] = "/test_graph_cache";
+  size_t count = 0u;
+  ret = rmw_implementation_graph_cache_count_publishers(&cache, topic_name, &count);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(0u, count);
+
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_publisher_options_t options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub =
+    rmw_create_publisher(other_node, ts, topic_name, &rmw_qos_profile_default, &options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+
+  // snapshots are dropped once the publisher is discovered
+  SLEEP_AND_RETRY_UNTIL(rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10) {
+    ret = rmw_implementation_graph_cache_count_publishers(&cache, topic_name, &count);
+    if (RMW_RET_OK != ret || 1u == count) {
+      break;
+    }
+  }
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(1u, count);
+
+  // and agree with the rmw implementation
+  size_t expected_count = 0u;
+  ret = rmw_count_publishers(node, topic_name, &expected_count);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(expected_count, count);
+  rmw_names_and_types_t topic_names_and_types = rmw_get_zero_initialized_names_and_types();
+  ret = rmw_implementation_graph_cache_get_topic_names_and_types(
+    &cache, &allocator, false, &topic_names_and_types);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rmw_names_and_types_t expected_topic_names_and_types =
+    rmw_get_zero_initialized_names_and_types();
+  ret = rmw_get_topic_names_and_types(node, &allocator, false, &expected_topic_names_and_types);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  const std::vector<std::string> topic_names = sorted_names(topic_names_and_types);
+  EXPECT_EQ(sorted_names(expected_topic_names_and_types), topic_names);
+  EXPECT_NE(
+    topic_names.end(), std::find(topic_names.begin(), topic_names.end(), topic_name));
+  ret = rmw_names_and_types_fini(&expected_topic_names_and_types);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = rmw_names_and_types_fini(&topic_names_and_types);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  rcutils_string_array_t node_names = rcutils_get_zero_initialized_string_array();
+  rcutils_string_array_t node_namespaces = rcutils_get_zero_initialized_string_array();
+  ret = rmw_implementation_graph_cache_get_node_names(&cache, &node_names, &node_namespaces);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rcutils_string_array_t expected_node_names = rcutils_get_zero_initialized_string_array();
+  rcutils_string_array_t expected_node_namespaces = rcutils_get_zero_initialized_string_array();
+  ret = rmw_get_node_names(node, &expected_node_names, &expected_node_namespaces);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(expected_node_names.size, node_names.size);
+  EXPECT_EQ(expected_node_namespaces.size, node_namespaces.size);
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&expected_node_namespaces));
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&expected_node_names));
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_namespaces));
+  EXPECT_EQ(RCUTILS_RET_OK, rcutils_string_array_fini(&node_names));
+
+  ret = rmw_destroy_publisher(other_node, pub);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  // and so are they once the publisher is gone
+  SLEEP_AND_RETRY_UNTIL(rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10) {
+    ret = rmw_implementation_graph_cache_count_publishers(&cache, topic_name, &count);
+    if (RMW_RET_OK != ret || 0u == count) {
+      break;
+    }
+  }
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(0u, count);
+}
+
+TEST_F(CLASSNAME(TestGraphAPI, RMW_IMPLEMENTATION), graph_events_follow_endpoints) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_graph_event_stream_t stream =
+    rmw_implementation_get_zero_initialized_graph_event_stream();
+  rmw_ret_t ret = rmw_implementation_graph_event_stream_init(&stream, node, true, &allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    rmw_ret_t ret = rmw_implementation_graph_event_stream_fini(&stream);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+
+  constexpr char topic_name[] = "/test_graph_events";
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_publisher_options_t options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub =
+    rmw_create_publisher(other_node, ts, topic_name, &rmw_qos_profile_default, &options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  rmw_gid_t gid;
+  ret = rmw_get_gid_for_publisher(pub, &gid);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  // Take events until one of the given type is taken for the publisher.
+  auto wait_for_event =
+    [&](rmw_implementation_graph_event_type_t type) -> bool {
+      SLEEP_AND_RETRY_UNTIL(
+        rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10)
+      {
+        rmw_implementation_graph_event_t events[8];
+        size_t count = 0u;
+        ret = rmw_implementation_graph_event_stream_take(&stream, events, 8u, &count);
+        if (RMW_RET_OK != ret) {
+          return false;
+        }
+        for (size_t i = 0u; i < count; ++i) {
+          if (type == events[i].type && 0 == strcmp(topic_name, events[i].topic_name) &&
+            0 == memcmp(gid.data, events[i].endpoint_gid, RMW_GID_STORAGE_SIZE))
+          {
+            EXPECT_STREQ(other_node->name, events[i].node_name);
+            EXPECT_STREQ(other_node->namespace_, events[i].node_namespace);
+            return true;
+          }
+        }
+      }
+      return false;
+    };
+
+  EXPECT_TRUE(wait_for_event(RMW_IMPLEMENTATION_GRAPH_EVENT_PUBLISHER_ADDED));
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  ret = rmw_destroy_publisher(other_node, pub);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  EXPECT_TRUE(wait_for_event(RMW_IMPLEMENTATION_GRAPH_EVENT_PUBLISHER_REMOVED));
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+}
@@ -24,6 +24,7 @@
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
+#include "./isolation.hpp"
 #include "./testing_macros.hpp"
 
 #ifdef RMW_IMPLEMENTATION
@@ -43,6 +44,8 @@ protected:
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", options.enclave);
+    ret = isolate_init_options(&options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
   }
 
   void TearDown() override
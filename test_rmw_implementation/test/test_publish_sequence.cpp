@@ -0,0 +1,172 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "rmw_implementation/extensions.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+#include "./config.hpp"
+#include "./isolation.hpp"
+#include "./testing_macros.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+class CLASSNAME (TestPublishSequence, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    init_options = rmw_get_zero_initialized_init_options();
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    context = rmw_get_zero_initialized_context();
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    constexpr char node_name[] = "my_test_node";
+    constexpr char node_namespace[] = "/my_test_ns";
+    node = rmw_create_node(&context, node_name, node_namespace);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+    rmw_publisher_options_t options = rmw_get_default_publisher_options();
+    pub = rmw_create_publisher(node, ts, topic_name, &rmw_qos_profile_default, &options);
+    ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+
+    allocator = rcutils_get_default_allocator();
+    sequence = rmw_get_zero_initialized_message_sequence();
+    ret = rmw_message_sequence_init(&sequence, count, &allocator);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    for (size_t i = 0u; i < count; ++i) {
+      ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&messages[i]));
+      messages[i].int32_value = static_cast<int32_t>(i);
+      sequence.data[i] = &messages[i];
+    }
+    sequence.size = count;
+  }
+
+  void TearDown() override
+  {
+    for (size_t i = 0u; i < count; ++i) {
+      test_msgs__msg__BasicTypes__fini(&messages[i]);
+    }
+    rmw_ret_t ret = rmw_message_sequence_fini(&sequence);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_destroy_publisher(node, pub);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_destroy_node(node);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_init_options_fini(&init_options);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  rmw_init_options_t init_options;
+  rmw_context_t context;
+  rmw_node_t * node;
+  rmw_publisher_t * pub{nullptr};
+  const char * const topic_name = "/test";
+  const rosidl_message_type_support_t * ts{
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes)};
+  static constexpr size_t count = 10u;
+  test_msgs__msg__BasicTypes messages[count]{};
+  rcutils_allocator_t allocator;
+  rmw_message_sequence_t sequence;
+};
+
+constexpr size_t CLASSNAME(TestPublishSequence, RMW_IMPLEMENTATION)::count;
+
+TEST_F(CLASSNAME(TestPublishSequence, RMW_IMPLEMENTATION), publish_sequence) {
+  rmw_publisher_allocation_t * null_allocation{nullptr};  // still valid allocation
+  size_t published = 0u;
+  rmw_ret_t ret = rmw_publish_sequence(pub, &sequence, &published, null_allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(count, published);
+}
+
+TEST_F(CLASSNAME(TestPublishSequence, RMW_IMPLEMENTATION), publish_empty_sequence) {
+  rmw_publisher_allocation_t * null_allocation{nullptr};  // still valid allocation
+  sequence.size = 0u;
+  size_t published = 10u;  // Non-zero value to check variable update
+  rmw_ret_t ret = rmw_publish_sequence(pub, &sequence, &published, null_allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(0u, published);
+}
+
+TEST_F(CLASSNAME(TestPublishSequence, RMW_IMPLEMENTATION), publish_sequence_with_bad_arguments) {
+  rmw_publisher_allocation_t * null_allocation{nullptr};  // still valid allocation
+  size_t published = 0u;
+  rmw_ret_t ret = rmw_publish_sequence(nullptr, &sequence, &published, null_allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
+
+  ret = rmw_publish_sequence(pub, nullptr, &published, null_allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
+
+  ret = rmw_publish_sequence(pub, &sequence, nullptr, null_allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
+
+  const char * implementation_identifier = pub->implementation_identifier;
+  pub->implementation_identifier = "not-an-rmw-implementation-identifier";
+  ret = rmw_publish_sequence(pub, &sequence, &published, null_allocation);
+  EXPECT_EQ(RMW_RET_INCORRECT_RMW_IMPLEMENTATION, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(0u, published);
+  rmw_reset_error();
+  pub->implementation_identifier = implementation_identifier;
+}
+
+TEST_F(
+  CLASSNAME(TestPublishSequence, RMW_IMPLEMENTATION),
+  publish_sequence_stops_at_first_failure) {
+  rmw_publisher_allocation_t * null_allocation{nullptr};  // still valid allocation
+  constexpr size_t bad_message_index = count / 2u;
+  sequence.data[bad_message_index] = nullptr;
+  size_t published = 0u;
+  rmw_ret_t ret = rmw_publish_sequence(pub, &sequence, &published, null_allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(bad_message_index, published);
+  rmw_reset_error();
+}
+
+TEST_F(CLASSNAME(TestPublishSequence, RMW_IMPLEMENTATION), publish_sequence_with_internal_errors) {
+  rmw_publisher_allocation_t * null_allocation{nullptr};  // still valid allocation
+  RCUTILS_FAULT_INJECTION_TEST(
+  {
+    size_t published = 0u;
+    rmw_ret_t ret = rmw_publish_sequence(pub, &sequence, &published, null_allocation);
+    if (RMW_RET_OK != ret) {
+      EXPECT_GT(count, published);
+      rmw_reset_error();
+    }
+  });
+}
@@ -24,9 +24,13 @@
 #include "rmw/rmw.h"
 #include "rmw/error_handling.h"
 
+#include "rmw_implementation/graph_wait.h"
+#include "rmw_implementation/message_loan_pool.h"
+
 #include "test_msgs/msg/basic_types.h"
 
 #include "./config.hpp"
+#include "./isolation.hpp"
 #include "./testing_macros.hpp"
 
 #ifdef RMW_IMPLEMENTATION
@@ -46,6 +50,8 @@ protected:
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     context = rmw_get_zero_initialized_context();
     ret = rmw_init(&init_options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
@@ -355,12 +361,10 @@ TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), count_matched_subscripti
   ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
 
   // TODO(hidmic): revisit when https://github.com/ros2/rmw/issues/264 is resolved.
-  SLEEP_AND_RETRY_UNTIL(rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10) {
-    ret = rmw_publisher_count_matched_subscriptions(pub, &subscription_count);
-    if (RMW_RET_OK == ret && 1u == subscription_count) {
-      break;
-    }
-  }
+  ret = rmw_implementation_wait_for_matched_subscriptions(
+    node, pub, 1u, &rmw_intraprocess_discovery_timeout);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
 
   EXPECT_NO_MEMORY_OPERATIONS(
   {
@@ -373,12 +377,10 @@ TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), count_matched_subscripti
   EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
 
   // TODO(hidmic): revisit when https://github.com/ros2/rmw/issues/264 is resolved.
-  SLEEP_AND_RETRY_UNTIL(rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10) {
-    ret = rmw_publisher_count_matched_subscriptions(pub, &subscription_count);
-    if (RMW_RET_OK == ret && 0u == subscription_count) {
-      break;
-    }
-  }
+  ret = rmw_implementation_wait_for_matched_subscriptions(
+    node, pub, 0u, &rmw_intraprocess_discovery_timeout);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
 
   EXPECT_NO_MEMORY_OPERATIONS(
   {
@@ -472,6 +474,40 @@ TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), publish_with_internal_er
   });
 }
 
+TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), publish_from_message_loan_pool) {
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_message_loan_pool_t pool =
+    rmw_implementation_get_zero_initialized_message_loan_pool();
+  rmw_ret_t ret = rmw_implementation_message_loan_pool_init(
+    &pool, pub, ts, sizeof(test_msgs__msg__BasicTypes), 1u, &allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(pub->can_loan_messages, pool.loans_messages);
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    ret = rmw_implementation_message_loan_pool_fini(&pool);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+
+  // Same calls whether the rmw implementation loans messages or not.
+  for (size_t i = 0u; i < 3u; ++i) {
+    void * ros_message = nullptr;
+    ret = rmw_implementation_message_loan_pool_borrow(&pool, &ros_message);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_NE(nullptr, ros_message);
+    auto message = static_cast<test_msgs__msg__BasicTypes *>(ros_message);
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(message));
+    message->int32_value = static_cast<int32_t>(i);
+    ret = rmw_implementation_message_loan_pool_publish(&pool, ros_message, nullptr);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  void * ros_message = nullptr;
+  ret = rmw_implementation_message_loan_pool_borrow(&pool, &ros_message);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = rmw_implementation_message_loan_pool_return(&pool, ros_message);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+}
+
 TEST_F(
   CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION),
   publish_serialized_message_with_bad_arguments) {
@@ -27,6 +27,7 @@
 #include "test_msgs/srv/basic_types.h"
 
 #include "./config.hpp"
+#include "./isolation.hpp"
 #include "./testing_macros.hpp"
 
 #ifdef RMW_IMPLEMENTATION
@@ -51,6 +52,8 @@ protected:
     });
     init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     ret = rmw_init(&init_options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     constexpr char node_name[] = "my_test_node";
@@ -0,0 +1,191 @@
+// Copyright 2021 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "osrf_testing_tools_cpp/memory_tools/gtest_quickstart.hpp"
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "rmw_implementation/allocation_arena.h"
+#include "rmw_implementation/graph_wait.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+#include "./allocator_testing_utils.h"
+#include "./isolation.hpp"
+#include "./config.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+class CLASSNAME (TestSteadyStateAllocations, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    allocator = get_counting_allocator(&allocator_state);
+    rmw_ret_t ret = rmw_init_options_init(&init_options, allocator);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", allocator);
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    constexpr char node_name[] = "my_test_node";
+    constexpr char node_namespace[] = "/my_test_ns";
+    node = rmw_create_node(&context, node_name, node_namespace);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    qos_profile.reliability = RMW_QOS_POLICY_RELIABILITY_RELIABLE;
+    qos_profile.history = RMW_QOS_POLICY_HISTORY_KEEP_LAST;
+    qos_profile.depth = 1u;
+    constexpr char topic_name[] = "/test_steady_state";
+    rmw_publisher_options_t publisher_options = rmw_get_default_publisher_options();
+    pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &publisher_options);
+    ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+    rmw_subscription_options_t subscription_options = rmw_get_default_subscription_options();
+    sub = rmw_create_subscription(node, ts, topic_name, &qos_profile, &subscription_options);
+    ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+    wait_set = rmw_create_wait_set(&context, 1u);
+    ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+
+    ret = rmw_implementation_allocation_arena_init(&arena, &allocator);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_implementation_allocation_arena_get_publisher_allocation(
+      &arena, pub, ts, nullptr, &publisher_allocation);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_implementation_allocation_arena_get_subscription_allocation(
+      &arena, sub, ts, nullptr, &subscription_allocation);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+    ret = rmw_implementation_wait_for_matched_subscriptions(
+      node, pub, 1u, &rmw_intraprocess_discovery_timeout);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    rmw_ret_t ret;
+    if (nullptr != arena.impl) {
+      ret = rmw_implementation_allocation_arena_fini(&arena);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    if (nullptr != wait_set) {
+      ret = rmw_destroy_wait_set(wait_set);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    if (nullptr != sub) {
+      ret = rmw_destroy_subscription(node, sub);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    if (nullptr != pub) {
+      ret = rmw_destroy_publisher(node, pub);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    ret = rmw_destroy_node(node);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_init_options_fini(&init_options);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  // Publish a message and take it, returning the first error if any.
+  // Assertions are left to callers, as they may allocate.
+  rmw_ret_t publish_take(test_msgs__msg__BasicTypes & input, test_msgs__msg__BasicTypes & output)
+  {
+    rmw_ret_t ret = rmw_publish(pub, &input, publisher_allocation);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    subscriptions_storage[0] = sub->data;
+    rmw_subscriptions_t subscriptions = {1u, subscriptions_storage};
+    rmw_time_t timeout = {1u, 0u};
+    ret = rmw_wait(&subscriptions, nullptr, nullptr, nullptr, nullptr, wait_set, &timeout);
+    if (RMW_RET_OK != ret) {
+      return ret;
+    }
+    bool taken = false;
+    ret = rmw_take(sub, &output, &taken, subscription_allocation);
+    if (RMW_RET_OK == ret && !taken) {
+      return RMW_RET_ERROR;
+    }
+    return ret;
+  }
+
+  __counting_allocator_state allocator_state;
+  rcutils_allocator_t allocator;
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  const rosidl_message_type_support_t * ts{
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes)};
+  rmw_qos_profile_t qos_profile{rmw_qos_profile_default};
+  rmw_publisher_t * pub{nullptr};
+  rmw_subscription_t * sub{nullptr};
+  rmw_wait_set_t * wait_set{nullptr};
+  void * subscriptions_storage[1];
+  rmw_implementation_allocation_arena_t arena{
+    rmw_implementation_get_zero_initialized_allocation_arena()};
+  rmw_publisher_allocation_t * publisher_allocation{nullptr};
+  rmw_subscription_allocation_t * subscription_allocation{nullptr};
+};
+
+TEST_F(CLASSNAME(TestSteadyStateAllocations, RMW_IMPLEMENTATION), publish_take_loop) {
+  osrf_testing_tools_cpp::memory_tools::ScopedQuickstartGtest sqg;
+
+  test_msgs__msg__BasicTypes input_message{};
+  test_msgs__msg__BasicTypes output_message{};
+  rmw_ret_t ret;
+  // let the rmw implementation settle, e.g. grow its caches
+  constexpr size_t warm_up_iterations = 100u;
+  for (size_t i = 0u; i < warm_up_iterations; ++i) {
+    input_message.uint32_value = static_cast<uint32_t>(i);
+    ret = publish_take(input_message, output_message);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_EQ(input_message.uint32_value, output_message.uint32_value);
+  }
+
+  const size_t allocations = allocator_state.allocations;
+  const size_t deallocations = allocator_state.deallocations;
+  constexpr size_t iterations = 1000u;
+  size_t iteration = 0u;
+  EXPECT_NO_MEMORY_OPERATIONS(
+  {
+    for (; iteration < iterations; ++iteration) {
+      input_message.uint32_value = static_cast<uint32_t>(iteration);
+      ret = publish_take(input_message, output_message);
+      if (RMW_RET_OK != ret) {
+        break;
+      }
+    }
+  });
+  EXPECT_EQ(RMW_RET_OK, ret) << "at iteration " << iteration << ": " <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(input_message.uint32_value, output_message.uint32_value);
+  EXPECT_EQ(allocations, allocator_state.allocations);
+  EXPECT_EQ(deallocations, allocator_state.deallocations);
+}
@@ -14,6 +14,9 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <cstring>
+
 #include "osrf_testing_tools_cpp/memory_tools/gtest_quickstart.hpp"
 #include "osrf_testing_tools_cpp/scope_exit.hpp"
 
@@ -23,9 +26,14 @@
 #include "rmw/rmw.h"
 #include "rmw/error_handling.h"
 
+#include "rmw_implementation/capture.h"
+#include "rmw_implementation/graph_wait.h"
+#include "rmw_implementation/injection.h"
+
 #include "test_msgs/msg/basic_types.h"
 #include "test_msgs/msg/strings.h"
 #include "./config.hpp"
+#include "./isolation.hpp"
 #include "./testing_macros.hpp"
 
 #include "rmw_dds_common/gid_utils.hpp"
@@ -48,6 +56,8 @@ protected:
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     ret = rmw_init(&init_options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     constexpr char node_name[] = "my_test_node";
@@ -361,12 +371,10 @@ TEST_F(CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION), count_matched_subscri
   ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
 
   // TODO(hidmic): revisit when https://github.com/ros2/rmw/issues/264 is resolved.
-  SLEEP_AND_RETRY_UNTIL(rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10) {
-    ret = rmw_subscription_count_matched_publishers(sub, &publisher_count);
-    if (RMW_RET_OK == ret && 1u == publisher_count) {
-      break;
-    }
-  }
+  ret = rmw_implementation_wait_for_matched_publishers(
+    node, sub, 1u, &rmw_intraprocess_discovery_timeout);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
 
   EXPECT_NO_MEMORY_OPERATIONS(
   {
@@ -379,12 +387,10 @@ TEST_F(CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION), count_matched_subscri
   EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
 
   // TODO(hidmic): revisit when https://github.com/ros2/rmw/issues/264 is resolved.
-  SLEEP_AND_RETRY_UNTIL(rmw_intraprocess_discovery_delay, rmw_intraprocess_discovery_delay * 10) {
-    ret = rmw_subscription_count_matched_publishers(sub, &publisher_count);
-    if (RMW_RET_OK == ret && 0u == publisher_count) {
-      break;
-    }
-  }
+  ret = rmw_implementation_wait_for_matched_publishers(
+    node, sub, 0u, &rmw_intraprocess_discovery_timeout);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
 
   EXPECT_NO_MEMORY_OPERATIONS(
   {
@@ -769,6 +775,236 @@ TEST_F(
     RMW_RET_OK, rmw_serialized_message_fini(&serialized_message)) << rmw_get_error_string().str;
 }
 
+TEST_F(CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION), capture_serialized_messages) {
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    rmw_ret_t ret = rmw_destroy_publisher(node, pub);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+  rmw_ret_t ret = rmw_implementation_wait_for_matched_subscriptions(
+    node, pub, 1u, &rmw_intraprocess_discovery_timeout);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  rcutils_allocator_t default_allocator = rcutils_get_default_allocator();
+  test_msgs__msg__BasicTypes message{};
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&message));
+  message.int32_value = 42;
+  rmw_serialized_message_t published_message = rmw_get_zero_initialized_serialized_message();
+  ret = rmw_serialized_message_init(&published_message, 0lu, &default_allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  rmw_serialized_message_t taken_message = rmw_get_zero_initialized_serialized_message();
+  ret = rmw_serialized_message_init(&taken_message, 0lu, &default_allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&published_message));
+    EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&taken_message));
+  });
+  ret = rmw_serialize(&message, ts, &published_message);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  constexpr char capture_file_path[] = "test_subscription_capture.rmwcap";
+  ret = rmw_implementation_capture_enable(capture_file_path, nullptr);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_capture_disable());
+    std::remove(capture_file_path);
+  });
+  rmw_publisher_allocation_t * null_publisher_allocation{nullptr};  // still valid allocation
+  ret = rmw_publish_serialized_message(pub, &published_message, null_publisher_allocation);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, 1u);
+  ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set)) << rmw_get_error_string().str;
+  });
+  void * subscriptions_storage[1] = {sub->data};
+  rmw_subscriptions_t subscriptions{1u, subscriptions_storage};
+  ret = rmw_wait(
+    &subscriptions, nullptr, nullptr, nullptr, nullptr, wait_set,
+    &rmw_intraprocess_discovery_timeout);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  bool taken = false;
+  rmw_subscription_allocation_t * null_allocation{nullptr};  // still valid allocation
+  ret = rmw_take_serialized_message(sub, &taken_message, &taken, null_allocation);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ASSERT_TRUE(taken);
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_capture_disable()) << rmw_get_error_string().str;
+
+  // Messages are captured in the order these were published and taken in by this thread
+  rmw_implementation_capture_reader_t reader =
+    rmw_implementation_get_zero_initialized_capture_reader();
+  ret = rmw_implementation_capture_reader_init(&reader, capture_file_path, &default_allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_capture_reader_fini(&reader));
+  });
+  EXPECT_EQ(2u, reader.record_count);
+  const rmw_implementation_capture_direction_t directions[] = {
+    RMW_IMPLEMENTATION_CAPTURE_PUBLISHED, RMW_IMPLEMENTATION_CAPTURE_TAKEN};
+  for (rmw_implementation_capture_direction_t direction : directions) {
+    rmw_implementation_capture_record_t record;
+    bool found = false;
+    ret = rmw_implementation_capture_reader_next(&reader, &record, &found);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_TRUE(found);
+    EXPECT_EQ(direction, record.direction);
+    EXPECT_STREQ(topic_name, record.topic_name);
+    ASSERT_EQ(published_message.buffer_length, record.serialized_message.buffer_length);
+    EXPECT_EQ(
+      0, memcmp(
+        published_message.buffer, record.serialized_message.buffer,
+        published_message.buffer_length));
+  }
+  rmw_implementation_capture_stats_t stats;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_capture_get_stats(&stats));
+  EXPECT_EQ(2u, stats.record_count);
+  EXPECT_EQ(0u, stats.dropped_count);
+}
+
+TEST_F(CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION), capture_with_thread_buffer_sizes) {
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    rmw_ret_t ret = rmw_destroy_publisher(node, pub);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+
+  rcutils_allocator_t default_allocator = rcutils_get_default_allocator();
+  test_msgs__msg__BasicTypes message{};
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&message));
+  rmw_serialized_message_t serialized_message = rmw_get_zero_initialized_serialized_message();
+  rmw_ret_t ret = rmw_serialized_message_init(&serialized_message, 0lu, &default_allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&serialized_message));
+  });
+  ret = rmw_serialize(&message, ts, &serialized_message);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  // buffers of threads that captured before follow the size of each capture
+  constexpr char capture_file_path[] = "test_subscription_capture_sizes.rmwcap";
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_capture_disable());
+    std::remove(capture_file_path);
+  });
+  const size_t thread_buffer_sizes[] = {16u, 64u * 1024u};
+  for (size_t thread_buffer_size : thread_buffer_sizes) {
+    rmw_implementation_capture_options_t options =
+      rmw_implementation_get_default_capture_options();
+    options.thread_buffer_size = thread_buffer_size;
+    ret = rmw_implementation_capture_enable(capture_file_path, &options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    rmw_publisher_allocation_t * null_publisher_allocation{nullptr};  // still valid allocation
+    ret = rmw_publish_serialized_message(pub, &serialized_message, null_publisher_allocation);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_EQ(RMW_RET_OK, rmw_implementation_capture_disable()) << rmw_get_error_string().str;
+
+    rmw_implementation_capture_stats_t stats;
+    ASSERT_EQ(RMW_RET_OK, rmw_implementation_capture_get_stats(&stats));
+    const bool fits = thread_buffer_size > serialized_message.buffer_length;
+    EXPECT_EQ(fits ? 1u : 0u, stats.record_count) << thread_buffer_size;
+    EXPECT_EQ(fits ? 0u : 1u, stats.dropped_count) << thread_buffer_size;
+  }
+}
+
+TEST_F(CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION), inject_reordering) {
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  rmw_publisher_t * pub = rmw_create_publisher(node, ts, topic_name, &qos_profile, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    rmw_ret_t ret = rmw_destroy_publisher(node, pub);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+  rmw_ret_t ret = rmw_implementation_wait_for_matched_subscriptions(
+    node, pub, 1u, &rmw_intraprocess_discovery_timeout);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  rcutils_allocator_t default_allocator = rcutils_get_default_allocator();
+  rmw_serialized_message_t published_messages[2];
+  for (rmw_serialized_message_t & published_message : published_messages) {
+    published_message = rmw_get_zero_initialized_serialized_message();
+    ret = rmw_serialized_message_init(&published_message, 0lu, &default_allocator);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+  rmw_serialized_message_t taken_message = rmw_get_zero_initialized_serialized_message();
+  ret = rmw_serialized_message_init(&taken_message, 0lu, &default_allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    for (rmw_serialized_message_t & published_message : published_messages) {
+      EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&published_message));
+    }
+    EXPECT_EQ(RMW_RET_OK, rmw_serialized_message_fini(&taken_message));
+  });
+  for (int32_t i = 0; i < 2; ++i) {
+    test_msgs__msg__BasicTypes message{};
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&message));
+    message.int32_value = i;
+    ret = rmw_serialize(&message, ts, &published_messages[i]);
+    test_msgs__msg__BasicTypes__fini(&message);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  rmw_implementation_injection_t injection = rmw_implementation_get_zero_initialized_injection();
+  injection.reorder_probability = 1.0;
+  ret = rmw_implementation_injection_set(topic_name, &injection);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_reset_stats());
+  ret = rmw_implementation_injection_enable(0u);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_disable());
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_injection_clear());
+  });
+  rmw_publisher_allocation_t * null_publisher_allocation{nullptr};  // still valid allocation
+  for (const rmw_serialized_message_t & published_message : published_messages) {
+    ret = rmw_publish_serialized_message(pub, &published_message, null_publisher_allocation);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+  rmw_implementation_injection_stats_t stats;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_injection_get_stats(&stats));
+  EXPECT_EQ(1u, stats.reordered_count);
+
+  rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, 1u);
+  ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set)) << rmw_get_error_string().str;
+  });
+  // The first message is held back, then published right after the second one
+  for (size_t i : {1u, 0u}) {
+    void * subscriptions_storage[1] = {sub->data};
+    rmw_subscriptions_t subscriptions{1u, subscriptions_storage};
+    ret = rmw_wait(
+      &subscriptions, nullptr, nullptr, nullptr, nullptr, wait_set,
+      &rmw_intraprocess_discovery_timeout);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    bool taken = false;
+    rmw_subscription_allocation_t * null_allocation{nullptr};  // still valid allocation
+    ret = rmw_take_serialized_message(sub, &taken_message, &taken, null_allocation);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ASSERT_TRUE(taken);
+    ASSERT_EQ(published_messages[i].buffer_length, taken_message.buffer_length);
+    EXPECT_EQ(
+      0, memcmp(
+        published_messages[i].buffer, taken_message.buffer, taken_message.buffer_length));
+  }
+}
+
 class CLASSNAME (TestSubscriptionUseLoan, RMW_IMPLEMENTATION)
   : public CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION)
 {
@@ -22,8 +22,11 @@
 #include "rmw/error_handling.h"
 #include "rmw/rmw.h"
 
+#include "rmw_implementation/gid.h"
+
 #include "test_msgs/msg/basic_types.h"
 
+#include "./isolation.hpp"
 
 #ifdef RMW_IMPLEMENTATION
 # define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
@@ -47,6 +50,8 @@ protected:
     });
     init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", init_options.enclave);
+    ret = isolate_init_options(&init_options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     ret = rmw_init(&init_options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     constexpr char node_name[] = "my_test_node";
@@ -221,3 +226,44 @@ TEST_F(CLASSNAME(TestUniqueIdentifiersForMultiplePublishers, RMW_IMPLEMENTATION)
   EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
   EXPECT_FALSE(are_equal);
 }
+
+TEST_F(CLASSNAME(TestUniqueIdentifiersForMultiplePublishers, RMW_IMPLEMENTATION), gid_set) {
+  rmw_publisher_t * pubs[] = {pub_for_topic0, first_pub_for_topic1, second_pub_for_topic1};
+  rmw_gid_t gids[3];
+  for (size_t i = 0u; i < 3u; ++i) {
+    rmw_ret_t ret = rmw_get_gid_for_publisher(pubs[i], &gids[i]);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+  // GIDs compare as with rmw_compare_gids_equal()
+  for (const rmw_gid_t & lhs : gids) {
+    for (const rmw_gid_t & rhs : gids) {
+      bool are_equal = false;
+      rmw_ret_t ret = rmw_compare_gids_equal(&lhs, &rhs, &are_equal);
+      ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+      EXPECT_EQ(are_equal, rmw_implementation_gid_equal(&lhs, &rhs));
+    }
+  }
+
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  rmw_implementation_gid_set_t set = rmw_implementation_get_zero_initialized_gid_set();
+  rmw_ret_t ret = rmw_implementation_gid_set_init(&set, &allocator);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_fini(&set));
+  });
+  ret = rmw_implementation_gid_set_insert(&set, &gids[0], nullptr);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = rmw_implementation_gid_set_insert(&set, &gids[1], nullptr);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(2u, set.size);
+
+  rmw_gid_t gid{};
+  ret = rmw_get_gid_for_publisher(first_pub_for_topic1, &gid);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  bool contains = false;
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_contains(&set, &gid, &contains));
+  EXPECT_TRUE(contains);
+  EXPECT_EQ(RMW_RET_OK, rmw_implementation_gid_set_contains(&set, &gids[2], &contains));
+  EXPECT_FALSE(contains);
+}
@@ -14,6 +14,11 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "osrf_testing_tools_cpp/scope_exit.hpp"
 
 #include "rcutils/allocator.h"
@@ -24,9 +29,13 @@
 #include "rmw/error_handling.h"
 #include "rmw/event.h"
 
+#include "rmw_implementation/wait_timing.h"
+
 #include "test_msgs/msg/basic_types.h"
 #include "test_msgs/srv/basic_types.h"
 
+#include "./isolation.hpp"
+
 #ifdef RMW_IMPLEMENTATION
 # define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
 # define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
@@ -49,6 +58,8 @@ protected:
     });
     options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
     ASSERT_STREQ("/", options.enclave);
+    ret = isolate_init_options(&options);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
     context = rmw_get_zero_initialized_context();
     ret = rmw_init(&options, &context);
     ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
@@ -390,6 +401,153 @@ TEST_F(CLASSNAME(TestWaitSetUse, RMW_IMPLEMENTATION), rmw_wait)
   });
 }
 
+TEST_F(CLASSNAME(TestWaitSetUse, RMW_IMPLEMENTATION), rmw_wait_with_many_entities)
+{
+  constexpr size_t number_of_subscriptions = 200u;
+  constexpr size_t number_of_guard_conditions = 2000u;
+  constexpr size_t triggered_guard_conditions[] = {0u, 1000u, number_of_guard_conditions - 1u};
+
+  std::vector<rmw_subscription_t *> subscriptions;
+  std::vector<rmw_guard_condition_t *> guard_conditions;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    for (rmw_guard_condition_t * guard_condition : guard_conditions) {
+      rmw_ret_t ret = rmw_destroy_guard_condition(guard_condition);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+    for (rmw_subscription_t * subscription : subscriptions) {
+      rmw_ret_t ret = rmw_destroy_subscription(node, subscription);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    }
+  });
+  constexpr char topic_name[] = "/test_many_entities";
+  const rosidl_message_type_support_t * message_ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  for (size_t i = 0u; i < number_of_subscriptions; ++i) {
+    rmw_subscription_t * subscription = rmw_create_subscription(
+      node, message_ts, topic_name, &rmw_qos_profile_default, &sub_options);
+    ASSERT_NE(nullptr, subscription) << rmw_get_error_string().str;
+    subscriptions.push_back(subscription);
+  }
+  for (size_t i = 0u; i < number_of_guard_conditions; ++i) {
+    rmw_guard_condition_t * guard_condition = rmw_create_guard_condition(&context);
+    ASSERT_NE(nullptr, guard_condition) << rmw_get_error_string().str;
+    guard_conditions.push_back(guard_condition);
+  }
+
+  rmw_wait_set_t * wait_set =
+    rmw_create_wait_set(&context, number_of_subscriptions + number_of_guard_conditions);
+  ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    rmw_ret_t ret = rmw_destroy_wait_set(wait_set);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+
+  std::vector<void *> subscriptions_storage(number_of_subscriptions);
+  std::vector<void *> guard_conditions_storage(number_of_guard_conditions);
+  rmw_subscriptions_t subscriptions_argument{
+    subscriptions_storage.size(), subscriptions_storage.data()};
+  rmw_guard_conditions_t guard_conditions_argument{
+    guard_conditions_storage.size(), guard_conditions_storage.data()};
+  auto fill_arrays = [&]() {
+      for (size_t i = 0u; i < number_of_subscriptions; ++i) {
+        subscriptions_storage[i] = subscriptions[i]->data;
+      }
+      for (size_t i = 0u; i < number_of_guard_conditions; ++i) {
+        guard_conditions_storage[i] = guard_conditions[i]->data;
+      }
+    };
+
+  for (size_t index : triggered_guard_conditions) {
+    rmw_ret_t ret = rmw_trigger_guard_condition(guard_conditions[index]);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+  rmw_time_t timeout_argument = {1, 0};
+  fill_arrays();
+  rmw_ret_t ret = rmw_wait(
+    &subscriptions_argument, &guard_conditions_argument, nullptr, nullptr, nullptr, wait_set,
+    &timeout_argument);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  // Only triggered entities are left
+  for (size_t i = 0u; i < number_of_subscriptions; ++i) {
+    EXPECT_EQ(nullptr, subscriptions_storage[i]) << "subscription " << i;
+  }
+  size_t ready_guard_conditions = 0u;
+  for (size_t i = 0u; i < number_of_guard_conditions; ++i) {
+    if (nullptr != guard_conditions_storage[i]) {
+      EXPECT_EQ(guard_conditions[i]->data, guard_conditions_storage[i]) << "guard condition " << i;
+      ++ready_guard_conditions;
+    }
+  }
+  EXPECT_EQ(sizeof(triggered_guard_conditions) / sizeof(size_t), ready_guard_conditions);
+  for (size_t index : triggered_guard_conditions) {
+    EXPECT_NE(nullptr, guard_conditions_storage[index]) << "guard condition " << index;
+  }
+
+  // Triggers were consumed by waiting
+  rmw_time_t timeout_argument_zero = {0, 0};
+  fill_arrays();
+  ret = rmw_wait(
+    &subscriptions_argument, &guard_conditions_argument, nullptr, nullptr, nullptr, wait_set,
+    &timeout_argument_zero);
+  EXPECT_EQ(RMW_RET_TIMEOUT, ret) << rmw_get_error_string().str;
+  rmw_reset_error();
+  for (size_t i = 0u; i < number_of_guard_conditions; ++i) {
+    EXPECT_EQ(nullptr, guard_conditions_storage[i]) << "guard condition " << i;
+  }
+}
+
+TEST_F(CLASSNAME(TestWaitSetUse, RMW_IMPLEMENTATION), rmw_wait_wakeup_latency)
+{
+  rmw_wait_set_t * wait_set = rmw_create_wait_set(&context, 1u);
+  ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    rmw_ret_t ret = rmw_destroy_wait_set(wait_set);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  });
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_reset());
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_enable()) << rmw_get_error_string().str;
+  OSRF_TESTING_TOOLS_CPP_SCOPE_EXIT(
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_disable());
+  });
+
+  constexpr size_t iterations = 10u;
+  for (size_t i = 0u; i < iterations; ++i) {
+    std::thread trigger_thread(
+      [this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        EXPECT_EQ(RMW_RET_OK, rmw_trigger_guard_condition(gc));
+      });
+    rmw_guard_conditions_t guard_conditions;
+    INITIALIZE_ARRAY(guard_conditions, guard_condition, 1u);
+    guard_conditions.guard_conditions[0] = gc->data;
+    rmw_time_t timeout_argument = {1, 0};
+    rmw_ret_t ret = rmw_wait(
+      nullptr, &guard_conditions, nullptr, nullptr, nullptr, wait_set, &timeout_argument);
+    trigger_thread.join();
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    EXPECT_EQ(gc->data, guard_conditions.guard_conditions[0]);
+  }
+
+  rmw_implementation_wait_timing_t timing;
+  ASSERT_EQ(RMW_RET_OK, rmw_implementation_wait_timing_snapshot(&timing));
+  EXPECT_EQ(iterations, timing.wait_count);
+  // Guard conditions are mostly triggered while waiting on them, though some
+  // triggers may come before waiting does on a loaded machine
+  EXPECT_GT(timing.wakeup_count, 0u);
+  EXPECT_LE(timing.wakeup_count, iterations);
+  EXPECT_LE(timing.total_wakeup_latency_ns, timing.total_wait_duration_ns);
+  if (timing.wakeup_count > 0u) {
+    RecordProperty(
+      "mean_wakeup_latency_ns",
+      std::to_string(timing.total_wakeup_latency_ns / timing.wakeup_count));
+  }
+}
+
 TEST_F(CLASSNAME(TestWaitSet, RMW_IMPLEMENTATION), rmw_destroy_wait_set)
 {
   // Try to destroy a nullptr